@@ -19,8 +19,14 @@
     #define __ERRORCODES_H
     
     typedef enum {
-        NO_ERROR,           ///< No error generated
-        ERROR               ///< Error generated
+        NO_ERROR,               ///< No error generated
+        ERROR,                  ///< Error generated
+        ERROR_ADDRESS_NAK,      ///< Device did not acknowledge its address
+        ERROR_DATA_NAK,         ///< Device did not acknowledge a data byte
+        ERROR_ARBITRATION_LOST, ///< Another master or a stuck line took the bus
+        ERROR_TIMEOUT,          ///< Operation not completed before its deadline
+        ERROR_BUS_BUSY,         ///< Bus never became free before the deadline
+        ERROR_CODE_COUNT        ///< Number of error codes, not an error
     } ErrorCode;
 
 #endif
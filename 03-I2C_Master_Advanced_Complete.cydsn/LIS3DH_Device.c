@@ -0,0 +1,203 @@
+/*
+* This file includes the source code to handle
+* each LIS3DH connected to the I2C bus.
+*/
+
+#include "LIS3DH_Device.h"
+
+    void LIS3DH_Device_Init(LIS3DH_Device* device,
+                            uint8_t address,
+                            const LIS3DH_Profile* profile)
+    {
+        device->address = address;
+        device->profile = profile;
+        device->pending = 0;
+        device->data_ready = 0;
+        device->sample_count = 0;
+        device->failure_count = 0;
+        LIS3DH_Cache_Reset(&device->cache, address);
+
+        for (uint8_t i = 0; i < REGISTER_PLAN_MAX_BURSTS; i++)
+        {
+            device->transfers[i].state = I2C_TRANSFER_IDLE;
+        }
+        device->drain.transfer.state = I2C_TRANSFER_IDLE;
+        device->drain.state = LIS3DH_FIFO_DRAIN_IDLE;
+        for (uint8_t i = 0; i < REGISTER_PLAN_IMAGE_SIZE; i++)
+        {
+            device->image[i] = 0;
+        }
+        LIS3DH_Device_SetDataReady(device, 0);
+    }
+
+    void LIS3DH_Device_SetDataReady(LIS3DH_Device* device, uint8_t enabled)
+    {
+        device->data_ready = enabled;
+
+        // The status register is followed by the output registers, so the
+        // two reads are merged into a single auto-increment burst; it is
+        // not needed when the data-ready signal tells that data is there
+        RegisterPlan_Clear(&device->plan);
+        if (!enabled)
+        {
+            RegisterPlan_Add(&device->plan, LIS3DH_STATUS_REG, 1);
+        }
+        RegisterPlan_Add(&device->plan, LIS3DH_OUT_X_L, 6);
+        RegisterPlan_Coalesce(&device->plan, REGISTER_PLAN_DEFAULT_GAP);
+    }
+
+    ErrorCode LIS3DH_Device_Identify(const LIS3DH_Device* device)
+    {
+        uint8_t who_am_i_reg;
+        ErrorCode error = I2C_Peripheral_ReadRegister(device->address,
+                                                      LIS3DH_WHO_AM_I_REG_ADDR,
+                                                      &who_am_i_reg);
+        if (error != NO_ERROR)
+        {
+            return error;
+        }
+        return (who_am_i_reg == LIS3DH_WHO_AM_I_VALUE) ? NO_ERROR : ERROR;
+    }
+
+    ErrorCode LIS3DH_Device_Configure(LIS3DH_Device* device)
+    {
+        ErrorCode error = LIS3DH_Cache_Init(&device->cache, device->address);
+        if (error != NO_ERROR)
+        {
+            return error;
+        }
+        return LIS3DH_Profile_Apply(&device->cache, device->profile);
+    }
+
+    ErrorCode LIS3DH_Device_Resume(LIS3DH_Device* device,
+                                   const LIS3DH_RegisterImage* image)
+    {
+        ErrorCode error = LIS3DH_Profile_Verify(device->address, image);
+        if (error != NO_ERROR)
+        {
+            return error;
+        }
+
+        // The registers have just been verified, no need to read them again
+        LIS3DH_Device_Adopt(device, image);
+        return NO_ERROR;
+    }
+
+    void LIS3DH_Device_Adopt(LIS3DH_Device* device,
+                             const LIS3DH_RegisterImage* image)
+    {
+        LIS3DH_Cache_Reset(&device->cache, device->address);
+        LIS3DH_Profile_Sync(&device->cache, image);
+    }
+
+    ErrorCode LIS3DH_Device_SubmitSample(LIS3DH_Device* device)
+    {
+        if (device->pending)
+        {
+            return ERROR;
+        }
+
+        ErrorCode error = RegisterPlan_Submit(&device->plan, device->address,
+                                              device->image, device->transfers);
+        if (error == NO_ERROR)
+        {
+            device->pending = 1;
+        }
+        return error;
+    }
+
+    uint8_t LIS3DH_Device_IsSampleComplete(LIS3DH_Device* device, ErrorCode* error)
+    {
+        if (!device->pending ||
+            !RegisterPlan_IsComplete(&device->plan, device->transfers, error))
+        {
+            return 0;
+        }
+
+        device->pending = 0;
+        if (*error == NO_ERROR)
+        {
+            device->sample_count++;
+        }
+        else
+        {
+            device->failure_count++;
+        }
+        return 1;
+    }
+
+    uint8_t LIS3DH_Device_HasNewData(const LIS3DH_Device* device)
+    {
+        // Reading the output registers clears the data-ready signal, so each
+        // sample read on the signal is a new one
+        if (device->data_ready)
+        {
+            return 1;
+        }
+        return (device->image[LIS3DH_STATUS_REG] & LIS3DH_STATUS_ZYXDA) != 0;
+    }
+
+    void LIS3DH_Device_GetRaw(const LIS3DH_Device* device, int16_t* xyz)
+    {
+        const uint8_t* data = &device->image[LIS3DH_OUT_X_L];
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            xyz[i] = (int16_t)(data[2*i] | (data[2*i+1] << 8));
+        }
+    }
+
+    void LIS3DH_Device_GetMilliG(const LIS3DH_Device* device, int32_t* xyz)
+    {
+        const LIS3DH_Format* format = LIS3DH_Profile_Format(device->profile);
+        int16_t raw[3];
+        LIS3DH_Device_GetRaw(device, raw);
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            xyz[i] = LIS3DH_Format_ToMilliG(format, raw[i]);
+        }
+    }
+
+    ErrorCode LIS3DH_Device_ReadFifo(const LIS3DH_Device* device,
+                                     uint8_t min_level,
+                                     LIS3DH_FifoBatch* batch)
+    {
+        return LIS3DH_Fifo_Drain(device->address, min_level, batch);
+    }
+
+    ErrorCode LIS3DH_Device_SubmitFifo(LIS3DH_Device* device,
+                                       uint8_t min_level,
+                                       LIS3DH_FifoBatch* batch)
+    {
+        return LIS3DH_Fifo_SubmitDrain(&device->drain, device->address, min_level, batch);
+    }
+
+    uint8_t LIS3DH_Device_IsFifoComplete(LIS3DH_Device* device, ErrorCode* error)
+    {
+        return LIS3DH_Fifo_IsDrainComplete(&device->drain, error);
+    }
+
+    ErrorCode LIS3DH_Device_ReadAdc(const LIS3DH_Device* device,
+                                    uint8_t channel,
+                                    int16_t* value)
+    {
+        if (channel < 1 || channel > 3)
+        {
+            return ERROR;
+        }
+
+        // Each channel is a pair of registers after OUT_ADC1, read with one burst
+        uint8_t data[2];
+        ErrorCode error = I2C_Peripheral_ReadRegisterMulti(device->address,
+                                                           LIS3DH_OUT_ADC_1L + 2 * (channel - 1),
+                                                           2,
+                                                           data);
+        if (error != NO_ERROR)
+        {
+            return error;
+        }
+        *value = LIS3DH_Format_AlignAdc(LIS3DH_Profile_Format(device->profile),
+                                        data[0] | (data[1] << 8));
+        return NO_ERROR;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,118 @@
+/** 
+ * \file LIS3DH_Fifo.h
+ * \brief Batch reads of the LIS3DH FIFO.
+ *
+ * When the FIFO is enabled, the register pointer of an auto-increment
+ * read rolls back from OUT_Z_H to OUT_X_L, so a single burst starting at
+ * OUT_X_L returns as many XYZ samples as it is long. The FIFO level is
+ * read from FIFO_SRC_REG first, so that no sample is read twice.
+*/
+
+#ifndef LIS3DH_Fifo_H
+    #define LIS3DH_Fifo_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "I2C_Interface.h"
+    #include "LIS3DH_Registers.h"
+    
+    /**
+    *   \brief Number of samples held by the FIFO.
+    */
+    #define LIS3DH_FIFO_DEPTH 32
+    
+    /**
+    *   \brief Number of bytes of one XYZ sample.
+    */
+    #define LIS3DH_FIFO_SAMPLE_SIZE 6
+    
+    /**
+    *   \brief Samples read from the FIFO with one burst.
+    */
+    typedef struct {
+        uint8_t data[LIS3DH_FIFO_DEPTH * LIS3DH_FIFO_SAMPLE_SIZE]; ///< Output registers of each sample
+        uint8_t count;                                          ///< Number of samples read
+        uint8_t overrun;                                        ///< True if samples were lost before the batch
+    } LIS3DH_FifoBatch;
+    
+    /**
+    *   \brief Phase of an asynchronous FIFO read.
+    */
+    typedef enum {
+        LIS3DH_FIFO_DRAIN_IDLE,         ///< No read in progress
+        LIS3DH_FIFO_DRAIN_LEVEL,        ///< FIFO_SRC_REG being read
+        LIS3DH_FIFO_DRAIN_DATA          ///< Samples being read
+    } LIS3DH_FifoDrainState;
+    
+    /**
+    *   \brief Asynchronous read of the FIFO, on the transfer queue.
+    */
+    typedef struct {
+        I2C_Transfer transfer;          ///< Transfer of the current phase
+        uint8_t fifo_src;               ///< Value of FIFO_SRC_REG
+        uint8_t min_level;              ///< Minimum number of samples to be read
+        LIS3DH_FifoBatch* batch;        ///< Batch being filled
+        LIS3DH_FifoDrainState state;    ///< Current phase
+    } LIS3DH_FifoDrain;
+    
+    /**
+    *   \brief Get the number of samples stored in the FIFO.
+    *
+    *   \param fifo_src Value of FIFO_SRC_REG.
+    *   \retval Number of unread samples, LIS3DH_FIFO_DEPTH if the FIFO is full.
+    */
+    uint8_t LIS3DH_Fifo_Level(uint8_t fifo_src);
+    
+    /**
+    *   \brief Read all the samples stored in the FIFO.
+    *
+    *   FIFO_SRC_REG is read first; if the FIFO holds at least min_level
+    *   samples, all of them are read with a single burst of up to 192 bytes,
+    *   otherwise the batch is left empty.
+    *   \param device_address I2C address of the device.
+    *   \param min_level Minimum number of samples to be read.
+    *   \param batch Pointer to the batch to be filled.
+    */
+    ErrorCode LIS3DH_Fifo_Drain(uint8_t device_address,
+                                uint8_t min_level,
+                                LIS3DH_FifoBatch* batch);
+    
+    /**
+    *   \brief Start the asynchronous read of the samples stored in the FIFO.
+    *
+    *   Same as LIS3DH_Fifo_Drain, but the two reads go through the transfer
+    *   queue and the function returns immediately.
+    *   \param drain Pointer to the state of the read.
+    *   \param device_address I2C address of the device.
+    *   \param min_level Minimum number of samples to be read.
+    *   \param batch Pointer to the batch to be filled, valid until the read is completed.
+    *   \retval ERROR if a read is already in progress or cannot be queued.
+    */
+    ErrorCode LIS3DH_Fifo_SubmitDrain(LIS3DH_FifoDrain* drain,
+                                      uint8_t device_address,
+                                      uint8_t min_level,
+                                      LIS3DH_FifoBatch* batch);
+    
+    /**
+    *   \brief Move an asynchronous FIFO read forward.
+    *
+    *   Once FIFO_SRC_REG is read, the burst of samples is queued; this
+    *   function must be called from the main loop until it returns true.
+    *   \param drain Pointer to the state of the read.
+    *   \param error Pointer to a variable where the result is saved.
+    *   \retval Returns true (>0) the first time the read is found completed.
+    */
+    uint8_t LIS3DH_Fifo_IsDrainComplete(LIS3DH_FifoDrain* drain, ErrorCode* error);
+    
+    /**
+    *   \brief Get one sample of a batch.
+    *
+    *   The values are left-justified as in the output registers.
+    *   \param batch Pointer to the batch.
+    *   \param index Index of the sample, 0 is the oldest one.
+    *   \param xyz Array where the values of the three axes are saved.
+    */
+    void LIS3DH_Fifo_GetSample(const LIS3DH_FifoBatch* batch, uint8_t index, int16_t* xyz);
+    
+#endif // LIS3DH_Fifo_H
+/* [] END OF FILE */
@@ -0,0 +1,176 @@
+/*
+* This file includes the source code of the shadow copy
+* of the LIS3DH configuration registers.
+*/
+
+#include "LIS3DH_RegisterCache.h"
+#include "I2C_Interface.h"
+#include "RegisterPlan.h"
+
+/**
+*   \brief Bit mask of the cached registers, bit 0 is LIS3DH_CACHE_FIRST.
+*
+*   Source registers are left out since reading them clears the
+*   latched interrupts, and the status and output registers change
+*   on their own.
+*/
+#define LIS3DH_CACHE_MASK ((0x7Ful << (LIS3DH_TEMP_CFG_REG - LIS3DH_CACHE_FIRST)) | \
+                           (0x01ul << (LIS3DH_FIFO_CTRL_REG - LIS3DH_CACHE_FIRST)) | \
+                           (0x01ul << (LIS3DH_INT1_CFG - LIS3DH_CACHE_FIRST)) | \
+                           (0x07ul << (LIS3DH_INT1_THS - LIS3DH_CACHE_FIRST)) | \
+                           (0x03ul << (LIS3DH_INT2_THS - LIS3DH_CACHE_FIRST)))
+
+    uint8_t LIS3DH_Cache_IsCached(uint8_t register_address)
+    {
+        if (register_address < LIS3DH_CACHE_FIRST ||
+            register_address >= LIS3DH_CACHE_FIRST + LIS3DH_CACHE_SIZE)
+        {
+            return 0;
+        }
+        return (LIS3DH_CACHE_MASK >> (register_address - LIS3DH_CACHE_FIRST)) & 1;
+    }
+    
+    void LIS3DH_Cache_Reset(LIS3DH_RegisterCache* cache, uint8_t device_address)
+    {
+        cache->device_address = device_address;
+        cache->dirty = 0;
+        for (uint8_t i = 0; i < LIS3DH_CACHE_SIZE; i++)
+        {
+            cache->values[i] = 0x00;
+        }
+        cache->values[LIS3DH_CTRL_REG1 - LIS3DH_CACHE_FIRST] = LIS3DH_CTRL_REG1_DEFAULT;
+    }
+    
+    ErrorCode LIS3DH_Cache_Init(LIS3DH_RegisterCache* cache, uint8_t device_address)
+    {
+        // Start from the power-on values, used if the device cannot be read
+        LIS3DH_Cache_Reset(cache, device_address);
+        
+        // Read each group of consecutive cached registers with one burst
+        RegisterPlan plan;
+        RegisterPlan_Clear(&plan);
+        uint8_t index = 0;
+        while (index < LIS3DH_CACHE_SIZE)
+        {
+            if (!LIS3DH_Cache_IsCached(LIS3DH_CACHE_FIRST + index))
+            {
+                index++;
+                continue;
+            }
+            uint8_t first = index;
+            while (index < LIS3DH_CACHE_SIZE && LIS3DH_Cache_IsCached(LIS3DH_CACHE_FIRST + index))
+            {
+                index++;
+            }
+            RegisterPlan_Add(&plan, LIS3DH_CACHE_FIRST + first, index - first);
+        }
+        
+        uint8_t image[REGISTER_PLAN_IMAGE_SIZE];
+        ErrorCode error = RegisterPlan_Execute(&plan, device_address, image);
+        if (error == NO_ERROR)
+        {
+            for (uint8_t i = 0; i < LIS3DH_CACHE_SIZE; i++)
+            {
+                cache->values[i] = image[LIS3DH_CACHE_FIRST + i];
+            }
+        }
+        return error;
+    }
+    
+    ErrorCode LIS3DH_Cache_Read(const LIS3DH_RegisterCache* cache,
+                                uint8_t register_address,
+                                uint8_t* data)
+    {
+        if (!LIS3DH_Cache_IsCached(register_address))
+        {
+            return ERROR;
+        }
+        *data = cache->values[register_address - LIS3DH_CACHE_FIRST];
+        return NO_ERROR;
+    }
+    
+    ErrorCode LIS3DH_Cache_Write(LIS3DH_RegisterCache* cache,
+                                 uint8_t register_address,
+                                 uint8_t data)
+    {
+        if (!LIS3DH_Cache_IsCached(register_address))
+        {
+            return ERROR;
+        }
+        uint8_t index = register_address - LIS3DH_CACHE_FIRST;
+        if (cache->values[index] != data)
+        {
+            cache->values[index] = data;
+            cache->dirty |= 1ul << index;
+        }
+        return NO_ERROR;
+    }
+    
+    ErrorCode LIS3DH_Cache_Sync(LIS3DH_RegisterCache* cache,
+                                uint8_t register_address,
+                                uint8_t data)
+    {
+        if (!LIS3DH_Cache_IsCached(register_address))
+        {
+            return ERROR;
+        }
+        uint8_t index = register_address - LIS3DH_CACHE_FIRST;
+        cache->values[index] = data;
+        cache->dirty &= ~(1ul << index);
+        return NO_ERROR;
+    }
+    
+    ErrorCode LIS3DH_Cache_Flush(LIS3DH_RegisterCache* cache, uint8_t* burst_count)
+    {
+        uint8_t bursts = 0;
+        uint8_t index = 0;
+        
+        while (cache->dirty != 0 && index < LIS3DH_CACHE_SIZE)
+        {
+            // Look for the next dirty register
+            if (!((cache->dirty >> index) & 1))
+            {
+                index++;
+                continue;
+            }
+            
+            // Extend the burst over the following cached registers, up to the last dirty one
+            uint8_t first = index;
+            uint8_t last = index;
+            while (index < LIS3DH_CACHE_SIZE && LIS3DH_Cache_IsCached(LIS3DH_CACHE_FIRST + index))
+            {
+                if ((cache->dirty >> index) & 1)
+                {
+                    last = index;
+                }
+                index++;
+            }
+            
+            ErrorCode error = I2C_Peripheral_WriteRegisterMulti(cache->device_address,
+                                                               LIS3DH_CACHE_FIRST + first,
+                                                               last - first + 1,
+                                                               &cache->values[first]);
+            bursts++;
+            if (error != NO_ERROR)
+            {
+                // Keep the registers dirty so that the flush can be repeated
+                if (burst_count != NULL)
+                {
+                    *burst_count = bursts;
+                }
+                return error;
+            }
+            for (uint8_t i = first; i <= last; i++)
+            {
+                cache->dirty &= ~(1ul << i);
+            }
+        }
+        
+        if (burst_count != NULL)
+        {
+            *burst_count = bursts;
+        }
+        return NO_ERROR;
+    }
+
+/* [] END OF FILE */
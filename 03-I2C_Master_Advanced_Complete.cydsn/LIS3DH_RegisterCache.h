@@ -0,0 +1,119 @@
+/** 
+ * \file LIS3DH_RegisterCache.h
+ * \brief Write-through shadow copy of the LIS3DH configuration registers.
+ *
+ * The configuration registers (TEMP_CFG_REG, CTRL_REG1..CTRL_REG6,
+ * FIFO_CTRL_REG and the interrupt configuration) are read once and kept
+ * in RAM. Reads are served from the copy, writes only mark the register
+ * as dirty, and all the changes are sent to the device by a flush with
+ * one multi-register burst per group of consecutive registers.
+*/
+
+#ifndef LIS3DH_RegisterCache_H
+    #define LIS3DH_RegisterCache_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH_Registers.h"
+    
+    /**
+    *   \brief Address of the first register covered by the cache.
+    */
+    #define LIS3DH_CACHE_FIRST LIS3DH_TEMP_CFG_REG
+    
+    /**
+    *   \brief Number of register addresses covered by the cache.
+    *
+    *   The window goes from TEMP_CFG_REG to INT2_DURATION; status, output
+    *   and interrupt source registers inside it are not cached.
+    */
+    #define LIS3DH_CACHE_SIZE (LIS3DH_INT2_DURATION - LIS3DH_CACHE_FIRST + 1)
+    
+    /**
+    *   \brief Shadow copy of the configuration registers of one device.
+    */
+    typedef struct {
+        uint8_t device_address;             ///< I2C address of the device
+        uint8_t values[LIS3DH_CACHE_SIZE];  ///< Last known value of each register
+        uint32_t dirty;                     ///< One bit for each register to be written
+    } LIS3DH_RegisterCache;
+    
+    /**
+    *   \brief Set the cache to the power-on values of the registers.
+    *
+    *   No bus operation is performed.
+    *   \param cache Pointer to the cache.
+    *   \param device_address I2C address of the device.
+    */
+    void LIS3DH_Cache_Reset(LIS3DH_RegisterCache* cache, uint8_t device_address);
+    
+    /**
+    *   \brief Load the cache with the registers of the device.
+    *
+    *   \param cache Pointer to the cache.
+    *   \param device_address I2C address of the device.
+    */
+    ErrorCode LIS3DH_Cache_Init(LIS3DH_RegisterCache* cache, uint8_t device_address);
+    
+    /**
+    *   \brief Check if a register is kept in the cache.
+    *
+    *   \param register_address Address of the register.
+    *   \retval Returns true (>0) if the register is cached.
+    */
+    uint8_t LIS3DH_Cache_IsCached(uint8_t register_address);
+    
+    /**
+    *   \brief Read a register from the cache, without any bus operation.
+    *
+    *   \param cache Pointer to the cache.
+    *   \param register_address Address of the register to be read.
+    *   \param data Pointer to a variable where the value will be saved.
+    *   \retval ERROR if the register is not cached.
+    */
+    ErrorCode LIS3DH_Cache_Read(const LIS3DH_RegisterCache* cache,
+                                uint8_t register_address,
+                                uint8_t* data);
+    
+    /**
+    *   \brief Change a register in the cache.
+    *
+    *   The register is marked as dirty only if its value changes, and it is
+    *   sent to the device at the next flush.
+    *   \param cache Pointer to the cache.
+    *   \param register_address Address of the register to be written.
+    *   \param data New value of the register.
+    *   \retval ERROR if the register is not cached.
+    */
+    ErrorCode LIS3DH_Cache_Write(LIS3DH_RegisterCache* cache,
+                                 uint8_t register_address,
+                                 uint8_t data);
+    
+    /**
+    *   \brief Record the value a register is known to hold on the device.
+    *
+    *   Unlike LIS3DH_Cache_Write the register is not marked as dirty, so
+    *   it is not written again. It is used when the device registers have
+    *   been checked by other means.
+    *   \param cache Pointer to the cache.
+    *   \param register_address Address of the register.
+    *   \param data Value held by the device.
+    *   \retval ERROR if the register is not cached.
+    */
+    ErrorCode LIS3DH_Cache_Sync(LIS3DH_RegisterCache* cache,
+                                uint8_t register_address,
+                                uint8_t data);
+    
+    /**
+    *   \brief Send all the changed registers to the device.
+    *
+    *   Dirty registers are grouped with the consecutive cached registers
+    *   around them and written with a single burst per group.
+    *   \param cache Pointer to the cache.
+    *   \param burst_count Pointer to a variable where the number of bursts
+    *          will be saved, can be NULL.
+    */
+    ErrorCode LIS3DH_Cache_Flush(LIS3DH_RegisterCache* cache, uint8_t* burst_count);
+    
+#endif // LIS3DH_RegisterCache_H
+/* [] END OF FILE */
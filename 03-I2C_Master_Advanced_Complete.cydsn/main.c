@@ -11,58 +11,11 @@
 
 // Include required header files
 #include "I2C_Interface.h"
+#include "LIS3DH_Registers.h"
+#include "LIS3DH_Device.h"
 #include "project.h"
 #include "stdio.h"
 
-/**
-*   \brief 7-bit I2C address of the slave device.
-*/
-#define LIS3DH_DEVICE_ADDRESS 0x18
-
-/**
-*   \brief Address of the WHO AM I register
-*/
-#define LIS3DH_WHO_AM_I_REG_ADDR 0x0F
-
-/**
-*   \brief Address of the Status register
-*/
-#define LIS3DH_STATUS_REG 0x27
-
-/**
-*   \brief Address of the Control register 1
-*/
-#define LIS3DH_CTRL_REG1 0x20
-
-/**
-*   \brief Hex value to set normal mode to the accelerator
-*/
-#define LIS3DH_NORMAL_MODE_CTRL_REG1 0x47
-
-/**
-*   \brief  Address of the Temperature Sensor Configuration register
-*/
-#define LIS3DH_TEMP_CFG_REG 0x1F
-
-#define LIS3DH_TEMP_CFG_REG_ACTIVE 0xC0
-
-/**
-*   \brief Address of the Control register 4
-*/
-#define LIS3DH_CTRL_REG4 0x23
-
-#define LIS3DH_CTRL_REG4_BDU_ACTIVE 0x80
-
-/**
-*   \brief Address of the ADC output LSB register
-*/
-#define LIS3DH_OUT_ADC_3L 0x0C
-
-/**
-*   \brief Address of the ADC output MSB register
-*/
-#define LIS3DH_OUT_ADC_3H 0x0D
-
 int main(void)
 {
     CyGlobalIntEnable; /* Enable global interrupts. */
@@ -75,6 +28,11 @@ int main(void)
     
     // String to print out messages on the UART
     char message[50];
+    
+    // Accelerometer with the SA0 pin tied low and its configuration
+    const LIS3DH_Profile* profile = &LIS3DH_Profiles[LIS3DH_PROFILE_NORMAL_50HZ_ADC];
+    LIS3DH_Device Accelerometer;
+    LIS3DH_Device_Init(&Accelerometer, LIS3DH_DEVICE_ADDRESS_SA0_LOW, profile);
 
     // Check which devices are present on the I2C bus
     for (int i = 0 ; i < 128; i++)
@@ -94,7 +52,7 @@ int main(void)
     
     /* Read WHO AM I REGISTER register */
     uint8_t who_am_i_reg;
-    ErrorCode error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+    ErrorCode error = I2C_Peripheral_ReadRegister(Accelerometer.address,
                                                   LIS3DH_WHO_AM_I_REG_ADDR, 
                                                   &who_am_i_reg);
     if (error == NO_ERROR)
@@ -110,7 +68,7 @@ int main(void)
     /*      I2C Reading Status Register       */
     
     uint8_t status_register; 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+    error = I2C_Peripheral_ReadRegister(Accelerometer.address,
                                         LIS3DH_STATUS_REG,
                                         &status_register);
     
@@ -125,21 +83,30 @@ int main(void)
     }
     
     /******************************************/
-    /*        Read Control Register 1         */
+    /*      Read Configuration Registers      */
     /******************************************/
-    uint8_t ctrl_reg1; 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
     
+    // The configuration registers are read once with a few bursts,
+    // then they are served by the shadow copy in RAM
+    error = LIS3DH_Cache_Init(&Accelerometer.cache, Accelerometer.address);
+    
+    uint8_t ctrl_reg1, tmp_cfg_reg, ctrl_reg4;
     if (error == NO_ERROR)
     {
+        LIS3DH_Cache_Read(&Accelerometer.cache, LIS3DH_CTRL_REG1, &ctrl_reg1);
+        LIS3DH_Cache_Read(&Accelerometer.cache, LIS3DH_TEMP_CFG_REG, &tmp_cfg_reg);
+        LIS3DH_Cache_Read(&Accelerometer.cache, LIS3DH_CTRL_REG4, &ctrl_reg4);
+        
         sprintf(message, "CONTROL REGISTER 1: 0x%02X\r\n", ctrl_reg1);
         UART_Debug_PutString(message); 
+        sprintf(message, "TEMPERATURE CONFIG REGISTER: 0x%02X\r\n", tmp_cfg_reg);
+        UART_Debug_PutString(message); 
+        sprintf(message, "CONTROL REGISTER 4: 0x%02X\r\n", ctrl_reg4);
+        UART_Debug_PutString(message); 
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 1\r\n");   
+        UART_Debug_PutString("Error occurred during I2C comm to read control registers\r\n");   
     }
     
     /******************************************/
@@ -149,128 +116,24 @@ int main(void)
         
     UART_Debug_PutString("\r\nWriting new values..\r\n");
     
-    if (ctrl_reg1 != LIS3DH_NORMAL_MODE_CTRL_REG1)
-    {
-        ctrl_reg1 = LIS3DH_NORMAL_MODE_CTRL_REG1;
-    
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                             LIS3DH_CTRL_REG1,
-                                             ctrl_reg1);
-    
-        if (error == NO_ERROR)
-        {
-            sprintf(message, "CONTROL REGISTER 1 successfully written as: 0x%02X\r\n", ctrl_reg1);
-            UART_Debug_PutString(message); 
-        }
-        else
-        {
-            UART_Debug_PutString("Error occurred during I2C comm to set control register 1\r\n");   
-        }
-    }
-    
-    /******************************************/
-    /*     Read Control Register 1 again      */
-    /******************************************/
-
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
+    // The profile is encoded into a register image, the registers that
+    // change are written with a single burst and verified with a read-back
+    error = LIS3DH_Profile_Apply(&Accelerometer.cache, profile);
     
     if (error == NO_ERROR)
     {
-        sprintf(message, "CONTROL REGISTER 1 after overwrite operation: 0x%02X\r\n", ctrl_reg1);
+        sprintf(message, "PROFILE: %s\r\n", profile->name);
         UART_Debug_PutString(message); 
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 1\r\n");   
-    }
-    
-     /******************************************/
-     /* I2C Reading Temperature sensor CFG reg */
-     /******************************************/
-
-    uint8_t tmp_cfg_reg;
-
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_TEMP_CFG_REG,
-                                        &tmp_cfg_reg);
-    
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "TEMPERATURE CONFIG REGISTER: 0x%02X\r\n", tmp_cfg_reg);
-        UART_Debug_PutString(message); 
-    }
-    else
-    {
-        UART_Debug_PutString("Error occurred during I2C comm to read temperature config register\r\n");   
-    }
-    
-    
-    tmp_cfg_reg = LIS3DH_TEMP_CFG_REG_ACTIVE; // must be changed to the appropriate value
-    
-    error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                         LIS3DH_TEMP_CFG_REG,
-                                         tmp_cfg_reg);
-    
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_TEMP_CFG_REG,
-                                        &tmp_cfg_reg);
-    
-    
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "TEMPERATURE CONFIG REGISTER after being updated: 0x%02X\r\n", tmp_cfg_reg);
-        UART_Debug_PutString(message); 
-    }
-    else
-    {
-        UART_Debug_PutString("Error occurred during I2C comm to read temperature config register\r\n");   
-    }
-    
-    uint8_t ctrl_reg4;
-
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4);
-    
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "CONTROL REGISTER 4: 0x%02X\r\n", ctrl_reg4);
-        UART_Debug_PutString(message); 
-    }
-    else
-    {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register4\r\n");   
-    }
-    
-    
-    ctrl_reg4 = LIS3DH_CTRL_REG4_BDU_ACTIVE; // must be changed to the appropriate value
-    
-    error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                         LIS3DH_CTRL_REG4,
-                                         ctrl_reg4);
-    
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4);
-    
-    
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "CONTROL REGISTER 4 after being updated: 0x%02X\r\n", ctrl_reg4);
-        UART_Debug_PutString(message); 
-    }
-    else
-    {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register4\r\n");   
+        UART_Debug_PutString("Error occurred during I2C comm to set control registers\r\n");   
     }
     
     int16_t OutTemp;
     uint8_t header = 0xA0;
     uint8_t footer = 0xC0;
     uint8_t OutArray[4]; 
-    uint8_t TemperatureData[2];
     
     OutArray[0] = header;
     OutArray[3] = footer;
@@ -278,20 +141,10 @@ int main(void)
     for(;;)
     {
         CyDelay(100);
-        error = I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS,
-                                                 LIS3DH_OUT_ADC_3L,
-                                                 2,
-                                                 &TemperatureData[0]);
-        error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                            LIS3DH_OUT_ADC_3L,
-                                            &TemperatureData[0]);
-        
-        error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                            LIS3DH_OUT_ADC_3H,
-                                            &TemperatureData[1]);
+        // The temperature is on ADC channel 3, both registers are read with one burst
+        error = LIS3DH_Device_ReadAdc(&Accelerometer, 3, &OutTemp);
         if(error == NO_ERROR)
         {
-            OutTemp = (int16)((TemperatureData[0] | (TemperatureData[1]<<8)))>>6;
             OutArray[1] = (uint8_t)(OutTemp & 0xFF);
             OutArray[2] = (uint8_t)(OutTemp >> 8);
             UART_Debug_PutArray(OutArray, 4);
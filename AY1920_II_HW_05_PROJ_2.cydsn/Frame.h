@@ -0,0 +1,111 @@
+/** 
+ * \file Frame.h
+ * \brief Framing of the packets sent on the UART.
+ *
+ * Each packet is carried by a frame:
+ *
+ *     0xAA, 0x55, version, sequence, length, check, payload,
+ *     CRC (16 bits, big endian)
+ *
+ * The sequence number grows by one at each frame, so that the receiver
+ * can count the frames lost. The CRC is CRC-16/CCITT-FALSE (polynomial
+ * 0x1021, initial value 0xFFFF) of version, sequence, length and payload,
+ * computed with a 256-entry table: one lookup, a shift and two XORs per
+ * byte. The check byte is the low byte of the same CRC after the length.
+ *
+ * The parser has no dependency on the PSoC, so it can be built on the
+ * host as well. The check byte rejects a false sync pattern as soon as
+ * its header is received, without waiting for the payload length it
+ * announces. When a frame is rejected the parser looks for the next sync
+ * pattern among the bytes already received, starting from the byte after
+ * the rejected sync, so a corruption costs only the frame it hits.
+*/
+
+#ifndef Frame_H
+    #define Frame_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Sync pattern at the start of each frame.
+    */
+    #define FRAME_SYNC_1 0xAA
+    #define FRAME_SYNC_2 0x55
+    
+    /**
+    *   \brief Version of the frame format.
+    */
+    #define FRAME_VERSION 2
+    
+    /**
+    *   \brief Bytes before and after the payload.
+    */
+    #define FRAME_HEADER_SIZE 6
+    #define FRAME_TRAILER_SIZE 2
+    
+    /**
+    *   \brief Longest payload, a full FIFO batch fits.
+    */
+    #define FRAME_MAX_PAYLOAD 200
+    
+    /**
+    *   \brief Initial value of the CRC.
+    */
+    #define FRAME_CRC_INIT 0xFFFF
+    
+    /**
+    *   \brief State of the parser.
+    */
+    typedef struct {
+        uint8_t buffer[FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + FRAME_TRAILER_SIZE]; ///< Bytes received
+        uint16_t length;                ///< Bytes in the buffer
+        uint16_t consumed;              ///< Bytes of the last frame returned
+        uint8_t expected_sequence;      ///< Sequence number of the next frame
+        uint8_t synced;                 ///< True after the first valid frame
+        uint16_t lost;                  ///< Frames missing from the sequence
+        uint16_t rejected;              ///< Frames dropped by the check byte or the CRC
+    } FrameParser;
+    
+    /**
+    *   \brief Update a CRC with a block of bytes.
+    *
+    *   \param crc CRC of the previous bytes, FRAME_CRC_INIT at the start.
+    *   \param data Bytes to be added.
+    *   \param length Number of bytes.
+    */
+    uint16_t Frame_Crc16(uint16_t crc, const uint8_t* data, uint16_t length);
+    
+    /**
+    *   \brief Build the bytes that surround a payload.
+    *
+    *   \param sequence Sequence number of the frame.
+    *   \param payload Bytes of the payload.
+    *   \param length Number of bytes of the payload (at most FRAME_MAX_PAYLOAD).
+    *   \param header Array of FRAME_HEADER_SIZE bytes.
+    *   \param trailer Array of FRAME_TRAILER_SIZE bytes.
+    */
+    void Frame_Encode(uint8_t sequence,
+                      const uint8_t* payload,
+                      uint8_t length,
+                      uint8_t* header,
+                      uint8_t* trailer);
+    
+    /**
+    *   \brief Reset the parser.
+    */
+    void Frame_InitParser(FrameParser* parser);
+    
+    /**
+    *   \brief Parse the next byte of the stream.
+    *
+    *   \param parser Pointer to the parser.
+    *   \param byte Byte received.
+    *   \param payload Pointer set to the payload of a complete frame, valid
+    *   until the next call.
+    *   \param length Pointer to the variable where the payload length is saved.
+    *   \retval Returns true (>0) when a valid frame has been completed.
+    */
+    uint8_t Frame_Parse(FrameParser* parser, uint8_t byte, const uint8_t** payload, uint8_t* length);
+    
+#endif // Frame_H
+/* [] END OF FILE */
@@ -16,6 +16,110 @@
     #include "cytypes.h"
     #include "ErrorCodes.h"
     
+    /**
+    *   \brief Maximum number of data bytes of an asynchronous write transfer.
+    *
+    *   The register address and the data of a write transfer are copied in a
+    *   single buffer, so that they can be sent with one bus operation.
+    */
+    #define I2C_TRANSFER_MAX_WRITE 32
+    
+    /**
+    *   \brief Margin of ticks an asynchronous transfer can stay on the bus.
+    *
+    *   The ticks are counted by I2C_Peripheral_Tick, a transfer that is not
+    *   completed after this many ticks, plus the ones its bytes take on the
+    *   bus at the current data rate, is aborted and the bus is recovered.
+    */
+    #define I2C_TRANSFER_TIMEOUT_TICKS 2
+    
+    /**
+    *   \brief Period of the calls to I2C_Peripheral_Tick, in us.
+    */
+    #define I2C_TICK_PERIOD_US 10000
+    
+    /**
+    *   \brief Fixed part of the deadline of a blocking operation, in us.
+    */
+    #define I2C_TIMEOUT_BASE_US 1000
+    
+    /**
+    *   \brief Deadline added for each byte of a blocking operation, in us.
+    *
+    *   A byte takes 90 us on the bus at 100 kHz.
+    */
+    #define I2C_TIMEOUT_BYTE_US 100
+    
+    /**
+    *   \brief Period with which blocking operations poll the bus, in us.
+    */
+    #define I2C_POLL_PERIOD_US 10
+    
+    /**
+    *   \brief Number of SCL pulses sent to free a device holding SDA low.
+    */
+    #define I2C_BUS_CLEAR_PULSES 9
+    
+    /**
+    *   \brief Standard-mode data rate, in kHz.
+    */
+    #define I2C_DATA_RATE_STANDARD 100
+    
+    /**
+    *   \brief Fast-mode data rate, in kHz.
+    */
+    #define I2C_DATA_RATE_FAST 400
+    
+    /**
+    *   \brief Fast-mode Plus data rate, in kHz.
+    */
+    #define I2C_DATA_RATE_FAST_PLUS 1000
+    
+    /**
+    *   \brief Direction of an asynchronous I2C transfer.
+    */
+    typedef enum {
+        I2C_TRANSFER_READ,          ///< Read registers from the device
+        I2C_TRANSFER_WRITE          ///< Write registers of the device
+    } I2C_TransferDirection;
+    
+    /**
+    *   \brief State of an asynchronous I2C transfer.
+    */
+    typedef enum {
+        I2C_TRANSFER_IDLE,          ///< Transfer not submitted
+        I2C_TRANSFER_PENDING,       ///< Transfer queued, waiting for the bus
+        I2C_TRANSFER_ADDRESSING,    ///< Register address being sent
+        I2C_TRANSFER_DATA,          ///< Data being read from the device
+        I2C_TRANSFER_DONE           ///< Transfer completed, see error field
+    } I2C_TransferState;
+    
+    typedef struct I2C_Transfer I2C_Transfer;
+    
+    /**
+    *   \brief Function called when an asynchronous transfer is completed.
+    */
+    typedef void (*I2C_TransferCallback)(I2C_Transfer* transfer);
+    
+    /**
+    *   \brief Descriptor of an asynchronous I2C transfer.
+    *
+    *   The descriptor is owned by the caller and must stay valid until
+    *   the transfer reaches the I2C_TRANSFER_DONE state.
+    */
+    struct I2C_Transfer {
+        uint8_t device_address;             ///< I2C address of the device
+        uint8_t register_address;           ///< Address of the first register
+        uint8_t register_count;             ///< Number of registers to transfer
+        uint8_t* data;                      ///< Source or destination of the data
+        I2C_TransferDirection direction;    ///< Read or write transfer
+        I2C_TransferCallback callback;      ///< Completion callback, can be NULL
+        void* context;                      ///< User data for the callback
+        volatile I2C_TransferState state;   ///< Current state of the transfer
+        volatile ErrorCode error;           ///< Result, valid once done
+        I2C_Transfer* next;                 ///< Next transfer in the queue
+    };
+    
     /** \brief Start the I2C peripheral.
     *   
     *   This function starts the I2C peripheral so that it is ready to work.
@@ -28,6 +132,27 @@
     */
     ErrorCode I2C_Peripheral_Stop(void);
     
+    /**
+    *   \brief Change the data rate of the I2C bus.
+    *
+    *   This function waits for the queued transfers, then reprograms the
+    *   clock divider of the I2C master. The divider is rounded up, so the
+    *   bus is never faster than requested; the rate set in the schematic is
+    *   used until this function is called. The setting survives a bus
+    *   recovery.
+    *   \param data_rate One of I2C_DATA_RATE_STANDARD, I2C_DATA_RATE_FAST
+    *                    and I2C_DATA_RATE_FAST_PLUS.
+    *   \retval ERROR if the rate is not supported or the bus clock is too slow.
+    */
+    ErrorCode I2C_Peripheral_SetDataRate(uint16_t data_rate);
+    
+    /**
+    *   \brief Get the data rate of the I2C bus.
+    *
+    *   \retval Data rate obtained with the current divider, in kHz.
+    */
+    uint16_t I2C_Peripheral_GetDataRate(void);
+    
     /**
     *   \brief Read one byte over I2C.
     *   
@@ -45,7 +170,10 @@
     *   \brief Read multiple bytes over I2C.
     *   
     *   This function performs a complete reading operation over I2C from multiple
-    *   registers.
+    *   registers. The registers are read in a single auto-increment burst whose
+    *   bytes are stored by the I2C interrupt, so whole FIFO blocks (up to 255
+    *   bytes) can be read with one operation. The operation is aborted if it
+    *   is not completed within its deadline.
     *   \param device_address I2C address of the device to talk to.
     *   \param register_address Address of the first register to be read.
     *   \param register_count Number of registers we want to read.
@@ -72,7 +200,8 @@
     *   \brief Write multiple bytes over I2C.
     *   
     *   This function performs a complete writing operation over I2C to multiple
-    *   registers
+    *   consecutive registers, with a single auto-increment burst of at most
+    *   I2C_TRANSFER_MAX_WRITE registers.
     *   \param device_address I2C address of the device to talk to.
     *   \param register_address Address of the first register to be written.
     *   \param register_count Number of registers that need to be written.
@@ -92,5 +221,74 @@
     */
     uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address);
     
+    /**
+    *   \brief Submit an asynchronous transfer.
+    *
+    *   This function queues a read or write transfer and returns immediately.
+    *   The transfer is carried out by the I2C interrupt while the caller keeps
+    *   working, and it is advanced by I2C_Peripheral_ProcessTransfers.
+    *   On completion the state of the descriptor is set to I2C_TRANSFER_DONE,
+    *   the error field holds the result and the callback, if any, is called.
+    *   \param transfer Pointer to the descriptor of the transfer.
+    *   \retval ERROR if the descriptor is not valid or already queued.
+    */
+    ErrorCode I2C_Peripheral_SubmitTransfer(I2C_Transfer* transfer);
+    
+    /**
+    *   \brief Advance the queued asynchronous transfers.
+    *
+    *   This function never waits for the bus: it checks the status of the
+    *   I2C master, moves the current transfer to its next phase and starts
+    *   the following one. It must be called periodically from the main loop.
+    */
+    void I2C_Peripheral_ProcessTransfers(void);
+    
+    /**
+    *   \brief Check if asynchronous transfers are queued.
+    *
+    *   \retval Returns true (>0) if at least one transfer is not completed.
+    */
+    uint8_t I2C_Peripheral_IsBusy(void);
+    
+    /**
+    *   \brief Count the time of the asynchronous transfer on the bus.
+    *
+    *   This function must be called by a periodic interrupt every
+    *   I2C_TICK_PERIOD_US: the transfer on the bus for more than
+    *   I2C_TRANSFER_TIMEOUT_TICKS ticks plus the time of its bytes is aborted
+    *   by I2C_Peripheral_ProcessTransfers with ERROR_TIMEOUT. Blocking
+    *   operations have their own deadline and do not need the ticks.
+    */
+    void I2C_Peripheral_Tick(void);
+    
+    /**
+    *   \brief Free the bus and restart the I2C master.
+    *
+    *   This function takes the SCL and SDA pins from the I2C block, pulses SCL
+    *   until the device holding SDA low releases it, sends a stop condition
+    *   and then initializes the I2C master again. It is called automatically
+    *   when an operation times out or loses arbitration.
+    *   \retval ERROR_BUS_BUSY if the lines are still held low.
+    */
+    ErrorCode I2C_Peripheral_RecoverBus(void);
+    
+    /**
+    *   \brief Get the number of failed operations of a given kind.
+    *
+    *   \param error Kind of error to be counted.
+    *   \retval Number of operations that failed with this error.
+    */
+    uint16_t I2C_Peripheral_GetErrorCount(ErrorCode error);
+    
+    /**
+    *   \brief Get the number of bus recoveries.
+    */
+    uint16_t I2C_Peripheral_GetRecoveryCount(void);
+    
+    /**
+    *   \brief Reset the error and recovery counters.
+    */
+    void I2C_Peripheral_ClearErrorCounts(void);
+    
 #endif // I2C_Interface_H
 /* [] END OF FILE */
@@ -10,8 +10,9 @@
  * ========================================
 */
 #include "InterruptRoutines.h"
+#include "StreamOutput.h"
 
-uint8 FlagIsr = 0;   //Inizialization of FlagIsr
+volatile uint8 FlagIsr = 0;   //Inizialization of FlagIsr
 
 CY_ISR(Custom_ISR)
 {
@@ -20,4 +21,9 @@ CY_ISR(Custom_ISR)
     
 }
 
+CY_ISR(UART_TX_ISR)
+{
+    StreamOutput_Transmit(); //Refill the FIFO of the UART from the stream buffer
+}
+
 /* [] END OF FILE */
@@ -13,9 +13,18 @@
     #define __INTERRUPT_ROUTINES_H
     #include "project.h"
     
-    extern uint8 FlagIsr; //Definition of the Flag for the data read
+    extern volatile uint8 FlagIsr; //Definition of the Flag for the data read
+    
+    // isr_TX is connected to the tx_interrupt terminal of UART_Debug; when
+    // the schematic does not have it the main loop sends the stream
+    #ifdef isr_TX__INTC_NUMBER
+        #define INTERRUPT_UART_TX 1
+    #else
+        #define INTERRUPT_UART_TX 0
+    #endif
     
     CY_ISR_PROTO(Custom_ISR);
+    CY_ISR_PROTO(UART_TX_ISR);
     
     #endif
 /* [] END OF FILE */
@@ -0,0 +1,135 @@
+/*
+* This file includes the source code to read
+* batches of samples from the LIS3DH FIFO.
+*/
+
+#include "LIS3DH_Fifo.h"
+#include "I2C_Interface.h"
+
+    uint8_t LIS3DH_Fifo_Level(uint8_t fifo_src)
+    {
+        if (fifo_src & LIS3DH_FIFO_SRC_EMPTY)
+        {
+            return 0;
+        }
+        // The FSS field counts up to 31, a full FIFO is flagged by OVRN_FIFO
+        if (fifo_src & LIS3DH_FIFO_SRC_OVRN)
+        {
+            return LIS3DH_FIFO_DEPTH;
+        }
+        return fifo_src & LIS3DH_FIFO_SRC_FSS_MASK;
+    }
+    
+    ErrorCode LIS3DH_Fifo_Drain(uint8_t device_address,
+                                uint8_t min_level,
+                                LIS3DH_FifoBatch* batch)
+    {
+        batch->count = 0;
+        batch->overrun = 0;
+        
+        uint8_t fifo_src;
+        ErrorCode error = I2C_Peripheral_ReadRegister(device_address,
+                                                      LIS3DH_FIFO_SRC_REG,
+                                                      &fifo_src);
+        if (error != NO_ERROR)
+        {
+            return error;
+        }
+        
+        uint8_t level = LIS3DH_Fifo_Level(fifo_src);
+        if (level == 0 || level < min_level)
+        {
+            return NO_ERROR;
+        }
+        
+        // Only the samples counted in FIFO_SRC_REG are read: reading past
+        // them would return the last sample again
+        error = I2C_Peripheral_ReadRegisterMulti(device_address,
+                                                 LIS3DH_OUT_X_L,
+                                                 level * LIS3DH_FIFO_SAMPLE_SIZE,
+                                                 batch->data);
+        if (error != NO_ERROR)
+        {
+            return error;
+        }
+        batch->count = level;
+        batch->overrun = (fifo_src & LIS3DH_FIFO_SRC_OVRN) != 0;
+        return NO_ERROR;
+    }
+    
+    ErrorCode LIS3DH_Fifo_SubmitDrain(LIS3DH_FifoDrain* drain,
+                                      uint8_t device_address,
+                                      uint8_t min_level,
+                                      LIS3DH_FifoBatch* batch)
+    {
+        if (drain->state != LIS3DH_FIFO_DRAIN_IDLE)
+        {
+            return ERROR;
+        }
+        batch->count = 0;
+        batch->overrun = 0;
+        drain->batch = batch;
+        drain->min_level = min_level;
+        drain->transfer = (I2C_Transfer) {
+            .device_address = device_address,
+            .register_address = LIS3DH_FIFO_SRC_REG,
+            .register_count = 1,
+            .data = &drain->fifo_src,
+            .direction = I2C_TRANSFER_READ,
+        };
+        ErrorCode error = I2C_Peripheral_SubmitTransfer(&drain->transfer);
+        if (error == NO_ERROR)
+        {
+            drain->state = LIS3DH_FIFO_DRAIN_LEVEL;
+        }
+        return error;
+    }
+    
+    uint8_t LIS3DH_Fifo_IsDrainComplete(LIS3DH_FifoDrain* drain, ErrorCode* error)
+    {
+        if (drain->state == LIS3DH_FIFO_DRAIN_IDLE ||
+            drain->transfer.state != I2C_TRANSFER_DONE)
+        {
+            return 0;
+        }
+        
+        *error = drain->transfer.error;
+        if (*error == NO_ERROR && drain->state == LIS3DH_FIFO_DRAIN_LEVEL)
+        {
+            uint8_t level = LIS3DH_Fifo_Level(drain->fifo_src);
+            if (level == 0 || level < drain->min_level)
+            {
+                drain->state = LIS3DH_FIFO_DRAIN_IDLE;
+                return 1;
+            }
+            
+            // As in LIS3DH_Fifo_Drain, only the samples counted are read
+            drain->transfer.register_address = LIS3DH_OUT_X_L;
+            drain->transfer.register_count = level * LIS3DH_FIFO_SAMPLE_SIZE;
+            drain->transfer.data = drain->batch->data;
+            *error = I2C_Peripheral_SubmitTransfer(&drain->transfer);
+            if (*error == NO_ERROR)
+            {
+                drain->state = LIS3DH_FIFO_DRAIN_DATA;
+                return 0;
+            }
+        }
+        else if (*error == NO_ERROR)
+        {
+            drain->batch->count = drain->transfer.register_count / LIS3DH_FIFO_SAMPLE_SIZE;
+            drain->batch->overrun = (drain->fifo_src & LIS3DH_FIFO_SRC_OVRN) != 0;
+        }
+        drain->state = LIS3DH_FIFO_DRAIN_IDLE;
+        return 1;
+    }
+    
+    void LIS3DH_Fifo_GetSample(const LIS3DH_FifoBatch* batch, uint8_t index, int16_t* xyz)
+    {
+        const uint8_t* data = &batch->data[index * LIS3DH_FIFO_SAMPLE_SIZE];
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            xyz[i] = (int16_t)(data[2*i] | (data[2*i+1] << 8));
+        }
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,40 @@
+/*
+* This file includes the table of the data formats
+* of the LIS3DH and the code to decode them.
+*/
+
+#include "LIS3DH_Format.h"
+
+// mm_s2_q12 is mg_per_digit * 9.806 * 4096, rounded to nearest
+const LIS3DH_Format LIS3DH_Formats[LIS3DH_FORMAT_MODES][LIS3DH_FORMAT_RANGES] = {
+    // Low-power mode, 8-bit data and ADC
+    {
+        { .bits = 8, .shift = 8, .adc_shift = 8, .mg_per_digit = 16,  .mm_s2_q12 = 642646 },
+        { .bits = 8, .shift = 8, .adc_shift = 8, .mg_per_digit = 32,  .mm_s2_q12 = 1285292 },
+        { .bits = 8, .shift = 8, .adc_shift = 8, .mg_per_digit = 64,  .mm_s2_q12 = 2570584 },
+        { .bits = 8, .shift = 8, .adc_shift = 8, .mg_per_digit = 192, .mm_s2_q12 = 7711752 },
+    },
+    // Normal mode, 10-bit data and ADC
+    {
+        { .bits = 10, .shift = 6, .adc_shift = 6, .mg_per_digit = 4,  .mm_s2_q12 = 160662 },
+        { .bits = 10, .shift = 6, .adc_shift = 6, .mg_per_digit = 8,  .mm_s2_q12 = 321323 },
+        { .bits = 10, .shift = 6, .adc_shift = 6, .mg_per_digit = 16, .mm_s2_q12 = 642646 },
+        { .bits = 10, .shift = 6, .adc_shift = 6, .mg_per_digit = 48, .mm_s2_q12 = 1927938 },
+    },
+    // High resolution mode, 12-bit data and 10-bit ADC
+    {
+        { .bits = 12, .shift = 4, .adc_shift = 6, .mg_per_digit = 1,  .mm_s2_q12 = 40165 },
+        { .bits = 12, .shift = 4, .adc_shift = 6, .mg_per_digit = 2,  .mm_s2_q12 = 80331 },
+        { .bits = 12, .shift = 4, .adc_shift = 6, .mg_per_digit = 4,  .mm_s2_q12 = 160662 },
+        { .bits = 12, .shift = 4, .adc_shift = 6, .mg_per_digit = 12, .mm_s2_q12 = 481985 },
+    },
+};
+
+    int32_t LIS3DH_Format_ToMmPerS2(const LIS3DH_Format* format, int16_t raw)
+    {
+        // At ±16 g the product stays below 2^30, so it fits in 32 bits
+        int32_t product = (int32_t) LIS3DH_Format_Align(format, raw) * format->mm_s2_q12;
+        return LIS3DH_Format_TruncateQ12(product);
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,87 @@
+/** 
+ * \file LIS3DH_Format.h
+ * \brief Data format of the LIS3DH output for each mode and full scale range.
+ *
+ * The output and ADC registers are left-justified 16-bit values whose
+ * number of significant bits depends on the operating mode, while the
+ * sensitivity depends on both the mode and the full scale range. Each of
+ * the 12 combinations has a constant descriptor, so that decoding a value
+ * is a table lookup done once, then a shift and a multiply.
+*/
+
+#ifndef LIS3DH_Format_H
+    #define LIS3DH_Format_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Number of operating modes (low-power, normal, high resolution).
+    */
+    #define LIS3DH_FORMAT_MODES 3
+    
+    /**
+    *   \brief Number of full scale ranges (±2, ±4, ±8, ±16 g).
+    */
+    #define LIS3DH_FORMAT_RANGES 4
+    
+    /**
+    *   \brief Fractional bits of the mm/s^2 scale.
+    */
+    #define LIS3DH_FORMAT_Q 12
+    
+    /**
+    *   \brief Decoding of the output of one mode and full scale range.
+    */
+    typedef struct {
+        uint8_t bits;                   ///< Significant bits of the acceleration (8, 10, 12)
+        uint8_t shift;                  ///< Right shift of the left-justified acceleration
+        uint8_t adc_shift;              ///< Right shift of the left-justified ADC output
+        uint8_t mg_per_digit;           ///< Sensitivity in mg/digit (datasheet, table 4)
+        int32_t mm_s2_q12;              ///< Sensitivity in mm/s^2 per digit, Q12
+    } LIS3DH_Format;
+    
+    /**
+    *   \brief Descriptors indexed by LIS3DH_Mode and LIS3DH_Fsr.
+    */
+    extern const LIS3DH_Format LIS3DH_Formats[LIS3DH_FORMAT_MODES][LIS3DH_FORMAT_RANGES];
+    
+    /**
+    *   \brief Get the descriptor of a mode and full scale range.
+    */
+    #define LIS3DH_Format_Get(mode, fsr) (&LIS3DH_Formats[(mode)][(fsr)])
+    
+    /**
+    *   \brief Right-align a left-justified acceleration value.
+    */
+    #define LIS3DH_Format_Align(format, raw) ((int16_t)(raw) >> (format)->shift)
+    
+    /**
+    *   \brief Convert a left-justified acceleration value to mg.
+    */
+    #define LIS3DH_Format_ToMilliG(format, raw) \
+        ((int32_t) LIS3DH_Format_Align(format, raw) * (format)->mg_per_digit)
+    
+    /**
+    *   \brief Right-align a left-justified ADC value.
+    */
+    #define LIS3DH_Format_AlignAdc(format, raw) ((int16_t)(raw) >> (format)->adc_shift)
+    
+    /**
+    *   \brief Convert a left-justified acceleration value to mm/s^2.
+    *
+    *   The result is truncated toward zero and is within 1 LSB of the
+    *   float computation value * mg_per_digit * 9.806.
+    */
+    int32_t LIS3DH_Format_ToMmPerS2(const LIS3DH_Format* format, int16_t raw);
+    
+    /**
+    *   \brief Divide a Q12 product by 4096, truncating toward zero.
+    *
+    *   Negative values are biased by 4095 before the arithmetic shift, the
+    *   bias is taken from the sign bit so no branch is needed.
+    */
+    #define LIS3DH_Format_TruncateQ12(product) \
+        (((product) + (((product) >> 31) & ((1 << LIS3DH_FORMAT_Q) - 1))) >> LIS3DH_FORMAT_Q)
+    
+#endif // LIS3DH_Format_H
+/* [] END OF FILE */
@@ -0,0 +1,215 @@
+/**
+*   \file LIS3DH_Registers.h
+*   \brief Register map of the LIS3DH accelerometer.
+*
+*   This file contains the addresses of the registers of the LIS3DH
+*   and the bits used throughout the project to configure it.
+*/
+
+#ifndef __LIS3DH_REGISTERS_H
+    #define __LIS3DH_REGISTERS_H
+    
+    /**
+    *   \brief Address of the auxiliary Status register
+    */
+    #define LIS3DH_STATUS_REG_AUX 0x07
+    
+    /**
+    *   \brief Address of the ADC 1 output LSB register
+    */
+    #define LIS3DH_OUT_ADC_1L 0x08
+    
+    /**
+    *   \brief Address of the ADC 3 output LSB register
+    */
+    #define LIS3DH_OUT_ADC_3L 0x0C
+    
+    /**
+    *   \brief Address of the ADC 3 output MSB register
+    */
+    #define LIS3DH_OUT_ADC_3H 0x0D
+    
+    /**
+    *   \brief Address of the WHO AM I register
+    */
+    #define LIS3DH_WHO_AM_I_REG_ADDR 0x0F
+    
+    /**
+    *   \brief Value of the WHO AM I register
+    */
+    #define LIS3DH_WHO_AM_I_VALUE 0x33
+    
+    /**
+    *   \brief Highest I2C data rate supported by the LIS3DH, in kHz
+    */
+    #define LIS3DH_I2C_MAX_DATA_RATE 400
+    
+    /**
+    *   \brief Address of the Temperature Sensor Configuration register
+    */
+    #define LIS3DH_TEMP_CFG_REG 0x1F
+    
+    /**
+    *   \brief Address of the Control register 1
+    */
+    #define LIS3DH_CTRL_REG1 0x20
+    
+    /**
+    *   \brief Power-on value of the Control register 1: 0 Hz, X, Y and Z enabled
+    */
+    #define LIS3DH_CTRL_REG1_DEFAULT 0x07
+    
+    /**
+    *   \brief Address of the Control register 2
+    */
+    #define LIS3DH_CTRL_REG2 0x21
+    
+    /**
+    *   \brief Address of the Control register 3
+    */
+    #define LIS3DH_CTRL_REG3 0x22
+    
+    /**
+    *   \brief Address of the Control register 4
+    */
+    #define LIS3DH_CTRL_REG4 0x23
+    
+    /**
+    *   \brief Address of the Control register 5
+    */
+    #define LIS3DH_CTRL_REG5 0x24
+    
+    /**
+    *   \brief Address of the Control register 6
+    */
+    #define LIS3DH_CTRL_REG6 0x25
+    
+    /**
+    *   \brief Address of the Reference register
+    */
+    #define LIS3DH_REFERENCE 0x26
+    
+    /**
+    *   \brief Address of the Status register
+    */
+    #define LIS3DH_STATUS_REG 0x27
+    
+    /**
+    *   \brief Address of the x-axis acceleration data output LSB register
+    */
+    #define LIS3DH_OUT_X_L 0x28
+    
+    /**
+    *   \brief Address of the y-axis acceleration data output LSB register
+    */
+    #define LIS3DH_OUT_Y_L 0x2A
+    
+    /**
+    *   \brief Address of the z-axis acceleration data output LSB register
+    */
+    #define LIS3DH_OUT_Z_L 0x2C
+    
+    /**
+    *   \brief Address of the FIFO Control register
+    */
+    #define LIS3DH_FIFO_CTRL_REG 0x2E
+    
+    /**
+    *   \brief Address of the FIFO Source register
+    */
+    #define LIS3DH_FIFO_SRC_REG 0x2F
+    
+    /**
+    *   \brief Address of the Interrupt 1 Configuration register
+    */
+    #define LIS3DH_INT1_CFG 0x30
+    
+    /**
+    *   \brief Address of the Interrupt 1 Source register
+    */
+    #define LIS3DH_INT1_SRC 0x31
+    
+    /**
+    *   \brief Address of the Interrupt 1 Threshold register
+    */
+    #define LIS3DH_INT1_THS 0x32
+    
+    /**
+    *   \brief Address of the Interrupt 1 Duration register
+    */
+    #define LIS3DH_INT1_DURATION 0x33
+    
+    /**
+    *   \brief Address of the Interrupt 2 Configuration register
+    */
+    #define LIS3DH_INT2_CFG 0x34
+    
+    /**
+    *   \brief Address of the Interrupt 2 Source register
+    */
+    #define LIS3DH_INT2_SRC 0x35
+    
+    /**
+    *   \brief Address of the Interrupt 2 Threshold register
+    */
+    #define LIS3DH_INT2_THS 0x36
+    
+    /**
+    *   \brief Address of the Interrupt 2 Duration register
+    */
+    #define LIS3DH_INT2_DURATION 0x37
+    
+    /**
+    *   \brief ZYXDA bit of the Status register: new X, Y, Z data available
+    */
+    #define LIS3DH_STATUS_ZYXDA 0x08
+    
+    /**
+    *   \brief ADC_EN and TEMP_EN bits of the Temperature Sensor Configuration register
+    */
+    #define LIS3DH_TEMP_CFG_ADC_EN 0x80
+    #define LIS3DH_TEMP_CFG_TEMP_EN 0x40
+    
+    /**
+    *   \brief ODR field, LPen bit and axes enable bits of the Control register 1
+    */
+    #define LIS3DH_CTRL_REG1_ODR_SHIFT 4
+    #define LIS3DH_CTRL_REG1_LPEN 0x08
+    #define LIS3DH_CTRL_REG1_XYZ_EN 0x07
+    
+    /**
+    *   \brief INT1 sources of the Control register 3
+    */
+    #define LIS3DH_CTRL_REG3_I1_IA1 0x40
+    #define LIS3DH_CTRL_REG3_I1_ZYXDA 0x10
+    #define LIS3DH_CTRL_REG3_I1_WTM 0x04
+    #define LIS3DH_CTRL_REG3_I1_OVERRUN 0x02
+    
+    /**
+    *   \brief BDU bit, FS field and HR bit of the Control register 4
+    */
+    #define LIS3DH_CTRL_REG4_BDU 0x80
+    #define LIS3DH_CTRL_REG4_FS_SHIFT 4
+    #define LIS3DH_CTRL_REG4_HR 0x08
+    
+    /**
+    *   \brief FIFO_EN bit of the Control register 5
+    */
+    #define LIS3DH_CTRL_REG5_FIFO_EN 0x40
+    
+    /**
+    *   \brief FM field and FTH field of the FIFO Control register
+    */
+    #define LIS3DH_FIFO_CTRL_FM_SHIFT 6
+    #define LIS3DH_FIFO_CTRL_FTH_MASK 0x1F
+    
+    /**
+    *   \brief WTM, OVRN_FIFO and EMPTY bits and FSS field of the FIFO Source register
+    */
+    #define LIS3DH_FIFO_SRC_WTM 0x80
+    #define LIS3DH_FIFO_SRC_OVRN 0x40
+    #define LIS3DH_FIFO_SRC_EMPTY 0x20
+    #define LIS3DH_FIFO_SRC_FSS_MASK 0x1F
+    
+#endif
+/* [] END OF FILE */
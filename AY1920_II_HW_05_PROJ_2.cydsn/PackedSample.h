@@ -0,0 +1,126 @@
+/** 
+ * \file PackedSample.h
+ * \brief Bit-packed wire format of the acceleration samples.
+ *
+ * Each sample carries the three right-aligned raw values only, packed
+ * big-endian after a short marker:
+ *
+ *     12-bit data: 1010 xxxxxxxxxxxx yyyyyyyyyyyy zzzzzzzzzzzz  (5 bytes)
+ *     10-bit data:   10 xxxxxxxxxx   yyyyyyyyyy   zzzzzzzzzz    (4 bytes)
+ *
+ * 8-bit data (low-power mode) uses the 10-bit layout. The scaling is sent
+ * once in a stream header, repeated periodically so that a receiver that
+ * joins late can resynchronize:
+ *
+ *     0xE3, bits, mg/digit, mm/s^2 Q12 scale (32 bits, little endian),
+ *     ODR in Hz (16 bits, little endian), 0xC0
+ *
+ * The first byte of a sample is always between 0x80 and 0xBF, the header
+ * starts outside this range so that it is never taken for a sample.
+ *
+ * The decoder has no dependency on the PSoC, so it can be built on the
+ * host as well.
+*/
+
+#ifndef PackedSample_H
+    #define PackedSample_H
+    
+    #include "cytypes.h"
+    #include "LIS3DH_Format.h"
+    
+    /**
+    *   \brief Size of a packed sample with 12-bit and with 10-bit data.
+    */
+    #define PACKED_SAMPLE_SIZE_12 5
+    #define PACKED_SAMPLE_SIZE_10 4
+    
+    /**
+    *   \brief Largest packed sample.
+    */
+    #define PACKED_SAMPLE_MAX_SIZE PACKED_SAMPLE_SIZE_12
+    
+    /**
+    *   \brief Markers in the first bits of a packed sample.
+    */
+    #define PACKED_SAMPLE_MARKER_12 0xA0
+    #define PACKED_SAMPLE_MARKER_10 0x80
+    
+    /**
+    *   \brief First byte and size of the stream header.
+    */
+    #define PACKED_STREAM_HEADER 0xE3
+    #define PACKED_STREAM_HEADER_SIZE 10
+    
+    /**
+    *   \brief Number of samples between two stream headers.
+    */
+    #define PACKED_STREAM_HEADER_PERIOD 100
+    
+    /**
+    *   \brief Get the size of the packed samples of a format.
+    */
+    #define PackedSample_Size(format) \
+        (((format)->bits > 10) ? PACKED_SAMPLE_SIZE_12 : PACKED_SAMPLE_SIZE_10)
+    
+    /**
+    *   \brief State of the stream decoder.
+    */
+    typedef struct {
+        uint8_t packet[PACKED_STREAM_HEADER_SIZE];      ///< Bytes of the current packet
+        uint8_t length;                                 ///< Bytes received
+        uint8_t expected;                               ///< Size of the current packet
+        uint8_t bits;                                   ///< Significant bits, 0 before the first header
+        uint8_t mg_per_digit;                           ///< Sensitivity in mg/digit
+        int32_t mm_s2_q12;                              ///< Sensitivity in mm/s^2 per digit, Q12
+        uint16_t odr_hz;                                ///< Output data rate of the stream
+        uint16_t errors;                                ///< Headers dropped by the footer check
+    } PackedDecoder;
+    
+    /**
+    *   \brief Pack a sample.
+    *
+    *   \param format Data format of the sample.
+    *   \param raw Left-justified values of the three axes.
+    *   \param packet Array of at least PACKED_SAMPLE_MAX_SIZE bytes.
+    *   \retval Number of bytes of the packed sample.
+    */
+    uint8_t PackedSample_Pack(const LIS3DH_Format* format, const int16_t* raw, uint8_t* packet);
+    
+    /**
+    *   \brief Fill the stream header of a format.
+    *
+    *   \param format Data format of the stream.
+    *   \param odr_hz Output data rate of the stream.
+    *   \param header Array of PACKED_STREAM_HEADER_SIZE bytes.
+    */
+    void PackedSample_StreamHeader(const LIS3DH_Format* format, uint16_t odr_hz, uint8_t* header);
+    
+    /**
+    *   \brief Unpack a sample.
+    *
+    *   \param bits Significant bits of the stream, from the stream header.
+    *   \param packet Bytes of the packed sample.
+    *   \param xyz Array where the right-aligned values are saved.
+    *   \retval Number of bytes used, 0 if the marker does not match.
+    */
+    uint8_t PackedSample_Unpack(uint8_t bits, const uint8_t* packet, int16_t* xyz);
+    
+    /**
+    *   \brief Wait for a stream header.
+    */
+    void PackedSample_InitDecoder(PackedDecoder* decoder);
+    
+    /**
+    *   \brief Decode the next byte of the stream.
+    *
+    *   Bytes that start neither a header nor a sample of the current format
+    *   are skipped, so that the decoder resynchronizes on its own.
+    *   \param decoder Pointer to the decoder.
+    *   \param byte Byte received.
+    *   \param xyz Array where the right-aligned values of a sample are saved.
+    *   \retval 1 if a sample was completed with this byte, 0 otherwise.
+    */
+    uint8_t PackedSample_Decode(PackedDecoder* decoder, uint8_t byte, int16_t* xyz);
+    
+#endif // PackedSample_H
+/* [] END OF FILE */
@@ -0,0 +1,147 @@
+/*
+* This file includes the source code to plan and carry out
+* the register reads performed over I2C.
+*/
+
+#include "RegisterPlan.h"
+
+    void RegisterPlan_Clear(RegisterPlan* plan)
+    {
+        plan->burst_count = 0;
+    }
+    
+    ErrorCode RegisterPlan_Add(RegisterPlan* plan,
+                               uint8_t register_address,
+                               uint8_t register_count)
+    {
+        // Check that the range fits in the plan and in the image
+        if (plan->burst_count >= REGISTER_PLAN_MAX_BURSTS || register_count == 0 ||
+            register_address + register_count > REGISTER_PLAN_IMAGE_SIZE)
+        {
+            return ERROR;
+        }
+        plan->bursts[plan->burst_count].register_address = register_address;
+        plan->bursts[plan->burst_count].register_count = register_count;
+        plan->burst_count++;
+        return NO_ERROR;
+    }
+    
+    void RegisterPlan_Coalesce(RegisterPlan* plan, uint8_t max_gap)
+    {
+        // Sort the ranges by address (insertion sort, plans are short)
+        for (uint8_t i = 1; i < plan->burst_count; i++)
+        {
+            RegisterBurst burst = plan->bursts[i];
+            uint8_t j = i;
+            while (j > 0 && plan->bursts[j-1].register_address > burst.register_address)
+            {
+                plan->bursts[j] = plan->bursts[j-1];
+                j--;
+            }
+            plan->bursts[j] = burst;
+        }
+        
+        // Merge each range into the previous one when they are close enough
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < plan->burst_count; i++)
+        {
+            RegisterBurst* burst = &plan->bursts[i];
+            if (count > 0)
+            {
+                RegisterBurst* last = &plan->bursts[count-1];
+                uint8_t last_end = last->register_address + last->register_count;
+                if (burst->register_address <= last_end + max_gap)
+                {
+                    uint8_t burst_end = burst->register_address + burst->register_count;
+                    if (burst_end > last_end)
+                    {
+                        last->register_count = burst_end - last->register_address;
+                    }
+                    continue;
+                }
+            }
+            plan->bursts[count++] = *burst;
+        }
+        plan->burst_count = count;
+    }
+    
+    uint16_t RegisterPlan_BusBytes(const RegisterPlan* plan)
+    {
+        uint16_t bytes = 0;
+        for (uint8_t i = 0; i < plan->burst_count; i++)
+        {
+            // Address with write bit, register address, address with read bit and data
+            bytes += 3 + plan->bursts[i].register_count;
+        }
+        return bytes;
+    }
+    
+    ErrorCode RegisterPlan_Execute(const RegisterPlan* plan,
+                                   uint8_t device_address,
+                                   uint8_t* image)
+    {
+        for (uint8_t i = 0; i < plan->burst_count; i++)
+        {
+            const RegisterBurst* burst = &plan->bursts[i];
+            ErrorCode error = I2C_Peripheral_ReadRegisterMulti(device_address,
+                                                               burst->register_address,
+                                                               burst->register_count,
+                                                               &image[burst->register_address]);
+            if (error != NO_ERROR)
+            {
+                return error;
+            }
+        }
+        return NO_ERROR;
+    }
+    
+    ErrorCode RegisterPlan_Submit(const RegisterPlan* plan,
+                                  uint8_t device_address,
+                                  uint8_t* image,
+                                  I2C_Transfer* transfers)
+    {
+        for (uint8_t i = 0; i < plan->burst_count; i++)
+        {
+            const RegisterBurst* burst = &plan->bursts[i];
+            transfers[i].device_address = device_address;
+            transfers[i].register_address = burst->register_address;
+            transfers[i].register_count = burst->register_count;
+            transfers[i].data = &image[burst->register_address];
+            transfers[i].direction = I2C_TRANSFER_READ;
+            transfers[i].callback = NULL;
+            ErrorCode error = I2C_Peripheral_SubmitTransfer(&transfers[i]);
+            if (error != NO_ERROR)
+            {
+                // The bursts already queued stay on the bus, the others are
+                // completed right away so that the plan still completes
+                for (uint8_t j = i; j < plan->burst_count; j++)
+                {
+                    transfers[j].error = error;
+                    transfers[j].state = I2C_TRANSFER_DONE;
+                }
+                return (i == 0) ? error : NO_ERROR;
+            }
+        }
+        return NO_ERROR;
+    }
+    
+    uint8_t RegisterPlan_IsComplete(const RegisterPlan* plan,
+                                    I2C_Transfer* transfers,
+                                    ErrorCode* error)
+    {
+        *error = NO_ERROR;
+        for (uint8_t i = 0; i < plan->burst_count; i++)
+        {
+            if (transfers[i].state != I2C_TRANSFER_DONE)
+            {
+                return 0;
+            }
+            if (transfers[i].error != NO_ERROR)
+            {
+                *error = transfers[i].error;
+            }
+        }
+        return 1;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,134 @@
+/** 
+ * \file RegisterPlan.h
+ * \brief Planner of the register reads performed over I2C.
+ *
+ * A plan collects the register ranges that must be read at every
+ * sample and merges contiguous or near-contiguous ranges into as few
+ * auto-increment bursts as possible, so that the START, address and
+ * RESTART overhead is paid once per burst instead of once per range.
+*/
+
+#ifndef RegisterPlan_H
+    #define RegisterPlan_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "I2C_Interface.h"
+    
+    /**
+    *   \brief Maximum number of register ranges in a plan.
+    */
+    #define REGISTER_PLAN_MAX_BURSTS 8
+    
+    /**
+    *   \brief Size of the register image filled by a plan.
+    *
+    *   The image is indexed by register address, so it covers the
+    *   whole register space of the device.
+    */
+    #define REGISTER_PLAN_IMAGE_SIZE 0x40
+    
+    /**
+    *   \brief Default number of unused registers that can be read to join two ranges.
+    *
+    *   Every burst costs the device address twice and the register address
+    *   once, so reading up to three unused registers is never more expensive
+    *   than starting a new burst.
+    */
+    #define REGISTER_PLAN_DEFAULT_GAP 3
+    
+    /**
+    *   \brief Range of consecutive registers read with one burst.
+    */
+    typedef struct {
+        uint8_t register_address;   ///< Address of the first register
+        uint8_t register_count;     ///< Number of registers
+    } RegisterBurst;
+    
+    /**
+    *   \brief List of register ranges to be read.
+    */
+    typedef struct {
+        uint8_t burst_count;                            ///< Number of ranges
+        RegisterBurst bursts[REGISTER_PLAN_MAX_BURSTS]; ///< Ranges of the plan
+    } RegisterPlan;
+    
+    /**
+    *   \brief Remove all the ranges from a plan.
+    *   \param plan Pointer to the plan.
+    */
+    void RegisterPlan_Clear(RegisterPlan* plan);
+    
+    /**
+    *   \brief Add a range of registers to a plan.
+    *
+    *   \param plan Pointer to the plan.
+    *   \param register_address Address of the first register of the range.
+    *   \param register_count Number of registers of the range.
+    *   \retval ERROR if the plan is full or the range exceeds the image.
+    */
+    ErrorCode RegisterPlan_Add(RegisterPlan* plan,
+                               uint8_t register_address,
+                               uint8_t register_count);
+    
+    /**
+    *   \brief Merge the ranges of a plan into auto-increment bursts.
+    *
+    *   Ranges are sorted by address; overlapping ranges and ranges separated
+    *   by at most max_gap registers are merged into a single burst.
+    *   \param plan Pointer to the plan.
+    *   \param max_gap Maximum number of unused registers read to merge two ranges.
+    */
+    void RegisterPlan_Coalesce(RegisterPlan* plan, uint8_t max_gap);
+    
+    /**
+    *   \brief Number of bytes on the bus needed to carry out a plan.
+    *
+    *   Each burst costs the device address for the write and the read
+    *   phase, the register address and one byte per register.
+    *   \param plan Pointer to the plan.
+    */
+    uint16_t RegisterPlan_BusBytes(const RegisterPlan* plan);
+    
+    /**
+    *   \brief Read all the registers of a plan.
+    *
+    *   \param plan Pointer to the plan.
+    *   \param device_address I2C address of the device to talk to.
+    *   \param image Register image, each register is saved at its own address.
+    */
+    ErrorCode RegisterPlan_Execute(const RegisterPlan* plan,
+                                   uint8_t device_address,
+                                   uint8_t* image);
+    
+    /**
+    *   \brief Submit all the bursts of a plan as asynchronous transfers.
+    *
+    *   \param plan Pointer to the plan.
+    *   \param device_address I2C address of the device to talk to.
+    *   \param image Register image, each register is saved at its own address.
+    *   If a burst cannot be queued, it and the following ones are marked as
+    *   completed with the error, which RegisterPlan_IsComplete reports once
+    *   the bursts already queued are completed as well.
+    *   \param transfers Array of REGISTER_PLAN_MAX_BURSTS transfer descriptors.
+    *   \retval The error of the first burst if none could be queued.
+    */
+    ErrorCode RegisterPlan_Submit(const RegisterPlan* plan,
+                                  uint8_t device_address,
+                                  uint8_t* image,
+                                  I2C_Transfer* transfers);
+    
+    /**
+    *   \brief Check if the transfers submitted for a plan are completed.
+    *
+    *   \param plan Pointer to the plan.
+    *   \param transfers Array of transfer descriptors passed to RegisterPlan_Submit.
+    *   \param error Pointer to a variable where the result will be saved.
+    *   \retval Returns true (>0) if all the bursts are completed.
+    */
+    uint8_t RegisterPlan_IsComplete(const RegisterPlan* plan,
+                                    I2C_Transfer* transfers,
+                                    ErrorCode* error);
+    
+#endif // RegisterPlan_H
+/* [] END OF FILE */
@@ -10,60 +10,25 @@
 
 // Include required header files
 #include "I2C_Interface.h"
+#include "LIS3DH_Registers.h"
+#include "LIS3DH_Device.h"
+#include "PackedSample.h"
+#include "StreamOutput.h"
 #include "project.h"
 #include "stdio.h"
 #include "InterruptRoutines.h"
 
 /**
-*   \brief 7-bit I2C address of the slave device.
+*   \brief Set to 1 to send bit-packed samples (4 bytes) instead of the
+*   8-byte packets in mg read by the Bridge Control Panel.
 */
-#define LIS3DH_DEVICE_ADDRESS 0x18
+#define STREAM_PACKED 0
 
 /**
-*   \brief Address of the WHO AM I register
+*   \brief Set to 1 to send each packet inside a frame with sequence number
+*   and CRC (see Frame.h).
 */
-#define LIS3DH_WHO_AM_I_REG_ADDR 0x0F
-
-/**
-*   \brief Address of the Status register
-*/
-#define LIS3DH_STATUS_REG 0x27
-
-/**
-*   \brief Address of the Control register 1
-*/
-#define LIS3DH_CTRL_REG1 0x20
-
-/**
-*   \brief Hex value to set normal mode at 100 Hz to the accelerator
-*/
-#define LIS3DH_NORMAL_MODE_100HZ_CTRL_REG1 0x57
-
-/**
-*   \brief Address of the Control register 4
-*/
-#define LIS3DH_CTRL_REG4 0x23
-
-// For the normale mode at 100 Hz and ±2.0 g FSR, Hex value is set to 0x80 because BDU is set to 1
-
-#define LIS3DH_NORMAL_MODE_100HZ_CTRL_REG4 0x80
-/**
-*   \brief Address of the x-axis acceleration data output LSB register
-*/
-#define LIS3DH_OUT_X_L 0x28
-
-/**
-*   \brief Address of the y-axis acceleration data output LSB register
-*/
-#define LIS3DH_OUT_Y_L 0x2A
-
-/**
-*   \brief Address of the z-axis acceleration data output LSB register
-*/
-#define LIS3DH_OUT_Z_L 0x2C
-
-/*Thanks to the multiread function, we don't need to specify the MSB register address */
-
+#define STREAM_FRAMED 0
 
 int main(void)
 {
@@ -77,6 +42,11 @@ int main(void)
     
     // String to print out messages on the UART
     char message[50];
+    
+    // Accelerometer with the SA0 pin tied low and its configuration
+    const LIS3DH_Profile* profile = &LIS3DH_Profiles[LIS3DH_PROFILE_NORMAL_100HZ_2G];
+    LIS3DH_Device Accelerometer;
+    LIS3DH_Device_Init(&Accelerometer, LIS3DH_DEVICE_ADDRESS_SA0_LOW, profile);
 
     // Check which devices are present on the I2C bus
     for (int i = 0 ; i < 128; i++)
@@ -96,7 +66,7 @@ int main(void)
     
     /* Read WHO AM I REGISTER register */
     uint8_t who_am_i_reg;
-    ErrorCode error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+    ErrorCode error = I2C_Peripheral_ReadRegister(Accelerometer.address,
                                                   LIS3DH_WHO_AM_I_REG_ADDR, 
                                                   &who_am_i_reg);
     if (error == NO_ERROR)
@@ -110,159 +80,132 @@ int main(void)
     }
     
     /******************************************/
-    /*        Read Control Register 1         */
+    /*      Read Configuration Registers      */
     /******************************************/
-    uint8_t ctrl_reg1; 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
+    
+    // The configuration registers are read once with a few bursts,
+    // then they are served by the shadow copy in RAM
+    error = LIS3DH_Cache_Init(&Accelerometer.cache, Accelerometer.address);
     
     if (error == NO_ERROR)
     {
+        uint8_t ctrl_reg1, ctrl_reg4;
+        LIS3DH_Cache_Read(&Accelerometer.cache, LIS3DH_CTRL_REG1, &ctrl_reg1);
+        LIS3DH_Cache_Read(&Accelerometer.cache, LIS3DH_CTRL_REG4, &ctrl_reg4);
+        
         sprintf(message, "CONTROL REGISTER 1: 0x%02X\r\n", ctrl_reg1);
         UART_Debug_PutString(message); 
+        sprintf(message, "CONTROL REGISTER 4: 0x%02X\r\n", ctrl_reg4);
+        UART_Debug_PutString(message); 
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 1\r\n");   
+        UART_Debug_PutString("Error occurred during I2C comm to read control registers\r\n");   
     }
     
     /******************************************/
-    /*            I2C Writing  
-                 Control Register 1           */
+    /*     I2C Writing Sensor Profile         */
     /******************************************/
     
-        
     UART_Debug_PutString("\r\nWriting new values..\r\n");
     
-    if (ctrl_reg1 != LIS3DH_NORMAL_MODE_100HZ_CTRL_REG1)
-    {
-        ctrl_reg1 = LIS3DH_NORMAL_MODE_100HZ_CTRL_REG1;
-    
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                             LIS3DH_CTRL_REG1,
-                                             ctrl_reg1);
-    
-        if (error == NO_ERROR)
-        {
-            sprintf(message, "CONTROL REGISTER 1 successfully written as: 0x%02X\r\n", ctrl_reg1);
-            UART_Debug_PutString(message); 
-        }
-        else
-        {
-            UART_Debug_PutString("Error occurred during I2C comm to set control register 1\r\n");   
-        }
-    }
-    
-     /******************************************/
-    /*        Read Control Register 4        */
-    /******************************************/
-    uint8_t ctrl_reg4; 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4);
+    // The profile is encoded into a register image, the registers that
+    // change are written with a single burst and verified with a read-back
+    error = LIS3DH_Profile_Apply(&Accelerometer.cache, profile);
     
     if (error == NO_ERROR)
     {
-        sprintf(message, "CONTROL REGISTER 4: 0x%02X\r\n", ctrl_reg4);
+        sprintf(message, "PROFILE: %s\r\n", profile->name);
         UART_Debug_PutString(message); 
     }
     else
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 4\r\n");   
+        UART_Debug_PutString("Error occurred during I2C comm to set control registers\r\n");   
     }
     
-    /******************************************/
-    /*            I2C Writing 
-               Control Register 4             */
-    /******************************************/
-    
-    UART_Debug_PutString("\r\nWriting new values..\r\n");
-    
-    if (ctrl_reg4 != LIS3DH_NORMAL_MODE_100HZ_CTRL_REG4)
-    {
-        ctrl_reg4 = LIS3DH_NORMAL_MODE_100HZ_CTRL_REG4;
-    
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                             LIS3DH_CTRL_REG4,
-                                             ctrl_reg4);
     
-        if (error == NO_ERROR)
-        {
-            sprintf(message, "CONTROL REGISTER 4 successfully written as: 0x%02X\r\n", ctrl_reg4);
-            UART_Debug_PutString(message); 
-        }
-        else
-        {
-            UART_Debug_PutString("Error occurred during I2C comm to set control register 4\r\n");   
-        }
-    }
-    
-    
-    int16_t ValueX, ValueY, ValueZ;
+    int32_t MilliG[3];
+    int16_t Raw[3];
+    uint8_t PackedPacket[PACKED_STREAM_HEADER_SIZE];
+    uint8_t packed_count = 0;
     uint8_t header = 0xA0;
     uint8_t footer = 0xC0;
     uint8_t ValueArray[8]; 
-    uint8_t AccData[6];
-    uint8_t status_register;
     
     ValueArray[0] = header;
     ValueArray[7] = footer;
     
+    /******************************************/
+    /*       Registers read at each tick      */
+    /******************************************/
+    
+    // Status and output registers are consecutive, so the plan of the
+    // device reads them with a single auto-increment burst
+    sprintf(message, "Bus bytes per sample: %u\r\n",
+            RegisterPlan_BusBytes(&Accelerometer.plan));
+    UART_Debug_PutString(message);
+    
+    StreamOutput_SetFramed(STREAM_FRAMED);
+    
+    // The packets are queued and sent by the TX interrupt, the sampling
+    // never waits for the UART; when it cannot keep up new packets are lost
+    StreamOutput_Start(STREAM_OUTPUT_DROP_NEWEST);
+    #if INTERRUPT_UART_TX
+        isr_TX_StartEx(UART_TX_ISR);
+    #endif
+    
     Timer_1_Start();
     isr_10_StartEx(Custom_ISR);
     
     for(;;)
     {
+        #if !INTERRUPT_UART_TX
+            StreamOutput_Transmit(); //No TX interrupt: the loop refills the UART FIFO
+        #endif
+        
         if(FlagIsr != 0)
         {
-            //Reading of the status register
-             error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                                 LIS3DH_STATUS_REG,
-                                                 &status_register);
-        
-             if(error==NO_ERROR) 
-            { 
-                //Checking if ZYXDA is set to 1. This condition that means that a new set of data is avaiable.
-               if((status_register & 1<<3) == 8)
-                { 
-                
-                 //It is used a multiread function because the registers X, Y and Z are consecutives.
-            
-                 error = I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS,
-                                                          LIS3DH_OUT_X_L,
-                                                          6,
-                                                          &AccData[0]);
+            //Reading of the status register together with the output registers
+             error = RegisterPlan_Execute(&Accelerometer.plan,
+                                          Accelerometer.address,
+                                          Accelerometer.image);
         
-                 if (error==NO_ERROR)
-                {    
-                   ValueX = (int16)((AccData[0] | (AccData[1]<<8)))>>6;
-                   ValueX = (ValueX*4); //Operation needed because the sensitity is of 4 mg/digit
-                   ValueArray[1] = (uint8_t)(ValueX & 0xFF);
-                   ValueArray[2] = (uint8_t)(ValueX >> 8);
-            
-            
-                   ValueY = (int16)((AccData[2] | (AccData[3]<<8)))>>6;
-                   ValueY = (ValueY*4); //Operation needed because the sensitity is of 4 mg/digit
-                   ValueArray[3] = (uint8_t)(ValueY & 0xFF);
-                   ValueArray[4] = (uint8_t)(ValueY >> 8);
-            
-            
-                   ValueZ = (int16)((AccData[4] | (AccData[5]<<8)))>>6;
-                   ValueZ = (ValueZ*4); //Operation needed because the sensitity is of 4 mg/digit
-                   ValueArray[5] = (uint8_t)(ValueZ & 0xFF);
-                   ValueArray[6] = (uint8_t)(ValueZ >> 8);
+             //Checking if ZYXDA is set to 1. This condition that means that a new set of data is avaiable.
+             if(error==NO_ERROR && LIS3DH_Device_HasNewData(&Accelerometer) && STREAM_PACKED)
+             {
+                   //The scaling is sent once every 100 samples, then only the raw 10-bit values
+                   const LIS3DH_Format* format = LIS3DH_Profile_Format(profile);
+                   if (packed_count == 0)
+                   {
+                       PackedSample_StreamHeader(format, 100, PackedPacket); //100 Hz, ODR of the profile
+                       StreamOutput_Send(PackedPacket, PACKED_STREAM_HEADER_SIZE);
+                   }
+                   packed_count = (packed_count + 1) % PACKED_STREAM_HEADER_PERIOD;
+                   
+                   LIS3DH_Device_GetRaw(&Accelerometer, Raw);
+                   StreamOutput_Send(PackedPacket, PackedSample_Pack(format, Raw, PackedPacket));
+                   
+                   FlagIsr =0; //Set FlagIsr to 0 again
+             }
+             else if(error==NO_ERROR && LIS3DH_Device_HasNewData(&Accelerometer))
+             { 
+                   //The shift and the sensitivity (4 mg/digit in normal mode at +-2 g)
+                   //come from the format descriptor of the profile
+                   LIS3DH_Device_GetMilliG(&Accelerometer, MilliG);
+                   ValueArray[1] = (uint8_t)(MilliG[0] & 0xFF);
+                   ValueArray[2] = (uint8_t)(MilliG[0] >> 8);
+                   ValueArray[3] = (uint8_t)(MilliG[1] & 0xFF);
+                   ValueArray[4] = (uint8_t)(MilliG[1] >> 8);
+                   ValueArray[5] = (uint8_t)(MilliG[2] & 0xFF);
+                   ValueArray[6] = (uint8_t)(MilliG[2] >> 8);
                 
-                   UART_Debug_PutArray(ValueArray, 8); //Sending the values to UART
+                   StreamOutput_Send(ValueArray, 8); //Sending the values to UART
                 
                    FlagIsr =0; //Set FlagIsr to 0 again
-                }
-                }
-              
-            }
+             }
         }
     }
 }
     
 
-/* [] END OF FILE */
+/* [] END OF FILE */
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*
+* This file includes the source code to measure
+* the throughput of the I2C bus.
+*/
+
+#include "BusBenchmark.h"
+#include "I2C_Interface.h"
+#include "CycleCounter.h"
+
+    /**
+    *   \brief Count the failed sample reads of all the devices.
+    */
+    static uint16_t BusBenchmark_Failures(const SampleScheduler* scheduler)
+    {
+        uint16_t failures = 0;
+        for (uint8_t i = 0; i < scheduler->device_count; i++)
+        {
+            failures += scheduler->devices[i]->failure_count;
+        }
+        return failures;
+    }
+    
+    ErrorCode BusBenchmark_Run(SampleScheduler* scheduler,
+                               uint16_t rounds,
+                               BusBenchmark_Result* result)
+    {
+        if (scheduler->device_count == 0 || scheduler->active || rounds == 0)
+        {
+            return ERROR;
+        }
+        
+        // Transactions and bytes of a round
+        uint16_t bursts = 0;
+        for (uint8_t i = 0; i < scheduler->device_count; i++)
+        {
+            bursts += scheduler->devices[i]->plan.burst_count;
+        }
+        uint16_t bytes = SampleScheduler_BusBytes(scheduler);
+        uint16_t failures = BusBenchmark_Failures(scheduler);
+        
+        uint32_t start = CycleCounter_Read();
+        uint32_t last_tick = start;
+        for (uint16_t i = 0; i < rounds; i++)
+        {
+            if (SampleScheduler_StartRound(scheduler) != NO_ERROR)
+            {
+                return ERROR;
+            }
+            do
+            {
+                I2C_Peripheral_ProcessTransfers();
+                
+                // Stuck transfers are aborted as they would be by the timer
+                uint32_t now = CycleCounter_Read();
+                if (CycleCounter_ToMicroseconds(now - last_tick) >= BUS_BENCHMARK_TICK_US)
+                {
+                    I2C_Peripheral_Tick();
+                    last_tick = now;
+                }
+            } while (!SampleScheduler_Poll(scheduler));
+        }
+        uint32_t elapsed = CycleCounter_ToMicroseconds(CycleCounter_Read() - start);
+        if (elapsed == 0)
+        {
+            elapsed = 1;
+        }
+        
+        result->data_rate_khz = I2C_Peripheral_GetDataRate();
+        result->rounds = rounds;
+        result->failures = BusBenchmark_Failures(scheduler) - failures;
+        result->transactions_per_second =
+            (uint32_t)(((uint64_t) bursts * rounds * 1000000u) / elapsed);
+        result->bytes_per_second =
+            (uint32_t)(((uint64_t) bytes * rounds * 1000000u) / elapsed);
+        return NO_ERROR;
+    }
+
+/* [] END OF FILE */
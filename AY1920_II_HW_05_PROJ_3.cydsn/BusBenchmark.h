@@ -0,0 +1,55 @@
+/** 
+ * \file BusBenchmark.h
+ * \brief Measurement of the throughput of the I2C bus.
+ *
+ * The benchmark repeats the rounds of sample reads of a scheduler as fast
+ * as possible, that is the same read pattern used by the stream, and
+ * measures with the cycle counter how many transactions and bytes per
+ * second the bus achieves at its current data rate.
+*/
+
+#ifndef BusBenchmark_H
+    #define BusBenchmark_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "SampleScheduler.h"
+    
+    /**
+    *   \brief Number of rounds of sample reads measured at each data rate.
+    */
+    #define BUS_BENCHMARK_ROUNDS 100
+    
+    /**
+    *   \brief Period of the ticks given to the I2C engine during a benchmark, in us.
+    *
+    *   The benchmark runs before the timer is started, so it counts the
+    *   ticks itself to keep the deadline of the transfers.
+    */
+    #define BUS_BENCHMARK_TICK_US 10000
+    
+    /**
+    *   \brief Throughput measured at one data rate.
+    */
+    typedef struct {
+        uint16_t data_rate_khz;             ///< Data rate of the bus
+        uint16_t rounds;                    ///< Rounds of sample reads performed
+        uint16_t failures;                  ///< Sample reads that failed
+        uint32_t transactions_per_second;   ///< Bursts completed per second
+        uint32_t bytes_per_second;          ///< Bytes moved on the bus per second
+    } BusBenchmark_Result;
+    
+    /**
+    *   \brief Measure the throughput of the bus at its current data rate.
+    *
+    *   \param scheduler Scheduler holding the devices and their read pattern.
+    *   \param rounds Number of rounds of sample reads to perform.
+    *   \param result Pointer to the structure where the results are saved.
+    *   \retval ERROR if the scheduler has no device or is already sampling.
+    */
+    ErrorCode BusBenchmark_Run(SampleScheduler* scheduler,
+                               uint16_t rounds,
+                               BusBenchmark_Result* result);
+    
+#endif // BusBenchmark_H
+/* [] END OF FILE */
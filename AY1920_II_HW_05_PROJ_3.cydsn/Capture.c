@@ -0,0 +1,199 @@
+/*
+* This file includes the source code to capture
+* the samples around a shock.
+*/
+
+#include "Capture.h"
+    
+    /**
+    *   \brief Integer square root, rounded down.
+    */
+    static uint16_t Capture_Sqrt(uint32_t value)
+    {
+        uint32_t root = 0;
+        uint32_t bit = (uint32_t) 1 << 30;
+        while (bit > value)
+        {
+            bit >>= 2;
+        }
+        while (bit != 0)
+        {
+            if (value >= root + bit)
+            {
+                value -= root + bit;
+                root = (root >> 1) + bit;
+            }
+            else
+            {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint16_t) root;
+    }
+    
+    static void Capture_Put16(uint8_t* data, uint16_t value)
+    {
+        data[0] = (uint8_t)(value & 0xFF);
+        data[1] = (uint8_t)(value >> 8);
+    }
+    
+    ErrorCode Capture_Init(Capture* capture, CaptureTrigger trigger,
+                           uint16_t threshold_mg, uint16_t hysteresis_mg,
+                           uint16_t pre_trigger, uint16_t post_trigger,
+                           uint16_t rate_hz)
+    {
+        if (trigger > CAPTURE_TRIGGER_AXIS || hysteresis_mg > threshold_mg ||
+            post_trigger == 0 || (uint32_t) pre_trigger + post_trigger > CAPTURE_BUFFER_SAMPLES)
+        {
+            return ERROR;
+        }
+        capture->trigger = trigger;
+        capture->threshold_mg = threshold_mg;
+        capture->hysteresis_mg = hysteresis_mg;
+        capture->trigger_level = (uint32_t) threshold_mg * threshold_mg;
+        capture->release_level = (uint32_t)(threshold_mg - hysteresis_mg) * (threshold_mg - hysteresis_mg);
+        capture->pre_trigger = pre_trigger;
+        capture->post_trigger = post_trigger;
+        capture->heartbeat_samples = rate_hz ? rate_hz : 1;
+        capture->since_heartbeat = 0;
+        capture->peak_level = 0;
+        capture->head = 0;
+        capture->stored = 0;
+        capture->unsent = 0;
+        capture->to_record = 0;
+        capture->events = 0;
+        capture->lost = 0;
+        capture->released = 1;
+        capture->state = CAPTURE_ARMED;
+        return NO_ERROR;
+    }
+    
+    void Capture_Push(Capture* capture, const LIS3DH_Format* format, const int16_t* xyz)
+    {
+        // The level is squared, so that the magnitude needs no square root
+        uint32_t level = 0;
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            int32_t value = LIS3DH_Format_ToMilliG(format, xyz[axis]);
+            uint32_t square = (uint32_t)(value * value);
+            if (capture->trigger == CAPTURE_TRIGGER_MAGNITUDE)
+            {
+                level += square;
+            }
+            else if (square > level)
+            {
+                level = square;
+            }
+        }
+        if (level > capture->peak_level)
+        {
+            capture->peak_level = level;
+        }
+    
+        // When the stream cannot keep up, the buffer wraps around and the
+        // sample written takes the place of the oldest one not sent
+        if (capture->state == CAPTURE_BURST && capture->unsent > 0 && capture->head == capture->read)
+        {
+            capture->read = (capture->read + 1) & (CAPTURE_BUFFER_SAMPLES - 1);
+            capture->offset++;
+            capture->unsent--;
+            capture->lost++;
+        }
+        
+        int16_t* sample = capture->samples[capture->head];
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            sample[axis] = xyz[axis];
+        }
+        capture->head = (capture->head + 1) & (CAPTURE_BUFFER_SAMPLES - 1);
+        if (capture->stored < CAPTURE_BUFFER_SAMPLES)
+        {
+            capture->stored++;
+        }
+        capture->since_heartbeat++;
+    
+        if (level < capture->release_level)
+        {
+            capture->released = 1;
+        }
+    
+        if (capture->state == CAPTURE_ARMED && level >= capture->trigger_level)
+        {
+            // The burst starts with the pre-trigger samples already stored
+            uint16_t pre = (capture->stored - 1 < capture->pre_trigger) ?
+                           capture->stored - 1 : capture->pre_trigger;
+            capture->read = (capture->head - 1 - pre) & (CAPTURE_BUFFER_SAMPLES - 1);
+            capture->unsent = pre + 1;
+            capture->to_record = capture->post_trigger - 1;
+            capture->offset = -(int16_t) pre;
+            capture->released = 0;
+            capture->events++;
+            capture->state = CAPTURE_BURST;
+        }
+        else if (capture->state == CAPTURE_BURST && capture->to_record > 0)
+        {
+            capture->to_record--;
+            capture->unsent++;
+        }
+        else if (capture->state == CAPTURE_HOLD && capture->released)
+        {
+            capture->state = CAPTURE_ARMED;
+        }
+    }
+    
+    uint8_t Capture_Process(Capture* capture, uint8_t* packet)
+    {
+        uint8_t length = 0;
+        if (capture->state != CAPTURE_BURST)
+        {
+            if (capture->since_heartbeat < capture->heartbeat_samples)
+            {
+                return 0;
+            }
+            packet[length++] = CAPTURE_HEARTBEAT_HEADER;
+            Capture_Put16(&packet[length], capture->events);
+            Capture_Put16(&packet[length + 2], capture->lost);
+            Capture_Put16(&packet[length + 4], Capture_Sqrt(capture->peak_level));
+            length += 6;
+            packet[length++] = 0xC0;
+            capture->since_heartbeat = 0;
+            capture->peak_level = 0;
+            return length;
+        }
+    
+        // Packets are filled, only the last one of the burst can be shorter
+        uint8_t count = (capture->unsent < CAPTURE_SAMPLES_PER_PACKET) ?
+                        capture->unsent : CAPTURE_SAMPLES_PER_PACKET;
+        if (count == 0 || (count < CAPTURE_SAMPLES_PER_PACKET && capture->to_record > 0))
+        {
+            if (capture->unsent == 0 && capture->to_record == 0)
+            {
+                capture->state = capture->released ? CAPTURE_ARMED : CAPTURE_HOLD;
+                capture->since_heartbeat = 0;
+            }
+            return 0;
+        }
+    
+        packet[length++] = CAPTURE_BURST_HEADER;
+        packet[length++] = (uint8_t) capture->events;
+        Capture_Put16(&packet[length], (uint16_t) capture->offset);
+        packet[length + 2] = count;
+        length += 3;
+        for (uint8_t n = 0; n < count; n++)
+        {
+            const int16_t* sample = capture->samples[capture->read];
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                Capture_Put16(&packet[length], (uint16_t) sample[axis]);
+                length += 2;
+            }
+            capture->read = (capture->read + 1) & (CAPTURE_BUFFER_SAMPLES - 1);
+        }
+        packet[length++] = 0xC0;
+        capture->unsent -= count;
+        capture->offset += count;
+        return length;
+    }
+
+/* [] END OF FILE */
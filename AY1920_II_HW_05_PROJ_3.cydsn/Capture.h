@@ -0,0 +1,143 @@
+/**
+ * \file Capture.h
+ * \brief Capture of the samples around a shock, on a threshold.
+ *
+ * The samples go continuously into a ring buffer. When the level of a
+ * sample reaches the threshold, the pre-trigger samples already in the
+ * buffer and the post-trigger samples that follow, starting with the one
+ * that triggered, are sent as a burst. The level is the magnitude of the
+ * acceleration or the largest of the three axes, in mg; a new burst can
+ * only start once the level has gone back below the threshold minus the
+ * hysteresis. While no burst is sent a heartbeat goes out every second.
+ *
+ *     burst:     0xAD, event, offset of the first sample from the trigger
+ *                (signed), count, count raw XYZ samples, 0xC0
+ *     heartbeat: 0xAB, events, samples lost, peak level since the last
+ *                heartbeat in mg, 0xC0
+ *
+ * All the 16-bit values are little endian, the raw samples are the output
+ * registers as in the combined packet. The burst is sent while the
+ * post-trigger samples are still coming: if the stream cannot keep up and
+ * the buffer wraps around, the oldest samples not sent yet are lost and
+ * the offsets show the gap.
+*/
+
+#ifndef Capture_H
+    #define Capture_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH_Format.h"
+
+    /**
+    *   \brief Samples held by the ring buffer, must be a power of 2.
+    *
+    *   24 KB of SRAM, about ten seconds at 400 Hz.
+    */
+    #define CAPTURE_BUFFER_SAMPLES 4096
+
+    /**
+    *   \brief First byte of the packets.
+    */
+    #define CAPTURE_BURST_HEADER 0xAD
+    #define CAPTURE_HEARTBEAT_HEADER 0xAB
+
+    /**
+    *   \brief Samples in a packet of the burst.
+    */
+    #define CAPTURE_SAMPLES_PER_PACKET 20
+
+    /**
+    *   \brief Size of the largest packet.
+    */
+    #define CAPTURE_MAX_PACKET (6 + 6 * CAPTURE_SAMPLES_PER_PACKET)
+
+    /**
+    *   \brief Size of a heartbeat.
+    */
+    #define CAPTURE_HEARTBEAT_SIZE 8
+
+    /**
+    *   \brief Level compared with the threshold.
+    */
+    typedef enum {
+        CAPTURE_TRIGGER_MAGNITUDE,      ///< Magnitude of the acceleration
+        CAPTURE_TRIGGER_AXIS            ///< Largest absolute value of the three axes
+    } CaptureTrigger;
+
+    /**
+    *   \brief State of the trigger.
+    */
+    typedef enum {
+        CAPTURE_ARMED,                  ///< Waiting for the level to reach the threshold
+        CAPTURE_BURST,                  ///< Sending the samples of an event
+        CAPTURE_HOLD                    ///< Burst sent, waiting for the level to go down
+    } CaptureState;
+
+    /**
+    *   \brief Ring buffer and state of the trigger.
+    */
+    typedef struct {
+        int16_t samples[CAPTURE_BUFFER_SAMPLES][3];         ///< Last raw samples
+        uint16_t head;                                      ///< Position of the next sample
+        uint16_t stored;                                    ///< Samples in the buffer
+        uint16_t read;                                      ///< Position of the next sample of the burst
+        uint16_t unsent;                                    ///< Samples of the burst stored but not sent
+        uint16_t to_record;                                 ///< Post-trigger samples still to come
+        int16_t offset;                                     ///< Offset from the trigger of the next sample sent
+        uint16_t threshold_mg;                              ///< Level that starts a burst
+        uint16_t hysteresis_mg;                             ///< Drop of the level that arms the trigger again
+        uint32_t trigger_level;                             ///< Squared level that starts a burst
+        uint32_t release_level;                             ///< Squared level that arms the trigger again
+        uint32_t peak_level;                                ///< Squared largest level since the last heartbeat
+        uint16_t pre_trigger;                               ///< Samples sent before the trigger
+        uint16_t post_trigger;                              ///< Samples sent from the trigger on
+        uint16_t heartbeat_samples;                         ///< Samples between two heartbeats
+        uint16_t since_heartbeat;                           ///< Samples since the last heartbeat
+        uint16_t events;                                    ///< Bursts started
+        uint16_t lost;                                      ///< Samples of the bursts overwritten before being sent
+        uint8_t released;                                   ///< True once the level went below the release level
+        CaptureTrigger trigger;                             ///< Level compared with the threshold
+        CaptureState state;                                 ///< State of the trigger
+    } Capture;
+
+    /**
+    *   \brief Empty the buffer and arm the trigger.
+    *
+    *   \param capture Pointer to the capture.
+    *   \param trigger Level compared with the threshold.
+    *   \param threshold_mg Level that starts a burst.
+    *   \param hysteresis_mg Drop of the level that arms the trigger again.
+    *   \param pre_trigger Samples sent before the one that triggered.
+    *   \param post_trigger Samples sent from the one that triggered on.
+    *   \param rate_hz Rate of the samples, one heartbeat is sent every rate_hz samples.
+    *   \retval ERROR if the burst does not fit in the buffer or the
+    *   hysteresis is larger than the threshold.
+    */
+    ErrorCode Capture_Init(Capture* capture, CaptureTrigger trigger,
+                           uint16_t threshold_mg, uint16_t hysteresis_mg,
+                           uint16_t pre_trigger, uint16_t post_trigger,
+                           uint16_t rate_hz);
+
+    /**
+    *   \brief Add a sample and check it against the threshold.
+    *
+    *   \param capture Pointer to the capture.
+    *   \param format Format of the raw values, used to compute the level.
+    *   \param xyz Raw values of the three axes.
+    */
+    void Capture_Push(Capture* capture, const LIS3DH_Format* format, const int16_t* xyz);
+
+    /**
+    *   \brief Write the next packet to be sent, if any.
+    *
+    *   This function must be called from the main loop when the stream has
+    *   room for CAPTURE_MAX_PACKET bytes.
+    *   \param capture Pointer to the capture.
+    *   \param packet Array of CAPTURE_MAX_PACKET bytes.
+    *   \retval Number of bytes of the packet, 0 if nothing is due.
+    */
+    uint8_t Capture_Process(Capture* capture, uint8_t* packet);
+
+#endif // Capture_H
+/* [] END OF FILE */
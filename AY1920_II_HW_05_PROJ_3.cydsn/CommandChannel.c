@@ -0,0 +1,191 @@
+/*
+* This file includes the source code to receive
+* and parse commands on the UART RX line.
+*/
+
+#include "CommandChannel.h"
+#include "UART_Debug.h"
+#include "StreamOutput.h"
+
+    /**
+    *   \brief States of the frame parser.
+    */
+    typedef enum {
+        COMMAND_STATE_SYNC,
+        COMMAND_STATE_ID,
+        COMMAND_STATE_LENGTH,
+        COMMAND_STATE_PAYLOAD,
+        COMMAND_STATE_CHECKSUM
+    } CommandState;
+    
+    // The interrupt only writes the head and the main loop only writes the
+    // tail, so the buffer needs no critical section
+    static volatile uint8_t CommandChannel_Buffer[COMMAND_CHANNEL_BUFFER_SIZE];
+    static volatile uint8_t CommandChannel_Head = 0;
+    static volatile uint8_t CommandChannel_Tail = 0;
+    static volatile uint16_t CommandChannel_Overflows = 0;
+    
+    static CommandState CommandChannel_State = COMMAND_STATE_SYNC;
+    static Command CommandChannel_Frame;
+    static uint8_t CommandChannel_Index = 0;
+    static uint8_t CommandChannel_Checksum = 0;
+    
+    void CommandChannel_Start(void)
+    {
+        CommandChannel_Tail = CommandChannel_Head;
+        CommandChannel_Overflows = 0;
+        CommandChannel_State = COMMAND_STATE_SYNC;
+    }
+    
+    void CommandChannel_Receive(void)
+    {
+        while (UART_Debug_ReadRxStatus() & UART_Debug_RX_STS_FIFO_NOTEMPTY)
+        {
+            uint8_t byte = UART_Debug_ReadRxData();
+            uint8_t next = (CommandChannel_Head + 1) & (COMMAND_CHANNEL_BUFFER_SIZE - 1);
+            if (next == CommandChannel_Tail)
+            {
+                CommandChannel_Overflows++;
+                continue;
+            }
+            CommandChannel_Buffer[CommandChannel_Head] = byte;
+            CommandChannel_Head = next;
+        }
+    }
+    
+    uint8_t CommandChannel_Poll(Command* command)
+    {
+        while (CommandChannel_Tail != CommandChannel_Head)
+        {
+            uint8_t byte = CommandChannel_Buffer[CommandChannel_Tail];
+            CommandChannel_Tail = (CommandChannel_Tail + 1) & (COMMAND_CHANNEL_BUFFER_SIZE - 1);
+            
+            switch (CommandChannel_State)
+            {
+                case COMMAND_STATE_SYNC:
+                    if (byte == COMMAND_CHANNEL_SYNC)
+                    {
+                        CommandChannel_State = COMMAND_STATE_ID;
+                    }
+                    break;
+                    
+                case COMMAND_STATE_ID:
+                    CommandChannel_Frame.id = byte;
+                    CommandChannel_Checksum = byte;
+                    CommandChannel_State = COMMAND_STATE_LENGTH;
+                    break;
+                    
+                case COMMAND_STATE_LENGTH:
+                    // A frame too long for the buffer cannot be a valid one
+                    if (byte > COMMAND_CHANNEL_MAX_PAYLOAD)
+                    {
+                        CommandChannel_State = COMMAND_STATE_SYNC;
+                        break;
+                    }
+                    CommandChannel_Frame.length = byte;
+                    CommandChannel_Checksum ^= byte;
+                    CommandChannel_Index = 0;
+                    CommandChannel_State = (byte > 0) ? COMMAND_STATE_PAYLOAD : COMMAND_STATE_CHECKSUM;
+                    break;
+                    
+                case COMMAND_STATE_PAYLOAD:
+                    CommandChannel_Frame.payload[CommandChannel_Index++] = byte;
+                    CommandChannel_Checksum ^= byte;
+                    if (CommandChannel_Index == CommandChannel_Frame.length)
+                    {
+                        CommandChannel_State = COMMAND_STATE_CHECKSUM;
+                    }
+                    break;
+                    
+                case COMMAND_STATE_CHECKSUM:
+                    CommandChannel_State = COMMAND_STATE_SYNC;
+                    if (byte == CommandChannel_Checksum)
+                    {
+                        *command = CommandChannel_Frame;
+                        return 1;
+                    }
+                    break;
+            }
+        }
+        return 0;
+    }
+    
+    ErrorCode CommandChannel_ParseConfigure(const Command* command,
+                                            LIS3DH_Profile* profile,
+                                            StreamFormat* format)
+    {
+        if (command->length != COMMAND_CONFIGURE_LENGTH)
+        {
+            return ERROR;
+        }
+        
+        const uint8_t* payload = command->payload;
+        if (payload[0] > LIS3DH_MODE_HIGH_RESOLUTION ||
+            payload[1] > LIS3DH_ODR_1344HZ ||
+            payload[2] > LIS3DH_FSR_16G ||
+            payload[3] > 1 ||
+            payload[4] > STREAM_FORMAT_CAPTURE)
+        {
+            return ERROR;
+        }
+        
+        // 1.620 kHz exists in low-power mode only
+        if (payload[1] == LIS3DH_ODR_1620HZ && payload[0] != LIS3DH_MODE_LOW_POWER)
+        {
+            return ERROR;
+        }
+        
+        profile->mode = (LIS3DH_Mode) payload[0];
+        profile->odr = (LIS3DH_Odr) payload[1];
+        profile->fsr = (LIS3DH_Fsr) payload[2];
+        profile->bdu = payload[3];
+        *format = (StreamFormat) payload[4];
+        return NO_ERROR;
+    }
+    
+    void CommandChannel_SendDescriptor(uint8_t status,
+                                       const LIS3DH_Profile* profile,
+                                       StreamFormat format,
+                                       const StreamBudget* budget)
+    {
+        uint8_t descriptor[COMMAND_CHANNEL_DESCRIPTOR_SIZE] = {
+            COMMAND_CHANNEL_ACK,
+            status,
+            profile->mode,
+            profile->odr,
+            profile->fsr,
+            profile->bdu,
+            format,
+            (uint8_t)(budget->odr_hz & 0xFF),
+            (uint8_t)(budget->odr_hz >> 8),
+            LIS3DH_Profile_Format(profile)->mg_per_digit,
+            LIS3DH_Profile_Format(profile)->shift,
+            budget->decimation,
+            0xC0
+        };
+        StreamOutput_Send(descriptor, COMMAND_CHANNEL_DESCRIPTOR_SIZE);
+    }
+    
+    void CommandChannel_SendTxStats(void)
+    {
+        uint16_t high_water = StreamOutput_GetHighWaterMark();
+        uint16_t tx_overflows = StreamOutput_GetOverflowCount();
+        uint8_t stats[COMMAND_CHANNEL_TX_STATS_SIZE] = {
+            COMMAND_CHANNEL_TX_STATS,
+            (uint8_t)(high_water & 0xFF),
+            (uint8_t)(high_water >> 8),
+            (uint8_t)(tx_overflows & 0xFF),
+            (uint8_t)(tx_overflows >> 8),
+            (uint8_t)(CommandChannel_Overflows & 0xFF),
+            (uint8_t)(CommandChannel_Overflows >> 8),
+            0xC0
+        };
+        StreamOutput_Send(stats, COMMAND_CHANNEL_TX_STATS_SIZE);
+    }
+    
+    uint16_t CommandChannel_GetOverflowCount(void)
+    {
+        return CommandChannel_Overflows;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,192 @@
+/** 
+ * \file CommandChannel.h
+ * \brief Binary command protocol on the RX line of UART_Debug.
+ *
+ * The bytes received by the UART are saved by its RX interrupt (isr_RX),
+ * or by the main loop when the schematic has none, in a ring buffer, and
+ * parsed from the main loop. Each command is framed as:
+ *
+ *     0xB0, command, payload length, payload, checksum
+ *
+ * where the checksum is the XOR of command, length and payload bytes.
+ * Frames with a wrong length or checksum are dropped and the parser looks
+ * for the next 0xB0.
+*/
+
+#ifndef CommandChannel_H
+    #define CommandChannel_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH_Profiles.h"
+    #include "StreamBudget.h"
+    
+    /**
+    *   \brief Size of the receive ring buffer, must be a power of 2.
+    */
+    #define COMMAND_CHANNEL_BUFFER_SIZE 32
+    
+    /**
+    *   \brief Longest payload of a command.
+    */
+    #define COMMAND_CHANNEL_MAX_PAYLOAD 9
+    
+    /**
+    *   \brief First byte of a command frame.
+    */
+    #define COMMAND_CHANNEL_SYNC 0xB0
+    
+    /**
+    *   \brief Commands accepted on the channel.
+    */
+    typedef enum {
+        COMMAND_GET_DESCRIPTOR = 0x01,  ///< No payload, answer with the stream descriptor
+        COMMAND_CONFIGURE = 0x02,       ///< Payload: mode, ODR, FSR, BDU, packet format
+        COMMAND_SET_FRAMING = 0x03,     ///< Payload: 1 to send the packets inside frames, 0 not to
+        COMMAND_SET_BATCH = 0x04,       ///< Payload: samples per batch, max latency in ms (16 bits LE)
+        COMMAND_GET_TX_STATS = 0x05,    ///< No payload, answer with the counters of the TX buffer
+        COMMAND_SET_WINDOW = 0x06,      ///< Payload: window and hop of the statistics (16 bits LE each)
+        COMMAND_SET_SPECTRUM = 0x07,    ///< Payload: log2 of the FFT points, peaks per axis (0 for all bins)
+        COMMAND_SET_TRIGGER = 0x08,     ///< Payload: level, threshold and hysteresis in mg, pre- and post-trigger samples (16 bits LE each)
+    } CommandId;
+    
+    /**
+    *   \brief Payload length of COMMAND_CONFIGURE.
+    */
+    #define COMMAND_CONFIGURE_LENGTH 5
+    
+    /**
+    *   \brief Payload length of COMMAND_SET_BATCH.
+    */
+    #define COMMAND_SET_BATCH_LENGTH 3
+    
+    /**
+    *   \brief Payload length of COMMAND_SET_WINDOW.
+    */
+    #define COMMAND_SET_WINDOW_LENGTH 4
+    
+    /**
+    *   \brief Payload length of COMMAND_SET_SPECTRUM.
+    */
+    #define COMMAND_SET_SPECTRUM_LENGTH 2
+    
+    /**
+    *   \brief Payload length of COMMAND_SET_TRIGGER.
+    */
+    #define COMMAND_SET_TRIGGER_LENGTH 9
+    
+    /**
+    *   \brief First byte of the stream descriptor sent as acknowledge.
+    */
+    #define COMMAND_CHANNEL_ACK 0xB1
+    
+    /**
+    *   \brief Size of the stream descriptor.
+    */
+    #define COMMAND_CHANNEL_DESCRIPTOR_SIZE 13
+    
+    /**
+    *   \brief First byte of the answer to COMMAND_GET_TX_STATS.
+    */
+    #define COMMAND_CHANNEL_TX_STATS 0xB2
+    
+    /**
+    *   \brief Size of the answer to COMMAND_GET_TX_STATS.
+    */
+    #define COMMAND_CHANNEL_TX_STATS_SIZE 8
+    
+    /**
+    *   \brief Status of the acknowledge, the refusals of the stream budget use
+    *   the values of StreamVerdict.
+    */
+    #define COMMAND_STATUS_OK 0x00
+    #define COMMAND_STATUS_BUS_ERROR 0xFD
+    #define COMMAND_STATUS_INVALID 0xFE
+    #define COMMAND_STATUS_UNKNOWN 0xFF
+    
+    /**
+    *   \brief Format of the packets of single samples.
+    */
+    typedef enum {
+        STREAM_FORMAT_CONVERTED,        ///< XYZ in mm/s^2, 32 bits each (14-byte packet)
+        STREAM_FORMAT_RAW,              ///< Raw XYZ output registers (combined packet)
+        STREAM_FORMAT_MILLI_G,          ///< XYZ in mg, 32 bits each (14-byte packet)
+        STREAM_FORMAT_PACKED,           ///< Raw XYZ bit-packed in 4 or 5 bytes, see PackedSample.h
+        STREAM_FORMAT_COMPRESSED,       ///< Raw XYZ delta-coded in blocks, see DeltaCodec.h
+        STREAM_FORMAT_BATCHED,          ///< Raw XYZ bit-packed, several samples per packet, see SampleBatch.h
+        STREAM_FORMAT_TIMESTAMPED,      ///< Raw XYZ bit-packed followed by its timestamp, see Timestamp.h
+        STREAM_FORMAT_STATISTICS,       ///< Summaries of windows of samples, see WindowStats.h
+        STREAM_FORMAT_SPECTRUM,         ///< Magnitude bins or peaks of the FFT, see Spectrum.h
+        STREAM_FORMAT_CAPTURE           ///< Raw XYZ around the samples over a threshold, see Capture.h
+    } StreamFormat;
+    
+    /**
+    *   \brief Command received on the channel.
+    */
+    typedef struct {
+        uint8_t id;                                     ///< Command identifier
+        uint8_t length;                                 ///< Number of payload bytes
+        uint8_t payload[COMMAND_CHANNEL_MAX_PAYLOAD];   ///< Payload of the command
+    } Command;
+    
+    /**
+    *   \brief Empty the ring buffer and reset the parser.
+    */
+    void CommandChannel_Start(void);
+    
+    /**
+    *   \brief Move the bytes received by the UART to the ring buffer.
+    *
+    *   This function must be called from the RX interrupt of the UART or,
+    *   when there is no such interrupt, from the main loop only.
+    */
+    void CommandChannel_Receive(void);
+    
+    /**
+    *   \brief Parse the bytes received so far.
+    *
+    *   \param command Pointer to the structure where a command is saved.
+    *   \retval Returns true (>0) when a complete command has been parsed.
+    */
+    uint8_t CommandChannel_Poll(Command* command);
+    
+    /**
+    *   \brief Apply the payload of COMMAND_CONFIGURE to a profile.
+    *
+    *   The profile is changed only if all the values are valid.
+    *   \param command Pointer to the command.
+    *   \param profile Pointer to the profile to be changed.
+    *   \param format Pointer to the packet format to be changed.
+    *   \retval ERROR if the payload holds an invalid value.
+    */
+    ErrorCode CommandChannel_ParseConfigure(const Command* command,
+                                            LIS3DH_Profile* profile,
+                                            StreamFormat* format);
+    
+    /**
+    *   \brief Send the stream descriptor that acknowledges a command.
+    *
+    *   0xB1, status, mode, ODR, FSR, BDU, packet format, ODR in Hz (16 bits,
+    *   little endian), sensitivity in mg/digit, right shift of the raw
+    *   values, decimation of the stream and 0xC0.
+    */
+    void CommandChannel_SendDescriptor(uint8_t status,
+                                       const LIS3DH_Profile* profile,
+                                       StreamFormat format,
+                                       const StreamBudget* budget);
+    
+    /**
+    *   \brief Send the counters of the TX buffer and of the command buffer.
+    *
+    *   0xB2, high-water mark of the TX buffer, packets lost by the TX buffer,
+    *   bytes lost by the command buffer (16 bits each, little endian) and 0xC0.
+    */
+    void CommandChannel_SendTxStats(void);
+    
+    /**
+    *   \brief Number of bytes lost because the ring buffer was full.
+    */
+    uint16_t CommandChannel_GetOverflowCount(void);
+    
+#endif // CommandChannel_H
+/* [] END OF FILE */
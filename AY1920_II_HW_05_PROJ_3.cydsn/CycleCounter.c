@@ -0,0 +1,40 @@
+/*
+* This file includes the source code to start the
+* cycle counter of the Cortex-M3 core.
+*/
+
+#include "CycleCounter.h"
+
+    static uint32_t CycleCounter_Last = 0;
+    static uint32_t CycleCounter_Remainder = 0;
+    static uint32_t CycleCounter_Us = 0;
+    
+    void CycleCounter_Start(void)
+    {
+        // Enable the DWT unit, then reset and enable its cycle counter
+        CYCLE_COUNTER_DEMCR_REG |= CYCLE_COUNTER_DEMCR_TRCENA;
+        CYCLE_COUNTER_DWT_CYCCNT_REG = 0;
+        CYCLE_COUNTER_DWT_CTRL_REG |= CYCLE_COUNTER_DWT_CTRL_CYCCNTENA;
+        CycleCounter_Last = 0;
+        CycleCounter_Remainder = 0;
+        CycleCounter_Us = 0;
+    }
+    
+    uint32_t CycleCounter_Microseconds(void)
+    {
+        // The cycles that do not make a whole microsecond are kept for the next call
+        uint32_t now = CycleCounter_Read();
+        uint32_t cycles = (now - CycleCounter_Last) + CycleCounter_Remainder;
+        CycleCounter_Last = now;
+        CycleCounter_Us += cycles / BCLK__BUS_CLK__MHZ;
+        CycleCounter_Remainder = cycles % BCLK__BUS_CLK__MHZ;
+        return CycleCounter_Us;
+    }
+    
+    uint32_t CycleCounter_ToTimestamp(uint32_t cycles)
+    {
+        uint32_t now_us = CycleCounter_Microseconds();
+        return now_us - CycleCounter_ToMicroseconds(CycleCounter_Last - cycles);
+    }
+
+/* [] END OF FILE */
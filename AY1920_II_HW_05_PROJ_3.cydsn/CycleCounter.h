@@ -0,0 +1,70 @@
+/** 
+ * \file CycleCounter.h
+ * \brief Cycle counter of the Cortex-M3 core.
+ *
+ * The DWT unit of the core counts the CPU clock cycles with a free-running
+ * 32-bit counter. It is used to measure the time spent by the firmware
+ * without using any PSoC resource.
+*/
+
+#ifndef CycleCounter_H
+    #define CycleCounter_H
+    
+    #include "cytypes.h"
+    #include "cyfitter.h"
+    
+    /**
+    *   \brief Debug Exception and Monitor Control register, enables the DWT unit.
+    */
+    #define CYCLE_COUNTER_DEMCR_REG (*(reg32 *) 0xE000EDFCu)
+    #define CYCLE_COUNTER_DEMCR_TRCENA 0x01000000u
+    
+    /**
+    *   \brief DWT Control register, enables the cycle counter.
+    */
+    #define CYCLE_COUNTER_DWT_CTRL_REG (*(reg32 *) 0xE0001000u)
+    #define CYCLE_COUNTER_DWT_CTRL_CYCCNTENA 0x00000001u
+    
+    /**
+    *   \brief DWT Cycle Count register, replaced by a simulated clock in the
+    *   host tests.
+    */
+    #ifndef CYCLE_COUNTER_DWT_CYCCNT_REG
+        #define CYCLE_COUNTER_DWT_CYCCNT_REG (*(reg32 *) 0xE0001004u)
+    #endif
+    
+    /**
+    *   \brief Read the number of cycles counted since CycleCounter_Start.
+    */
+    #define CycleCounter_Read() ((uint32_t) CYCLE_COUNTER_DWT_CYCCNT_REG)
+    
+    /**
+    *   \brief Convert a number of cycles of the CPU clock to microseconds.
+    */
+    #define CycleCounter_ToMicroseconds(cycles) ((uint32_t)(cycles) / BCLK__BUS_CLK__MHZ)
+    
+    /**
+    *   \brief Reset and start the cycle counter.
+    */
+    void CycleCounter_Start(void);
+    
+    /**
+    *   \brief Read the microseconds elapsed since CycleCounter_Start.
+    *
+    *   The cycles are accumulated at each call, so the time keeps growing
+    *   after the cycle counter wraps around (every 179 s at 24 MHz), as
+    *   long as the function is called at least once per wrap. The value
+    *   itself wraps around after about 71 minutes.
+    */
+    uint32_t CycleCounter_Microseconds(void);
+    
+    /**
+    *   \brief Convert a cycle count read earlier to the time base of
+    *   CycleCounter_Microseconds.
+    *
+    *   \param cycles Value of CycleCounter_Read, less than 179 s old.
+    */
+    uint32_t CycleCounter_ToTimestamp(uint32_t cycles);
+    
+#endif // CycleCounter_H
+/* [] END OF FILE */
@@ -0,0 +1,115 @@
+/*
+* This file includes the source code to filter
+* and decimate the acceleration samples.
+*/
+
+#include "Decimator.h"
+
+    /**
+    *   \brief Saturate a value to 16 bits.
+    */
+    static int16_t Decimator_Clamp(int32_t value)
+    {
+        if (value > INT16_MAX)
+        {
+            return INT16_MAX;
+        }
+        if (value < INT16_MIN)
+        {
+            return INT16_MIN;
+        }
+        return (int16_t) value;
+    }
+    
+    void Decimator_Init(Decimator* decimator, uint8_t rate, uint8_t filtered)
+    {
+        if (rate < 1)
+        {
+            rate = 1;
+        }
+        else if (rate > DECIMATOR_MAX_RATE)
+        {
+            rate = DECIMATOR_MAX_RATE;
+        }
+        decimator->rate = rate;
+        decimator->phase = 0;
+        decimator->filtered = filtered && rate > 1;
+        
+        uint32_t cube = (uint32_t) rate * rate * rate;
+        decimator->gain = (cube == 1) ? UINT32_MAX : (uint32_t)((((uint64_t) 1 << 32) + cube / 2) / cube);
+        
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            for (uint8_t i = 0; i < DECIMATOR_ORDER; i++)
+            {
+                decimator->integrators[axis][i] = 0;
+                decimator->combs[axis][i] = 0;
+            }
+            decimator->history[axis][0] = 0;
+            decimator->history[axis][1] = 0;
+        }
+    }
+    
+    uint8_t Decimator_Push(Decimator* decimator, const int16_t* in, int16_t* out)
+    {
+        if (!decimator->filtered)
+        {
+            if (decimator->phase++ != 0)
+            {
+                decimator->phase %= decimator->rate;
+                return 0;
+            }
+            decimator->phase %= decimator->rate;
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                out[axis] = in[axis];
+            }
+            return 1;
+        }
+        
+        // The integrators wrap around, the combs take the wraps away as long
+        // as the output fits in 32 bits
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            uint32_t* integrator = decimator->integrators[axis];
+            integrator[0] += (uint32_t)(int32_t) in[axis];
+            integrator[1] += integrator[0];
+            integrator[2] += integrator[1];
+        }
+        if (++decimator->phase < decimator->rate)
+        {
+            return 0;
+        }
+        decimator->phase = 0;
+        
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            uint32_t value = decimator->integrators[axis][DECIMATOR_ORDER - 1];
+            for (uint8_t i = 0; i < DECIMATOR_ORDER; i++)
+            {
+                uint32_t delayed = decimator->combs[axis][i];
+                decimator->combs[axis][i] = value;
+                value -= delayed;
+            }
+            
+            // Rounded division by rate^3, then the compensator
+            int32_t cic = (int32_t)(((int64_t)(int32_t) value * decimator->gain + ((int64_t) 1 << 31)) >> 32);
+            int32_t* history = decimator->history[axis];
+            int32_t sum = -3 * cic + 22 * history[0] - 3 * history[1];
+            history[1] = history[0];
+            history[0] = cic;
+            out[axis] = Decimator_Clamp((sum + 8) >> 4);
+        }
+        return 1;
+    }
+    
+    void Decimator_TestSignal(uint16_t n, int16_t* xyz)
+    {
+        uint32_t hash = (n + 1) * 2654435761u;
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            xyz[axis] = (int16_t)(hash >> (8 * axis));
+        }
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,91 @@
+/** 
+ * \file Decimator.h
+ * \brief Low-pass decimation of the acceleration samples.
+ *
+ * When the UART cannot carry every sample, or a lower output rate is
+ * chosen, one sample out of rate is sent. Without a filter, everything
+ * above half the output rate aliases into the stream; the decimator
+ * filters each axis first, with integer arithmetic only:
+ *
+ *  - a CIC filter of order 3 (three integrators at the input rate,
+ *    three combs at the output rate), whose gain rate^3 is removed with
+ *    a 32-bit reciprocal;
+ *  - a 3-tap compensator (-3, 22, -3) / 16 at the output rate, which
+ *    flattens the droop of the CIC up to a quarter of the output rate.
+ *
+ * The values keep the scale of the input, so the filter sits between the
+ * sample read and the packet formats. The code has no dependency on the
+ * PSoC: built on the host, it gives bit-exact reference outputs.
+*/
+
+#ifndef Decimator_H
+    #define Decimator_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Order of the CIC filter.
+    */
+    #define DECIMATOR_ORDER 3
+    
+    /**
+    *   \brief Highest decimation rate, the CIC grows by 15 bits at most.
+    */
+    #define DECIMATOR_MAX_RATE 32
+    
+    /**
+    *   \brief Filter state of the three axes.
+    */
+    typedef struct {
+        uint32_t integrators[3][DECIMATOR_ORDER];   ///< Integrators, at the input rate
+        uint32_t combs[3][DECIMATOR_ORDER];         ///< Previous inputs of the combs
+        int32_t history[3][2];                      ///< Previous outputs of the CIC
+        uint32_t gain;                              ///< 2^32 / rate^3, saturated
+        uint8_t rate;                               ///< One output every rate inputs
+        uint8_t phase;                              ///< Inputs since the last output
+        uint8_t filtered;                           ///< False to keep one sample out of rate
+    } Decimator;
+    
+    /**
+    *   \brief Reset the decimator.
+    *
+    *   \param decimator Pointer to the decimator.
+    *   \param rate One sample out of rate is sent (1 to DECIMATOR_MAX_RATE).
+    *   \param filtered True to low-pass filter the samples, false to drop them.
+    */
+    void Decimator_Init(Decimator* decimator, uint8_t rate, uint8_t filtered);
+    
+    /**
+    *   \brief Feed a sample of the three axes.
+    *
+    *   \param decimator Pointer to the decimator.
+    *   \param in Values of the three axes.
+    *   \param out Array where the output values are saved, can be the input.
+    *   \retval Returns true (>0) when an output sample is ready.
+    */
+    uint8_t Decimator_Push(Decimator* decimator, const int16_t* in, int16_t* out);
+    
+    /**
+    *   \brief Decimation rate and length of the test signal run at boot.
+    */
+    #define DECIMATOR_TEST_RATE 8
+    #define DECIMATOR_TEST_SAMPLES 256
+    
+    /**
+    *   \brief CRC of the outputs of the test signal, as given by the host build.
+    *
+    *   Frame_Crc16 from FRAME_CRC_INIT over the three little-endian values
+    *   of each output, filtered at DECIMATOR_TEST_RATE.
+    */
+    #define DECIMATOR_TEST_CRC 0x1D37
+    
+    /**
+    *   \brief Sample n of the test signal, white noise on the three axes.
+    *
+    *   The outputs of the decimator fed with this signal are compared with
+    *   the ones of the host build to check that they are bit-exact.
+    */
+    void Decimator_TestSignal(uint16_t n, int16_t* xyz);
+    
+#endif // Decimator_H
+/* [] END OF FILE */
@@ -0,0 +1,240 @@
+/*
+* This file includes the source code to compress
+* and decompress the stream of samples.
+*/
+
+#include "DeltaCodec.h"
+
+    /**
+    *   \brief Map a difference to an unsigned value, small in magnitude first.
+    *
+    *   Differences wrap around in 16 bits on both sides, so any pair of
+    *   samples can be encoded.
+    */
+    #define DeltaCodec_Zigzag(delta) ((uint16_t)(((uint16_t)(delta) << 1) ^ (uint16_t)((int16_t)(delta) >> 15)))
+    #define DeltaCodec_Unzigzag(value) ((int16_t)(((value) >> 1) ^ (uint16_t)(-(int16_t)((value) & 1))))
+    
+    /**
+    *   \brief Number of bits needed by a value, with a single CLZ instruction.
+    */
+    #define DeltaCodec_Width(mask) ((mask) ? (uint8_t)(32 - __builtin_clz(mask)) : 0)
+    
+    /**
+    *   \brief XOR of the bytes of a packet.
+    */
+    static uint8_t DeltaCodec_Checksum(const uint8_t* packet, uint8_t length)
+    {
+        uint8_t checksum = 0;
+        for (uint8_t i = 0; i < length; i++)
+        {
+            checksum ^= packet[i];
+        }
+        return checksum;
+    }
+    
+    /**
+    *   \brief Pack the values of one axis of a block, MSB first.
+    *
+    *   With 8 values, width bits each fill exactly width bytes.
+    */
+    static void DeltaCodec_PackAxis(const uint16_t* values, uint8_t width, uint8_t* data)
+    {
+        uint32_t accumulator = 0;
+        uint8_t bits = 0;
+        for (uint8_t i = 0; i < DELTA_CODEC_BLOCK_SIZE; i++)
+        {
+            accumulator = (accumulator << width) | values[i];
+            bits += width;
+            while (bits >= 8)
+            {
+                bits -= 8;
+                *data++ = (uint8_t)(accumulator >> bits);
+            }
+        }
+    }
+    
+    /**
+    *   \brief Unpack the values of one axis of a block.
+    */
+    static void DeltaCodec_UnpackAxis(const uint8_t* data, uint8_t width, uint16_t* values)
+    {
+        uint32_t accumulator = 0;
+        uint8_t bits = 0;
+        uint16_t mask = (uint16_t)((1ul << width) - 1);
+        for (uint8_t i = 0; i < DELTA_CODEC_BLOCK_SIZE; i++)
+        {
+            while (bits < width)
+            {
+                accumulator = (accumulator << 8) | *data++;
+                bits += 8;
+            }
+            bits -= width;
+            values[i] = (uint16_t)(accumulator >> bits) & mask;
+        }
+    }
+    
+    void DeltaCodec_InitEncoder(DeltaEncoder* encoder)
+    {
+        encoder->count = 0;
+        encoder->blocks = DELTA_CODEC_FRAME_BLOCKS;
+        encoder->sequence = 0;
+    }
+    
+    uint8_t DeltaCodec_Encode(DeltaEncoder* encoder, const int16_t* xyz, uint8_t* packet)
+    {
+        // A new frame starts with the absolute values
+        if (encoder->blocks == DELTA_CODEC_FRAME_BLOCKS)
+        {
+            packet[0] = DELTA_CODEC_KEYFRAME;
+            packet[1] = encoder->sequence++;
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                encoder->previous[axis] = xyz[axis];
+                encoder->width_mask[axis] = 0;
+                packet[2 + 2 * axis] = (uint8_t)(xyz[axis] & 0xFF);
+                packet[3 + 2 * axis] = (uint8_t)((uint16_t) xyz[axis] >> 8);
+            }
+            packet[8] = DeltaCodec_Checksum(packet, 8);
+            encoder->blocks = 0;
+            encoder->count = 0;
+            return DELTA_CODEC_KEYFRAME_SIZE;
+        }
+        
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            uint16_t value = DeltaCodec_Zigzag(xyz[axis] - encoder->previous[axis]);
+            encoder->zigzag[axis][encoder->count] = value;
+            encoder->width_mask[axis] |= value;
+            encoder->previous[axis] = xyz[axis];
+        }
+        if (++encoder->count < DELTA_CODEC_BLOCK_SIZE)
+        {
+            return 0;
+        }
+        
+        // The block is full: each axis gets the width of its largest value
+        uint8_t width[3];
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            width[axis] = DeltaCodec_Width(encoder->width_mask[axis]);
+            encoder->width_mask[axis] = 0;
+        }
+        packet[0] = DELTA_CODEC_BLOCK;
+        packet[1] = (uint8_t)((width[0] << 3) | (width[1] >> 2));
+        packet[2] = (uint8_t)(((width[1] & 0x03) << 6) | (width[2] << 1));
+        
+        uint8_t length = 3;
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            DeltaCodec_PackAxis(encoder->zigzag[axis], width[axis], &packet[length]);
+            length += width[axis];
+        }
+        packet[length] = DeltaCodec_Checksum(packet, length);
+        
+        encoder->count = 0;
+        encoder->blocks++;
+        return length + 1;
+    }
+    
+    uint8_t DeltaCodec_WorstCaseBytes(uint8_t bits)
+    {
+        // A difference of two values of n bits takes n + 1 bits once mapped
+        uint16_t frame_bytes = DELTA_CODEC_KEYFRAME_SIZE +
+                               DELTA_CODEC_FRAME_BLOCKS * DELTA_CODEC_BLOCK_LENGTH(bits + 1, bits + 1, bits + 1);
+        return (uint8_t)((frame_bytes + DELTA_CODEC_FRAME_SAMPLES - 1) / DELTA_CODEC_FRAME_SAMPLES);
+    }
+    
+    void DeltaCodec_InitDecoder(DeltaDecoder* decoder)
+    {
+        decoder->length = 0;
+        decoder->synced = 0;
+        decoder->errors = 0;
+    }
+    
+    uint8_t DeltaCodec_Decode(DeltaDecoder* decoder, uint8_t byte, int16_t samples[][3])
+    {
+        // Bytes outside a packet are skipped until a packet starts
+        if (decoder->length == 0)
+        {
+            if (byte == DELTA_CODEC_KEYFRAME)
+            {
+                decoder->expected = DELTA_CODEC_KEYFRAME_SIZE;
+            }
+            else if (byte == DELTA_CODEC_BLOCK)
+            {
+                decoder->expected = 3;
+            }
+            else
+            {
+                return 0;
+            }
+        }
+        decoder->packet[decoder->length++] = byte;
+        
+        // The widths give the size of a block
+        if (decoder->packet[0] == DELTA_CODEC_BLOCK && decoder->length == 3)
+        {
+            uint8_t wx = decoder->packet[1] >> 3;
+            uint8_t wy = ((decoder->packet[1] & 0x07) << 2) | (decoder->packet[2] >> 6);
+            uint8_t wz = (decoder->packet[2] >> 1) & 0x1F;
+            if (wx > 16 || wy > 16 || wz > 16)
+            {
+                decoder->length = 0;
+                decoder->synced = 0;
+                decoder->errors++;
+                return 0;
+            }
+            decoder->expected = DELTA_CODEC_BLOCK_LENGTH(wx, wy, wz);
+        }
+        if (decoder->length < decoder->expected)
+        {
+            return 0;
+        }
+        
+        uint8_t length = decoder->length;
+        decoder->length = 0;
+        if (DeltaCodec_Checksum(decoder->packet, length - 1) != decoder->packet[length - 1])
+        {
+            // The differences that follow are useless without this packet
+            decoder->synced = 0;
+            decoder->errors++;
+            return 0;
+        }
+        
+        if (decoder->packet[0] == DELTA_CODEC_KEYFRAME)
+        {
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                decoder->previous[axis] = (int16_t)(decoder->packet[2 + 2 * axis] |
+                                                    (decoder->packet[3 + 2 * axis] << 8));
+                samples[0][axis] = decoder->previous[axis];
+            }
+            decoder->synced = 1;
+            return 1;
+        }
+        if (!decoder->synced)
+        {
+            return 0;
+        }
+        
+        uint8_t offset = 3;
+        uint8_t width[3] = {
+            decoder->packet[1] >> 3,
+            ((decoder->packet[1] & 0x07) << 2) | (decoder->packet[2] >> 6),
+            (decoder->packet[2] >> 1) & 0x1F
+        };
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            uint16_t values[DELTA_CODEC_BLOCK_SIZE];
+            DeltaCodec_UnpackAxis(&decoder->packet[offset], width[axis], values);
+            offset += width[axis];
+            for (uint8_t i = 0; i < DELTA_CODEC_BLOCK_SIZE; i++)
+            {
+                decoder->previous[axis] += DeltaCodec_Unzigzag(values[i]);
+                samples[i][axis] = decoder->previous[axis];
+            }
+        }
+        return DELTA_CODEC_BLOCK_SIZE;
+    }
+
+/* [] END OF FILE */
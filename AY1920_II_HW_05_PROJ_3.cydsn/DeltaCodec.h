@@ -0,0 +1,126 @@
+/** 
+ * \file DeltaCodec.h
+ * \brief Compressed stream of the acceleration samples.
+ *
+ * Consecutive samples are close to each other, so after a keyframe with
+ * the absolute values only the differences are sent. The differences are
+ * zigzag-mapped (0, -1, 1, -2, ... become 0, 1, 2, 3, ...) and packed in
+ * blocks of 8 samples, with the smallest bit width holding all the values
+ * of each axis in the block:
+ *
+ *     keyframe: 0xA4, sequence, X, Y, Z (16 bits, little endian), checksum
+ *     block:    0xA5, widths of X, Y, Z (5 bits each, big endian),
+ *               8 values of X, then Y, then Z (width bytes each), checksum
+ *
+ * The checksum is the XOR of all the previous bytes of the packet. A
+ * keyframe starts each frame of 4 blocks; a corrupted packet stops the
+ * decoder until the next keyframe, which is never more than 32 samples
+ * away. The decoder has no dependency on the PSoC, so it can be built on
+ * the host as well and is fed one byte at a time.
+*/
+
+#ifndef DeltaCodec_H
+    #define DeltaCodec_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Samples in a block, each axis of a block fills width bytes.
+    */
+    #define DELTA_CODEC_BLOCK_SIZE 8
+    
+    /**
+    *   \brief Blocks sent after each keyframe.
+    */
+    #define DELTA_CODEC_FRAME_BLOCKS 4
+    
+    /**
+    *   \brief Samples in a frame, the keyframe and its blocks.
+    */
+    #define DELTA_CODEC_FRAME_SAMPLES (1 + DELTA_CODEC_FRAME_BLOCKS * DELTA_CODEC_BLOCK_SIZE)
+    
+    /**
+    *   \brief First byte of a keyframe and of a block.
+    */
+    #define DELTA_CODEC_KEYFRAME 0xA4
+    #define DELTA_CODEC_BLOCK 0xA5
+    
+    /**
+    *   \brief Size of a keyframe.
+    */
+    #define DELTA_CODEC_KEYFRAME_SIZE 9
+    
+    /**
+    *   \brief Size of a block with the given widths.
+    */
+    #define DELTA_CODEC_BLOCK_LENGTH(wx, wy, wz) (4 + (wx) + (wy) + (wz))
+    
+    /**
+    *   \brief Largest packet, a block with three 16-bit widths.
+    */
+    #define DELTA_CODEC_MAX_PACKET DELTA_CODEC_BLOCK_LENGTH(16, 16, 16)
+    
+    /**
+    *   \brief State of the encoder.
+    */
+    typedef struct {
+        int16_t previous[3];                                ///< Last sample encoded
+        uint16_t zigzag[3][DELTA_CODEC_BLOCK_SIZE];         ///< Mapped differences of the block
+        uint16_t width_mask[3];                             ///< OR of the values of each axis
+        uint8_t count;                                      ///< Samples in the current block
+        uint8_t blocks;                                     ///< Blocks sent since the keyframe
+        uint8_t sequence;                                   ///< Number of the next keyframe
+    } DeltaEncoder;
+    
+    /**
+    *   \brief State of the decoder.
+    */
+    typedef struct {
+        uint8_t packet[DELTA_CODEC_MAX_PACKET];             ///< Bytes of the current packet
+        uint8_t length;                                     ///< Bytes received
+        uint8_t expected;                                   ///< Size of the current packet
+        int16_t previous[3];                                ///< Last sample decoded
+        uint8_t synced;                                     ///< True after a valid keyframe
+        uint16_t errors;                                    ///< Packets dropped by the checksum
+    } DeltaDecoder;
+    
+    /**
+    *   \brief Start a new stream, the next sample is sent as keyframe.
+    */
+    void DeltaCodec_InitEncoder(DeltaEncoder* encoder);
+    
+    /**
+    *   \brief Encode a sample.
+    *
+    *   The cost of a sample is bounded: a mapping and an OR per axis, and
+    *   every 8 samples the packing of 24 values of at most 16 bits.
+    *   \param encoder Pointer to the encoder.
+    *   \param xyz Right-aligned values of the three axes.
+    *   \param packet Array of DELTA_CODEC_MAX_PACKET bytes.
+    *   \retval Number of bytes of the packet to be sent, 0 if none is ready.
+    */
+    uint8_t DeltaCodec_Encode(DeltaEncoder* encoder, const int16_t* xyz, uint8_t* packet);
+    
+    /**
+    *   \brief Largest number of bytes per sample for values of the given bits.
+    */
+    uint8_t DeltaCodec_WorstCaseBytes(uint8_t bits);
+    
+    /**
+    *   \brief Wait for a keyframe.
+    */
+    void DeltaCodec_InitDecoder(DeltaDecoder* decoder);
+    
+    /**
+    *   \brief Decode the next byte of the stream.
+    *
+    *   \param decoder Pointer to the decoder.
+    *   \param byte Byte received.
+    *   \param samples Array of DELTA_CODEC_BLOCK_SIZE samples filled when a
+    *   packet is completed.
+    *   \retval Number of samples decoded with this byte (0, 1 or 8).
+    */
+    uint8_t DeltaCodec_Decode(DeltaDecoder* decoder, uint8_t byte, int16_t samples[][3]);
+    
+#endif // DeltaCodec_H
+/* [] END OF FILE */
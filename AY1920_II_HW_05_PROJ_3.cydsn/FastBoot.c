@@ -0,0 +1,157 @@
+/*
+* This file includes the source code to save and check
+* the known-good configuration used by the fast boot.
+*/
+
+#include "FastBoot.h"
+#include "I2C_Interface.h"
+#include "project.h"
+#include "stddef.h"
+#include "string.h"
+
+/**
+*   \brief Flash row holding the record.
+*/
+static const uint8_t FastBoot_Storage[CY_FLASH_SIZEOF_ROW]
+    CY_ALIGN(CY_FLASH_SIZEOF_ROW) = {0u};
+
+    /**
+    *   \brief Checksum of a record, so that the sum of all its bytes is zero.
+    */
+    static uint8_t FastBoot_Checksum(const FastBoot_Record* record)
+    {
+        const uint8_t* bytes = (const uint8_t*) record;
+        uint8_t sum = 0;
+        for (uint8_t i = 0; i < offsetof(FastBoot_Record, checksum); i++)
+        {
+            sum += bytes[i];
+        }
+        return (uint8_t)(0 - sum);
+    }
+    
+    ErrorCode FastBoot_Load(FastBoot_Record* record)
+    {
+        // The row is read as volatile, the compiler only sees its initial zeros
+        const volatile uint8_t* row = FastBoot_Storage;
+        uint8_t* bytes = (uint8_t*) record;
+        for (uint16_t i = 0; i < sizeof(FastBoot_Record); i++)
+        {
+            bytes[i] = row[i];
+        }
+        if (record->magic != FAST_BOOT_MAGIC || record->version != FAST_BOOT_VERSION ||
+            record->checksum != FastBoot_Checksum(record))
+        {
+            return ERROR;
+        }
+        return NO_ERROR;
+    }
+    
+    ErrorCode FastBoot_Check(const FastBoot_Record* record, const LIS3DH_Profile** profile)
+    {
+        // A new firmware may encode the profile differently
+        LIS3DH_RegisterImage image;
+        if (record->profile >= LIS3DH_PROFILE_COUNT || record->device_count == 0 ||
+            record->device_count > FAST_BOOT_MAX_DEVICES)
+        {
+            return ERROR;
+        }
+        LIS3DH_Profile_Encode(&LIS3DH_Profiles[record->profile], &image);
+        if (memcmp(&image, &record->image, sizeof(image)) != 0)
+        {
+            return ERROR;
+        }
+        
+        for (uint8_t i = 0; i < record->device_count; i++)
+        {
+            // Each device must answer at the saved address...
+            uint8_t who_am_i_reg;
+            ErrorCode error = I2C_Peripheral_ReadRegister(record->device_addresses[i],
+                                                          LIS3DH_WHO_AM_I_REG_ADDR,
+                                                          &who_am_i_reg);
+            if (error != NO_ERROR || who_am_i_reg != LIS3DH_WHO_AM_I_VALUE)
+            {
+                return ERROR;
+            }
+            
+            // ...and still hold the saved configuration
+            if (LIS3DH_Profile_Verify(record->device_addresses[i], &record->image) != NO_ERROR)
+            {
+                return ERROR;
+            }
+        }
+        
+        *profile = &LIS3DH_Profiles[record->profile];
+        return NO_ERROR;
+    }
+    
+    ErrorCode FastBoot_Store(const uint8_t* device_addresses,
+                             uint8_t device_count,
+                             LIS3DH_ProfileIndex profile,
+                             uint16_t data_rate_khz)
+    {
+        if (device_count == 0 || device_count > FAST_BOOT_MAX_DEVICES || profile >= LIS3DH_PROFILE_COUNT)
+        {
+            return ERROR;
+        }
+        FastBoot_Record record = {
+            .magic = FAST_BOOT_MAGIC,
+            .version = FAST_BOOT_VERSION,
+            .profile = (uint8_t) profile,
+            .data_rate_khz = data_rate_khz,
+            .device_count = device_count,
+        };
+        for (uint8_t i = 0; i < device_count; i++)
+        {
+            record.device_addresses[i] = device_addresses[i];
+        }
+        LIS3DH_Profile_Encode(&LIS3DH_Profiles[profile], &record.image);
+        record.checksum = FastBoot_Checksum(&record);
+        
+        // Do not wear the flash if the same record is already saved
+        FastBoot_Record saved;
+        if (FastBoot_Load(&saved) == NO_ERROR)
+        {
+            const uint8_t* a = (const uint8_t*) &saved;
+            const uint8_t* b = (const uint8_t*) &record;
+            uint8_t i = 0;
+            while (i < sizeof(FastBoot_Record) && a[i] == b[i])
+            {
+                i++;
+            }
+            if (i == sizeof(FastBoot_Record))
+            {
+                return NO_ERROR;
+            }
+        }
+        
+        // The whole row is written, the bytes after the record are left at zero
+        static uint8_t row[CY_FLASH_SIZEOF_ROW];
+        memset(row, 0, sizeof(row));
+        memcpy(row, &record, sizeof(FastBoot_Record));
+        
+        uint32_t address = (uint32_t)(uintptr_t) FastBoot_Storage;
+        uint8_t array_id = (uint8_t)(address / CY_FLASH_SIZEOF_ARRAY);
+        uint16_t row_number = (uint16_t)((address % CY_FLASH_SIZEOF_ARRAY) / CY_FLASH_SIZEOF_ROW);
+        if (CySetTemp() != CYRET_SUCCESS ||
+            CyWriteRowData(array_id, row_number, row) != CYRET_SUCCESS)
+        {
+            return ERROR;
+        }
+        
+        // The next reads must see the new row, not the cached one
+        CyFlushCache();
+        return NO_ERROR;
+    }
+    
+    void FastBoot_Report(uint8_t fast_boot, uint32_t first_sample_us, uint8_t* report)
+    {
+        report[0] = FAST_BOOT_REPORT;
+        report[1] = fast_boot;
+        report[2] = (uint8_t)(first_sample_us & 0xFF);
+        report[3] = (uint8_t)(first_sample_us >> 8);
+        report[4] = (uint8_t)(first_sample_us >> 16);
+        report[5] = (uint8_t)(first_sample_us >> 24);
+        report[6] = 0xC0;
+    }
+
+/* [] END OF FILE */
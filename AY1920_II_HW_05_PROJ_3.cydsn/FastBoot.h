@@ -0,0 +1,107 @@
+/** 
+ * \file FastBoot.h
+ * \brief Fast boot based on the last known-good sensor configuration.
+ *
+ * The I2C addresses of the accelerometers, their profile and the register
+ * image implementing it are saved in a flash row after a successful full
+ * boot. At the following boots each device is checked with one WHO AM I
+ * read and one burst read-back, so that the bus scan and the diagnostic
+ * messages can be skipped and the stream can start right away.
+ *
+ * The record takes one row of flash (CY_FLASH_SIZEOF_ROW, 256 bytes),
+ * reserved by the linker for FastBoot_Storage and aligned on a row, and is
+ * written with the row API of cy_boot: no EEPROM component is needed.
+*/
+
+#ifndef FastBoot_H
+    #define FastBoot_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH_Profiles.h"
+    
+    /**
+    *   \brief Value marking a valid record ("LIS3").
+    */
+    #define FAST_BOOT_MAGIC 0x4C495333u
+    
+    /**
+    *   \brief Version of the record layout, to be changed with the layout.
+    */
+    #define FAST_BOOT_VERSION 3
+    
+    /**
+    *   \brief Devices in a record: a LIS3DH answers at two addresses only.
+    */
+    #define FAST_BOOT_MAX_DEVICES 2
+    
+    /**
+    *   \brief Header and size of the boot report: header, 1 after a fast
+    *   boot or 0 after a full one, microseconds from power-up to the first
+    *   sample (32 bits, little endian) and footer 0xC0.
+    */
+    #define FAST_BOOT_REPORT 0xAE
+    #define FAST_BOOT_REPORT_SIZE 7
+    
+    /**
+    *   \brief Known-good configuration saved in flash.
+    */
+    typedef struct {
+        uint32_t magic;                 ///< FAST_BOOT_MAGIC if the record is valid
+        uint8_t version;                ///< FAST_BOOT_VERSION
+        uint8_t profile;                ///< Index of the profile in LIS3DH_Profiles
+        uint16_t data_rate_khz;         ///< Fastest stable data rate of the I2C bus
+        uint8_t device_count;           ///< Number of accelerometers
+        uint8_t device_addresses[FAST_BOOT_MAX_DEVICES]; ///< I2C addresses of the accelerometers
+        LIS3DH_RegisterImage image;     ///< Configuration registers of the accelerometers
+        uint8_t checksum;               ///< Sum of all the previous bytes, two's complement
+    } FastBoot_Record;
+    
+    /**
+    *   \brief Read the record from flash.
+    *
+    *   \param record Pointer to the record to be filled.
+    *   \retval ERROR if the record is missing or corrupted.
+    */
+    ErrorCode FastBoot_Load(FastBoot_Record* record);
+    
+    /**
+    *   \brief Check the record against the devices on the bus.
+    *
+    *   The image must still be the one of the saved profile. For each
+    *   device one WHO AM I read checks that it still answers at the saved
+    *   address, one burst read-back checks that it still holds the image.
+    *   On success the devices can be taken over at the addresses of the
+    *   record without further bus operations.
+    *   \param record Pointer to the record.
+    *   \param profile Set to the verified profile, in LIS3DH_Profiles.
+    *   \retval ERROR if a device does not match the record.
+    */
+    ErrorCode FastBoot_Check(const FastBoot_Record* record, const LIS3DH_Profile** profile);
+    
+    /**
+    *   \brief Save a known-good configuration in flash.
+    *
+    *   The row is written only if the record changes, to save flash cycles.
+    *   \param device_addresses I2C addresses of the accelerometers.
+    *   \param device_count Number of accelerometers, at most FAST_BOOT_MAX_DEVICES.
+    *   \param profile Index of the profile of the accelerometers.
+    *   \param data_rate_khz Data rate of the I2C bus to be used.
+    */
+    ErrorCode FastBoot_Store(const uint8_t* device_addresses,
+                             uint8_t device_count,
+                             LIS3DH_ProfileIndex profile,
+                             uint16_t data_rate_khz);
+    
+    /**
+    *   \brief Build the boot report, sent with the stream once the first
+    *   sample is queued.
+    *
+    *   \param fast_boot 1 after a fast boot, 0 after a full one.
+    *   \param first_sample_us Microseconds from power-up to the first sample.
+    *   \param report Buffer of FAST_BOOT_REPORT_SIZE bytes.
+    */
+    void FastBoot_Report(uint8_t fast_boot, uint32_t first_sample_us, uint8_t* report);
+    
+#endif // FastBoot_H
+/* [] END OF FILE */
@@ -19,7 +19,177 @@
 
 #include "I2C_Interface.h" 
 #include "I2C_Master.h"
+#include "SCL_1.h"
+#include "SDA_1.h"
+#include "CyLib.h"
+#include "cyfitter.h"
 
+/**
+*   \brief First transfer of the asynchronous queue, the one on the bus.
+*/
+static I2C_Transfer* transfer_head = NULL;
+
+/**
+*   \brief Last transfer of the asynchronous queue.
+*/
+static I2C_Transfer* transfer_tail = NULL;
+
+/**
+*   \brief Buffer holding register address and data of a write transfer.
+*/
+static uint8_t transfer_buffer[I2C_TRANSFER_MAX_WRITE + 1];
+
+/**
+*   \brief Ticks elapsed since the first transfer of the queue was started.
+*/
+static volatile uint8_t transfer_ticks = 0;
+
+/**
+*   \brief Ticks the first transfer of the queue can take before being aborted.
+*/
+static uint8_t transfer_deadline = I2C_TRANSFER_TIMEOUT_TICKS;
+
+/**
+*   \brief Number of failed operations for each kind of error.
+*/
+static uint16_t error_counts[ERROR_CODE_COUNT];
+
+/**
+*   \brief Number of bus recoveries.
+*/
+static uint16_t recovery_count = 0;
+
+/**
+*   \brief Clock divider set at runtime, 0 to keep the one of the schematic.
+*/
+static uint16_t data_rate_divider = 0;
+
+/**
+*   \brief Clock rate bit of the configuration register set at runtime.
+*/
+static uint8_t data_rate_config = 0;
+
+/**
+*   \brief Current data rate of the bus, in kHz.
+*/
+static uint16_t data_rate_khz = I2C_Master_DATA_RATE;
+
+    static void I2C_Peripheral_AbortTransfer(void);
+    
+    /**
+    *   \brief Restart the tick count for the transfer at the head of the queue.
+    *
+    *   The deadline covers the 9 clocks of each byte at the current data
+    *   rate, device and register address included, so that a long burst
+    *   at 100 kHz is not aborted while it is still on the bus.
+    */
+    static void I2C_Peripheral_RestartTicks(void)
+    {
+        transfer_ticks = 0;
+        if (transfer_head != NULL)
+        {
+            uint32_t bus_us = (uint32_t)(transfer_head->register_count + 2) * 9 * 1000 / data_rate_khz;
+            transfer_deadline = (uint8_t)(I2C_TRANSFER_TIMEOUT_TICKS +
+                                          (bus_us + I2C_TICK_PERIOD_US - 1) / I2C_TICK_PERIOD_US);
+        }
+    }
+    
+    /**
+    *   \brief Wait for a transfer with a deadline.
+    *
+    *   The queue is advanced while polling the bus; each transfer that gets
+    *   to the head of the queue has a deadline proportional to its length,
+    *   and it is aborted if it is not completed in time.
+    *   \param transfer Transfer to wait for, NULL to wait for the whole queue.
+    */
+    static void I2C_Peripheral_WaitTransfer(I2C_Transfer* transfer)
+    {
+        I2C_Transfer* current = NULL;
+        uint32_t elapsed = 0;
+        uint32_t deadline = 0;
+        
+        for (;;)
+        {
+            I2C_Peripheral_ProcessTransfers();
+            if (transfer_head == NULL ||
+                (transfer != NULL && transfer->state == I2C_TRANSFER_DONE))
+            {
+                return;
+            }
+            
+            // Restart the count each time a new transfer gets to the head
+            if (transfer_head != current)
+            {
+                current = transfer_head;
+                elapsed = 0;
+                deadline = I2C_TIMEOUT_BASE_US +
+                           I2C_TIMEOUT_BYTE_US * (current->register_count + 2);
+            }
+            
+            CyDelayUs(I2C_POLL_PERIOD_US);
+            elapsed += I2C_POLL_PERIOD_US;
+            if (elapsed >= deadline)
+            {
+                I2C_Peripheral_AbortTransfer();
+            }
+        }
+    }
+    
+    /**
+    *   \brief Complete all the queued asynchronous transfers.
+    *
+    *   The device probe drives the I2C master byte by byte, so it
+    *   has to wait for the asynchronous engine to release the bus.
+    */
+    static void I2C_Peripheral_WaitTransfers(void)
+    {
+        I2C_Peripheral_WaitTransfer(NULL);
+    }
+    
+    /**
+    *   \brief Submit a transfer and wait for it with a deadline.
+    */
+    static ErrorCode I2C_Peripheral_Transfer(uint8_t device_address,
+                                             uint8_t register_address,
+                                             uint8_t register_count,
+                                             uint8_t* data,
+                                             I2C_TransferDirection direction)
+    {
+        I2C_Transfer transfer = {
+            .device_address = device_address,
+            .register_address = register_address,
+            .register_count = register_count,
+            .data = data,
+            .direction = direction,
+        };
+        if (I2C_Peripheral_SubmitTransfer(&transfer) != NO_ERROR)
+        {
+            return ERROR;
+        }
+        
+        I2C_Peripheral_WaitTransfer(&transfer);
+        // Return error code
+        return transfer.error;
+    }
+
+    /**
+    *   \brief Program the clock divider chosen at runtime, if any.
+    *
+    *   The I2C master must be stopped; its initialization restores the
+    *   divider of the schematic, so this is repeated after each one.
+    */
+    static void I2C_Peripheral_ApplyDataRate(void)
+    {
+        if (data_rate_divider == 0)
+        {
+            return;
+        }
+        I2C_Master_CLKDIV1_REG = (uint8_t)(data_rate_divider & 0xFF);
+        I2C_Master_CLKDIV2_REG = (uint8_t)(data_rate_divider >> 8);
+        I2C_Master_CFG_REG = (I2C_Master_CFG_REG & (uint8_t) ~I2C_Master_CFG_CLK_RATE_MSK) |
+                             data_rate_config;
+    }
+    
     ErrorCode I2C_Peripheral_Start(void) 
     {
         // Start I2C peripheral
@@ -38,33 +208,58 @@
         return NO_ERROR;
     }
 
+    ErrorCode I2C_Peripheral_SetDataRate(uint16_t data_rate)
+    {
+        // Each bit is oversampled 16 times in Standard mode and 32 times above
+        uint8_t oversampling;
+        uint8_t config;
+        if (data_rate == I2C_DATA_RATE_STANDARD)
+        {
+            oversampling = 16;
+            config = I2C_Master_CFG_CLK_RATE_100;
+        }
+        else if (data_rate == I2C_DATA_RATE_FAST || data_rate == I2C_DATA_RATE_FAST_PLUS)
+        {
+            oversampling = 32;
+            config = I2C_Master_CFG_CLK_RATE_400;
+        }
+        else
+        {
+            return ERROR;
+        }
+        
+        // The bus clock must be fast enough for a divider of at least 1
+        uint32_t sample_rate = (uint32_t) data_rate * oversampling;
+        if (BCLK__BUS_CLK__KHZ < sample_rate)
+        {
+            return ERROR;
+        }
+        uint32_t divider = (BCLK__BUS_CLK__KHZ + sample_rate - 1) / sample_rate;
+        
+        // Change the clock only once the bus is free
+        I2C_Peripheral_WaitTransfers();
+        I2C_Master_Stop();
+        data_rate_divider = (uint16_t) divider;
+        data_rate_config = config;
+        I2C_Peripheral_ApplyDataRate();
+        I2C_Master_Start();
+        
+        data_rate_khz = (uint16_t)(BCLK__BUS_CLK__KHZ / (divider * oversampling));
+        return NO_ERROR;
+    }
+    
+    uint16_t I2C_Peripheral_GetDataRate(void)
+    {
+        return data_rate_khz;
+    }
+    
     ErrorCode I2C_Peripheral_ReadRegister(uint8_t device_address, 
                                             uint8_t register_address,
                                             uint8_t* data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address,I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
-        {
-            // Write address of register to be read
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Send restart condition
-                error = I2C_Master_MasterSendRestart(device_address, I2C_Master_READ_XFER_MODE);
-                if (error == I2C_Master_MSTR_NO_ERROR)
-                {
-                    // Read data without acknowledgement
-                    *data = I2C_Master_MasterReadByte(I2C_Master_NAK_DATA);
-                    // Send stop condition and return no error
-                    I2C_Master_MasterSendStop();
-                }
-            }
-        }
-        // Send stop condition if something went wrong
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+        // A single register is read as a burst of one byte
+        return I2C_Peripheral_Transfer(device_address, register_address,
+                                       1, data, I2C_TRANSFER_READ);
     }
     
     ErrorCode I2C_Peripheral_ReadRegisterMulti(uint8_t device_address,
@@ -72,59 +267,19 @@
                                                 uint8_t register_count,
                                                 uint8_t* data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address,I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
-        {
-            // Write address of register to be read with the MSB equal to 1
-            register_address |= 0x80;
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Send restart condition
-                error = I2C_Master_MasterSendRestart(device_address, I2C_Master_READ_XFER_MODE);
-                if (error == I2C_Master_MSTR_NO_ERROR)
-                {
-                    // Continue reading until we have register to read
-                    uint8_t counter = register_count;
-                    while(counter>1)
-                    {
-                        data[register_count-counter] =
-                            I2C_Master_MasterReadByte(I2C_Master_ACK_DATA);
-                        counter--;
-                    }
-                    // Read last data without acknowledgement
-                    data[register_count-1]
-                        = I2C_Master_MasterReadByte(I2C_Master_NAK_DATA);
-                }
-            }
-        }
-        // Send stop condition
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+        // Read all the registers in a single burst: the bytes are moved into
+        // the array by the I2C interrupt and the transfer completes only once
+        return I2C_Peripheral_Transfer(device_address, register_address,
+                                       register_count, data, I2C_TRANSFER_READ);
     }
     
     ErrorCode I2C_Peripheral_WriteRegister(uint8_t device_address,
                                             uint8_t register_address,
                                             uint8_t data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
-        {
-            // Write register address
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Write byte of interest
-                error = I2C_Master_MasterWriteByte(data);
-            }
-        }
-        // Send stop condition
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+        // Register address and data are sent with one bus operation
+        return I2C_Peripheral_Transfer(device_address, register_address,
+                                       1, &data, I2C_TRANSFER_WRITE);
     }
     
     ErrorCode I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
@@ -132,49 +287,353 @@
                                             uint8_t register_count,
                                             uint8_t* data)
     {
-        // Send start condition
+        // The MSB of the register address is set by the transfer engine
+        return I2C_Peripheral_Transfer(device_address, register_address,
+                                       register_count, data, I2C_TRANSFER_WRITE);
+    }
+    
+    
+    uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address)
+    {
+        // Wait for the asynchronous transfers to release the bus
+        I2C_Peripheral_WaitTransfers();
+        
+        // A line held low would stall the probe, free it first
+        if (SCL_1_Read() == 0 || SDA_1_Read() == 0)
+        {
+            I2C_Peripheral_RecoverBus();
+        }
+        
+        // Send a start condition followed by a stop condition
         uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
+        I2C_Master_MasterSendStop();
+        // If no error generated during stop, device is connected
         if (error == I2C_Master_MSTR_NO_ERROR)
         {
-            // Write register address
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
+            return DEVICE_CONNECTED;
+        }
+        return DEVICE_UNCONNECTED;
+    }
+    
+    /**
+    *   \brief Remove the current transfer from the queue and report its result.
+    */
+    static void I2C_Peripheral_CompleteTransfer(ErrorCode error)
+    {
+        I2C_Transfer* transfer = transfer_head;
+        
+        if (error == ERROR_TIMEOUT || error == ERROR_BUS_BUSY ||
+            error == ERROR_ARBITRATION_LOST)
+        {
+            // A stuck line or a lost arbitration leave the bus in an unknown
+            // state, where even a stop condition could wait forever
+            I2C_Peripheral_RecoverBus();
+        }
+        else if (I2C_Master_MasterStatus() & I2C_Master_MSTAT_XFER_HALT)
+        {
+            // Release the bus if the master was left holding it
+            I2C_Master_MasterSendStop();
+        }
+        I2C_Master_MasterClearStatus();
+        
+        // Move to the next transfer of the queue
+        transfer_head = transfer->next;
+        if (transfer_head == NULL)
+        {
+            transfer_tail = NULL;
+        }
+        transfer->next = NULL;
+        I2C_Peripheral_RestartTicks();
+        
+        // Report the result
+        if (error != NO_ERROR && error_counts[error] < UINT16_MAX)
+        {
+            error_counts[error]++;
+        }
+        transfer->error = error;
+        transfer->state = I2C_TRANSFER_DONE;
+        if (transfer->callback != NULL)
+        {
+            transfer->callback(transfer);
+        }
+    }
+    
+    /**
+    *   \brief Put the first phase of the current transfer on the bus.
+    *
+    *   Both reads and writes start by sending the register address; a write
+    *   sends its data in the same operation and then releases the bus, while
+    *   a read keeps it to send a repeated start.
+    */
+    static void I2C_Peripheral_StartTransfer(void)
+    {
+        I2C_Transfer* transfer = transfer_head;
+        uint8_t error;
+        
+        // Set the MSB of the register address to read or write multiple registers
+        transfer_buffer[0] = transfer->register_address;
+        if (transfer->register_count > 1)
+        {
+            transfer_buffer[0] |= 0x80;
+        }
+        
+        I2C_Master_MasterClearStatus();
+        if (transfer->direction == I2C_TRANSFER_READ)
+        {
+            error = I2C_Master_MasterWriteBuf(transfer->device_address,
+                                              transfer_buffer,
+                                              1,
+                                              I2C_Master_MODE_NO_STOP);
+        }
+        else
+        {
+            for (uint8_t i = 0; i < transfer->register_count; i++)
+            {
+                transfer_buffer[i+1] = transfer->data[i];
+            }
+            error = I2C_Master_MasterWriteBuf(transfer->device_address,
+                                              transfer_buffer,
+                                              transfer->register_count + 1,
+                                              I2C_Master_MODE_COMPLETE_XFER);
+        }
+        
+        if (error == I2C_Master_MSTR_NO_ERROR)
+        {
+            transfer->state = I2C_TRANSFER_ADDRESSING;
+        }
+        else if (error != I2C_Master_MSTR_BUS_BUSY)
+        {
+            // Bus is free but the master refused the transfer
+            I2C_Peripheral_CompleteTransfer(ERROR);
+        }
+        // If the bus is busy the transfer is started on the next call
+    }
+    
+    /**
+    *   \brief Abort the current transfer because its deadline expired.
+    */
+    static void I2C_Peripheral_AbortTransfer(void)
+    {
+        // A transfer that never got on the bus was waiting for it to be free
+        if (transfer_head->state == I2C_TRANSFER_PENDING)
+        {
+            I2C_Peripheral_CompleteTransfer(ERROR_BUS_BUSY);
+        }
+        else
+        {
+            I2C_Peripheral_CompleteTransfer(ERROR_TIMEOUT);
+        }
+    }
+    
+    /**
+    *   \brief Translate the error flags of the I2C master into an error code.
+    */
+    static ErrorCode I2C_Peripheral_StatusError(uint8_t status)
+    {
+        if (status & I2C_Master_MSTAT_ERR_ARB_LOST)
+        {
+            return ERROR_ARBITRATION_LOST;
+        }
+        if (status & I2C_Master_MSTAT_ERR_ADDR_NAK)
+        {
+            return ERROR_ADDRESS_NAK;
+        }
+        if (status & I2C_Master_MSTAT_ERR_SHORT_XFER)
+        {
+            return ERROR_DATA_NAK;
+        }
+        return ERROR;
+    }
+    
+    ErrorCode I2C_Peripheral_SubmitTransfer(I2C_Transfer* transfer)
+    {
+        // Check that the descriptor can be queued
+        if (transfer == NULL || transfer->data == NULL || transfer->register_count == 0)
+        {
+            return ERROR;
+        }
+        if (transfer->state != I2C_TRANSFER_IDLE && transfer->state != I2C_TRANSFER_DONE)
+        {
+            return ERROR;
+        }
+        if (transfer->direction == I2C_TRANSFER_WRITE &&
+            transfer->register_count > I2C_TRANSFER_MAX_WRITE)
+        {
+            return ERROR;
+        }
+        
+        // Append the transfer to the queue
+        transfer->state = I2C_TRANSFER_PENDING;
+        transfer->error = NO_ERROR;
+        transfer->next = NULL;
+        if (transfer_tail == NULL)
+        {
+            transfer_head = transfer;
+        }
+        else
+        {
+            transfer_tail->next = transfer;
+        }
+        transfer_tail = transfer;
+        
+        // Put it on the bus right away if nothing else is going on
+        if (transfer_head == transfer)
+        {
+            I2C_Peripheral_RestartTicks();
+            I2C_Peripheral_StartTransfer();
+        }
+        return NO_ERROR;
+    }
+    
+    void I2C_Peripheral_ProcessTransfers(void)
+    {
+        while (transfer_head != NULL)
+        {
+            I2C_Transfer* transfer = transfer_head;
+            uint8_t status = I2C_Master_MasterStatus();
+            
+            if (transfer_ticks >= transfer_deadline)
             {
-                // Continue writing until we have data to write
-                uint8_t counter = register_count;
-                while(counter >= 0)
+                // The transfer is stuck, give up to keep the loop going
+                I2C_Peripheral_AbortTransfer();
+            }
+            else if (transfer->state == I2C_TRANSFER_PENDING)
+            {
+                I2C_Peripheral_StartTransfer();
+            }
+            else if (status & I2C_Master_MSTAT_ERR_XFER)
+            {
+                // NAK or arbitration lost: the transfer failed
+                I2C_Peripheral_CompleteTransfer(I2C_Peripheral_StatusError(status));
+            }
+            else if (transfer->state == I2C_TRANSFER_ADDRESSING &&
+                     (status & I2C_Master_MSTAT_WR_CMPLT))
+            {
+                if (transfer->direction == I2C_TRANSFER_WRITE)
+                {
+                    I2C_Peripheral_CompleteTransfer(NO_ERROR);
+                }
+                else
                 {
-                     error =
-                        I2C_Master_MasterWriteByte(data[register_count-counter]);
-                    if (error != I2C_Master_MSTR_NO_ERROR)
+                    // Send restart condition and read the registers
+                    I2C_Master_MasterClearStatus();
+                    uint8_t error = I2C_Master_MasterReadBuf(transfer->device_address,
+                                                             transfer->data,
+                                                             transfer->register_count,
+                                                             I2C_Master_MODE_REPEAT_START);
+                    if (error == I2C_Master_MSTR_NO_ERROR)
                     {
-                        // Send stop condition
-                        I2C_Master_MasterSendStop();
-                        // Return error code
-                        return ERROR;
+                        transfer->state = I2C_TRANSFER_DATA;
+                    }
+                    else
+                    {
+                        I2C_Peripheral_CompleteTransfer(ERROR);
                     }
-                    counter--;
                 }
             }
+            else if (transfer->state == I2C_TRANSFER_DATA &&
+                     (status & I2C_Master_MSTAT_RD_CMPLT))
+            {
+                I2C_Peripheral_CompleteTransfer(NO_ERROR);
+            }
+            
+            // Stop as soon as the first transfer of the queue is on the bus
+            if (transfer_head == transfer)
+            {
+                break;
+            }
         }
-        // Send stop condition in case something didn't work out correctly
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
     }
     
+    uint8_t I2C_Peripheral_IsBusy(void)
+    {
+        return (transfer_head != NULL);
+    }
     
-    uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address)
+    void I2C_Peripheral_Tick(void)
     {
-        // Send a start condition followed by a stop condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
-        I2C_Master_MasterSendStop();
-        // If no error generated during stop, device is connected
-        if (error == I2C_Master_MSTR_NO_ERROR)
+        // Count only while a transfer is queued, and never wrap around
+        if (transfer_head != NULL && transfer_ticks < UINT8_MAX)
         {
-            return DEVICE_CONNECTED;
+            transfer_ticks++;
         }
-        return DEVICE_UNCONNECTED;
+    }
+    
+    /**
+    *   \brief Wait for half a period of the recovery clock (about 100 kHz).
+    */
+    static void I2C_Peripheral_BusClearDelay(void)
+    {
+        CyDelayUs(5);
+    }
+    
+    ErrorCode I2C_Peripheral_RecoverBus(void)
+    {
+        I2C_Master_Stop();
+        
+        // Give the pins to their data registers: both lines released
+        SCL_1_Write(1);
+        SDA_1_Write(1);
+        SCL_1_BYP &= (uint8_t) ~SCL_1_MASK;
+        SDA_1_BYP &= (uint8_t) ~SDA_1_MASK;
+        I2C_Peripheral_BusClearDelay();
+        
+        // Clock out the byte the device is sending until it releases SDA
+        for (uint8_t i = 0; i < I2C_BUS_CLEAR_PULSES && SDA_1_Read() == 0; i++)
+        {
+            SCL_1_Write(0);
+            I2C_Peripheral_BusClearDelay();
+            SCL_1_Write(1);
+            I2C_Peripheral_BusClearDelay();
+        }
+        
+        // Stop condition: SDA goes high while SCL is high
+        SCL_1_Write(0);
+        I2C_Peripheral_BusClearDelay();
+        SDA_1_Write(0);
+        I2C_Peripheral_BusClearDelay();
+        SCL_1_Write(1);
+        I2C_Peripheral_BusClearDelay();
+        SDA_1_Write(1);
+        I2C_Peripheral_BusClearDelay();
+        uint8_t released = (SCL_1_Read() != 0 && SDA_1_Read() != 0);
+        
+        // Give the pins back to the I2C block and start it from scratch
+        SCL_1_BYP |= SCL_1_MASK;
+        SDA_1_BYP |= SDA_1_MASK;
+        I2C_Master_Init();
+        I2C_Peripheral_ApplyDataRate();
+        I2C_Master_Start();
+        I2C_Master_MasterClearStatus();
+        
+        if (recovery_count < UINT16_MAX)
+        {
+            recovery_count++;
+        }
+        return released ? NO_ERROR : ERROR_BUS_BUSY;
+    }
+    
+    uint16_t I2C_Peripheral_GetErrorCount(ErrorCode error)
+    {
+        if (error >= ERROR_CODE_COUNT)
+        {
+            return 0;
+        }
+        return error_counts[error];
+    }
+    
+    uint16_t I2C_Peripheral_GetRecoveryCount(void)
+    {
+        return recovery_count;
+    }
+    
+    void I2C_Peripheral_ClearErrorCounts(void)
+    {
+        for (uint8_t i = 0; i < ERROR_CODE_COUNT; i++)
+        {
+            error_counts[i] = 0;
+        }
+        recovery_count = 0;
     }
 
 /* [] END OF FILE */
\ No newline at end of file
@@ -10,14 +10,37 @@
  * ========================================
 */
 #include "InterruptRoutines.h"
+#include "I2C_Interface.h"
+#include "CommandChannel.h"
+#include "StreamOutput.h"
 
-uint8 FlagIsr = 0;   //Inizialization of FlagIsr
+volatile uint8 FlagIsr = 0;   //Inizialization of FlagIsr
+volatile uint8 FlagDataReady = 0;   //Inizialization of FlagDataReady
 
 CY_ISR(Custom_ISR)
 {
     Timer_1_ReadStatusRegister();
     FlagIsr = 1; //Set the Flag to 1 every 10 ms
+    I2C_Peripheral_Tick(); //Deadline of the transfer on the I2C bus
     
 }
 
+#if INTERRUPT_INT1
+CY_ISR(INT1_ISR)
+{
+    INT1_ClearInterrupt();
+    FlagDataReady = 1; //Set the Flag on the rising edge of INT1, when the accelerometer has new data
+}
+#endif
+
+CY_ISR(UART_RX_ISR)
+{
+    CommandChannel_Receive(); //Move the received bytes to the command buffer
+}
+
+CY_ISR(UART_TX_ISR)
+{
+    StreamOutput_Transmit(); //Refill the FIFO of the UART from the stream buffer
+}
+
 /* [] END OF FILE */
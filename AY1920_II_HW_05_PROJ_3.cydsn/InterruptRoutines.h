@@ -13,9 +13,40 @@
     #define __INTERRUPT_ROUTINES_H
     #include "project.h"
     
-    extern uint8 FlagIsr; //Definition of the Flag for the data read
+    extern volatile uint8 FlagIsr; //Definition of the Flag for the data read
+    extern volatile uint8 FlagDataReady; //Definition of the Flag for the INT1 pin of the accelerometer
+    
+    // isr_TX is connected to the tx_interrupt terminal of UART_Debug; when
+    // the schematic does not have it the main loop sends the stream
+    #ifdef isr_TX__INTC_NUMBER
+        #define INTERRUPT_UART_TX 1
+    #else
+        #define INTERRUPT_UART_TX 0
+    #endif
+    
+    // isr_RX is connected to the rx_interrupt terminal of UART_Debug; when
+    // the schematic does not have it the main loop reads the commands
+    #ifdef isr_RX__INTC_NUMBER
+        #define INTERRUPT_UART_RX 1
+    #else
+        #define INTERRUPT_UART_RX 0
+    #endif
+    
+    // INT1 is a digital input pin wired to the INT1 output of the
+    // accelerometer, with an interrupt on the rising edge routed to isr_INT1;
+    // without them the samples are read on the timer
+    #if defined(isr_INT1__INTC_NUMBER) && defined(INT1__PORT)
+        #define INTERRUPT_INT1 1
+    #else
+        #define INTERRUPT_INT1 0
+    #endif
     
     CY_ISR_PROTO(Custom_ISR);
+    #if INTERRUPT_INT1
+        CY_ISR_PROTO(INT1_ISR);
+    #endif
+    CY_ISR_PROTO(UART_RX_ISR);
+    CY_ISR_PROTO(UART_TX_ISR);
     
     #endif
 /* [] END OF FILE */
@@ -0,0 +1,208 @@
+/**
+ * \file LIS3DH_Device.h
+ * \brief Handle of one LIS3DH connected to the I2C bus.
+ *
+ * A handle groups everything that belongs to a single accelerometer:
+ * its I2C address, its configuration profile, the shadow copy of its
+ * configuration registers and the register image filled at each sample,
+ * together with the transfers used to read it. Several handles can share
+ * the same bus, each one with its own configuration and state.
+ *
+ * The values are decoded with the format descriptor of the profile, so
+ * the same code serves every operating mode and full scale range.
+*/
+
+#ifndef LIS3DH_Device_H
+    #define LIS3DH_Device_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "I2C_Interface.h"
+    #include "RegisterPlan.h"
+    #include "LIS3DH_Registers.h"
+    #include "LIS3DH_RegisterCache.h"
+    #include "LIS3DH_Profiles.h"
+    #include "LIS3DH_Format.h"
+    #include "LIS3DH_Fifo.h"
+
+    /**
+    *   \brief 7-bit I2C address of a LIS3DH with the SA0 pin tied low.
+    */
+    #define LIS3DH_DEVICE_ADDRESS_SA0_LOW 0x18
+
+    /**
+    *   \brief 7-bit I2C address of a LIS3DH with the SA0 pin tied high.
+    */
+    #define LIS3DH_DEVICE_ADDRESS_SA0_HIGH 0x19
+
+    /**
+    *   \brief State and configuration of one LIS3DH.
+    */
+    typedef struct {
+        uint8_t address;                                ///< 7-bit I2C address
+        const LIS3DH_Profile* profile;                  ///< Configuration of the device
+        LIS3DH_RegisterCache cache;                     ///< Shadow copy of the configuration
+        RegisterPlan plan;                              ///< Registers read at each sample
+        uint8_t image[REGISTER_PLAN_IMAGE_SIZE];        ///< Registers of the last sample
+        I2C_Transfer transfers[REGISTER_PLAN_MAX_BURSTS]; ///< Transfers of the sample read
+        LIS3DH_FifoDrain drain;                         ///< Asynchronous read of the FIFO
+        uint8_t pending;                                ///< True while a sample is being read
+        uint8_t data_ready;                             ///< True if reads are triggered by INT1 data-ready
+        uint16_t sample_count;                          ///< Samples read successfully
+        uint16_t failure_count;                         ///< Sample reads that failed
+    } LIS3DH_Device;
+
+    /**
+    *   \brief Initialize a device handle.
+    *
+    *   The handle is set up without accessing the bus: the cache holds the
+    *   power-on values and the sample plan reads the status and output
+    *   registers with a single burst.
+    *   \param device Pointer to the handle.
+    *   \param address 7-bit I2C address of the device.
+    *   \param profile Configuration of the device.
+    */
+    void LIS3DH_Device_Init(LIS3DH_Device* device,
+                            uint8_t address,
+                            const LIS3DH_Profile* profile);
+
+    /**
+    *   \brief Select how the reads of the device are triggered.
+    *
+    *   When the reads are triggered by the data-ready signal on INT1, a new
+    *   sample is known to be available and only the output registers are
+    *   read; otherwise the status register is read with them to check it.
+    *   \param device Pointer to the handle.
+    *   \param enabled True if the reads are triggered by INT1 data-ready.
+    */
+    void LIS3DH_Device_SetDataReady(LIS3DH_Device* device, uint8_t enabled);
+
+    /**
+    *   \brief Check that the device answers as a LIS3DH.
+    *
+    *   \param device Pointer to the handle.
+    *   \retval ERROR if WHO_AM_I cannot be read or has an unexpected value.
+    */
+    ErrorCode LIS3DH_Device_Identify(const LIS3DH_Device* device);
+
+    /**
+    *   \brief Read the configuration of the device and apply its profile.
+    *
+    *   \param device Pointer to the handle.
+    */
+    ErrorCode LIS3DH_Device_Configure(LIS3DH_Device* device);
+
+    /**
+    *   \brief Take over a device that is already configured.
+    *
+    *   The configuration of the device is compared with the given register
+    *   image with a read-back; if it matches, the cache is filled from the
+    *   image and nothing is written.
+    *   \param device Pointer to the handle.
+    *   \param image Expected configuration of the device.
+    *   \retval ERROR if the device holds a different configuration.
+    */
+    ErrorCode LIS3DH_Device_Resume(LIS3DH_Device* device,
+                                   const LIS3DH_RegisterImage* image);
+
+    /**
+    *   \brief Take over a device whose configuration was already verified.
+    *
+    *   Same as LIS3DH_Device_Resume without the read-back: no bus operation
+    *   is performed.
+    *   \param device Pointer to the handle.
+    *   \param image Configuration the device is known to hold.
+    */
+    void LIS3DH_Device_Adopt(LIS3DH_Device* device,
+                             const LIS3DH_RegisterImage* image);
+
+    /**
+    *   \brief Start the asynchronous read of a sample.
+    *
+    *   \param device Pointer to the handle.
+    *   \retval ERROR if a sample is already being read.
+    */
+    ErrorCode LIS3DH_Device_SubmitSample(LIS3DH_Device* device);
+
+    /**
+    *   \brief Check if the read of a sample is completed.
+    *
+    *   \param device Pointer to the handle.
+    *   \param error Pointer to a variable where the result is saved.
+    *   \retval Returns true (>0) the first time the read is found completed.
+    */
+    uint8_t LIS3DH_Device_IsSampleComplete(LIS3DH_Device* device, ErrorCode* error);
+
+    /**
+    *   \brief Check if the last sample read holds new data on all the axes.
+    *
+    *   \param device Pointer to the handle.
+    */
+    uint8_t LIS3DH_Device_HasNewData(const LIS3DH_Device* device);
+
+    /**
+    *   \brief Get the output registers of the last sample.
+    *
+    *   The values are left-justified as in the output registers; the number
+    *   of significant bits depends on the operating mode of the profile.
+    *   \param device Pointer to the handle.
+    *   \param xyz Array where the values of the three axes are saved.
+    */
+    void LIS3DH_Device_GetRaw(const LIS3DH_Device* device, int16_t* xyz);
+
+    /**
+    *   \brief Get the last sample in mg.
+    *
+    *   \param device Pointer to the handle.
+    *   \param xyz Array where the values of the three axes are saved.
+    */
+    void LIS3DH_Device_GetMilliG(const LIS3DH_Device* device, int32_t* xyz);
+    
+    /**
+    *   \brief Read the samples stored in the FIFO of the device.
+    *
+    *   \param device Pointer to the handle.
+    *   \param min_level Minimum number of samples to be read.
+    *   \param batch Pointer to the batch to be filled.
+    */
+    ErrorCode LIS3DH_Device_ReadFifo(const LIS3DH_Device* device,
+                                     uint8_t min_level,
+                                     LIS3DH_FifoBatch* batch);
+    
+    /**
+    *   \brief Start the asynchronous read of the samples stored in the FIFO.
+    *
+    *   \param device Pointer to the handle.
+    *   \param min_level Minimum number of samples to be read.
+    *   \param batch Pointer to the batch to be filled, valid until the read is completed.
+    *   \retval ERROR if the FIFO is already being read.
+    */
+    ErrorCode LIS3DH_Device_SubmitFifo(LIS3DH_Device* device,
+                                       uint8_t min_level,
+                                       LIS3DH_FifoBatch* batch);
+    
+    /**
+    *   \brief Check if the read of the FIFO is completed.
+    *
+    *   \param device Pointer to the handle.
+    *   \param error Pointer to a variable where the result is saved.
+    *   \retval Returns true (>0) the first time the read is found completed.
+    */
+    uint8_t LIS3DH_Device_IsFifoComplete(LIS3DH_Device* device, ErrorCode* error);
+    
+    /**
+    *   \brief Read one channel of the auxiliary ADC.
+    *
+    *   The profile must enable the ADC; channel 3 holds the temperature
+    *   when the temperature sensor is enabled too.
+    *   \param device Pointer to the handle.
+    *   \param channel ADC channel (1-3).
+    *   \param value Pointer to the variable where the right-aligned value is saved.
+    *   \retval ERROR if the channel does not exist or cannot be read.
+    */
+    ErrorCode LIS3DH_Device_ReadAdc(const LIS3DH_Device* device,
+                                    uint8_t channel,
+                                    int16_t* value);
+    
+#endif // LIS3DH_Device_H
+/* [] END OF FILE */
@@ -0,0 +1,190 @@
+/*
+* This file includes the table of the configuration profiles
+* of the LIS3DH and the code to encode and apply them.
+*/
+
+#include "LIS3DH_Profiles.h"
+#include "I2C_Interface.h"
+
+const LIS3DH_Profile LIS3DH_Profiles[LIS3DH_PROFILE_COUNT] = {
+    [LIS3DH_PROFILE_POWER_DOWN] = {
+        .name = "Power down",
+        .mode = LIS3DH_MODE_NORMAL,
+        .odr = LIS3DH_ODR_POWER_DOWN,
+        .fsr = LIS3DH_FSR_2G,
+    },
+    [LIS3DH_PROFILE_NORMAL_50HZ_ADC] = {
+        .name = "Normal 50 Hz +-2 g ADC",
+        .mode = LIS3DH_MODE_NORMAL,
+        .odr = LIS3DH_ODR_50HZ,
+        .fsr = LIS3DH_FSR_2G,
+        .bdu = 1,
+        .adc_enabled = 1,
+        .temperature_enabled = 1,
+    },
+    [LIS3DH_PROFILE_NORMAL_100HZ_2G] = {
+        .name = "Normal 100 Hz +-2 g",
+        .mode = LIS3DH_MODE_NORMAL,
+        .odr = LIS3DH_ODR_100HZ,
+        .fsr = LIS3DH_FSR_2G,
+        .bdu = 1,
+    },
+    [LIS3DH_PROFILE_HIGH_RESOLUTION_100HZ_4G] = {
+        .name = "High resolution 100 Hz +-4 g",
+        .mode = LIS3DH_MODE_HIGH_RESOLUTION,
+        .odr = LIS3DH_ODR_100HZ,
+        .fsr = LIS3DH_FSR_4G,
+        .bdu = 1,
+        .int1_sources = LIS3DH_CTRL_REG3_I1_ZYXDA,
+    },
+    [LIS3DH_PROFILE_STREAM_400HZ_4G] = {
+        .name = "Normal 400 Hz +-4 g FIFO stream",
+        .mode = LIS3DH_MODE_NORMAL,
+        .odr = LIS3DH_ODR_400HZ,
+        .fsr = LIS3DH_FSR_4G,
+        .bdu = 1,
+        .fifo_mode = LIS3DH_FIFO_STREAM,
+        .fifo_watermark = 24,
+        .int1_sources = LIS3DH_CTRL_REG3_I1_WTM,
+    },
+    [LIS3DH_PROFILE_STREAM_1344HZ_4G] = {
+        .name = "Normal 1344 Hz +-4 g FIFO",
+        .mode = LIS3DH_MODE_NORMAL,
+        .odr = LIS3DH_ODR_1344HZ,
+        .fsr = LIS3DH_FSR_4G,
+        .bdu = 1,
+        .fifo_mode = LIS3DH_FIFO_STREAM,
+        .fifo_watermark = 24,
+        .int1_sources = LIS3DH_CTRL_REG3_I1_WTM,
+    },
+    [LIS3DH_PROFILE_LOW_POWER_5376HZ_4G] = {
+        .name = "Low power 5376 Hz +-4 g FIFO",
+        .mode = LIS3DH_MODE_LOW_POWER,
+        .odr = LIS3DH_ODR_1344HZ,
+        .fsr = LIS3DH_FSR_4G,
+        .bdu = 1,
+        .fifo_mode = LIS3DH_FIFO_STREAM,
+        .fifo_watermark = 24,
+        .int1_sources = LIS3DH_CTRL_REG3_I1_WTM,
+    },
+};
+
+    void LIS3DH_Profile_Encode(const LIS3DH_Profile* profile, LIS3DH_RegisterImage* image)
+    {
+        for (uint8_t i = 0; i < LIS3DH_CONFIG_SIZE; i++)
+        {
+            image->config[i] = 0x00;
+        }
+        uint8_t* temp_cfg_reg = &image->config[LIS3DH_TEMP_CFG_REG - LIS3DH_CONFIG_FIRST];
+        uint8_t* ctrl_reg1 = &image->config[LIS3DH_CTRL_REG1 - LIS3DH_CONFIG_FIRST];
+        uint8_t* ctrl_reg3 = &image->config[LIS3DH_CTRL_REG3 - LIS3DH_CONFIG_FIRST];
+        uint8_t* ctrl_reg4 = &image->config[LIS3DH_CTRL_REG4 - LIS3DH_CONFIG_FIRST];
+        uint8_t* ctrl_reg5 = &image->config[LIS3DH_CTRL_REG5 - LIS3DH_CONFIG_FIRST];
+        
+        // ADC and temperature sensor
+        if (profile->adc_enabled)
+        {
+            *temp_cfg_reg |= LIS3DH_TEMP_CFG_ADC_EN;
+        }
+        if (profile->temperature_enabled)
+        {
+            *temp_cfg_reg |= LIS3DH_TEMP_CFG_TEMP_EN;
+        }
+        
+        // Output data rate with all the axes enabled, the LPen bit selects low-power mode
+        *ctrl_reg1 = (profile->odr << LIS3DH_CTRL_REG1_ODR_SHIFT) | LIS3DH_CTRL_REG1_XYZ_EN;
+        if (profile->mode == LIS3DH_MODE_LOW_POWER)
+        {
+            *ctrl_reg1 |= LIS3DH_CTRL_REG1_LPEN;
+        }
+        
+        // Interrupt sources routed on INT1
+        *ctrl_reg3 = profile->int1_sources;
+        
+        // Block data update, full scale range, the HR bit selects high resolution mode
+        *ctrl_reg4 = profile->fsr << LIS3DH_CTRL_REG4_FS_SHIFT;
+        if (profile->bdu)
+        {
+            *ctrl_reg4 |= LIS3DH_CTRL_REG4_BDU;
+        }
+        if (profile->mode == LIS3DH_MODE_HIGH_RESOLUTION)
+        {
+            *ctrl_reg4 |= LIS3DH_CTRL_REG4_HR;
+        }
+        
+        // FIFO mode and watermark
+        image->fifo_ctrl = 0x00;
+        if (profile->fifo_mode != LIS3DH_FIFO_BYPASS)
+        {
+            *ctrl_reg5 |= LIS3DH_CTRL_REG5_FIFO_EN;
+            image->fifo_ctrl = (profile->fifo_mode << LIS3DH_FIFO_CTRL_FM_SHIFT) |
+                               (profile->fifo_watermark & LIS3DH_FIFO_CTRL_FTH_MASK);
+        }
+    }
+    
+    ErrorCode LIS3DH_Profile_Verify(uint8_t device_address, const LIS3DH_RegisterImage* image)
+    {
+        // Read back the whole configuration block with one burst
+        uint8_t config[LIS3DH_CONFIG_SIZE];
+        ErrorCode error = I2C_Peripheral_ReadRegisterMulti(device_address,
+                                                           LIS3DH_CONFIG_FIRST,
+                                                           LIS3DH_CONFIG_SIZE,
+                                                           config);
+        if (error != NO_ERROR)
+        {
+            return error;
+        }
+        for (uint8_t i = 0; i < LIS3DH_CONFIG_SIZE; i++)
+        {
+            if (config[i] != image->config[i])
+            {
+                return ERROR;
+            }
+        }
+        
+        // FIFO_CTRL_REG is not part of the block: it is checked even when the
+        // FIFO is bypassed, since the cache takes the image as the content
+        // of the device
+        uint8_t fifo_ctrl;
+        error = I2C_Peripheral_ReadRegister(device_address, LIS3DH_FIFO_CTRL_REG, &fifo_ctrl);
+        if (error != NO_ERROR)
+        {
+            return error;
+        }
+        if (fifo_ctrl != image->fifo_ctrl)
+        {
+            return ERROR;
+        }
+        return NO_ERROR;
+    }
+    
+    void LIS3DH_Profile_Sync(LIS3DH_RegisterCache* cache, const LIS3DH_RegisterImage* image)
+    {
+        for (uint8_t i = 0; i < LIS3DH_CONFIG_SIZE; i++)
+        {
+            LIS3DH_Cache_Sync(cache, LIS3DH_CONFIG_FIRST + i, image->config[i]);
+        }
+        LIS3DH_Cache_Sync(cache, LIS3DH_FIFO_CTRL_REG, image->fifo_ctrl);
+    }
+    
+    ErrorCode LIS3DH_Profile_Apply(LIS3DH_RegisterCache* cache, const LIS3DH_Profile* profile)
+    {
+        LIS3DH_RegisterImage image;
+        LIS3DH_Profile_Encode(profile, &image);
+        
+        // Let the cache find which registers change and write them with one burst
+        for (uint8_t i = 0; i < LIS3DH_CONFIG_SIZE; i++)
+        {
+            LIS3DH_Cache_Write(cache, LIS3DH_CONFIG_FIRST + i, image.config[i]);
+        }
+        LIS3DH_Cache_Write(cache, LIS3DH_FIFO_CTRL_REG, image.fifo_ctrl);
+        
+        ErrorCode error = LIS3DH_Cache_Flush(cache, NULL);
+        if (error != NO_ERROR)
+        {
+            return error;
+        }
+        return LIS3DH_Profile_Verify(cache->device_address, &image);
+    }
+
+/* [] END OF FILE */
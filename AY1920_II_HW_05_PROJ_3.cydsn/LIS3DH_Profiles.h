@@ -0,0 +1,163 @@
+/** 
+ * \file LIS3DH_Profiles.h
+ * \brief Named configuration profiles of the LIS3DH accelerometer.
+ *
+ * A profile describes the configuration of the sensor (operating mode,
+ * output data rate, full scale range, block data update, FIFO and
+ * interrupts) instead of the raw register values. Each profile is
+ * encoded once into a register image, which is written with a single
+ * multi-register burst and verified with a single read-back burst.
+*/
+
+#ifndef LIS3DH_Profiles_H
+    #define LIS3DH_Profiles_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH_Registers.h"
+    #include "LIS3DH_RegisterCache.h"
+    #include "LIS3DH_Format.h"
+    
+    /**
+    *   \brief Address of the first register of the configuration block.
+    */
+    #define LIS3DH_CONFIG_FIRST LIS3DH_TEMP_CFG_REG
+    
+    /**
+    *   \brief Number of registers of the configuration block (TEMP_CFG_REG..CTRL_REG6).
+    */
+    #define LIS3DH_CONFIG_SIZE (LIS3DH_CTRL_REG6 - LIS3DH_TEMP_CFG_REG + 1)
+    
+    /**
+    *   \brief Operating mode of the accelerometer.
+    */
+    typedef enum {
+        LIS3DH_MODE_LOW_POWER,          ///< 8-bit data output
+        LIS3DH_MODE_NORMAL,             ///< 10-bit data output
+        LIS3DH_MODE_HIGH_RESOLUTION     ///< 12-bit data output
+    } LIS3DH_Mode;
+    
+    /**
+    *   \brief Output data rate, as encoded in the ODR field of CTRL_REG1.
+    */
+    typedef enum {
+        LIS3DH_ODR_POWER_DOWN,          ///< Power-down mode
+        LIS3DH_ODR_1HZ,                 ///< 1 Hz
+        LIS3DH_ODR_10HZ,                ///< 10 Hz
+        LIS3DH_ODR_25HZ,                ///< 25 Hz
+        LIS3DH_ODR_50HZ,                ///< 50 Hz
+        LIS3DH_ODR_100HZ,               ///< 100 Hz
+        LIS3DH_ODR_200HZ,               ///< 200 Hz
+        LIS3DH_ODR_400HZ,               ///< 400 Hz
+        LIS3DH_ODR_1620HZ,              ///< 1.620 kHz, low-power mode only
+        LIS3DH_ODR_1344HZ               ///< 1.344 kHz, 5.376 kHz in low-power mode
+    } LIS3DH_Odr;
+    
+    /**
+    *   \brief Full scale range, as encoded in the FS field of CTRL_REG4.
+    */
+    typedef enum {
+        LIS3DH_FSR_2G,                  ///< ±2 g
+        LIS3DH_FSR_4G,                  ///< ±4 g
+        LIS3DH_FSR_8G,                  ///< ±8 g
+        LIS3DH_FSR_16G                  ///< ±16 g
+    } LIS3DH_Fsr;
+    
+    /**
+    *   \brief FIFO mode, as encoded in the FM field of FIFO_CTRL_REG.
+    */
+    typedef enum {
+        LIS3DH_FIFO_BYPASS,             ///< FIFO disabled
+        LIS3DH_FIFO_FIFO,               ///< Stop collecting when full
+        LIS3DH_FIFO_STREAM,             ///< Overwrite the oldest sample when full
+        LIS3DH_FIFO_STREAM_TO_FIFO      ///< Stream mode until the trigger event
+    } LIS3DH_FifoMode;
+    
+    /**
+    *   \brief Configuration profile of the accelerometer.
+    */
+    typedef struct {
+        const char* name;               ///< Name printed out on the UART
+        LIS3DH_Mode mode;               ///< Operating mode
+        LIS3DH_Odr odr;                 ///< Output data rate
+        LIS3DH_Fsr fsr;                 ///< Full scale range
+        uint8_t bdu;                    ///< Block data update enabled
+        LIS3DH_FifoMode fifo_mode;      ///< FIFO mode
+        uint8_t fifo_watermark;         ///< FIFO watermark level (0-31)
+        uint8_t int1_sources;           ///< Sources routed on INT1 (CTRL_REG3 bits)
+        uint8_t adc_enabled;            ///< Auxiliary ADC enabled
+        uint8_t temperature_enabled;    ///< Temperature sensor on ADC 3 enabled
+    } LIS3DH_Profile;
+    
+    /**
+    *   \brief Register values that implement a profile.
+    */
+    typedef struct {
+        uint8_t config[LIS3DH_CONFIG_SIZE]; ///< TEMP_CFG_REG, CTRL_REG1..CTRL_REG6
+        uint8_t fifo_ctrl;                  ///< FIFO_CTRL_REG
+    } LIS3DH_RegisterImage;
+    
+    /**
+    *   \brief Index of the profiles in the LIS3DH_Profiles table.
+    */
+    typedef enum {
+        LIS3DH_PROFILE_POWER_DOWN,              ///< Sensor stopped
+        LIS3DH_PROFILE_NORMAL_50HZ_ADC,         ///< Normal mode, 50 Hz, ±2 g, ADC and temperature
+        LIS3DH_PROFILE_NORMAL_100HZ_2G,         ///< Normal mode, 100 Hz, ±2 g
+        LIS3DH_PROFILE_HIGH_RESOLUTION_100HZ_4G,///< High resolution mode, 100 Hz, ±4 g, data-ready on INT1
+        LIS3DH_PROFILE_STREAM_400HZ_4G,         ///< Normal mode, 400 Hz, ±4 g, FIFO in Stream mode, watermark on INT1
+        LIS3DH_PROFILE_STREAM_1344HZ_4G,        ///< Normal mode, 1.344 kHz, ±4 g, FIFO in Stream mode, watermark on INT1
+        LIS3DH_PROFILE_LOW_POWER_5376HZ_4G,     ///< Low-power mode, 5.376 kHz, ±4 g, FIFO in Stream mode, watermark on INT1
+        LIS3DH_PROFILE_COUNT
+    } LIS3DH_ProfileIndex;
+    
+    /**
+    *   \brief Table of the available profiles.
+    */
+    extern const LIS3DH_Profile LIS3DH_Profiles[LIS3DH_PROFILE_COUNT];
+    
+    /**
+    *   \brief Get the data format of a profile.
+    */
+    #define LIS3DH_Profile_Format(profile) LIS3DH_Format_Get((profile)->mode, (profile)->fsr)
+    
+    /**
+    *   \brief Encode a profile into the register values implementing it.
+    *
+    *   \param profile Pointer to the profile.
+    *   \param image Pointer to the register image to be filled.
+    */
+    void LIS3DH_Profile_Encode(const LIS3DH_Profile* profile, LIS3DH_RegisterImage* image);
+    
+    /**
+    *   \brief Compare the registers of the device with a register image.
+    *
+    *   The configuration block is read with one burst, FIFO_CTRL_REG with
+    *   a second read.
+    *   \param device_address I2C address of the device.
+    *   \param image Pointer to the expected register image.
+    *   \retval ERROR if the registers cannot be read or do not match.
+    */
+    ErrorCode LIS3DH_Profile_Verify(uint8_t device_address, const LIS3DH_RegisterImage* image);
+    
+    /**
+    *   \brief Record in the cache a register image the device is known to hold.
+    *
+    *   No bus operation is performed, the image must have been verified.
+    *   \param cache Pointer to the register cache of the device.
+    *   \param image Pointer to the register image.
+    */
+    void LIS3DH_Profile_Sync(LIS3DH_RegisterCache* cache, const LIS3DH_RegisterImage* image);
+    
+    /**
+    *   \brief Configure the device with a profile.
+    *
+    *   The profile is encoded, written through the register cache (only the
+    *   registers that change, in one burst) and verified with a read-back.
+    *   \param cache Pointer to the register cache of the device.
+    *   \param profile Pointer to the profile.
+    */
+    ErrorCode LIS3DH_Profile_Apply(LIS3DH_RegisterCache* cache, const LIS3DH_Profile* profile);
+    
+#endif // LIS3DH_Profiles_H
+/* [] END OF FILE */
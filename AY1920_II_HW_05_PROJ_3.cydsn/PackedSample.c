@@ -0,0 +1,143 @@
+/*
+* This file includes the source code to pack
+* and unpack the acceleration samples.
+*/
+
+#include "PackedSample.h"
+
+    uint8_t PackedSample_Pack(const LIS3DH_Format* format, const int16_t* raw, uint8_t* packet)
+    {
+        uint16_t x = (uint16_t) LIS3DH_Format_Align(format, raw[0]);
+        uint16_t y = (uint16_t) LIS3DH_Format_Align(format, raw[1]);
+        uint16_t z = (uint16_t) LIS3DH_Format_Align(format, raw[2]);
+        
+        if (format->bits > 10)
+        {
+            packet[0] = PACKED_SAMPLE_MARKER_12 | ((x >> 8) & 0x0F);
+            packet[1] = (uint8_t)(x & 0xFF);
+            packet[2] = (uint8_t)((y >> 4) & 0xFF);
+            packet[3] = (uint8_t)(((y & 0x0F) << 4) | ((z >> 8) & 0x0F));
+            packet[4] = (uint8_t)(z & 0xFF);
+            return PACKED_SAMPLE_SIZE_12;
+        }
+        
+        uint32_t word = ((uint32_t) PACKED_SAMPLE_MARKER_10 << 24) |
+                        ((uint32_t)(x & 0x3FF) << 20) |
+                        ((uint32_t)(y & 0x3FF) << 10) |
+                        (z & 0x3FF);
+        packet[0] = (uint8_t)(word >> 24);
+        packet[1] = (uint8_t)(word >> 16);
+        packet[2] = (uint8_t)(word >> 8);
+        packet[3] = (uint8_t)(word & 0xFF);
+        return PACKED_SAMPLE_SIZE_10;
+    }
+    
+    void PackedSample_StreamHeader(const LIS3DH_Format* format, uint16_t odr_hz, uint8_t* header)
+    {
+        header[0] = PACKED_STREAM_HEADER;
+        header[1] = format->bits;
+        header[2] = format->mg_per_digit;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            header[3 + i] = (uint8_t)(format->mm_s2_q12 >> (8 * i));
+        }
+        header[7] = (uint8_t)(odr_hz & 0xFF);
+        header[8] = (uint8_t)(odr_hz >> 8);
+        header[9] = 0xC0;
+    }
+    
+    uint8_t PackedSample_Unpack(uint8_t bits, const uint8_t* packet, int16_t* xyz)
+    {
+        if (bits > 10)
+        {
+            if ((packet[0] & 0xF0) != PACKED_SAMPLE_MARKER_12)
+            {
+                return 0;
+            }
+            uint16_t x = ((packet[0] & 0x0F) << 8) | packet[1];
+            uint16_t y = (packet[2] << 4) | (packet[3] >> 4);
+            uint16_t z = ((packet[3] & 0x0F) << 8) | packet[4];
+            
+            // Sign extension from bit 11
+            xyz[0] = (int16_t)(x << 4) >> 4;
+            xyz[1] = (int16_t)(y << 4) >> 4;
+            xyz[2] = (int16_t)(z << 4) >> 4;
+            return PACKED_SAMPLE_SIZE_12;
+        }
+        
+        if ((packet[0] & 0xC0) != PACKED_SAMPLE_MARKER_10)
+        {
+            return 0;
+        }
+        uint32_t word = ((uint32_t) packet[0] << 24) | ((uint32_t) packet[1] << 16) |
+                        ((uint32_t) packet[2] << 8) | packet[3];
+        
+        // Sign extension from bit 9
+        xyz[0] = (int16_t)(((word >> 20) & 0x3FF) << 6) >> 6;
+        xyz[1] = (int16_t)(((word >> 10) & 0x3FF) << 6) >> 6;
+        xyz[2] = (int16_t)((word & 0x3FF) << 6) >> 6;
+        return PACKED_SAMPLE_SIZE_10;
+    }
+    
+    void PackedSample_InitDecoder(PackedDecoder* decoder)
+    {
+        decoder->length = 0;
+        decoder->bits = 0;
+        decoder->errors = 0;
+    }
+    
+    uint8_t PackedSample_Decode(PackedDecoder* decoder, uint8_t byte, int16_t* xyz)
+    {
+        // Samples can only be told apart once a header gave their size
+        if (decoder->length == 0)
+        {
+            if (byte == PACKED_STREAM_HEADER)
+            {
+                decoder->expected = PACKED_STREAM_HEADER_SIZE;
+            }
+            else if (decoder->bits > 10 && (byte & 0xF0) == PACKED_SAMPLE_MARKER_12)
+            {
+                decoder->expected = PACKED_SAMPLE_SIZE_12;
+            }
+            else if (decoder->bits != 0 && decoder->bits <= 10 &&
+                     (byte & 0xC0) == PACKED_SAMPLE_MARKER_10)
+            {
+                decoder->expected = PACKED_SAMPLE_SIZE_10;
+            }
+            else
+            {
+                return 0;
+            }
+        }
+        decoder->packet[decoder->length++] = byte;
+        if (decoder->length < decoder->expected)
+        {
+            return 0;
+        }
+        
+        decoder->length = 0;
+        if (decoder->packet[0] != PACKED_STREAM_HEADER)
+        {
+            return (PackedSample_Unpack(decoder->bits, decoder->packet, xyz) != 0);
+        }
+        
+        // A header is taken only if its footer and its resolution are right
+        const uint8_t* header = decoder->packet;
+        if (header[PACKED_STREAM_HEADER_SIZE - 1] != 0xC0 ||
+            (header[1] != 8 && header[1] != 10 && header[1] != 12))
+        {
+            decoder->errors++;
+            return 0;
+        }
+        decoder->bits = header[1];
+        decoder->mg_per_digit = header[2];
+        decoder->mm_s2_q12 = 0;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            decoder->mm_s2_q12 |= (int32_t)((uint32_t) header[3 + i] << (8 * i));
+        }
+        decoder->odr_hz = (uint16_t)(header[7] | (header[8] << 8));
+        return 0;
+    }
+
+/* [] END OF FILE */
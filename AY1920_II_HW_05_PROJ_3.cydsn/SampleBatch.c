@@ -0,0 +1,84 @@
+/*
+* This file includes the source code to collect
+* several samples in a single packet.
+*/
+
+#include "SampleBatch.h"
+#include "Frame.h"
+
+    void SampleBatch_Init(SampleBatch* batch, uint8_t size, uint32_t max_latency_us)
+    {
+        if (size < 1)
+        {
+            size = 1;
+        }
+        else if (size > SAMPLE_BATCH_MAX_SIZE)
+        {
+            size = SAMPLE_BATCH_MAX_SIZE;
+        }
+        batch->size = size;
+        batch->max_latency_us = max_latency_us;
+        batch->count = 0;
+    }
+    
+    uint8_t SampleBatch_Add(SampleBatch* batch,
+                            const LIS3DH_Format* format,
+                            const int16_t* raw,
+                            uint32_t timestamp_us)
+    {
+        if (batch->count == 0)
+        {
+            batch->packet[0] = SAMPLE_BATCH_HEADER;
+            batch->packet[1] = format->bits;
+            for (uint8_t i = 0; i < 4; i++)
+            {
+                batch->packet[3 + i] = (uint8_t)(timestamp_us >> (8 * i));
+            }
+            batch->length = 7;
+            batch->first_us = timestamp_us;
+        }
+        batch->length += PackedSample_Pack(format, raw, &batch->packet[batch->length]);
+        batch->count++;
+        return batch->count >= batch->size;
+    }
+    
+    uint8_t SampleBatch_IsDue(const SampleBatch* batch, uint32_t now_us)
+    {
+        return batch->count > 0 && (now_us - batch->first_us) >= batch->max_latency_us;
+    }
+    
+    uint8_t SampleBatch_Finish(SampleBatch* batch)
+    {
+        if (batch->count == 0)
+        {
+            return 0;
+        }
+        batch->packet[2] = batch->count;
+        uint16_t crc = Frame_Crc16(FRAME_CRC_INIT, &batch->packet[1], batch->length - 1);
+        batch->packet[batch->length++] = (uint8_t)(crc >> 8);
+        batch->packet[batch->length++] = (uint8_t)(crc & 0xFF);
+        batch->packet[batch->length++] = 0xC0;
+        batch->count = 0;
+        return batch->length;
+    }
+    
+    uint8_t SampleBatch_BytesPerSample(uint8_t size, uint8_t sample_bytes)
+    {
+        return (uint8_t)((SAMPLE_BATCH_OVERHEAD + size * sample_bytes + size - 1) / size);
+    }
+    
+    uint8_t SampleBatch_Efficiency(uint8_t size, uint8_t sample_bytes)
+    {
+        uint16_t data = size * sample_bytes;
+        return (uint8_t)(100 * data / (SAMPLE_BATCH_OVERHEAD + data));
+    }
+    
+    uint32_t SampleBatch_LatencyUs(uint8_t size, uint8_t sample_bytes,
+                                   uint16_t odr_hz, uint32_t baud_rate)
+    {
+        uint32_t wait_us = (uint32_t)(size - 1) * 1000000 / odr_hz;
+        uint32_t bytes = SAMPLE_BATCH_OVERHEAD + size * sample_bytes;
+        return wait_us + bytes * 10 * 1000000 / baud_rate;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,121 @@
+/** 
+ * \file SampleBatch.h
+ * \brief Several samples sent in a single packet.
+ *
+ * The samples are bit-packed (see PackedSample.h) and collected in a
+ * packet with a single header and checksum:
+ *
+ *     0xA6, bits, count, timestamp of the first sample in us (32 bits,
+ *     little endian), count packed samples, CRC-16 (big endian), 0xC0
+ *
+ * The CRC is the one of Frame.h, computed from bits to the last sample.
+ * The packet is sent when it holds the configured number of samples, or
+ * when its first sample has waited for the maximum latency.
+*/
+
+#ifndef SampleBatch_H
+    #define SampleBatch_H
+    
+    #include "cytypes.h"
+    #include "LIS3DH_Format.h"
+    #include "PackedSample.h"
+    
+    /**
+    *   \brief Largest number of samples in a packet.
+    */
+    #define SAMPLE_BATCH_MAX_SIZE 32
+    
+    /**
+    *   \brief Samples in a packet when the profile has no FIFO watermark.
+    */
+    #define SAMPLE_BATCH_DEFAULT_SIZE 10
+    
+    /**
+    *   \brief Time after which a packet is sent even if not full, in us.
+    */
+    #define SAMPLE_BATCH_DEFAULT_LATENCY_US 100000
+    
+    /**
+    *   \brief First byte of the packet.
+    */
+    #define SAMPLE_BATCH_HEADER 0xA6
+    
+    /**
+    *   \brief Bytes of the packet that are not samples.
+    */
+    #define SAMPLE_BATCH_OVERHEAD 10
+    
+    /**
+    *   \brief Size of the largest packet.
+    */
+    #define SAMPLE_BATCH_MAX_PACKET (SAMPLE_BATCH_OVERHEAD + SAMPLE_BATCH_MAX_SIZE * PACKED_SAMPLE_MAX_SIZE)
+    
+    /**
+    *   \brief Packet being filled.
+    */
+    typedef struct {
+        uint8_t packet[SAMPLE_BATCH_MAX_PACKET];    ///< Bytes of the packet
+        uint8_t length;                             ///< Bytes written so far
+        uint8_t count;                              ///< Samples in the packet
+        uint8_t size;                               ///< Samples of a full packet
+        uint32_t first_us;                          ///< Timestamp of the first sample
+        uint32_t max_latency_us;                    ///< Longest wait of the first sample
+    } SampleBatch;
+    
+    /**
+    *   \brief Start collecting packets of the given size.
+    *
+    *   \param batch Pointer to the batch.
+    *   \param size Samples in a packet (1 to SAMPLE_BATCH_MAX_SIZE).
+    *   \param max_latency_us Longest wait of the first sample of a packet.
+    */
+    void SampleBatch_Init(SampleBatch* batch, uint8_t size, uint32_t max_latency_us);
+    
+    /**
+    *   \brief Add a sample to the packet.
+    *
+    *   \param batch Pointer to the batch.
+    *   \param format Data format of the sample.
+    *   \param raw Left-justified values of the three axes.
+    *   \param timestamp_us Time of the sample.
+    *   \retval Returns true (>0) when the packet is full.
+    */
+    uint8_t SampleBatch_Add(SampleBatch* batch,
+                            const LIS3DH_Format* format,
+                            const int16_t* raw,
+                            uint32_t timestamp_us);
+    
+    /**
+    *   \brief Check if the first sample of the packet has waited too long.
+    */
+    uint8_t SampleBatch_IsDue(const SampleBatch* batch, uint32_t now_us);
+    
+    /**
+    *   \brief Close the packet, the next sample starts a new one.
+    *
+    *   \param batch Pointer to the batch.
+    *   \retval Number of bytes of the packet in batch->packet, 0 if empty.
+    */
+    uint8_t SampleBatch_Finish(SampleBatch* batch);
+    
+    /**
+    *   \brief Bytes sent for each sample, rounded up.
+    */
+    uint8_t SampleBatch_BytesPerSample(uint8_t size, uint8_t sample_bytes);
+    
+    /**
+    *   \brief Percentage of a packet that carries samples.
+    */
+    uint8_t SampleBatch_Efficiency(uint8_t size, uint8_t sample_bytes);
+    
+    /**
+    *   \brief Longest delay from a sample to the end of its packet on the UART.
+    *
+    *   The first sample waits for the others to be read, then for the whole
+    *   packet to be sent.
+    */
+    uint32_t SampleBatch_LatencyUs(uint8_t size, uint8_t sample_bytes,
+                                   uint16_t odr_hz, uint32_t baud_rate);
+    
+#endif // SampleBatch_H
+/* [] END OF FILE */
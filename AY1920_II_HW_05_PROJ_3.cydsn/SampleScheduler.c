@@ -0,0 +1,135 @@
+/*
+* This file includes the source code to sample
+* several LIS3DH in the same timer tick.
+*/
+
+#include "SampleScheduler.h"
+#include "CycleCounter.h"
+
+    void SampleScheduler_Init(SampleScheduler* scheduler)
+    {
+        scheduler->device_count = 0;
+        scheduler->active = 0;
+        scheduler->round_mask = 0;
+        scheduler->completed_mask = 0;
+        scheduler->fresh_mask = 0;
+        scheduler->round_cycles = 0;
+        scheduler->skew_cycles = 0;
+        scheduler->max_skew_cycles = 0;
+        scheduler->round_count = 0;
+    }
+
+    ErrorCode SampleScheduler_AddDevice(SampleScheduler* scheduler, LIS3DH_Device* device)
+    {
+        if (scheduler->device_count >= SAMPLE_SCHEDULER_MAX_DEVICES)
+        {
+            return ERROR;
+        }
+        scheduler->devices[scheduler->device_count++] = device;
+        return NO_ERROR;
+    }
+
+    ErrorCode SampleScheduler_StartRound(SampleScheduler* scheduler)
+    {
+        if (scheduler->active || scheduler->device_count == 0)
+        {
+            return ERROR;
+        }
+
+        scheduler->round_start = CycleCounter_Read();
+        scheduler->first_done = scheduler->round_start;
+        scheduler->round_mask = 0;
+        scheduler->completed_mask = 0;
+        scheduler->fresh_mask = 0;
+
+        // All the reads are queued now, the I2C engine chains them on the bus
+        for (uint8_t i = 0; i < scheduler->device_count; i++)
+        {
+            // A device whose read cannot be queued is skipped in this round
+            if (LIS3DH_Device_SubmitSample(scheduler->devices[i]) == NO_ERROR)
+            {
+                scheduler->round_mask |= (1u << i);
+            }
+        }
+        scheduler->active = 1;
+        return NO_ERROR;
+    }
+
+    uint8_t SampleScheduler_Poll(SampleScheduler* scheduler)
+    {
+        if (!scheduler->active)
+        {
+            return 0;
+        }
+
+        for (uint8_t i = 0; i < scheduler->device_count; i++)
+        {
+            ErrorCode error;
+            LIS3DH_Device* device = scheduler->devices[i];
+            if (LIS3DH_Device_IsSampleComplete(device, &error))
+            {
+                uint32_t now = CycleCounter_Read();
+                if (scheduler->completed_mask == 0)
+                {
+                    scheduler->first_done = now;
+                }
+                scheduler->completed_mask |= (1u << i);
+                if (error == NO_ERROR && LIS3DH_Device_HasNewData(device))
+                {
+                    scheduler->fresh_mask |= (1u << i);
+                }
+
+                // The last device closes the round
+                if (scheduler->completed_mask == scheduler->round_mask)
+                {
+                    scheduler->round_cycles = now - scheduler->round_start;
+                    scheduler->skew_cycles = now - scheduler->first_done;
+                    if (scheduler->skew_cycles > scheduler->max_skew_cycles)
+                    {
+                        scheduler->max_skew_cycles = scheduler->skew_cycles;
+                    }
+                }
+            }
+        }
+
+        if (scheduler->completed_mask != scheduler->round_mask)
+        {
+            return 0;
+        }
+        scheduler->active = 0;
+        scheduler->round_count++;
+        return 1;
+    }
+
+    uint8_t SampleScheduler_Pack(const SampleScheduler* scheduler, uint8_t* packet)
+    {
+        uint8_t length = 0;
+        packet[length++] = SAMPLE_SCHEDULER_HEADER;
+        packet[length++] = scheduler->fresh_mask;
+
+        for (uint8_t i = 0; i < scheduler->device_count; i++)
+        {
+            int16_t xyz[3];
+            LIS3DH_Device_GetRaw(scheduler->devices[i], xyz);
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                packet[length++] = (uint8_t)(xyz[axis] & 0xFF);
+                packet[length++] = (uint8_t)(xyz[axis] >> 8);
+            }
+        }
+
+        packet[length++] = SAMPLE_SCHEDULER_FOOTER;
+        return length;
+    }
+
+    uint16_t SampleScheduler_BusBytes(const SampleScheduler* scheduler)
+    {
+        uint16_t bytes = 0;
+        for (uint8_t i = 0; i < scheduler->device_count; i++)
+        {
+            bytes += RegisterPlan_BusBytes(&scheduler->devices[i]->plan);
+        }
+        return bytes;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,108 @@
+/**
+ * \file SampleScheduler.h
+ * \brief Sampling of several LIS3DH in the same timer tick.
+ *
+ * At each tick the scheduler queues the sample reads of all its devices
+ * back to back in the I2C engine, so that the transactions follow each
+ * other on the bus without waiting for the main loop. When all the reads
+ * are completed, the samples are packed into a single packet.
+ *
+ * Each round also measures how long the bus was busy and the skew between
+ * the first and the last device, using the cycle counter.
+*/
+
+#ifndef SampleScheduler_H
+    #define SampleScheduler_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH_Device.h"
+
+    /**
+    *   \brief Maximum number of devices sampled in the same tick.
+    */
+    #define SAMPLE_SCHEDULER_MAX_DEVICES 4
+
+    /**
+    *   \brief First byte of the combined packet.
+    *
+    *   Not 0xA0, which starts the packet of the converted values.
+    */
+    #define SAMPLE_SCHEDULER_HEADER 0xAC
+
+    /**
+    *   \brief Last byte of the combined packet.
+    */
+    #define SAMPLE_SCHEDULER_FOOTER 0xC0
+
+    /**
+    *   \brief Size of the combined packet for a given number of devices.
+    *
+    *   Header, mask of the devices with new data, three raw 16-bit values
+    *   for each device and footer.
+    */
+    #define SAMPLE_SCHEDULER_PACKET_SIZE(devices) (3 + 6 * (devices))
+
+    /**
+    *   \brief Devices sampled together and statistics of the rounds.
+    */
+    typedef struct {
+        LIS3DH_Device* devices[SAMPLE_SCHEDULER_MAX_DEVICES];   ///< Devices to be sampled
+        uint8_t device_count;                                   ///< Number of devices
+        uint8_t active;                                         ///< True while a round is running
+        uint8_t round_mask;                                     ///< Devices read in the current round
+        uint8_t completed_mask;                                 ///< Devices whose read is completed
+        uint8_t fresh_mask;                                     ///< Devices with new data in the round
+        uint32_t round_start;                                   ///< Cycle count at the start of the round
+        uint32_t first_done;                                    ///< Cycle count of the first completion
+        uint32_t round_cycles;                                  ///< Duration of the last round
+        uint32_t skew_cycles;                                   ///< Skew between devices in the last round
+        uint32_t max_skew_cycles;                               ///< Largest skew seen
+        uint16_t round_count;                                   ///< Rounds completed
+    } SampleScheduler;
+
+    /**
+    *   \brief Remove all the devices and reset the statistics.
+    */
+    void SampleScheduler_Init(SampleScheduler* scheduler);
+
+    /**
+    *   \brief Add a device to the ones sampled at each tick.
+    *
+    *   \retval ERROR if the scheduler is full.
+    */
+    ErrorCode SampleScheduler_AddDevice(SampleScheduler* scheduler, LIS3DH_Device* device);
+
+    /**
+    *   \brief Queue the sample reads of all the devices.
+    *
+    *   \retval ERROR if the previous round is still running.
+    */
+    ErrorCode SampleScheduler_StartRound(SampleScheduler* scheduler);
+
+    /**
+    *   \brief Check the progress of the current round.
+    *
+    *   This function must be called from the main loop after the I2C
+    *   transfers have been processed.
+    *   \retval Returns true (>0) once, when all the reads are completed.
+    */
+    uint8_t SampleScheduler_Poll(SampleScheduler* scheduler);
+
+    /**
+    *   \brief Pack the samples of the last round.
+    *
+    *   Devices whose read failed or had no new data keep the previous
+    *   values and have their bit cleared in the mask.
+    *   \param packet Array of SAMPLE_SCHEDULER_PACKET_SIZE(device_count) bytes.
+    *   \retval Number of bytes of the packet.
+    */
+    uint8_t SampleScheduler_Pack(const SampleScheduler* scheduler, uint8_t* packet);
+
+    /**
+    *   \brief Number of bytes moved on the bus by a round.
+    */
+    uint16_t SampleScheduler_BusBytes(const SampleScheduler* scheduler);
+
+#endif // SampleScheduler_H
+/* [] END OF FILE */
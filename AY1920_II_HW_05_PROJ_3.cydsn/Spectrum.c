@@ -0,0 +1,352 @@
+/*
+* This file includes the source code to compute
+* the spectrum of the acceleration.
+*/
+
+#include "Spectrum.h"
+
+    /**
+    *   \brief Quarter of a sine wave of SPECTRUM_MAX_POINTS samples, in Q15.
+    */
+    static const int16_t Spectrum_SineTable[SPECTRUM_MAX_POINTS / 4 + 1] = {
+        0, 402, 804, 1206, 1608, 2009, 2411, 2811,
+        3212, 3612, 4011, 4410, 4808, 5205, 5602, 5998,
+        6393, 6787, 7180, 7571, 7962, 8351, 8740, 9127,
+        9512, 9896, 10279, 10660, 11039, 11417, 11793, 12167,
+        12540, 12910, 13279, 13646, 14010, 14373, 14733, 15091,
+        15447, 15800, 16151, 16500, 16846, 17190, 17531, 17869,
+        18205, 18538, 18868, 19195, 19520, 19841, 20160, 20475,
+        20788, 21097, 21403, 21706, 22006, 22302, 22595, 22884,
+        23170, 23453, 23732, 24008, 24279, 24548, 24812, 25073,
+        25330, 25583, 25833, 26078, 26320, 26557, 26791, 27020,
+        27246, 27467, 27684, 27897, 28106, 28311, 28511, 28707,
+        28899, 29086, 29269, 29448, 29622, 29792, 29957, 30118,
+        30274, 30425, 30572, 30715, 30853, 30986, 31114, 31238,
+        31357, 31471, 31581, 31686, 31786, 31881, 31972, 32058,
+        32138, 32214, 32286, 32352, 32413, 32470, 32522, 32568,
+        32610, 32647, 32679, 32706, 32729, 32746, 32758, 32766,
+        32767
+    };
+    
+    /**
+    *   \brief First half of a Hann window of SPECTRUM_MAX_POINTS samples, in Q15.
+    */
+    static const int16_t Spectrum_HannTable[SPECTRUM_MAX_POINTS / 2 + 1] = {
+        0, 1, 5, 11, 20, 31, 44, 60,
+        79, 100, 123, 149, 177, 208, 241, 277,
+        315, 355, 398, 443, 491, 541, 593, 648,
+        705, 765, 827, 891, 958, 1027, 1098, 1171,
+        1247, 1325, 1406, 1488, 1573, 1660, 1749, 1841,
+        1935, 2030, 2128, 2229, 2331, 2435, 2542, 2651,
+        2761, 2874, 2989, 3105, 3224, 3345, 3468, 3592,
+        3719, 3847, 3978, 4110, 4244, 4380, 4518, 4657,
+        4799, 4942, 5087, 5233, 5381, 5531, 5682, 5835,
+        5990, 6146, 6304, 6463, 6624, 6786, 6950, 7115,
+        7282, 7449, 7619, 7789, 7961, 8134, 8308, 8484,
+        8661, 8839, 9018, 9198, 9379, 9561, 9745, 9929,
+        10114, 10300, 10487, 10676, 10864, 11054, 11245, 11436,
+        11628, 11821, 12014, 12208, 12403, 12598, 12794, 12991,
+        13188, 13385, 13583, 13781, 13980, 14179, 14378, 14578,
+        14778, 14978, 15179, 15379, 15580, 15781, 15982, 16183,
+        16384, 16585, 16786, 16987, 17188, 17389, 17589, 17790,
+        17990, 18190, 18390, 18589, 18788, 18987, 19185, 19383,
+        19580, 19777, 19974, 20170, 20365, 20560, 20754, 20947,
+        21140, 21332, 21523, 21714, 21904, 22092, 22281, 22468,
+        22654, 22839, 23023, 23207, 23389, 23570, 23750, 23929,
+        24107, 24284, 24460, 24634, 24807, 24979, 25149, 25319,
+        25486, 25653, 25818, 25982, 26144, 26305, 26464, 26622,
+        26778, 26933, 27086, 27237, 27387, 27535, 27681, 27826,
+        27969, 28111, 28250, 28388, 28524, 28658, 28790, 28921,
+        29049, 29176, 29300, 29423, 29544, 29663, 29779, 29894,
+        30007, 30117, 30226, 30333, 30437, 30539, 30640, 30738,
+        30833, 30927, 31019, 31108, 31195, 31280, 31362, 31443,
+        31521, 31597, 31670, 31741, 31810, 31877, 31941, 32003,
+        32063, 32120, 32175, 32227, 32277, 32325, 32370, 32413,
+        32453, 32491, 32527, 32560, 32591, 32619, 32645, 32668,
+        32689, 32708, 32724, 32737, 32748, 32757, 32763, 32767,
+        32767
+    };
+    
+    /**
+    *   \brief Sine of 2 pi m / SPECTRUM_MAX_POINTS, in Q15.
+    */
+    static int16_t Spectrum_Sine(uint16_t m)
+    {
+        m &= SPECTRUM_MAX_POINTS - 1;
+        if (m <= SPECTRUM_MAX_POINTS / 4)
+        {
+            return Spectrum_SineTable[m];
+        }
+        if (m <= SPECTRUM_MAX_POINTS / 2)
+        {
+            return Spectrum_SineTable[SPECTRUM_MAX_POINTS / 2 - m];
+        }
+        return -Spectrum_Sine(m - SPECTRUM_MAX_POINTS / 2);
+    }
+    
+    /**
+    *   \brief Integer square root, rounded down.
+    */
+    static uint16_t Spectrum_Sqrt(uint32_t value)
+    {
+        uint32_t root = 0;
+        uint32_t bit = (uint32_t) 1 << 30;
+        while (bit > value)
+        {
+            bit >>= 2;
+        }
+        while (bit != 0)
+        {
+            if (value >= root + bit)
+            {
+                value -= root + bit;
+                root = (root >> 1) + bit;
+            }
+            else
+            {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint16_t) root;
+    }
+    
+    static void Spectrum_Put16(uint8_t* data, uint16_t value)
+    {
+        data[0] = (uint8_t)(value & 0xFF);
+        data[1] = (uint8_t)(value >> 8);
+    }
+    
+    void Spectrum_Fft(int16_t* data, uint8_t log2_points)
+    {
+        uint16_t points = 1 << log2_points;
+        
+        // Inputs in bit-reversed order, so that the outputs are in order
+        for (uint16_t i = 1, j = 0; i < points; i++)
+        {
+            uint16_t bit = points >> 1;
+            while (j & bit)
+            {
+                j ^= bit;
+                bit >>= 1;
+            }
+            j |= bit;
+            if (i < j)
+            {
+                int16_t re = data[2*i];
+                int16_t im = data[2*i+1];
+                data[2*i] = data[2*j];
+                data[2*i+1] = data[2*j+1];
+                data[2*j] = re;
+                data[2*j+1] = im;
+            }
+        }
+        
+        // Each stage halves the values: the magnitudes never grow, so with
+        // inputs of at most 32767 no sum can overflow
+        for (uint16_t size = 2; size <= points; size <<= 1)
+        {
+            uint16_t half = size >> 1;
+            uint16_t stride = SPECTRUM_MAX_POINTS / size;
+            for (uint16_t k = 0; k < half; k++)
+            {
+                int32_t wr = Spectrum_Sine(k * stride + SPECTRUM_MAX_POINTS / 4);
+                int32_t wi = -Spectrum_Sine(k * stride);
+                for (uint16_t a = k; a < points; a += size)
+                {
+                    uint16_t b = a + half;
+                    int32_t tr = (data[2*b] * wr - data[2*b+1] * wi + 0x4000) >> 15;
+                    int32_t ti = (data[2*b] * wi + data[2*b+1] * wr + 0x4000) >> 15;
+                    int32_t ar = data[2*a];
+                    int32_t ai = data[2*a+1];
+                    data[2*a] = (int16_t)((ar + tr) >> 1);
+                    data[2*a+1] = (int16_t)((ai + ti) >> 1);
+                    data[2*b] = (int16_t)((ar - tr) >> 1);
+                    data[2*b+1] = (int16_t)((ai - ti) >> 1);
+                }
+            }
+        }
+    }
+    
+    ErrorCode Spectrum_Init(Spectrum* spectrum, uint8_t log2_points, uint8_t peaks, uint16_t rate_hz)
+    {
+        if (log2_points < SPECTRUM_MIN_LOG2 || log2_points > SPECTRUM_MAX_LOG2 ||
+            peaks > SPECTRUM_MAX_PEAKS)
+        {
+            return ERROR;
+        }
+        spectrum->log2_points = log2_points;
+        spectrum->peaks = peaks;
+        spectrum->rate_hz = rate_hz;
+        spectrum->fill = 0;
+        spectrum->filling = 0;
+        spectrum->ready = 0;
+        spectrum->overruns = 0;
+        spectrum->sequence = 0;
+        return NO_ERROR;
+    }
+    
+    void Spectrum_Push(Spectrum* spectrum, const int16_t* xyz)
+    {
+        int16_t* sample = spectrum->samples[spectrum->filling][spectrum->fill];
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            sample[axis] = xyz[axis];
+        }
+        
+        if (++spectrum->fill < (1 << spectrum->log2_points))
+        {
+            return;
+        }
+        spectrum->fill = 0;
+        
+        // The full buffer is kept only if the other one has been sent
+        if (spectrum->ready)
+        {
+            spectrum->overruns++;
+            return;
+        }
+        spectrum->filling ^= 1;
+        spectrum->ready = 1;
+        spectrum->axis = 0;
+        spectrum->next_bin = 0;
+    }
+    
+    /**
+    *   \brief Window and transform one axis of the full buffer, then take
+    *   the magnitudes of the bins up to half the sample rate.
+    */
+    static void Spectrum_Transform(Spectrum* spectrum)
+    {
+        uint16_t points = 1 << spectrum->log2_points;
+        const int16_t (*samples)[3] = spectrum->samples[spectrum->filling ^ 1];
+        
+        for (uint16_t n = 0; n < points; n++)
+        {
+            // The window of 256 points takes one value out of two of the table
+            uint16_t m = n << (SPECTRUM_MAX_LOG2 - spectrum->log2_points);
+            int32_t window = Spectrum_HannTable[(m <= SPECTRUM_MAX_POINTS / 2) ? m : SPECTRUM_MAX_POINTS - m];
+            spectrum->work[2*n] = (int16_t)((samples[n][spectrum->axis] * window + 0x4000) >> 15);
+            spectrum->work[2*n+1] = 0;
+        }
+        Spectrum_Fft(spectrum->work, spectrum->log2_points);
+        
+        for (uint16_t k = 0; k < points / 2; k++)
+        {
+            int32_t re = spectrum->work[2*k];
+            int32_t im = spectrum->work[2*k+1];
+            spectrum->magnitudes[k] = Spectrum_Sqrt((uint32_t)(re * re + im * im));
+        }
+    }
+    
+    /**
+    *   \brief Write the largest local maxima of the magnitudes.
+    */
+    static uint8_t Spectrum_WritePeaks(const Spectrum* spectrum, uint8_t* data)
+    {
+        uint16_t bins[SPECTRUM_MAX_PEAKS];
+        uint8_t count = 0;
+        uint16_t last = (1 << spectrum->log2_points) / 2 - 1;
+        const uint16_t* magnitudes = spectrum->magnitudes;
+        
+        // Insertion into a short list sorted by magnitude, largest first
+        for (uint16_t k = 1; k < last; k++)
+        {
+            if (magnitudes[k] <= magnitudes[k-1] || magnitudes[k] < magnitudes[k+1])
+            {
+                continue;
+            }
+            uint8_t i = (count < spectrum->peaks) ? count++ : count;
+            while (i > 0 && magnitudes[bins[i-1]] < magnitudes[k])
+            {
+                if (i < spectrum->peaks)
+                {
+                    bins[i] = bins[i-1];
+                }
+                i--;
+            }
+            if (i < spectrum->peaks)
+            {
+                bins[i] = k;
+            }
+        }
+        
+        data[0] = count;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            Spectrum_Put16(&data[1 + 4*i], bins[i]);
+            Spectrum_Put16(&data[3 + 4*i], magnitudes[bins[i]]);
+        }
+        return 1 + 4 * count;
+    }
+    
+    uint8_t Spectrum_Process(Spectrum* spectrum, uint8_t* packet)
+    {
+        if (!spectrum->ready)
+        {
+            return 0;
+        }
+        if (spectrum->next_bin == 0)
+        {
+            Spectrum_Transform(spectrum);
+        }
+        
+        uint8_t length = 0;
+        packet[length++] = spectrum->peaks ? SPECTRUM_PEAKS_HEADER : SPECTRUM_BINS_HEADER;
+        packet[length++] = spectrum->sequence;
+        packet[length++] = spectrum->axis;
+        packet[length++] = spectrum->log2_points;
+        Spectrum_Put16(&packet[length], spectrum->rate_hz);
+        length += 2;
+        
+        uint16_t bins = (1 << spectrum->log2_points) / 2;
+        if (spectrum->peaks)
+        {
+            length += Spectrum_WritePeaks(spectrum, &packet[length]);
+            spectrum->next_bin = bins;
+        }
+        else
+        {
+            uint8_t count = (bins - spectrum->next_bin < SPECTRUM_BINS_PER_PACKET) ?
+                            bins - spectrum->next_bin : SPECTRUM_BINS_PER_PACKET;
+            Spectrum_Put16(&packet[length], spectrum->next_bin);
+            packet[length + 2] = count;
+            length += 3;
+            for (uint8_t i = 0; i < count; i++)
+            {
+                Spectrum_Put16(&packet[length], spectrum->magnitudes[spectrum->next_bin++]);
+                length += 2;
+            }
+        }
+        packet[length++] = 0xC0;
+        
+        // The next call goes on with the next axis, then with the next buffer
+        if (spectrum->next_bin >= bins)
+        {
+            spectrum->next_bin = 0;
+            if (++spectrum->axis == 3)
+            {
+                spectrum->ready = 0;
+                spectrum->sequence++;
+            }
+        }
+        return length;
+    }
+    
+    uint8_t Spectrum_BytesPerSample(const Spectrum* spectrum)
+    {
+        uint16_t points = 1 << spectrum->log2_points;
+        uint16_t bytes;
+        if (spectrum->peaks)
+        {
+            bytes = 3 * (8 + 4 * spectrum->peaks);
+        }
+        else
+        {
+            uint16_t packets = (points / 2 + SPECTRUM_BINS_PER_PACKET - 1) / SPECTRUM_BINS_PER_PACKET;
+            bytes = 3 * (packets * 10 + points);
+        }
+        return (uint8_t)((bytes + points - 1) / points);
+    }
+
+/* [] END OF FILE */
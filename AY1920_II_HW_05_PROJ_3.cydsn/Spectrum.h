@@ -0,0 +1,128 @@
+/** 
+ * \file Spectrum.h
+ * \brief Spectrum of the acceleration computed on the board.
+ *
+ * The samples fill one of two buffers while the other one is transformed,
+ * one axis at each call from the main loop: Hann window, in-place radix-2
+ * FFT in Q15 (256 or 512 points, scaled by 1/2 at each stage so that it
+ * cannot overflow) and magnitude of the bins. Each axis is then sent as:
+ *
+ *     bins:  0xA8, sequence, axis, log2 of the points, sample rate in Hz,
+ *            first bin, count, count magnitudes, 0xC0
+ *     peaks: 0xA9, sequence, axis, log2 of the points, sample rate in Hz,
+ *            count, count pairs of bin and magnitude, 0xC0
+ *
+ * All the 16-bit values are little endian. The bins are split in packets
+ * of SPECTRUM_BINS_PER_PACKET; the peaks are the count largest local
+ * maxima, largest first. A full-scale sine gives a magnitude of about
+ * 8192, as the FFT is divided by the number of points and the window
+ * halves the amplitude. The code has no dependency on the PSoC, so the
+ * host build of Spectrum_Fft is the reference of the board.
+*/
+
+#ifndef Spectrum_H
+    #define Spectrum_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    
+    /**
+    *   \brief Supported sizes of the transform, as powers of 2.
+    */
+    #define SPECTRUM_MIN_LOG2 8
+    #define SPECTRUM_MAX_LOG2 9
+    #define SPECTRUM_MAX_POINTS (1 << SPECTRUM_MAX_LOG2)
+    
+    /**
+    *   \brief First byte of the packets.
+    */
+    #define SPECTRUM_BINS_HEADER 0xA8
+    #define SPECTRUM_PEAKS_HEADER 0xA9
+    
+    /**
+    *   \brief Magnitudes sent in each packet of bins.
+    */
+    #define SPECTRUM_BINS_PER_PACKET 64
+    
+    /**
+    *   \brief Largest number of peaks sent for each axis.
+    */
+    #define SPECTRUM_MAX_PEAKS 16
+    
+    /**
+    *   \brief Size of the largest packet, a packet of bins.
+    */
+    #define SPECTRUM_MAX_PACKET (10 + 2 * SPECTRUM_BINS_PER_PACKET)
+    
+    /**
+    *   \brief Buffers and progress of the spectrum.
+    */
+    typedef struct {
+        int16_t samples[2][SPECTRUM_MAX_POINTS][3];     ///< Ping-pong buffers of samples
+        int16_t work[2 * SPECTRUM_MAX_POINTS];          ///< Real and imaginary parts of the transform
+        uint16_t magnitudes[SPECTRUM_MAX_POINTS / 2];   ///< Magnitudes of the axis being sent
+        uint16_t fill;                                  ///< Samples in the buffer being filled
+        uint16_t next_bin;                              ///< Next bin to be sent
+        uint16_t rate_hz;                               ///< Sample rate
+        uint16_t overruns;                              ///< Buffers lost while the previous one was sent
+        uint8_t filling;                                ///< Buffer being filled
+        uint8_t ready;                                  ///< True while the other buffer is being sent
+        uint8_t axis;                                   ///< Axis being sent
+        uint8_t log2_points;                            ///< Size of the transform
+        uint8_t peaks;                                  ///< Peaks sent for each axis, 0 for all the bins
+        uint8_t sequence;                               ///< Number of the spectrum
+    } Spectrum;
+    
+    /**
+    *   \brief Configure the spectrum and empty its buffers.
+    *
+    *   \param spectrum Pointer to the spectrum.
+    *   \param log2_points Size of the transform (SPECTRUM_MIN_LOG2 to SPECTRUM_MAX_LOG2).
+    *   \param peaks Peaks sent for each axis, 0 to send all the bins.
+    *   \param rate_hz Sample rate, sent with the spectrum.
+    *   \retval ERROR if the size or the number of peaks are not supported.
+    */
+    ErrorCode Spectrum_Init(Spectrum* spectrum, uint8_t log2_points, uint8_t peaks, uint16_t rate_hz);
+    
+    /**
+    *   \brief Add a sample of the three axes.
+    *
+    *   When the buffer is full it is handed to Spectrum_Process; if the
+    *   previous one is still being sent, the samples are lost.
+    */
+    void Spectrum_Push(Spectrum* spectrum, const int16_t* xyz);
+    
+    /**
+    *   \brief Move the transform of the full buffer forward.
+    *
+    *   Each call transforms an axis or writes a packet of bins.
+    *   \param spectrum Pointer to the spectrum.
+    *   \param packet Array of SPECTRUM_MAX_PACKET bytes.
+    *   \retval Number of bytes of the packet, 0 if there is nothing to send.
+    */
+    uint8_t Spectrum_Process(Spectrum* spectrum, uint8_t* packet);
+    
+    /**
+    *   \brief Bytes sent for each sample, rounded up.
+    */
+    uint8_t Spectrum_BytesPerSample(const Spectrum* spectrum);
+    
+    /**
+    *   \brief In-place FFT in Q15, divided by the number of points.
+    *
+    *   \param data Real and imaginary parts, interleaved.
+    *   \param log2_points Size of the transform (at most SPECTRUM_MAX_LOG2).
+    */
+    void Spectrum_Fft(int16_t* data, uint8_t log2_points);
+    
+    /**
+    *   \brief CRC of the FFT of the test signal, as given by the host build.
+    *
+    *   The X and Y axes of the first SPECTRUM_MAX_POINTS samples of
+    *   Decimator_TestSignal are the real and imaginary parts; Frame_Crc16
+    *   from FRAME_CRC_INIT runs over the little-endian result.
+    */
+    #define SPECTRUM_TEST_CRC 0xB385
+    
+#endif // Spectrum_H
+/* [] END OF FILE */
@@ -0,0 +1,154 @@
+/*
+* This file includes the source code to check
+* that the stream of samples can be sustained.
+*/
+
+#include "StreamBudget.h"
+#include "LIS3DH_Fifo.h"
+#include "SampleScheduler.h"
+
+    /**
+    *   \brief Output data rates in Hz, in normal and high resolution mode.
+    */
+    static const uint16_t StreamBudget_OdrTable[] = {
+        0, 1, 10, 25, 50, 100, 200, 400, 0, 1344
+    };
+    
+    uint16_t StreamBudget_OdrHz(const LIS3DH_Profile* profile)
+    {
+        // The two highest codes are faster in low-power mode
+        if (profile->mode == LIS3DH_MODE_LOW_POWER)
+        {
+            if (profile->odr == LIS3DH_ODR_1620HZ)
+            {
+                return 1620;
+            }
+            if (profile->odr == LIS3DH_ODR_1344HZ)
+            {
+                return 5376;
+            }
+        }
+        return StreamBudget_OdrTable[profile->odr];
+    }
+    
+    /**
+    *   \brief UART bytes needed per second, one sample out of decimation sent.
+    */
+    static uint32_t StreamBudget_UartBytes(const StreamBudget* budget,
+                                           uint8_t watermark,
+                                           uint8_t device_count,
+                                           uint8_t packet_size,
+                                           uint8_t decimation)
+    {
+        uint32_t packets = budget->odr_hz / decimation;
+        if (device_count == 1 && packet_size > 0)
+        {
+            // The samples of a FIFO batch are sent one by one in the format
+            return packets * packet_size;
+        }
+        
+        if (budget->use_fifo)
+        {
+            // Each batch costs its framing even when few of its samples are kept
+            uint32_t batches = budget->odr_hz / watermark;
+            return device_count * (packets * budget->sample_bytes +
+                                   batches * STREAM_BATCH_OVERHEAD);
+        }
+        return packets * SAMPLE_SCHEDULER_PACKET_SIZE(device_count);
+    }
+    
+    ErrorCode StreamBudget_Plan(const LIS3DH_Profile* profile,
+                                uint16_t i2c_khz,
+                                uint32_t baud_rate,
+                                uint8_t device_count,
+                                uint8_t packet_size,
+                                uint16_t output_hz,
+                                uint8_t has_int1,
+                                StreamBudget* budget)
+    {
+        budget->verdict = STREAM_OK;
+        budget->odr_hz = StreamBudget_OdrHz(profile);
+        budget->use_fifo = (profile->fifo_mode != LIS3DH_FIFO_BYPASS);
+        budget->sample_bytes = (profile->mode == LIS3DH_MODE_LOW_POWER) ?
+                               LIS3DH_FIFO_SAMPLE_SIZE / 2 : LIS3DH_FIFO_SAMPLE_SIZE;
+        budget->decimation = 1;
+        budget->i2c_bytes_per_second = 0;
+        budget->uart_bytes_per_second = 0;
+        
+        if (budget->odr_hz == 0)
+        {
+            budget->verdict = STREAM_REFUSED_ODR;
+            return ERROR;
+        }
+        
+        // Sample source: without INT1 the reads follow the timer, so a FIFO
+        // must not fill up between two ticks and without FIFO the timer must
+        // be faster than the sensor
+        uint8_t watermark = (profile->fifo_watermark > 0) ? profile->fifo_watermark : 1;
+        uint32_t samples_per_tick = ((uint32_t) budget->odr_hz * STREAM_TICK_US + 999999) / 1000000;
+        if (!has_int1)
+        {
+            if (budget->use_fifo ?
+                (watermark - 1 + samples_per_tick >= LIS3DH_FIFO_DEPTH) :
+                (samples_per_tick > 1))
+            {
+                budget->verdict = STREAM_REFUSED_SOURCE;
+                return ERROR;
+            }
+        }
+        
+        // I2C: every read moves the address twice, the register address and
+        // the data; a FIFO drain reads FIFO_SRC_REG first
+        if (budget->use_fifo)
+        {
+            uint32_t drains = budget->odr_hz / watermark + 1;
+            budget->i2c_bytes_per_second = (uint32_t) budget->odr_hz * LIS3DH_FIFO_SAMPLE_SIZE +
+                                           drains * (4 + 3);
+        }
+        else
+        {
+            // The status register is not read when data-ready triggers the reads
+            uint8_t status = (has_int1 && (profile->int1_sources & LIS3DH_CTRL_REG3_I1_ZYXDA)) ? 0 : 1;
+            budget->i2c_bytes_per_second = (uint32_t) budget->odr_hz *
+                                           (3 + status + LIS3DH_FIFO_SAMPLE_SIZE);
+        }
+        budget->i2c_bytes_per_second *= device_count;
+        
+        uint32_t i2c_capacity = (uint32_t) i2c_khz * 1000 / STREAM_I2C_BITS_PER_BYTE *
+                                STREAM_LOAD_PERCENT / 100;
+        if (budget->i2c_bytes_per_second > i2c_capacity)
+        {
+            budget->verdict = STREAM_REFUSED_I2C;
+            return ERROR;
+        }
+        
+        // UART: the samples the link cannot carry are dropped at a fixed rate,
+        // so the ones sent are still evenly spaced; the output rate sets the
+        // lowest decimation
+        uint32_t uart_capacity = baud_rate / STREAM_UART_BITS_PER_BYTE *
+                                 STREAM_LOAD_PERCENT / 100;
+        uint8_t first = 1;
+        if (output_hz > 0 && budget->odr_hz > output_hz)
+        {
+            uint16_t rate = (budget->odr_hz + output_hz - 1) / output_hz;
+            first = (rate < STREAM_MAX_DECIMATION) ? rate : STREAM_MAX_DECIMATION;
+        }
+        for (uint8_t decimation = first; decimation <= STREAM_MAX_DECIMATION; decimation++)
+        {
+            uint32_t bytes = StreamBudget_UartBytes(budget, watermark, device_count,
+                                                    packet_size, decimation);
+            if (bytes <= uart_capacity)
+            {
+                budget->decimation = decimation;
+                budget->uart_bytes_per_second = bytes;
+                return NO_ERROR;
+            }
+        }
+        
+        budget->verdict = STREAM_REFUSED_UART;
+        budget->uart_bytes_per_second = StreamBudget_UartBytes(budget, watermark, device_count,
+                                                               packet_size, STREAM_MAX_DECIMATION);
+        return ERROR;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,116 @@
+/** 
+ * \file StreamBudget.h
+ * \brief Bandwidth budget of the acceleration stream.
+ *
+ * From the profile of the accelerometer, the data rate of the I2C bus and
+ * the baud rate of the UART, the budget chooses how the samples are read
+ * (one read per sample or FIFO batches) and how many of them can be sent.
+ * A stream that the I2C bus or the sample source cannot sustain is
+ * refused; a stream that only the UART cannot carry is decimated.
+*/
+
+#ifndef StreamBudget_H
+    #define StreamBudget_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH_Profiles.h"
+    
+    /**
+    *   \brief Baud rate of UART_Debug, as set in the schematic.
+    */
+    #define STREAM_UART_BAUD_RATE 19200
+    
+    /**
+    *   \brief Period of the Timer_1 interrupt, in us.
+    */
+    #define STREAM_TICK_US 10000
+    
+    /**
+    *   \brief Highest decimation accepted before the stream is refused.
+    */
+    #define STREAM_MAX_DECIMATION 32
+    
+    /**
+    *   \brief Percentage of the bus and UART capacity the stream can use.
+    */
+    #define STREAM_LOAD_PERCENT 80
+    
+    /**
+    *   \brief Bytes added to each FIFO batch (header, device, count, footer).
+    */
+    #define STREAM_BATCH_OVERHEAD 4
+    
+    /**
+    *   \brief Bytes of the packet carrying a single converted sample.
+    */
+    #define STREAM_SAMPLE_PACKET_SIZE 14
+
+    
+    /**
+    *   \brief Bits moved on the I2C bus for each byte (data and acknowledge).
+    */
+    #define STREAM_I2C_BITS_PER_BYTE 9
+    
+    /**
+    *   \brief Bits sent on the UART for each byte (start, data and stop).
+    */
+    #define STREAM_UART_BITS_PER_BYTE 10
+    
+    /**
+    *   \brief Reason why a stream is refused.
+    */
+    typedef enum {
+        STREAM_OK,                  ///< The stream can be sustained
+        STREAM_REFUSED_ODR,         ///< The sensor is powered down
+        STREAM_REFUSED_SOURCE,      ///< The samples cannot be collected in time
+        STREAM_REFUSED_I2C,         ///< The I2C bus is too slow for the samples
+        STREAM_REFUSED_UART         ///< The UART would need too much decimation
+    } StreamVerdict;
+    
+    /**
+    *   \brief Read strategy and bandwidth of a stream.
+    */
+    typedef struct {
+        StreamVerdict verdict;          ///< Whether the stream can be sustained
+        uint16_t odr_hz;                ///< Output data rate of the sensor
+        uint8_t use_fifo;               ///< Samples read in FIFO batches
+        uint8_t sample_bytes;           ///< Bytes of each sample in a batch, 3 in low-power mode
+        uint8_t decimation;             ///< One sample out of this many is sent
+        uint32_t i2c_bytes_per_second;  ///< Bus bytes needed to read the samples
+        uint32_t uart_bytes_per_second; ///< UART bytes needed to send them
+    } StreamBudget;
+    
+    /**
+    *   \brief Get the output data rate of a profile.
+    *
+    *   \retval Output data rate in Hz, 0 if the sensor is powered down.
+    */
+    uint16_t StreamBudget_OdrHz(const LIS3DH_Profile* profile);
+    
+    /**
+    *   \brief Plan the stream of a profile.
+    *
+    *   \param profile Profile of the accelerometer.
+    *   \param i2c_khz Data rate of the I2C bus, in kHz.
+    *   \param baud_rate Baud rate of the UART.
+    *   \param device_count Number of accelerometers streamed.
+    *   \param packet_size Bytes sent for each sample of a single accelerometer,
+    *   0 for the raw samples sent in combined packets or FIFO batches. With
+    *   more accelerometers the samples are always raw.
+    *   \param output_hz Highest rate of the samples sent, 0 for the ODR.
+    *   \param has_int1 True if the INT1 pin of the sensor triggers the reads.
+    *   \param budget Pointer to the structure where the plan is saved.
+    *   \retval ERROR if the stream is refused, see the verdict.
+    */
+    ErrorCode StreamBudget_Plan(const LIS3DH_Profile* profile,
+                                uint16_t i2c_khz,
+                                uint32_t baud_rate,
+                                uint8_t device_count,
+                                uint8_t packet_size,
+                                uint16_t output_hz,
+                                uint8_t has_int1,
+                                StreamBudget* budget);
+    
+#endif // StreamBudget_H
+/* [] END OF FILE */
@@ -0,0 +1,246 @@
+/*
+* This file includes the source code to send
+* the packets of the stream on the UART.
+*/
+
+#include "StreamOutput.h"
+#include "Frame.h"
+#include "UART_Debug.h"
+#include "CyLib.h"
+
+    // The main loop only writes the head and the interrupt only writes the
+    // tail; only dropping the oldest packets moves the tail from the main loop,
+    // inside a critical section
+    static uint8_t StreamOutput_Buffer[STREAM_OUTPUT_BUFFER_SIZE];
+    static volatile uint16_t StreamOutput_Head = 0;
+    static volatile uint16_t StreamOutput_Tail = 0;
+    static uint16_t StreamOutput_HighWater = 0;
+    static uint16_t StreamOutput_Overflows = 0;
+    static StreamOutputPolicy StreamOutput_Policy = STREAM_OUTPUT_DROP_NEWEST;
+    
+    // Offsets of the first byte of the queued packets, oldest first, kept
+    // by the main loop only with STREAM_OUTPUT_DROP_OLDEST
+    static uint16_t StreamOutput_Starts[STREAM_OUTPUT_MAX_PACKETS];
+    static uint8_t StreamOutput_FirstPacket = 0;
+    static uint8_t StreamOutput_PacketCount = 0;
+    
+    static uint8_t StreamOutput_Framed = 0;
+    static uint8_t StreamOutput_Sequence = 0;
+    
+    #define StreamOutput_Used() \
+        ((uint16_t)(StreamOutput_Head - StreamOutput_Tail) & (STREAM_OUTPUT_BUFFER_SIZE - 1))
+    
+    static void StreamOutput_Put(const uint8_t* data, uint8_t length)
+    {
+        uint16_t head = StreamOutput_Head;
+        for (uint8_t i = 0; i < length; i++)
+        {
+            StreamOutput_Buffer[head] = data[i];
+            head = (head + 1) & (STREAM_OUTPUT_BUFFER_SIZE - 1);
+        }
+        StreamOutput_Head = head;
+    }
+    
+    /**
+    *   \brief Forget the packets whose first byte has already been sent.
+    *
+    *   Must be called inside a critical section.
+    *   \param used Number of bytes queued.
+    *   \retval Returns the number of bytes left of the packet being sent.
+    */
+    static uint16_t StreamOutput_Forget(uint16_t used)
+    {
+        while (StreamOutput_PacketCount > 0)
+        {
+            uint16_t start = (StreamOutput_Starts[StreamOutput_FirstPacket] - StreamOutput_Tail) & (STREAM_OUTPUT_BUFFER_SIZE - 1);
+            if (start < used)
+            {
+                return start;
+            }
+            StreamOutput_FirstPacket = (StreamOutput_FirstPacket + 1) & (STREAM_OUTPUT_MAX_PACKETS - 1);
+            StreamOutput_PacketCount--;
+        }
+        return used;
+    }
+    
+    /**
+    *   \brief Drop the oldest whole packets until the given number of bytes fits.
+    *
+    *   The packet being sent is never cut: the packets after it are dropped
+    *   and the rest of it is moved up against the first packet kept.
+    *   \retval Returns false (0) if the packet still does not fit.
+    */
+    static uint8_t StreamOutput_DropOldest(uint16_t length)
+    {
+        uint16_t capacity = STREAM_OUTPUT_BUFFER_SIZE - 1;
+        uint8 state = CyEnterCriticalSection();
+        uint16_t used = StreamOutput_Used();
+        uint16_t sending = StreamOutput_Forget(used);
+        
+        // The dropped bytes go from the end of the packet being sent to the
+        // start of the first packet kept, both counted from the tail
+        uint16_t end = sending;
+        while (StreamOutput_PacketCount > 0 &&
+               (used - (end - sending) + length > capacity ||
+                StreamOutput_PacketCount == STREAM_OUTPUT_MAX_PACKETS))
+        {
+            StreamOutput_FirstPacket = (StreamOutput_FirstPacket + 1) & (STREAM_OUTPUT_MAX_PACKETS - 1);
+            StreamOutput_PacketCount--;
+            StreamOutput_Overflows++;
+            end = StreamOutput_PacketCount > 0 ?
+                (StreamOutput_Starts[StreamOutput_FirstPacket] - StreamOutput_Tail) & (STREAM_OUTPUT_BUFFER_SIZE - 1) : used;
+        }
+        
+        uint16_t dropped = end - sending;
+        if (dropped > 0)
+        {
+            for (uint16_t i = sending; i > 0; i--)
+            {
+                StreamOutput_Buffer[(StreamOutput_Tail + dropped + i - 1) & (STREAM_OUTPUT_BUFFER_SIZE - 1)] =
+                    StreamOutput_Buffer[(StreamOutput_Tail + i - 1) & (STREAM_OUTPUT_BUFFER_SIZE - 1)];
+            }
+            StreamOutput_Tail = (StreamOutput_Tail + dropped) & (STREAM_OUTPUT_BUFFER_SIZE - 1);
+        }
+        CyExitCriticalSection(state);
+        
+        if (used - dropped + length > capacity)
+        {
+            // Only the packet being sent is left and the new one is too long
+            StreamOutput_Overflows++;
+            return 0;
+        }
+        
+        StreamOutput_Starts[(StreamOutput_FirstPacket + StreamOutput_PacketCount) & (STREAM_OUTPUT_MAX_PACKETS - 1)] = StreamOutput_Head;
+        StreamOutput_PacketCount++;
+        return 1;
+    }
+    
+    /**
+    *   \brief Make room for the given number of bytes, as the policy says.
+    *
+    *   \retval Returns false (0) if the packet must be discarded.
+    */
+    static uint8_t StreamOutput_Reserve(uint16_t length)
+    {
+        if (StreamOutput_Policy == STREAM_OUTPUT_DROP_OLDEST)
+        {
+            return StreamOutput_DropOldest(length);
+        }
+        
+        // One slot is kept empty to tell a full buffer from an empty one
+        uint16_t capacity = STREAM_OUTPUT_BUFFER_SIZE - 1;
+        if (StreamOutput_Used() + length <= capacity)
+        {
+            return 1;
+        }
+        
+        switch (StreamOutput_Policy)
+        {
+            case STREAM_OUTPUT_BLOCK:
+                // Without the TX interrupt nobody else empties the buffer
+                while (StreamOutput_Used() + length > capacity)
+                {
+                    uint8 state = CyEnterCriticalSection();
+                    StreamOutput_Transmit();
+                    CyExitCriticalSection(state);
+                }
+                return 1;
+                
+            default:
+                StreamOutput_Overflows++;
+                return 0;
+        }
+    }
+    
+    void StreamOutput_Start(StreamOutputPolicy policy)
+    {
+        UART_Debug_SetTxInterruptMode(0);
+        StreamOutput_Policy = policy;
+        StreamOutput_Head = 0;
+        StreamOutput_Tail = 0;
+        StreamOutput_FirstPacket = 0;
+        StreamOutput_PacketCount = 0;
+        StreamOutput_HighWater = 0;
+        StreamOutput_Overflows = 0;
+    }
+    
+    void StreamOutput_SetFramed(uint8_t framed)
+    {
+        StreamOutput_Framed = framed;
+        StreamOutput_Sequence = 0;
+    }
+    
+    uint8_t StreamOutput_IsFramed(void)
+    {
+        return StreamOutput_Framed;
+    }
+    
+    void StreamOutput_Send(const uint8_t* packet, uint8_t length)
+    {
+        if (!StreamOutput_Framed)
+        {
+            if (!StreamOutput_Reserve(length))
+            {
+                return;
+            }
+            StreamOutput_Put(packet, length);
+        }
+        else
+        {
+            // The payload is copied from where it is, only header and CRC are added
+            uint8_t header[FRAME_HEADER_SIZE];
+            uint8_t trailer[FRAME_TRAILER_SIZE];
+            if (!StreamOutput_Reserve(FRAME_HEADER_SIZE + length + FRAME_TRAILER_SIZE))
+            {
+                return;
+            }
+            Frame_Encode(StreamOutput_Sequence++, packet, length, header, trailer);
+            StreamOutput_Put(header, FRAME_HEADER_SIZE);
+            StreamOutput_Put(packet, length);
+            StreamOutput_Put(trailer, FRAME_TRAILER_SIZE);
+        }
+        
+        uint16_t used = StreamOutput_Used();
+        if (used > StreamOutput_HighWater)
+        {
+            StreamOutput_HighWater = used;
+        }
+        
+        // The interrupt stops itself when the buffer is empty
+        UART_Debug_SetTxInterruptMode(UART_Debug_TX_STS_FIFO_NOT_FULL);
+    }
+    
+    uint8_t StreamOutput_CanSend(uint8_t length)
+    {
+        uint16_t size = StreamOutput_Framed ? FRAME_HEADER_SIZE + length + FRAME_TRAILER_SIZE : length;
+        return StreamOutput_Used() + size <= STREAM_OUTPUT_BUFFER_SIZE - 1;
+    }
+    
+    void StreamOutput_Transmit(void)
+    {
+        uint16_t tail = StreamOutput_Tail;
+        while (tail != StreamOutput_Head &&
+               (UART_Debug_ReadTxStatus() & UART_Debug_TX_STS_FIFO_NOT_FULL))
+        {
+            UART_Debug_WriteTxData(StreamOutput_Buffer[tail]);
+            tail = (tail + 1) & (STREAM_OUTPUT_BUFFER_SIZE - 1);
+        }
+        StreamOutput_Tail = tail;
+        
+        if (tail == StreamOutput_Head)
+        {
+            UART_Debug_SetTxInterruptMode(0);
+        }
+    }
+    
+    uint16_t StreamOutput_GetHighWaterMark(void)
+    {
+        return StreamOutput_HighWater;
+    }
+    
+    uint16_t StreamOutput_GetOverflowCount(void)
+    {
+        return StreamOutput_Overflows;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,102 @@
+/** 
+ * \file StreamOutput.h
+ * \brief Transmission of the stream packets on UART_Debug.
+ *
+ * All the packets of the stream go through this module, which sends them
+ * either as they are, as expected by the Bridge Control Panel, or inside
+ * a frame with sequence number and CRC (see Frame.h).
+ *
+ * The packets are copied into a ring buffer and the main loop goes on:
+ * the TX interrupt of the UART (isr_TX, on "FIFO not full") moves them to
+ * the hardware FIFO, so the time spent sending does not depend on the
+ * baud rate. Without isr_TX the main loop does the same on each pass. When the link cannot keep up, the policy decides which bytes
+ * are lost.
+*/
+
+#ifndef StreamOutput_H
+    #define StreamOutput_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Size of the ring buffer, must be a power of 2.
+    *
+    *   About half a second of stream at 19200 baud.
+    */
+    #define STREAM_OUTPUT_BUFFER_SIZE 1024
+    
+    /**
+    *   \brief Packets remembered for STREAM_OUTPUT_DROP_OLDEST, must be a power of 2.
+    *
+    *   One every 8 bytes of the buffer, the size of a packed sample with
+    *   its timestamp; with smaller packets the oldest are dropped earlier.
+    */
+    #define STREAM_OUTPUT_MAX_PACKETS 128
+    
+    /**
+    *   \brief What to do with a packet that does not fit in the buffer.
+    */
+    typedef enum {
+        STREAM_OUTPUT_DROP_NEWEST,      ///< The packet is discarded
+        STREAM_OUTPUT_DROP_OLDEST,      ///< The oldest whole packets are discarded to make room
+        STREAM_OUTPUT_BLOCK             ///< Wait for the UART to make room
+    } StreamOutputPolicy;
+    
+    /**
+    *   \brief Empty the buffer and reset the counters.
+    *
+    *   From now on the packets are sent by the TX interrupt, started with
+    *   StreamOutput_Transmit as handler, or by StreamOutput_Transmit called
+    *   from the main loop when the schematic has no isr_TX.
+    */
+    void StreamOutput_Start(StreamOutputPolicy policy);
+    
+    /**
+    *   \brief Select if the packets are sent inside frames.
+    *
+    *   The sequence number restarts from 0.
+    */
+    void StreamOutput_SetFramed(uint8_t framed);
+    
+    /**
+    *   \brief Check if the packets are sent inside frames.
+    */
+    uint8_t StreamOutput_IsFramed(void);
+    
+    /**
+    *   \brief Send a packet of the stream.
+    *
+    *   The packet, with its frame if any, is queued as a whole: it is
+    *   either sent entirely or, with STREAM_OUTPUT_DROP_NEWEST, not at all.
+    *   \param packet Bytes of the packet.
+    *   \param length Number of bytes (at most FRAME_MAX_PAYLOAD when framed).
+    */
+    void StreamOutput_Send(const uint8_t* packet, uint8_t length);
+    
+    /**
+    *   \brief Check if a packet fits in the buffer without waiting or dropping.
+    *
+    *   \param length Number of bytes of the packet, without the frame.
+    */
+    uint8_t StreamOutput_CanSend(uint8_t length);
+    
+    /**
+    *   \brief Move the queued bytes to the FIFO of the UART.
+    *
+    *   This function must be called from the TX interrupt of the UART or,
+    *   when there is no such interrupt, from the main loop only.
+    */
+    void StreamOutput_Transmit(void);
+    
+    /**
+    *   \brief Largest number of bytes found queued since the start.
+    */
+    uint16_t StreamOutput_GetHighWaterMark(void);
+    
+    /**
+    *   \brief Number of packets discarded, or overwritten, because the buffer was full.
+    */
+    uint16_t StreamOutput_GetOverflowCount(void);
+    
+#endif // StreamOutput_H
+/* [] END OF FILE */
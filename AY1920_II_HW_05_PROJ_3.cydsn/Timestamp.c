@@ -0,0 +1,73 @@
+/*
+* This file includes the source code to encode
+* and decode the timestamps of the samples.
+*/
+
+#include "Timestamp.h"
+
+    void Timestamp_InitEncoder(TimestampEncoder* encoder, uint32_t period_us)
+    {
+        encoder->period_us = period_us;
+        encoder->synced = 0;
+    }
+    
+    uint8_t Timestamp_Encode(TimestampEncoder* encoder, uint32_t time_us, uint8_t* data)
+    {
+        // Rounded to the nearest step, a late sample has a positive jitter
+        int32_t jitter = (int32_t)(time_us - encoder->last_us - encoder->period_us);
+        int32_t steps = (jitter + (jitter >= 0 ? TIMESTAMP_UNIT_US / 2 : -TIMESTAMP_UNIT_US / 2)) /
+                        TIMESTAMP_UNIT_US;
+        
+        if (encoder->synced && steps >= -127 && steps <= 127)
+        {
+            data[0] = (uint8_t)(int8_t) steps;
+            encoder->last_us += encoder->period_us + steps * TIMESTAMP_UNIT_US;
+            return 1;
+        }
+        
+        data[0] = TIMESTAMP_ABSOLUTE;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            data[1 + i] = (uint8_t)(time_us >> (8 * i));
+        }
+        encoder->last_us = time_us;
+        encoder->synced = 1;
+        return TIMESTAMP_MAX_SIZE;
+    }
+    
+    void Timestamp_InitDecoder(TimestampDecoder* decoder, uint32_t period_us)
+    {
+        decoder->last_us = 0;
+        decoder->period_us = period_us;
+        decoder->synced = 0;
+    }
+    
+    uint8_t Timestamp_Decode(TimestampDecoder* decoder, const uint8_t* data, uint64_t* time_us)
+    {
+        if (data[0] == TIMESTAMP_ABSOLUTE)
+        {
+            uint32_t board_us = data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t) data[4] << 24);
+            
+            // The board clock is 32 bits wide, the upper bits come from the
+            // previous time and go up by one when the clock wraps around
+            uint64_t time = (decoder->last_us & ~(uint64_t) 0xFFFFFFFF) | board_us;
+            if (decoder->synced && time < decoder->last_us)
+            {
+                time += (uint64_t) 1 << 32;
+            }
+            decoder->last_us = time;
+            decoder->synced = 1;
+            *time_us = time;
+            return TIMESTAMP_MAX_SIZE;
+        }
+        
+        if (!decoder->synced)
+        {
+            return 0;
+        }
+        decoder->last_us += decoder->period_us + (int8_t) data[0] * TIMESTAMP_UNIT_US;
+        *time_us = decoder->last_us;
+        return 1;
+    }
+
+/* [] END OF FILE */
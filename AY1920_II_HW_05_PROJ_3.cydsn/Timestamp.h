@@ -0,0 +1,99 @@
+/** 
+ * \file Timestamp.h
+ * \brief Delta-coded timestamps of the stream samples.
+ *
+ * Each sample is stamped with the cycle counter when it is read, in
+ * microseconds since the start of the board. Samples are expected one
+ * period apart, so only the difference from the expected time is sent,
+ * in steps of TIMESTAMP_UNIT_US, in a single signed byte:
+ *
+ *     delta:    jitter / TIMESTAMP_UNIT_US (-127 to 127)
+ *     absolute: 0x80, time in us (32 bits, little endian)
+ *
+ * An absolute time is sent for the first sample, after each resync and
+ * whenever the jitter does not fit in a byte. The encoder follows the
+ * time rebuilt by the decoder, so the rounding errors do not add up. The
+ * decoder has no dependency on the PSoC, so it can be built on the host
+ * as well; it extends the time to 64 bits across the wraps of the board
+ * clock. The host gets the absolute time of a sample by adding the offset
+ * between its own clock and the first absolute timestamp received, which
+ * also aligns the streams of several boards.
+*/
+
+#ifndef Timestamp_H
+    #define Timestamp_H
+    
+    #include "cytypes.h"
+    
+    /**
+    *   \brief Step of the delta-coded jitter.
+    */
+    #define TIMESTAMP_UNIT_US 4
+    
+    /**
+    *   \brief First byte of an absolute time.
+    */
+    #define TIMESTAMP_ABSOLUTE 0x80
+    
+    /**
+    *   \brief Size of an absolute time, the largest timestamp.
+    */
+    #define TIMESTAMP_MAX_SIZE 5
+    
+    /**
+    *   \brief State of the encoder.
+    */
+    typedef struct {
+        uint32_t last_us;       ///< Time of the previous sample, as rebuilt by the decoder
+        uint32_t period_us;     ///< Expected time between two samples
+        uint8_t synced;         ///< False until an absolute time is sent
+    } TimestampEncoder;
+    
+    /**
+    *   \brief State of the decoder.
+    */
+    typedef struct {
+        uint64_t last_us;       ///< Time of the previous sample
+        uint32_t period_us;     ///< Expected time between two samples
+        uint8_t synced;         ///< False until an absolute time is received
+    } TimestampDecoder;
+    
+    /**
+    *   \brief Start an encoder, the next timestamp is absolute.
+    *
+    *   \param encoder Pointer to the encoder.
+    *   \param period_us Expected time between two samples.
+    */
+    void Timestamp_InitEncoder(TimestampEncoder* encoder, uint32_t period_us);
+    
+    /**
+    *   \brief Encode the time of a sample.
+    *
+    *   \param encoder Pointer to the encoder.
+    *   \param time_us Time of the sample.
+    *   \param data Array of TIMESTAMP_MAX_SIZE bytes where the timestamp is written.
+    *   \retval Number of bytes written, 1 or TIMESTAMP_MAX_SIZE.
+    */
+    uint8_t Timestamp_Encode(TimestampEncoder* encoder, uint32_t time_us, uint8_t* data);
+    
+    /**
+    *   \brief Start a decoder, it waits for an absolute time.
+    *
+    *   \param decoder Pointer to the decoder.
+    *   \param period_us Expected time between two samples, as sent in the stream header.
+    */
+    void Timestamp_InitDecoder(TimestampDecoder* decoder, uint32_t period_us);
+    
+    /**
+    *   \brief Decode the timestamp of a sample.
+    *
+    *   \param decoder Pointer to the decoder.
+    *   \param data Bytes of the timestamp.
+    *   \param time_us Pointer to the variable where the time of the sample is saved.
+    *   \retval Number of bytes used, 0 if the time is unknown until the next
+    *   absolute timestamp (the byte is skipped all the same).
+    */
+    uint8_t Timestamp_Decode(TimestampDecoder* decoder, const uint8_t* data, uint64_t* time_us);
+    
+#endif // Timestamp_H
+/* [] END OF FILE */
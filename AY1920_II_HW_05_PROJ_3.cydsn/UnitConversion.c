@@ -0,0 +1,37 @@
+/*
+* This file includes the source code to convert
+* the LIS3DH output with integer operations only.
+*/
+
+#include "UnitConversion.h"
+
+    void UnitConversion_Init(UnitConversion* conversion,
+                             const LIS3DH_Profile* profile,
+                             Unit unit)
+    {
+        const LIS3DH_Format* format = LIS3DH_Profile_Format(profile);
+        conversion->shift = format->shift;
+        conversion->unit = unit;
+        
+        switch (unit)
+        {
+            case UNIT_MILLI_G:
+                conversion->scale = (int32_t) format->mg_per_digit << UNIT_CONVERSION_Q;
+                break;
+            case UNIT_MM_PER_S2:
+                conversion->scale = format->mm_s2_q12;
+                break;
+            default:
+                conversion->scale = 1 << UNIT_CONVERSION_Q;
+                break;
+        }
+    }
+    
+    int32_t UnitConversion_Apply(const UnitConversion* conversion, int16_t raw)
+    {
+        // At ±16 g the product stays below 2^30, so it fits in 32 bits
+        int32_t product = (int32_t)(raw >> conversion->shift) * conversion->scale;
+        return LIS3DH_Format_TruncateQ12(product);
+    }
+
+/* [] END OF FILE */
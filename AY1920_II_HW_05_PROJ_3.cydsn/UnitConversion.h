@@ -0,0 +1,65 @@
+/** 
+ * \file UnitConversion.h
+ * \brief Integer conversion of the LIS3DH output to physical units.
+ *
+ * The scale of each (mode, full scale range) pair is taken once from the
+ * format descriptors as a Q12 fixed-point factor, so that each value is
+ * converted with a shift, a 32-bit multiply and a shift, without any
+ * floating point routine.
+ *
+ * The result is truncated toward zero like the float conversion it
+ * replaces; in mm/s^2 it matches the float result within 1 LSB, because
+ * the Q12 scale is rounded to the nearest 1/4096.
+*/
+
+#ifndef UnitConversion_H
+    #define UnitConversion_H
+    
+    #include "cytypes.h"
+    #include "LIS3DH_Profiles.h"
+    
+    /**
+    *   \brief Fractional bits of the scale factors.
+    */
+    #define UNIT_CONVERSION_Q LIS3DH_FORMAT_Q
+    
+    /**
+    *   \brief Unit of the converted values.
+    */
+    typedef enum {
+        UNIT_RAW,                       ///< Right-aligned counts
+        UNIT_MILLI_G,                   ///< mg
+        UNIT_MM_PER_S2                  ///< mm/s^2
+    } Unit;
+    
+    /**
+    *   \brief Conversion of the output registers of a profile.
+    */
+    typedef struct {
+        uint8_t shift;                  ///< Right shift of the left-justified output
+        int32_t scale;                  ///< Q12 factor from counts to the unit
+        Unit unit;                      ///< Unit of the converted values
+    } UnitConversion;
+    
+    /**
+    *   \brief Derive the conversion of a profile.
+    *
+    *   \param conversion Pointer to the conversion to be filled.
+    *   \param profile Pointer to the profile of the accelerometer.
+    *   \param unit Unit of the converted values.
+    */
+    void UnitConversion_Init(UnitConversion* conversion,
+                             const LIS3DH_Profile* profile,
+                             Unit unit);
+    
+    /**
+    *   \brief Convert the value of an output register pair.
+    *
+    *   \param conversion Pointer to the conversion.
+    *   \param raw Left-justified value of the output registers.
+    *   \retval Value in the unit of the conversion, truncated toward zero.
+    */
+    int32_t UnitConversion_Apply(const UnitConversion* conversion, int16_t raw);
+    
+#endif // UnitConversion_H
+/* [] END OF FILE */
@@ -0,0 +1,229 @@
+/*
+* This file includes the source code to summarize
+* the acceleration over windows of samples.
+*/
+
+#include "WindowStats.h"
+
+    #define WINDOW_STATS_SLOT(position) ((position) & (WINDOW_STATS_MAX_SLIDING - 1))
+    
+    /**
+    *   \brief Value of an axis at a position of a sliding window.
+    */
+    #define WindowStats_Value(stats, position, axis) \
+        ((stats)->samples[WINDOW_STATS_SLOT(position)][axis])
+    
+    /**
+    *   \brief Position at an entry of a queue, counted from its head.
+    */
+    #define WindowStats_Entry(queue, head, index) ((queue)[WINDOW_STATS_SLOT((head) + (index))])
+    
+    /**
+    *   \brief Integer square root, rounded down.
+    */
+    static uint32_t WindowStats_Sqrt(uint64_t value)
+    {
+        uint64_t root = 0;
+        uint64_t bit = (uint64_t) 1 << 62;
+        while (bit > value)
+        {
+            bit >>= 2;
+        }
+        while (bit != 0)
+        {
+            if (value >= root + bit)
+            {
+                value -= root + bit;
+                root = (root >> 1) + bit;
+            }
+            else
+            {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return (uint32_t) root;
+    }
+    
+    static void WindowStats_Put16(uint8_t* data, int32_t value)
+    {
+        data[0] = (uint8_t)(value & 0xFF);
+        data[1] = (uint8_t)((value >> 8) & 0xFF);
+    }
+    
+    static void WindowStats_ResetAxis(WindowStatsAxis* axis)
+    {
+        axis->sum = 0;
+        axis->sum_squares = 0;
+        axis->min = INT16_MAX;
+        axis->max = INT16_MIN;
+        axis->min_head = 0;
+        axis->min_count = 0;
+        axis->max_head = 0;
+        axis->max_count = 0;
+    }
+    
+    ErrorCode WindowStats_Init(WindowStats* stats, uint16_t window, uint16_t hop)
+    {
+        if (window < 2 || window > WINDOW_STATS_MAX_WINDOW ||
+            hop < 1 || hop > window ||
+            (hop < window && window > WINDOW_STATS_MAX_SLIDING))
+        {
+            return ERROR;
+        }
+        
+        stats->window = window;
+        stats->hop = hop;
+        stats->count = 0;
+        stats->since = 0;
+        stats->position = 0;
+        stats->sequence = 0;
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            WindowStats_ResetAxis(&stats->axes[i]);
+        }
+        return NO_ERROR;
+    }
+    
+    /**
+    *   \brief Add a value to the monotonic queues of a sliding window.
+    *
+    *   Values that can no longer be the extreme of any window are removed
+    *   from the back, expired positions from the front: each position goes
+    *   in and out once, so the cost per sample is constant on average.
+    */
+    static void WindowStats_Slide(WindowStats* stats, uint8_t axis_index, uint16_t position)
+    {
+        WindowStatsAxis* axis = &stats->axes[axis_index];
+        int16_t value = WindowStats_Value(stats, position, axis_index);
+        
+        while (axis->max_count > 0 &&
+               WindowStats_Value(stats, WindowStats_Entry(axis->max_queue, axis->max_head, axis->max_count - 1),
+                                 axis_index) <= value)
+        {
+            axis->max_count--;
+        }
+        WindowStats_Entry(axis->max_queue, axis->max_head, axis->max_count++) = position;
+        if ((uint16_t)(position - axis->max_queue[axis->max_head]) >= stats->window)
+        {
+            axis->max_head = WINDOW_STATS_SLOT(axis->max_head + 1);
+            axis->max_count--;
+        }
+        
+        while (axis->min_count > 0 &&
+               WindowStats_Value(stats, WindowStats_Entry(axis->min_queue, axis->min_head, axis->min_count - 1),
+                                 axis_index) >= value)
+        {
+            axis->min_count--;
+        }
+        WindowStats_Entry(axis->min_queue, axis->min_head, axis->min_count++) = position;
+        if ((uint16_t)(position - axis->min_queue[axis->min_head]) >= stats->window)
+        {
+            axis->min_head = WINDOW_STATS_SLOT(axis->min_head + 1);
+            axis->min_count--;
+        }
+        
+        axis->max = WindowStats_Value(stats, axis->max_queue[axis->max_head], axis_index);
+        axis->min = WindowStats_Value(stats, axis->min_queue[axis->min_head], axis_index);
+    }
+    
+    /**
+    *   \brief Write the summary of the samples in the window.
+    */
+    static uint8_t WindowStats_Summarize(WindowStats* stats, uint8_t* frame)
+    {
+        uint8_t length = 0;
+        frame[length++] = WINDOW_STATS_HEADER;
+        frame[length++] = stats->sequence++;
+        WindowStats_Put16(&frame[length], stats->window);
+        length += 2;
+        
+        int64_t n = stats->count;
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            const WindowStatsAxis* axis = &stats->axes[i];
+            
+            // Variance times n^2, computed exactly before the single division
+            int32_t mean = (int32_t)((axis->sum + (axis->sum >= 0 ? n / 2 : -n / 2)) / n);
+            int64_t spread = n * axis->sum_squares - (int64_t) axis->sum * axis->sum;
+            uint32_t rms = WindowStats_Sqrt((uint64_t)(spread > 0 ? spread : 0) / (uint64_t)(n * n));
+            
+            int32_t peak = axis->max - mean;
+            if (mean - axis->min > peak)
+            {
+                peak = mean - axis->min;
+            }
+            uint32_t crest = (rms > 0) ? ((uint32_t) peak * 16 + rms / 2) / rms : 0;
+            
+            WindowStats_Put16(&frame[length], mean);
+            WindowStats_Put16(&frame[length + 2], rms);
+            WindowStats_Put16(&frame[length + 4], axis->min);
+            WindowStats_Put16(&frame[length + 6], axis->max);
+            WindowStats_Put16(&frame[length + 8], axis->max - axis->min);
+            frame[length + 10] = (crest > 255) ? 255 : (uint8_t) crest;
+            length += 11;
+        }
+        frame[length++] = 0xC0;
+        return length;
+    }
+    
+    uint8_t WindowStats_Push(WindowStats* stats, const int16_t* xyz, uint8_t* frame)
+    {
+        uint8_t sliding = (stats->hop < stats->window);
+        uint16_t position = stats->position++;
+        
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            WindowStatsAxis* axis = &stats->axes[i];
+            int16_t value = xyz[i];
+            
+            if (sliding)
+            {
+                // The oldest sample leaves the sums before its slot is reused
+                if (stats->count == stats->window)
+                {
+                    int16_t oldest = WindowStats_Value(stats, position - stats->window, i);
+                    axis->sum -= oldest;
+                    axis->sum_squares -= (int32_t) oldest * oldest;
+                }
+                WindowStats_Value(stats, position, i) = value;
+                WindowStats_Slide(stats, i, position);
+            }
+            else
+            {
+                if (value < axis->min)
+                {
+                    axis->min = value;
+                }
+                if (value > axis->max)
+                {
+                    axis->max = value;
+                }
+            }
+            axis->sum += value;
+            axis->sum_squares += (int32_t) value * value;
+        }
+        
+        if (stats->count < stats->window)
+        {
+            stats->count++;
+        }
+        if (++stats->since < stats->hop || stats->count < stats->window)
+        {
+            return 0;
+        }
+        stats->since = 0;
+        
+        uint8_t length = WindowStats_Summarize(stats, frame);
+        if (!sliding)
+        {
+            stats->count = 0;
+            for (uint8_t i = 0; i < 3; i++)
+            {
+                WindowStats_ResetAxis(&stats->axes[i]);
+            }
+        }
+        return length;
+    }
+
+/* [] END OF FILE */
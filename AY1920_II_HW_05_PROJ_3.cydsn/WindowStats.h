@@ -0,0 +1,110 @@
+/** 
+ * \file WindowStats.h
+ * \brief Statistics of the acceleration over windows of samples.
+ *
+ * For condition monitoring the samples stay on the board: each axis is
+ * summarized over a window and only the summary is sent. Each sample
+ * costs a few integer additions, whatever the window:
+ *
+ *  - tumbling windows (hop equal to the window, up to
+ *    WINDOW_STATS_MAX_WINDOW samples) only keep sums and extremes;
+ *  - sliding windows (up to WINDOW_STATS_MAX_SLIDING samples) also keep
+ *    the samples, to take the oldest one out of the sums, and two
+ *    monotonic queues for the extremes.
+ *
+ * Summary, values in mg:
+ *
+ *     0xA7, sequence, window (16 bits), for X, Y and Z: mean, RMS, min,
+ *     max, peak-to-peak (16 bits each), crest factor (Q4), then 0xC0
+ *
+ * All the 16-bit values are little endian. The RMS is taken around the
+ * mean, so that gravity does not hide the vibration; the crest factor is
+ * the largest distance from the mean divided by the RMS.
+*/
+
+#ifndef WindowStats_H
+    #define WindowStats_H
+    
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    
+    /**
+    *   \brief Longest tumbling window.
+    */
+    #define WINDOW_STATS_MAX_WINDOW 4096
+    
+    /**
+    *   \brief Longest sliding window, must be a power of 2.
+    */
+    #define WINDOW_STATS_MAX_SLIDING 64
+    
+    /**
+    *   \brief Window used until one is configured, four seconds at 100 Hz.
+    *
+    *   A summary then replaces 5600 bytes of converted samples.
+    */
+    #define WINDOW_STATS_DEFAULT_WINDOW 400
+    
+    /**
+    *   \brief First byte of a summary.
+    */
+    #define WINDOW_STATS_HEADER 0xA7
+    
+    /**
+    *   \brief Size of a summary.
+    */
+    #define WINDOW_STATS_FRAME_SIZE 38
+    
+    /**
+    *   \brief Running sums and extremes of one axis.
+    */
+    typedef struct {
+        int64_t sum_squares;                                ///< Sum of the squared values
+        int32_t sum;                                        ///< Sum of the values
+        int16_t min;                                        ///< Smallest value, tumbling window
+        int16_t max;                                        ///< Largest value, tumbling window
+        uint16_t min_queue[WINDOW_STATS_MAX_SLIDING];       ///< Positions of increasing values, sliding window
+        uint16_t max_queue[WINDOW_STATS_MAX_SLIDING];       ///< Positions of decreasing values, sliding window
+        uint8_t min_head;                                   ///< First entry of min_queue
+        uint8_t min_count;                                  ///< Entries of min_queue
+        uint8_t max_head;                                   ///< First entry of max_queue
+        uint8_t max_count;                                  ///< Entries of max_queue
+    } WindowStatsAxis;
+    
+    /**
+    *   \brief State of the statistics of the three axes.
+    */
+    typedef struct {
+        WindowStatsAxis axes[3];                            ///< Statistics of each axis
+        int16_t samples[WINDOW_STATS_MAX_SLIDING][3];       ///< Last samples, sliding window
+        uint16_t window;                                    ///< Samples of a window
+        uint16_t hop;                                       ///< Samples between two summaries
+        uint16_t count;                                     ///< Samples in the window
+        uint16_t since;                                     ///< Samples since the last summary
+        uint16_t position;                                  ///< Position of the next sample
+        uint8_t sequence;                                   ///< Number of the next summary
+    } WindowStats;
+    
+    /**
+    *   \brief Start the statistics over a new window.
+    *
+    *   \param stats Pointer to the statistics.
+    *   \param window Samples of a window.
+    *   \param hop Samples between two summaries: equal to the window for
+    *   tumbling windows, smaller for sliding ones.
+    *   \retval ERROR if the window or the hop are not supported.
+    */
+    ErrorCode WindowStats_Init(WindowStats* stats, uint16_t window, uint16_t hop);
+    
+    /**
+    *   \brief Add a sample of the three axes.
+    *
+    *   \param stats Pointer to the statistics.
+    *   \param xyz Values of the three axes in mg.
+    *   \param frame Array of WINDOW_STATS_FRAME_SIZE bytes where a summary is written.
+    *   \retval Number of bytes of the summary, 0 if no summary is due.
+    */
+    uint8_t WindowStats_Push(WindowStats* stats, const int16_t* xyz, uint8_t* frame);
+    
+#endif // WindowStats_H
+/* [] END OF FILE */
@@ -9,281 +9,1177 @@
 
 // Include required header files
 #include "I2C_Interface.h"
+#include "LIS3DH_Registers.h"
+#include "LIS3DH_Device.h"
+#include "SampleScheduler.h"
+#include "BusBenchmark.h"
+#include "LIS3DH_Fifo.h"
+#include "StreamBudget.h"
+#include "CommandChannel.h"
+#include "UnitConversion.h"
+#include "PackedSample.h"
+#include "DeltaCodec.h"
+#include "SampleBatch.h"
+#include "Timestamp.h"
+#include "Decimator.h"
+#include "WindowStats.h"
+#include "Spectrum.h"
+#include "Capture.h"
+#include "Frame.h"
+#include "StreamOutput.h"
+#include "FastBoot.h"
+#include "CycleCounter.h"
 #include "project.h"
 #include "stdio.h"
+#include "string.h"
 #include "InterruptRoutines.h"
 
 /**
-*   \brief 7-bit I2C address of the slave device.
+*   \brief Profile of the accelerometers.
+*
+*   The FIFO stream profiles (400 Hz, 1.344 kHz, 5.376 kHz) are meant for
+*   vibration measurements, the stream budget adapts the pipeline to them.
+*/
+#define STREAM_PROFILE LIS3DH_PROFILE_HIGH_RESOLUTION_100HZ_4G
+
+/**
+*   \brief Highest rate of the samples sent, in Hz.
+*
+*   With a faster ODR the samples are low-pass filtered and decimated, the
+*   stream budget may decimate further if the UART needs it.
+*/
+#define STREAM_OUTPUT_HZ 100
+
+/**
+*   \brief Set to 0 to drop the samples the stream does not send instead of
+*   filtering them.
+*/
+#define STREAM_FILTER 1
+
+/**
+*   \brief Default size of the FFT (log2 of the points) and number of peaks
+*   sent for each axis, 0 to send all the bins.
+*/
+#define SPECTRUM_LOG2_POINTS 9
+#define SPECTRUM_PEAKS 8
+
+/**
+*   \brief Default trigger of the capture: a magnitude 2 g, with 1 g of
+*   gravity, starts a burst of 100 samples before it and 400 from it.
+*/
+#define CAPTURE_TRIGGER CAPTURE_TRIGGER_MAGNITUDE
+#define CAPTURE_THRESHOLD_MG 2000
+#define CAPTURE_HYSTERESIS_MG 200
+#define CAPTURE_PRE_TRIGGER 100
+#define CAPTURE_POST_TRIGGER 400
+
+/**
+*   \brief What happens to the packets when the UART cannot keep up.
+*/
+#define STREAM_TX_POLICY STREAM_OUTPUT_DROP_NEWEST
+
+/**
+*   \brief Reasons why the stream is refused, indexed by StreamVerdict.
+*/
+static const char* const StreamVerdicts[] = {
+    "ok",
+    "sensor powered down",
+    "sample source too slow",
+    "I2C bus too slow",
+    "UART too slow",
+};
+
+/**
+*   \brief Data rates of the I2C bus measured by the benchmark, slowest first.
+*/
+static const uint16_t DataRates[] = {
+    I2C_DATA_RATE_STANDARD,
+    I2C_DATA_RATE_FAST,
+    I2C_DATA_RATE_FAST_PLUS,
+};
+
+/**
+*   \brief Batch sizes whose efficiency and latency are reported at boot.
+*/
+static const uint8_t BatchSizes[] = {1, 2, 4, 8, 16, 32};
+
+/**
+*   \brief State of the stream, from the samples read to the packets sent.
+*
+*   The packet formats other than raw work on the samples of a single
+*   device, fed in the same way by the reads of single samples and by the
+*   FIFO batches.
+*/
+typedef struct {
+    LIS3DH_Profile* profile;                            ///< Profile of the accelerometers, shared with their handles
+    SampleScheduler* scheduler;                         ///< Accelerometers streamed
+    StreamFormat format;                                ///< Format of the packets
+    StreamBudget budget;                                ///< Read path and decimation of the stream
+    uint8_t use_int1;                                   ///< Reads triggered by INT1 instead of the timer
+    volatile uint8* sample_flag;                        ///< Flag that starts a read
+    Decimator filters[SAMPLE_SCHEDULER_MAX_DEVICES];    ///< Low-pass decimator of each device
+    uint8_t round_phase;                                ///< Rounds since the last combined packet
+    UnitConversion conversion;                          ///< Scaling of the converted samples
+    uint8_t packed_count;                               ///< Packed samples since the last stream header
+    TimestampEncoder stamper;                           ///< Time of the timestamped samples
+    DeltaEncoder encoder;                               ///< State of the compressed stream
+    SampleBatch batcher;                                ///< Batch being filled
+    WindowStats stats;                                  ///< Statistics of the monitoring mode
+    Spectrum spectrum;                                  ///< Spectra of the three axes
+    Capture capture;                                    ///< Bursts around the trigger
+} Stream;
+
+/**
+*   \brief Bytes sent on the UART for each sample in a given format.
+*
+*   \retval 0 for the raw samples, sent in combined packets or FIFO batches.
+*/
+static uint8_t StreamPacketSize(StreamFormat format,
+                                const LIS3DH_Profile* profile,
+                                uint8_t batch_size,
+                                uint16_t stats_hop,
+                                const Spectrum* spectrum)
+{
+    const LIS3DH_Format* data_format = LIS3DH_Profile_Format(profile);
+    switch (format)
+    {
+        case STREAM_FORMAT_RAW:
+            return 0;
+        case STREAM_FORMAT_PACKED:
+            return PackedSample_Size(data_format);
+        case STREAM_FORMAT_COMPRESSED:
+            return DeltaCodec_WorstCaseBytes(data_format->bits);
+        case STREAM_FORMAT_BATCHED:
+            return SampleBatch_BytesPerSample(batch_size, PackedSample_Size(data_format));
+        case STREAM_FORMAT_TIMESTAMPED:
+            return PackedSample_Size(data_format) + 1;
+        case STREAM_FORMAT_STATISTICS:
+            return (WINDOW_STATS_FRAME_SIZE + stats_hop - 1) / stats_hop;
+        case STREAM_FORMAT_SPECTRUM:
+            return Spectrum_BytesPerSample(spectrum);
+        case STREAM_FORMAT_CAPTURE:
+            // Heartbeats only, the capture buffer absorbs the bursts
+            return 1;
+        default:
+            return STREAM_SAMPLE_PACKET_SIZE;
+    }
+}
+
+/**
+*   \brief Highest rate of the samples sent in a given format.
+*
+*   Statistics, spectra and triggers are computed on the board, so they use
+*   every sample the UART budget allows.
+*/
+static uint16_t StreamOutputHz(StreamFormat format)
+{
+    return (format == STREAM_FORMAT_STATISTICS || format == STREAM_FORMAT_SPECTRUM ||
+            format == STREAM_FORMAT_CAPTURE) ? 0 : STREAM_OUTPUT_HZ;
+}
+
+/**
+*   \brief Read the last sample of a device and feed it to its filter.
+*
+*   \retval Returns true (>0) when a filtered sample is ready in raw.
+*/
+static uint8_t FilterSample(Decimator* filter, const LIS3DH_Device* device, int16_t* raw)
+{
+    LIS3DH_Device_GetRaw(device, raw);
+    return Decimator_Push(filter, raw, raw);
+}
+
+/**
+*   \brief Add a sample to the window statistics, in mg.
+*
+*   \retval Number of bytes of the summary written in frame, 0 if none.
+*/
+static uint8_t SummarizeSample(WindowStats* stats, const LIS3DH_Format* format,
+                               const int16_t* raw, uint8_t* frame)
+{
+    int16_t milli_g[3];
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        milli_g[axis] = (int16_t) LIS3DH_Format_ToMilliG(format, raw[axis]);
+    }
+    return WindowStats_Push(stats, milli_g, frame);
+}
+
+/**
+*   \brief Check if the reads of a profile follow INT1 instead of the timer.
+*
+*   The schematic has at most a single INT1 pin, so with more devices, or
+*   without the pin, the timer is kept.
+*/
+static uint8_t UsesInt1(const LIS3DH_Profile* profile, uint8_t device_count)
+{
+    return INTERRUPT_INT1 && device_count == 1 &&
+           (profile->int1_sources & (LIS3DH_CTRL_REG3_I1_ZYXDA | LIS3DH_CTRL_REG3_I1_WTM)) != 0;
+}
+
+/**
+*   \brief Clear a flag set by an interrupt, if it is set.
+*
+*   Test and clear cannot be split by the interrupt, so an edge that comes
+*   after the flag is taken sets it again and is not lost.
+*   \retval Returns true (>0) if the flag was set.
+*/
+static uint8_t TakeFlag(volatile uint8* flag)
+{
+    uint8 state = CyEnterCriticalSection();
+    uint8_t taken = *flag;
+    *flag = 0;
+    CyExitCriticalSection(state);
+    return taken;
+}
+
+/**
+*   \brief Rate of the samples sent, after the decimation.
+*/
+static uint16_t StreamRateHz(const Stream* stream)
+{
+    return stream->budget.odr_hz / stream->budget.decimation;
+}
+
+/**
+*   \brief Plan the stream of a profile in a given format.
+*
+*   The packets are sized with the batch, window and spectrum in use.
 */
-#define LIS3DH_DEVICE_ADDRESS 0x18
+static ErrorCode PlanStream(const Stream* stream, const LIS3DH_Profile* profile,
+                            StreamFormat format, StreamBudget* budget)
+{
+    uint8_t device_count = stream->scheduler->device_count;
+    return StreamBudget_Plan(profile, I2C_Peripheral_GetDataRate(), STREAM_UART_BAUD_RATE, device_count,
+                             StreamPacketSize(format, profile, stream->batcher.size,
+                                              stream->stats.hop, &stream->spectrum),
+                             StreamOutputHz(format), UsesInt1(profile, device_count), budget);
+}
 
 /**
-*   \brief Address of the WHO AM I register
+*   \brief Send the samples collected in the current batch, if any.
 */
-#define LIS3DH_WHO_AM_I_REG_ADDR 0x0F
+static void SendBatch(Stream* stream)
+{
+    uint8_t length = SampleBatch_Finish(&stream->batcher);
+    if (length > 0)
+    {
+        StreamOutput_Send(stream->batcher.packet, length);
+    }
+}
 
 /**
-*   \brief Address of the Status register
+*   \brief Start the stream with a new budget and format.
+*
+*   The read path follows the budget: FIFO batches or single samples,
+*   triggered by INT1 or by the timer. The filters start again with the
+*   new decimation and the packet formats restart at the new rate; the
+*   samples of the current batch are sent first.
 */
-#define LIS3DH_STATUS_REG 0x27
+static void StartStream(Stream* stream, StreamFormat format, const StreamBudget* budget)
+{
+    SampleScheduler* scheduler = stream->scheduler;
+    stream->format = format;
+    stream->budget = *budget;
+
+    stream->use_int1 = UsesInt1(stream->profile, scheduler->device_count);
+    stream->sample_flag = stream->use_int1 ? &FlagDataReady : &FlagIsr;
+    TakeFlag(&FlagDataReady);
+    if (scheduler->device_count == 1)
+    {
+        LIS3DH_Device_SetDataReady(scheduler->devices[0], stream->use_int1 && !budget->use_fifo);
+    }
+    #if INTERRUPT_INT1
+        if (stream->use_int1)
+        {
+            isr_INT1_StartEx(INT1_ISR);
+        }
+        else
+        {
+            isr_INT1_Stop();
+        }
+    #endif
+
+    for (uint8_t i = 0; i < SAMPLE_SCHEDULER_MAX_DEVICES; i++)
+    {
+        Decimator_Init(&stream->filters[i], budget->decimation, STREAM_FILTER);
+    }
+    stream->round_phase = 0;
+
+    uint16_t rate_hz = StreamRateHz(stream);
+    UnitConversion_Init(&stream->conversion, stream->profile,
+                        (format == STREAM_FORMAT_MILLI_G) ? UNIT_MILLI_G : UNIT_MM_PER_S2);
+    stream->packed_count = 0;
+    DeltaCodec_InitEncoder(&stream->encoder);
+    SendBatch(stream);
+    WindowStats_Init(&stream->stats, stream->stats.window, stream->stats.hop);
+    Spectrum_Init(&stream->spectrum, stream->spectrum.log2_points, stream->spectrum.peaks, rate_hz);
+    Capture_Init(&stream->capture, stream->capture.trigger, stream->capture.threshold_mg,
+                 stream->capture.hysteresis_mg, stream->capture.pre_trigger,
+                 stream->capture.post_trigger, rate_hz);
+}
 
 /**
-*   \brief Address of the Control register 1
+*   \brief Switch the stream to a profile and format, if they can be sustained.
+*
+*   A new profile is written to the devices, the registers that change with
+*   one burst; the current profile can be passed to re-plan the stream after
+*   a change of the batch, window or spectrum.
+*   \retval COMMAND_STATUS_OK, the verdict of a refused budget (the stream
+*   goes on unchanged) or COMMAND_STATUS_BUS_ERROR.
 */
-#define LIS3DH_CTRL_REG1 0x20
+static uint8_t ApplyProfile(Stream* stream, const LIS3DH_Profile* profile, StreamFormat format)
+{
+    StreamBudget budget;
+    if (PlanStream(stream, profile, format, &budget) != NO_ERROR)
+    {
+        return budget.verdict;
+    }
+
+    uint8_t status = COMMAND_STATUS_OK;
+    if (profile != stream->profile)
+    {
+        *stream->profile = *profile;
+        for (uint8_t i = 0; i < stream->scheduler->device_count; i++)
+        {
+            if (LIS3DH_Profile_Apply(&stream->scheduler->devices[i]->cache, stream->profile) != NO_ERROR)
+            {
+                status = COMMAND_STATUS_BUS_ERROR;
+            }
+        }
+    }
+    StartStream(stream, format, &budget);
+    return status;
+}
 
 /**
-*   \brief Hex value to set high resolution mode at 100 Hz to the accelerator
+*   \brief Check if ApplyProfile left the stream unchanged.
 */
-#define LIS3DH_HIGH_RESOLUTION_MODE_100HZ_CTRL_REG1 0x57
+static uint8_t IsRefused(uint8_t status)
+{
+    return status != COMMAND_STATUS_OK && status != COMMAND_STATUS_BUS_ERROR;
+}
 
 /**
-*   \brief Address of the Control register 4
+*   \brief Send a sample bit-packed, with its timestamp in the timestamped format.
+*
+*   The scaling goes in a stream header sent before the first sample and
+*   then every PACKED_STREAM_HEADER_PERIOD samples, the time is sent in
+*   full after each stream header.
 */
-#define LIS3DH_CTRL_REG4 0x23
+static void SendPacked(Stream* stream, const int16_t* raw, uint32_t time_us)
+{
+    const LIS3DH_Format* data_format = LIS3DH_Profile_Format(stream->profile);
+    uint8_t packet[PACKED_STREAM_HEADER_SIZE];
 
-/*brief Hex value to set high resolution mode at 100 Hz to the accelerator and ±4.0 g FSR.*/
+    if (stream->packed_count == 0)
+    {
+        PackedSample_StreamHeader(data_format, StreamRateHz(stream), packet);
+        StreamOutput_Send(packet, PACKED_STREAM_HEADER_SIZE);
+        Timestamp_InitEncoder(&stream->stamper, 1000000ul * stream->budget.decimation / stream->budget.odr_hz);
+    }
+    stream->packed_count = (stream->packed_count + 1) % PACKED_STREAM_HEADER_PERIOD;
 
-#define LIS3DH_HIGH_RESOLUTION_MODE_100HZ_CTRL_REG4 0x98
-//The BDU bit is set to 1
+    // 5 bytes per sample with 12-bit data, 4 with 10-bit data
+    uint8_t length = PackedSample_Pack(data_format, raw, packet);
+    if (stream->format == STREAM_FORMAT_TIMESTAMPED)
+    {
+        length += Timestamp_Encode(&stream->stamper, time_us, &packet[length]);
+    }
+    StreamOutput_Send(packet, length);
+}
 
 /**
-*   \brief Address of the x-axis acceleration data output LSB register
+*   \brief Add a sample to the compressed stream.
+*
+*   A packet is ready at the keyframe and every 8 samples.
 */
-#define LIS3DH_OUT_X_L 0x028
+static void SendCompressed(Stream* stream, const int16_t* raw)
+{
+    const LIS3DH_Format* data_format = LIS3DH_Profile_Format(stream->profile);
+    DeltaEncoder* encoder = &stream->encoder;
+    uint8_t packet[DELTA_CODEC_MAX_PACKET];
+
+    // The stream header goes only before a keyframe, one out of three,
+    // so that the receiver can strip it without breaking a frame
+    if (encoder->blocks == DELTA_CODEC_FRAME_BLOCKS &&
+        encoder->sequence % (PACKED_STREAM_HEADER_PERIOD / DELTA_CODEC_FRAME_SAMPLES) == 0)
+    {
+        PackedSample_StreamHeader(data_format, StreamRateHz(stream), packet);
+        StreamOutput_Send(packet, PACKED_STREAM_HEADER_SIZE);
+    }
+
+    int16_t aligned[3];
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        aligned[axis] = LIS3DH_Format_Align(data_format, raw[axis]);
+    }
+    uint8_t length = DeltaCodec_Encode(encoder, aligned, packet);
+    if (length > 0)
+    {
+        StreamOutput_Send(packet, length);
+    }
+}
 
 /**
-*   \brief Address of the y-axis acceleration data output LSB register
+*   \brief Send a sample converted to mm/s^2 or mg, 32 bits per axis.
 */
-#define LIS3DH_OUT_Y_L 0x02A
+static void SendConverted(const Stream* stream, const int16_t* raw)
+{
+    uint8_t ValueArray[14];
+    int32 IntX, IntY, IntZ;
+
+    ValueArray[0] = 0xA0;
+    ValueArray[13] = 0xC0;
+
+    IntX = UnitConversion_Apply(&stream->conversion, raw[0]);
+    //The X axial output is aligned to the resolution of the profile and multiplied by its Q12 scale
+    //(sensitivity in mg/digit * 9.806 for mm/s2), so no floating point routine is needed.
+    ValueArray[1] = (uint8_t)(IntX & 0xFF);
+    ValueArray[2] = (uint8_t)(IntX >> 8);
+    ValueArray[3] = (uint8_t)(IntX >> 16);
+    ValueArray[4] = (uint8_t)(IntX >> 24);
+
+    IntY = UnitConversion_Apply(&stream->conversion, raw[1]);
+    //Same integer conversion for the Y axial output.
+    ValueArray[5] = (uint8_t)(IntY & 0xFF);
+    ValueArray[6] = (uint8_t)(IntY >> 8);
+    ValueArray[7] = (uint8_t)(IntY >> 16);
+    ValueArray[8] = (uint8_t)(IntY >> 24);
+
+    IntZ = UnitConversion_Apply(&stream->conversion, raw[2]);
+    //Same integer conversion for the Z axial output.
+    ValueArray[9] = (uint8_t)(IntZ & 0xFF);
+    ValueArray[10] = (uint8_t)(IntZ >> 8);
+    ValueArray[11] = (uint8_t)(IntZ >> 16);
+    ValueArray[12] = (uint8_t)(IntZ >> 24);
+
+    StreamOutput_Send(ValueArray, 14); // Sending the informations to the UART
+}
 
 /**
-*   \brief Address of the z-axis acceleration data output LSB register
+*   \brief Send a filtered sample of a single device in the format of the stream.
+*
+*   \param raw Values of the sample, left-justified.
+*   \param time_us Time the sample was taken, on the time base of CycleCounter_Microseconds.
 */
-#define LIS3DH_OUT_Z_L 0x02C
+static void SendSample(Stream* stream, const int16_t* raw, uint32_t time_us)
+{
+    const LIS3DH_Format* data_format = LIS3DH_Profile_Format(stream->profile);
+    switch (stream->format)
+    {
+        case STREAM_FORMAT_PACKED:
+        case STREAM_FORMAT_TIMESTAMPED:
+            SendPacked(stream, raw, time_us);
+            break;
+
+        case STREAM_FORMAT_COMPRESSED:
+            SendCompressed(stream, raw);
+            break;
+
+        case STREAM_FORMAT_BATCHED:
+            // The batch is sent when full, or by the latency check of the loop
+            if (SampleBatch_Add(&stream->batcher, data_format, raw, time_us))
+            {
+                SendBatch(stream);
+            }
+            break;
+
+        case STREAM_FORMAT_STATISTICS:
+        {
+            // Only a summary every hop samples goes on the UART
+            uint8_t frame[WINDOW_STATS_FRAME_SIZE];
+            uint8_t length = SummarizeSample(&stream->stats, data_format, raw, frame);
+            if (length > 0)
+            {
+                StreamOutput_Send(frame, length);
+            }
+            break;
+        }
+
+        case STREAM_FORMAT_SPECTRUM:
+            // The packets are sent by the main loop when a buffer is full
+            Spectrum_Push(&stream->spectrum, raw);
+            break;
 
-/*Thanks to the multiread function, we don't need to specify the MSB register address */
+        case STREAM_FORMAT_CAPTURE:
+            // The bursts and heartbeats are sent by the main loop
+            Capture_Push(&stream->capture, data_format, raw);
+            break;
 
+        default:
+            SendConverted(stream, raw);
+            break;
+    }
+}
+
+/**
+*   \brief Send the raw samples of a FIFO batch that the UART can carry.
+*
+*   Header, index of the device, number of samples (MSB set if samples
+*   were lost), raw XYZ of each sample and footer. In low-power mode only
+*   the high byte of each value is significant, the batches carry 3 bytes
+*   per sample and are marked by another header.
+*/
+static void SendRawBatch(Stream* stream, uint8_t device, const LIS3DH_FifoBatch* batch)
+{
+    static uint8_t packet[3 + LIS3DH_FIFO_DEPTH * LIS3DH_FIFO_SAMPLE_SIZE + 1];
+    uint8_t high_bytes_only = stream->budget.sample_bytes < LIS3DH_FIFO_SAMPLE_SIZE;
+    uint8_t kept = 0;
+    uint8_t length = 3;
+    for (uint8_t n = 0; n < batch->count; n++)
+    {
+        int16_t raw[3];
+        LIS3DH_Fifo_GetSample(batch, n, raw);
+        if (Decimator_Push(&stream->filters[device], raw, raw))
+        {
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                if (!high_bytes_only)
+                {
+                    packet[length++] = (uint8_t)(raw[axis] & 0xFF);
+                }
+                packet[length++] = (uint8_t)(raw[axis] >> 8);
+            }
+            kept++;
+        }
+    }
+
+    if (kept > 0)
+    {
+        packet[0] = high_bytes_only ? 0xA2 : 0xA1;
+        packet[1] = device;
+        packet[2] = kept | (batch->overrun ? 0x80 : 0x00);
+        packet[length++] = 0xC0;
+        StreamOutput_Send(packet, length);
+    }
+}
+
+/**
+*   \brief Send the time from power-up to now, right after the first sample.
+*
+*   The report is a typed packet of the stream, see FastBoot_Report.
+*/
+static void SendBootReport(uint8_t fast_boot)
+{
+    uint8_t report[FAST_BOOT_REPORT_SIZE];
+    FastBoot_Report(fast_boot, CycleCounter_ToMicroseconds(CycleCounter_Read()), report);
+    StreamOutput_Send(report, FAST_BOOT_REPORT_SIZE);
+}
 
 int main(void)
 {
     CyGlobalIntEnable; /* Enable global interrupts. */
-
+    
+    // Count the cycles from now on, to measure the time needed to start the stream
+    CycleCounter_Start();
+    
     I2C_Peripheral_Start();
     UART_Debug_Start();
     
     CyDelay(5); //"The boot procedure is complete about 5 milliseconds after device power-up."
     
     // String to print out messages on the UART
-    char message[50];
-
-    // Check which devices are present on the I2C bus
-    for (int i = 0 ; i < 128; i++)
-    {
-        if (I2C_Peripheral_IsDeviceConnected(i))
-        {
-            // print out the address is hex format
-            sprintf(message, "Device 0x%02X is connected\r\n", i);
-            UART_Debug_PutString(message); 
-        }
-        
-    }
+    char message[64];
+    
+    // Profile of the accelerometers, a copy so that the command channel can change it
+    LIS3DH_Profile Profile = LIS3DH_Profiles[STREAM_PROFILE];
+    LIS3DH_Profile* profile = &Profile;
+    
+    // Accelerometers found on the bus, all sampled at the same tick. The
+    // stack holds 2 KB only, so the large buffers here and below are static.
+    static LIS3DH_Device Devices[SAMPLE_SCHEDULER_MAX_DEVICES];
+    SampleScheduler Scheduler;
+    SampleScheduler_Init(&Scheduler);
     
     /******************************************/
-    /*            I2C Reading                 */
+    /*               Fast Boot                */
     /******************************************/
     
-    /* Read WHO AM I REGISTER register */
-    uint8_t who_am_i_reg;
-    ErrorCode error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                                  LIS3DH_WHO_AM_I_REG_ADDR, 
-                                                  &who_am_i_reg);
-    if (error == NO_ERROR)
+    // If the devices still hold the last known-good configuration, the bus
+    // scan and the diagnostic read-backs are skipped
+    FastBoot_Record record;
+    const LIS3DH_Profile* saved_profile;
+    uint8_t fast_boot = 0;
+    
+    if (FastBoot_Load(&record) == NO_ERROR &&
+        record.profile == STREAM_PROFILE &&
+        FastBoot_Check(&record, &saved_profile) == NO_ERROR)
     {
-        sprintf(message, "WHO AM I REG: 0x%02X [Expected: 0x33]\r\n", who_am_i_reg);
-        UART_Debug_PutString(message); 
+        fast_boot = 1;
+        Profile = *saved_profile;
+        
+        // The devices have just been verified at the saved addresses, the
+        // handles are built from the record without going on the bus again
+        for (uint8_t i = 0; i < record.device_count; i++)
+        {
+            LIS3DH_Device* device = &Devices[i];
+            LIS3DH_Device_Init(device, record.device_addresses[i], profile);
+            LIS3DH_Device_Adopt(device, &record.image);
+            SampleScheduler_AddDevice(&Scheduler, device);
+        }
+        
+        // The bus runs at the rate chosen by the last benchmark
+        I2C_Peripheral_SetDataRate(record.data_rate_khz);
     }
-    else
+    
+    if (!fast_boot)
     {
-        UART_Debug_PutString("Error occurred during I2C comm\r\n");   
+        SampleScheduler_Init(&Scheduler);
+        
+        // Check which devices are present on the I2C bus
+        for (int i = 0 ; i < 128; i++)
+        {
+            if (I2C_Peripheral_IsDeviceConnected(i))
+            {
+                // print out the address is hex format
+                snprintf(message, sizeof(message), "Device 0x%02X is connected\r\n", i);
+                UART_Debug_PutString(message);
+                
+                // Every device answering as a LIS3DH gets its own handle
+                if (Scheduler.device_count < SAMPLE_SCHEDULER_MAX_DEVICES)
+                {
+                    LIS3DH_Device* device = &Devices[Scheduler.device_count];
+                    LIS3DH_Device_Init(device, i, profile);
+                    if (LIS3DH_Device_Identify(device) == NO_ERROR)
+                    {
+                        SampleScheduler_AddDevice(&Scheduler, device);
+                    }
+                }
+            }
+            
+        }
+        
+        for (uint8_t i = 0; i < Scheduler.device_count; i++)
+        {
+            LIS3DH_Device* device = Scheduler.devices[i];
+            
+            /******************************************/
+            /*     I2C Writing Sensor Profile         */
+            /******************************************/
+            
+            // The configuration registers are read once with a few bursts,
+            // then the registers that change are written with a single burst
+            // and verified with a read-back
+            if (LIS3DH_Device_Configure(device) == NO_ERROR)
+            {
+                uint8_t ctrl_reg1, ctrl_reg4;
+                LIS3DH_Cache_Read(&device->cache, LIS3DH_CTRL_REG1, &ctrl_reg1);
+                LIS3DH_Cache_Read(&device->cache, LIS3DH_CTRL_REG4, &ctrl_reg4);
+                
+                snprintf(message, sizeof(message), "0x%02X PROFILE: %s\r\n", device->address, profile->name);
+                UART_Debug_PutString(message);
+                snprintf(message, sizeof(message), "CONTROL REGISTER 1: 0x%02X\r\n", ctrl_reg1);
+                UART_Debug_PutString(message);
+                snprintf(message, sizeof(message), "CONTROL REGISTER 4: 0x%02X\r\n", ctrl_reg4);
+                UART_Debug_PutString(message);
+            }
+            else
+            {
+                UART_Debug_PutString("Error occurred during I2C comm to set control registers\r\n");
+            }
+        }
+        
+        if (Scheduler.device_count == 0)
+        {
+            UART_Debug_PutString("No LIS3DH found\r\n");
+        }
+        else
+        {
+            snprintf(message, sizeof(message), "Bus bytes per tick: %u (%u devices)\r\n",
+                     SampleScheduler_BusBytes(&Scheduler), Scheduler.device_count);
+            UART_Debug_PutString(message);
+            
+            /******************************************/
+            /*          I2C Bus Benchmark             */
+            /******************************************/
+            
+            // The read pattern of the stream is repeated at each data rate,
+            // the fastest one without errors is kept
+            uint16_t data_rate = I2C_Peripheral_GetDataRate();
+            for (uint8_t i = 0; i < sizeof(DataRates) / sizeof(DataRates[0]); i++)
+            {
+                BusBenchmark_Result result;
+                if (DataRates[i] > LIS3DH_I2C_MAX_DATA_RATE ||
+                    I2C_Peripheral_SetDataRate(DataRates[i]) != NO_ERROR ||
+                    BusBenchmark_Run(&Scheduler, BUS_BENCHMARK_ROUNDS, &result) != NO_ERROR)
+                {
+                    snprintf(message, sizeof(message), "%u kHz: not supported\r\n", DataRates[i]);
+                    UART_Debug_PutString(message);
+                    continue;
+                }
+                
+                snprintf(message, sizeof(message), "%u kHz: %lu tr/s %lu B/s %u err\r\n",
+                         result.data_rate_khz,
+                         (unsigned long) result.transactions_per_second,
+                         (unsigned long) result.bytes_per_second,
+                         result.failures);
+                UART_Debug_PutString(message);
+                if (result.failures == 0)
+                {
+                    data_rate = DataRates[i];
+                }
+            }
+            I2C_Peripheral_SetDataRate(data_rate);
+            Scheduler.max_skew_cycles = 0;
+            
+            // Next boot can skip all of this
+            uint8_t addresses[FAST_BOOT_MAX_DEVICES];
+            if (Scheduler.device_count <= FAST_BOOT_MAX_DEVICES)
+            {
+                for (uint8_t i = 0; i < Scheduler.device_count; i++)
+                {
+                    addresses[i] = Scheduler.devices[i]->address;
+                }
+                FastBoot_Store(addresses, Scheduler.device_count, STREAM_PROFILE, data_rate);
+            }
+        }
     }
     
+    uint8_t Packet[SAMPLE_SCHEDULER_PACKET_SIZE(SAMPLE_SCHEDULER_MAX_DEVICES)];
+    int16_t Raw[3];
+    
+    // With the FIFO enabled the samples are read in batches, whose time is
+    // taken when the read is started: the last sample was taken then and
+    // the others one sampling period apart before it
+    static LIS3DH_FifoBatch Batch;
+    uint8_t fifo_active = 0;
+    uint8_t fifo_device = 0;
+    uint32_t fifo_time_us = 0;
+    ErrorCode fifo_error;
+    
+    // Conversion of the raw values, derived from the operating mode and the
+    // full scale range of the profile. With more devices the raw samples of
+    // all of them are sent together, in the combined packet or in FIFO
+    // batches: the other formats work on a single device.
+    static Stream Out;
+    Out.profile = profile;
+    Out.scheduler = &Scheduler;
+    StreamFormat format = (Scheduler.device_count > 1) ? STREAM_FORMAT_RAW : STREAM_FORMAT_CONVERTED;
+    Command command;
     
+    // Batched samples share a header, the timestamp of the first sample and
+    // a CRC: by default a batch holds as many samples as the FIFO watermark.
+    // In monitoring mode each window of samples is summarized in 38 bytes,
+    // tumbling windows of 400 samples until another window is configured.
+    // The spectrum and the capture get their rate when the stream starts.
+    SampleBatch_Init(&Out.batcher,
+                     profile->fifo_watermark ? profile->fifo_watermark : SAMPLE_BATCH_DEFAULT_SIZE,
+                     SAMPLE_BATCH_DEFAULT_LATENCY_US);
+    WindowStats_Init(&Out.stats, WINDOW_STATS_DEFAULT_WINDOW, WINDOW_STATS_DEFAULT_WINDOW);
+    Spectrum_Init(&Out.spectrum, SPECTRUM_LOG2_POINTS, SPECTRUM_PEAKS, 0);
+    Capture_Init(&Out.capture, CAPTURE_TRIGGER, CAPTURE_THRESHOLD_MG, CAPTURE_HYSTERESIS_MG,
+                 CAPTURE_PRE_TRIGGER, CAPTURE_POST_TRIGGER, 0);
     
     /******************************************/
-    /*        Read Control Register 1         */
+    /*             Stream Budget              */
     /******************************************/
-    uint8_t ctrl_reg1; 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
     
-    if (error == NO_ERROR)
+    // The ODR of the profile must be sustained by the sample source, the I2C
+    // bus and the UART, with the packets of the format: the UART sends one
+    // sample out of budget.decimation. When the sensor side cannot sustain
+    // the profile its ODR is lowered until it can; if none fits the sensors
+    // are powered down and nothing is sampled until a CONFIGURE command
+    // brings a stream that fits.
+    StreamBudget budget;
+    uint8_t degraded = 0;
+    while (PlanStream(&Out, profile, format, &budget) != NO_ERROR &&
+           Profile.odr > LIS3DH_ODR_1HZ)
+    {
+        Profile.odr = (LIS3DH_Odr)(Profile.odr - 1);
+        degraded = 1;
+    }
+    if (budget.verdict != STREAM_OK)
     {
-        sprintf(message, "CONTROL REGISTER 1: 0x%02X\r\n", ctrl_reg1);
-        UART_Debug_PutString(message); 
+        snprintf(message, sizeof(message), "Stream refused: %s\r\n", StreamVerdicts[budget.verdict]);
+        UART_Debug_PutString(message);
+        Profile = LIS3DH_Profiles[LIS3DH_PROFILE_POWER_DOWN];
+        degraded = 1;
     }
-    else
+    if (degraded)
+    {
+        for (uint8_t i = 0; i < Scheduler.device_count; i++)
+        {
+            LIS3DH_Profile_Apply(&Scheduler.devices[i]->cache, profile);
+        }
+    }
+    
+    // The diagnostic messages that wait for the UART are printed on a full
+    // boot only, a fast boot goes straight to the first tick
+    if (!fast_boot)
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 1\r\n");   
+        snprintf(message, sizeof(message), "Stream %u Hz: 1/%u sent, %lu B/s\r\n", budget.odr_hz,
+                 budget.decimation, (unsigned long) budget.uart_bytes_per_second);
+        UART_Debug_PutString(message);
     }
     
     /******************************************/
-    /*        Read Control Register 4        */
+    /*          Decimation Filter             */
     /******************************************/
-    uint8_t ctrl_reg4; 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4);
     
-    if (error == NO_ERROR)
+    // Each device has its own low-pass decimator, between the read of the
+    // samples and the packet formats. On a full boot its cost per input
+    // sample is measured on a test signal, whose CRC is checked against the
+    // one of the host build of Decimator.c.
+    if (!fast_boot)
     {
-        sprintf(message, "CONTROL REGISTER 4: 0x%02X\r\n", ctrl_reg4);
-        UART_Debug_PutString(message); 
+        uint32_t filter_cycles = 0;
+        uint16_t filter_crc = FRAME_CRC_INIT;
+        Decimator_Init(&Out.filters[0], DECIMATOR_TEST_RATE, 1);
+        for (uint16_t n = 0; n < DECIMATOR_TEST_SAMPLES; n++)
+        {
+            Decimator_TestSignal(n, Raw);
+            uint32_t start = CycleCounter_Read();
+            uint8_t ready = Decimator_Push(&Out.filters[0], Raw, Raw);
+            filter_cycles += CycleCounter_Read() - start;
+            if (ready)
+            {
+                filter_crc = Frame_Crc16(filter_crc, (const uint8_t*) Raw, sizeof(Raw));
+            }
+        }
+        snprintf(message, sizeof(message), "Filter 1/%u: %lu cycles/sample, CRC %04X %s\r\n", DECIMATOR_TEST_RATE,
+                 (unsigned long)(filter_cycles / DECIMATOR_TEST_SAMPLES), filter_crc,
+                 (filter_crc == DECIMATOR_TEST_CRC) ? "ok" : "mismatch");
+        UART_Debug_PutString(message);
     }
-    else
+    
+    // On a full boot the efficiency and the worst latency of the batches
+    // are reported for a few sizes
+    for (uint8_t i = 0; i < sizeof(BatchSizes) && !fast_boot && budget.verdict == STREAM_OK; i++)
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 4\r\n");   
+        uint8_t sample_bytes = PackedSample_Size(LIS3DH_Profile_Format(profile));
+        snprintf(message, sizeof(message), "Batch %u: %u%% payload, %lu us latency\r\n", BatchSizes[i],
+                 SampleBatch_Efficiency(BatchSizes[i], sample_bytes),
+                 (unsigned long) SampleBatch_LatencyUs(BatchSizes[i], sample_bytes,
+                                                       budget.odr_hz / budget.decimation,
+                                                       STREAM_UART_BAUD_RATE));
+        UART_Debug_PutString(message);
     }
     
     /******************************************/
-    /*            I2C Writing 
-               Control Register 1             */
+    /*              Spectrum                  */
     /******************************************/
     
-        
-    UART_Debug_PutString("\r\nWriting new values..\r\n");
-    
-    if (ctrl_reg1 != LIS3DH_HIGH_RESOLUTION_MODE_100HZ_CTRL_REG1)
+    // The FFT of each axis runs in the main loop while the next buffer of
+    // samples fills up. On a full boot its cost is measured on the test
+    // signal of the filter, whose CRC is checked against the one of the host
+    // build of Spectrum.c.
+    uint8_t SpectrumPacket[SPECTRUM_MAX_PACKET];
+    if (!fast_boot)
     {
-        ctrl_reg1 = LIS3DH_HIGH_RESOLUTION_MODE_100HZ_CTRL_REG1;
-    
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                             LIS3DH_CTRL_REG1,
-                                             ctrl_reg1);
-    
-        if (error == NO_ERROR)
+        for (uint16_t n = 0; n < SPECTRUM_MAX_POINTS; n++)
         {
-            sprintf(message, "CONTROL REGISTER 1 successfully written as: 0x%02X\r\n", ctrl_reg1);
-            UART_Debug_PutString(message); 
-        }
-        else
-        {
-            UART_Debug_PutString("Error occurred during I2C comm to set control register 1\r\n");   
+            Decimator_TestSignal(n, Raw);
+            Out.spectrum.work[2*n] = Raw[0];
+            Out.spectrum.work[2*n+1] = Raw[1];
         }
+        uint32_t fft_start = CycleCounter_Read();
+        Spectrum_Fft(Out.spectrum.work, SPECTRUM_MAX_LOG2);
+        uint32_t fft_cycles = CycleCounter_Read() - fft_start;
+        uint16_t fft_crc = Frame_Crc16(FRAME_CRC_INIT, (const uint8_t*) Out.spectrum.work, sizeof(Out.spectrum.work));
+        snprintf(message, sizeof(message), "FFT %u: %lu cycles, CRC %04X %s\r\n", SPECTRUM_MAX_POINTS, (unsigned long) fft_cycles,
+                 fft_crc, (fft_crc == SPECTRUM_TEST_CRC) ? "ok" : "mismatch");
+        UART_Debug_PutString(message);
+        snprintf(message, sizeof(message), "Spectrum SRAM: %u bytes\r\n", (unsigned) sizeof(Out.spectrum));
+        UART_Debug_PutString(message);
     }
-     /******************************************/
-    /*            I2C Writing 
-               Control Register 4             */
-    /******************************************/
     
-    UART_Debug_PutString("\r\nWriting new values..\r\n");
+    /******************************************/
+    /*               Capture                  */
+    /******************************************/
     
-    if (ctrl_reg4 != LIS3DH_HIGH_RESOLUTION_MODE_100HZ_CTRL_REG4)
+    // Every sample goes into the capture buffer, only the bursts around a
+    // shock and one heartbeat per second go on the UART
+    uint8_t CapturePacket[CAPTURE_MAX_PACKET];
+    if (!fast_boot)
     {
-        ctrl_reg4 = LIS3DH_HIGH_RESOLUTION_MODE_100HZ_CTRL_REG4;
-    
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                             LIS3DH_CTRL_REG4,
-                                             ctrl_reg4);
-    
-        if (error == NO_ERROR)
-        {
-            sprintf(message, "CONTROL REGISTER 4 successfully written as: 0x%02X\r\n", ctrl_reg4);
-            UART_Debug_PutString(message); 
-        }
-        else
-        {
-            UART_Debug_PutString("Error occurred during I2C comm to set control register 4\r\n");   
-        }
+        snprintf(message, sizeof(message), "Capture SRAM: %u bytes\r\n", (unsigned) sizeof(Out.capture));
+        UART_Debug_PutString(message);
     }
     
- 
-    uint8_t header = 0xA0;
-    uint8_t footer = 0xC0;
-    uint8_t ValueArray[14]; 
-    uint8_t AccData[6];
-    uint8_t status_register;
-    int16_t ValueX, ValueY, ValueZ;
-    int32 IntX, IntY, IntZ;
-    float32 FloatX, FloatY, FloatZ;
+    // From now on the packets are queued and sent by the TX interrupt, the
+    // full boot messages above were the last ones to wait for the UART
+    StreamOutput_Start(STREAM_TX_POLICY);
+    #if INTERRUPT_UART_TX
+        isr_TX_StartEx(UART_TX_ISR);
+    #endif
+    
+    CommandChannel_Start();
+    #if INTERRUPT_UART_RX
+        isr_RX_StartEx(UART_RX_ISR);
+    #endif
     
-    ValueArray[0] = header;
-    ValueArray[13] = footer;
+    // The read path, the filters and the packet formats follow the budget
+    StartStream(&Out, format, &budget);
     
     Timer_1_Start();
     isr_10_StartEx(Custom_ISR);
-   
+    
+    // The time to the first sample is reported once it is queued
+    uint8_t boot_reported = 0;
+    
     for(;;)
     {
-       if(FlagIsr != 0)
-        {
-          //Reading of the status register
-          error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                                LIS3DH_STATUS_REG,
-                                                &status_register);
+        // Let the I2C engine move the transfers forward, it never waits for the bus
+        I2C_Peripheral_ProcessTransfers();
         
-          if(error==NO_ERROR) 
-          { 
-           //Checking if ZYXDA is set to 1. This condition means that a new set of data is available.
-              if((status_register & 1<<3) == 8)
-              { 
-             //It is used a multiread function because the registers are consecutive.
-                error = I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS,
-                                                         LIS3DH_OUT_X_L,
-                                                         6,
-                                                         &AccData[0]);
+        #if !INTERRUPT_UART_TX
+            // No TX interrupt in the schematic: the loop refills the UART FIFO
+            StreamOutput_Transmit();
+        #endif
+        #if !INTERRUPT_UART_RX
+            // Same for the commands, the 4-byte RX FIFO holds 2 ms at 19200 baud
+            CommandChannel_Receive();
+        #endif
         
-                 if (error==NO_ERROR)
-                 {    
-                    ValueX = (int16)((AccData[0] | (AccData[1]<<8)))>>4;
-                //We need to multiply ValueX by 2 because the sensitivity in this case is of 2mg/digit. Then, in order to
-                //convert the X axial output of the Accelerometer to a floating point in m/s2 units, we need to multiply
-                // by 9.806* 0.001, that is the equivalent value of an mg in m/s2.
-                    FloatX = (ValueX*2*9.806*0.001); // The final result is set in a float variable.
-                //Cast the floating point values to an int variable without losing information through the
-                    IntX= FloatX * 1000; //multiplication by 1000.
-                    ValueArray[1] = (uint8_t)(IntX & 0xFF);
-                    ValueArray[2] = (uint8_t)(IntX >> 8);
-                    ValueArray[3] = (uint8_t)(IntX >> 16);
-                    ValueArray[4] = (uint8_t)(IntX >> 24);
-            
+        // Commands are applied between two samples: the registers that change
+        // are written with one burst, then the stream goes on with them
+        if (!Scheduler.active && !fifo_active && CommandChannel_Poll(&command))
+        {
+            uint8_t status = COMMAND_STATUS_OK;
             
-                    ValueY = (int16)((AccData[2] | (AccData[3]<<8)))>>4;
-               //We need to multiply ValueY by 2 because the sensitivity in this case is of 2mg/digit. Then, in order to
-              //convert the Y axial output of the Accelerometer to a floating point in m/s2 units, we need to multiply
-              // by 9.806* 0.001, that is the equivalent value of an mg in m/s2.        
-                    FloatY = (ValueY*2*9.806*0.001); //The final result is set in a float variable.
-              //Cast the floating point values to an int variable without losing information through the
-                    IntY= FloatY * 1000;  //multiplication by 1000.
-                    ValueArray[5] = (uint8_t)(IntY & 0xFF);
-                    ValueArray[6] = (uint8_t)(IntY >> 8);
-                    ValueArray[7] = (uint8_t)(IntY >> 16);
-                    ValueArray[8] = (uint8_t)(IntY >> 24);
-                
-                    
-                    ValueZ = (int16)((AccData[4] | (AccData[5]<<8)))>>4;
-            //We need to multiply ValueZ by 2 because the sensitivity in this case is of 2mg/digit. Then, in order to
-           //convert the Z axial output of the Accelerometer to a floating point in m/s2 units, we need to multiply
-           // by 9.806* 0.001, that is the equivalent value of an mg in m/s2.   
-                    FloatZ = (ValueZ*2*9.806*0.001); //The final result is set in a float variable.
-           //Cast the floating point values to an int variable without losing information through the
-                    IntZ= FloatZ * 1000;  //multiplication by 1000.
-                    ValueArray[9] = (uint8_t)(IntZ & 0xFF);
-                    ValueArray[10] = (uint8_t)(IntZ >> 8);
-                    ValueArray[11] = (uint8_t)(IntZ >> 16);
-                    ValueArray[12] = (uint8_t)(IntZ >> 24);
-                    
-                    UART_Debug_PutArray(ValueArray, 14); // Sending the informations to the UART
+            if (command.id == COMMAND_CONFIGURE)
+            {
+                LIS3DH_Profile requested = Profile;
+                StreamFormat requested_format = Out.format;
+                if (CommandChannel_ParseConfigure(&command, &requested, &requested_format) != NO_ERROR ||
+                    (Scheduler.device_count > 1 && requested_format != STREAM_FORMAT_RAW))
+                {
+                    // The formats other than raw are not available with more devices
+                    status = COMMAND_STATUS_INVALID;
+                }
+                else
+                {
+                    // A stream that cannot be sustained is refused, the current one goes on
+                    status = ApplyProfile(&Out, &requested, requested_format);
+                }
+            }
+            else if (command.id == COMMAND_SET_BATCH)
+            {
+                // The samples already collected are sent with the old size
+                uint8_t size = command.payload[0];
+                uint16_t latency_ms = command.payload[1] | (command.payload[2] << 8);
+                uint8_t old_size = Out.batcher.size;
+                uint32_t old_latency_us = Out.batcher.max_latency_us;
+                if (command.length != COMMAND_SET_BATCH_LENGTH ||
+                    size < 1 || size > SAMPLE_BATCH_MAX_SIZE || latency_ms == 0)
+                {
+                    status = COMMAND_STATUS_INVALID;
+                }
+                else
+                {
+                    SendBatch(&Out);
+                    SampleBatch_Init(&Out.batcher, size, (uint32_t) latency_ms * 1000);
                     
-                    FlagIsr = 0; // Set the FlagIsr to 0
+                    // A different batch size can change the decimation
+                    if (Out.format == STREAM_FORMAT_BATCHED &&
+                        IsRefused(status = ApplyProfile(&Out, profile, Out.format)))
+                    {
+                        SampleBatch_Init(&Out.batcher, old_size, old_latency_us);
                     }
                 }
             }
-         
+            else if (command.id == COMMAND_SET_WINDOW)
+            {
+                // A window equal to the hop is a tumbling one, a shorter hop slides it
+                uint16_t window = command.payload[0] | (command.payload[1] << 8);
+                uint16_t hop = command.payload[2] | (command.payload[3] << 8);
+                uint16_t old_window = Out.stats.window;
+                uint16_t old_hop = Out.stats.hop;
+                if (command.length != COMMAND_SET_WINDOW_LENGTH ||
+                    hop < 1 || hop > window ||
+                    WindowStats_Init(&Out.stats, window, hop) != NO_ERROR)
+                {
+                    status = COMMAND_STATUS_INVALID;
+                }
+                else if (Out.format == STREAM_FORMAT_STATISTICS &&
+                         IsRefused(status = ApplyProfile(&Out, profile, Out.format)))
+                {
+                    WindowStats_Init(&Out.stats, old_window, old_hop);
+                }
+            }
+            else if (command.id == COMMAND_SET_SPECTRUM)
+            {
+                // The buffers are restarted, the new size is checked against
+                // the budget and the old one is put back if it is refused
+                uint8_t log2_points = Out.spectrum.log2_points;
+                uint8_t peaks = Out.spectrum.peaks;
+                if (command.length != COMMAND_SET_SPECTRUM_LENGTH ||
+                    Spectrum_Init(&Out.spectrum, command.payload[0], command.payload[1],
+                                  StreamRateHz(&Out)) != NO_ERROR)
+                {
+                    status = COMMAND_STATUS_INVALID;
+                }
+                else if (Out.format == STREAM_FORMAT_SPECTRUM &&
+                         IsRefused(status = ApplyProfile(&Out, profile, Out.format)))
+                {
+                    Spectrum_Init(&Out.spectrum, log2_points, peaks, StreamRateHz(&Out));
+                }
+            }
+            else if (command.id == COMMAND_SET_TRIGGER)
+            {
+                // The samples already in the buffer are dropped with the old trigger
+                uint16_t threshold_mg = command.payload[1] | (command.payload[2] << 8);
+                uint16_t hysteresis_mg = command.payload[3] | (command.payload[4] << 8);
+                uint16_t pre_trigger = command.payload[5] | (command.payload[6] << 8);
+                uint16_t post_trigger = command.payload[7] | (command.payload[8] << 8);
+                if (command.length != COMMAND_SET_TRIGGER_LENGTH ||
+                    Capture_Init(&Out.capture, (CaptureTrigger) command.payload[0], threshold_mg, hysteresis_mg,
+                                 pre_trigger, post_trigger, StreamRateHz(&Out)) != NO_ERROR)
+                {
+                    status = COMMAND_STATUS_INVALID;
+                }
+            }
+            else if (command.id == COMMAND_SET_FRAMING)
+            {
+                // From the acknowledge on, packets are framed with sequence number and CRC
+                if (command.length == 1 && command.payload[0] <= 1)
+                {
+                    StreamOutput_SetFramed(command.payload[0]);
+                }
+                else
+                {
+                    status = COMMAND_STATUS_INVALID;
+                }
+            }
+            else if (command.id != COMMAND_GET_DESCRIPTOR && command.id != COMMAND_GET_TX_STATS)
+            {
+                status = COMMAND_STATUS_UNKNOWN;
+            }
+            
+            if (command.id == COMMAND_GET_TX_STATS)
+            {
+                CommandChannel_SendTxStats();
+            }
+            else
+            {
+                CommandChannel_SendDescriptor(status, profile, Out.format, &Out.budget);
+            }
         }
-    }    
+        
+        // One axis of the spectrum is transformed, or one packet of it sent,
+        // at each pass so that the loop never stops for a whole FFT
+        if (Out.format == STREAM_FORMAT_SPECTRUM)
+        {
+            uint8_t length = Spectrum_Process(&Out.spectrum, SpectrumPacket);
+            if (length > 0)
+            {
+                StreamOutput_Send(SpectrumPacket, length);
+            }
+        }
+        
+        // The bursts go out as fast as the TX buffer empties, the samples
+        // wait in the capture buffer meanwhile
+        if (Out.format == STREAM_FORMAT_CAPTURE && StreamOutput_CanSend(CAPTURE_MAX_PACKET))
+        {
+            uint8_t length = Capture_Process(&Out.capture, CapturePacket);
+            if (length > 0)
+            {
+                StreamOutput_Send(CapturePacket, length);
+            }
+        }
+        
+        // A batch that is not filled in time is sent as it is
+        if (SampleBatch_IsDue(&Out.batcher, CycleCounter_Microseconds()))
+        {
+            SendBatch(&Out);
+        }
+        
+        // With INT1 the timer only checks that the signal is not stuck high:
+        // an edge missed at startup or a failed read would stop the stream
+        #if INTERRUPT_INT1
+            if(Out.use_int1 && TakeFlag(&FlagIsr))
+            {
+                if (INT1_Read() && !Scheduler.active)
+                {
+                    FlagDataReady = 1;
+                }
+            }
+        #endif
+        
+        // The flag is cleared before the read, an edge that comes during the
+        // read sets it again and starts the next one
+        if(Out.budget.use_fifo && Out.budget.verdict == STREAM_OK && !fifo_active && TakeFlag(Out.sample_flag))
+        {
+            // Each FIFO is emptied with a single burst once it reaches its
+            // watermark, at 400 Hz that is one read every few ticks. The reads
+            // go through the transfer queue one device after the other, so
+            // the loop keeps serving the commands and the UART meanwhile.
+            fifo_device = 0;
+            fifo_time_us = CycleCounter_Microseconds();
+            fifo_active = (LIS3DH_Device_SubmitFifo(Scheduler.devices[0],
+                                                    profile->fifo_watermark, &Batch) == NO_ERROR);
+        }
+        
+        // A failed read leaves the batch empty
+        if(fifo_active && LIS3DH_Device_IsFifoComplete(Scheduler.devices[fifo_device], &fifo_error))
+        {
+            if (Scheduler.device_count == 1 && Out.format != STREAM_FORMAT_RAW)
+            {
+                // Each sample goes through the filter and the packet format,
+                // as the single samples do
+                uint32_t period_us = 1000000 / Out.budget.odr_hz;
+                for (uint8_t n = 0; n < Batch.count; n++)
+                {
+                    LIS3DH_Fifo_GetSample(&Batch, n, Raw);
+                    if (Decimator_Push(&Out.filters[0], Raw, Raw))
+                    {
+                        SendSample(&Out, Raw, fifo_time_us - (Batch.count - 1 - n) * period_us);
+                    }
+                }
+            }
+            else if (Batch.count > 0)
+            {
+                // Only the samples the UART can carry are kept
+                SendRawBatch(&Out, fifo_device, &Batch);
+            }
+            
+            if (!boot_reported && Batch.count > 0)
+            {
+                SendBootReport(fast_boot);
+                boot_reported = 1;
+            }
+            
+            // Then the FIFO of the next device
+            fifo_device++;
+            fifo_time_us = CycleCounter_Microseconds();
+            fifo_active = (fifo_device < Scheduler.device_count &&
+                           LIS3DH_Device_SubmitFifo(Scheduler.devices[fifo_device],
+                                                    profile->fifo_watermark, &Batch) == NO_ERROR);
+        }
+        
+        if(!Out.budget.use_fifo && Out.budget.verdict == STREAM_OK && !Scheduler.active && TakeFlag(Out.sample_flag))
+        {
+          //Reading of status and output registers of all the devices, the loop
+          //goes on while they are on the bus
+          SampleScheduler_StartRound(&Scheduler);
+        }
+        
+        // A failed read costs this sample only, the next tick tries again
+        if(SampleScheduler_Poll(&Scheduler) && Scheduler.fresh_mask != 0)
+        {
+            if (Scheduler.device_count > 1 || Out.format == STREAM_FORMAT_RAW)
+            {
+                // The raw samples of all the devices are sent in the same packet,
+                // copied from the registers: the rounds the UART cannot carry are dropped
+                if (++Out.round_phase >= Out.budget.decimation)
+                {
+                    Out.round_phase = 0;
+                    StreamOutput_Send(Packet, SampleScheduler_Pack(&Scheduler, Packet));
+                }
+            }
+            else if (FilterSample(&Out.filters[0], Scheduler.devices[0], Raw))
+            {
+                // Otherwise the sample only goes into the filter, the UART cannot carry it
+                SendSample(&Out, Raw, CycleCounter_ToTimestamp(Scheduler.round_start));
+            }
+            
+            if (!boot_reported)
+            {
+                SendBootReport(fast_boot);
+                boot_reported = 1;
+            }
+        }
+    }
 }
 
 /* [] END OF FILE */
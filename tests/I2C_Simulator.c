@@ -0,0 +1,410 @@
+/*
+* This file includes the source code of the simulated
+* I2C master and LIS3DH devices used by the host tests.
+*/
+
+#include "I2C_Simulator.h"
+#include "I2C_Master.h"
+#include "SCL_1.h"
+#include "SDA_1.h"
+#include "CyLib.h"
+#include "LIS3DH_Registers.h"
+#include "cyfitter.h"
+#include "string.h"
+
+reg8 I2C_Master_CLKDIV1_REG;
+reg8 I2C_Master_CLKDIV2_REG;
+reg8 I2C_Master_CFG_REG;
+reg8 SCL_1_BYP;
+reg8 SDA_1_BYP;
+volatile uint32_t I2C_Simulator_Cycles;
+
+/**
+*   \brief Bus operation started by the master and not completed yet.
+*/
+static struct {
+    uint8_t active;                         ///< True while the operation is on the bus
+    uint8_t read;                           ///< True for a read, false for a write
+    uint8_t address;                        ///< I2C address of the device
+    uint8_t* buffer;                        ///< Bytes sent or received
+    uint8_t count;                          ///< Number of bytes
+    uint8_t mode;                           ///< Mode of the operation
+    uint8_t polls;                          ///< Status polls before it completes
+    I2C_SimulatorFault fault;               ///< Fault injected on the operation
+} operation;
+
+static I2C_SimulatorDevice devices[I2C_SIMULATOR_MAX_DEVICES];
+static uint8_t master_status;
+static uint8_t sub_address;
+static uint8_t auto_increment;
+static uint8_t latency;
+static I2C_SimulatorFault fault;
+static uint8_t fault_count;
+static uint8_t sda_hold;
+static uint8_t sda_level;
+static uint8_t scl_level;
+static uint16_t init_count;
+static uint16_t operation_count;
+static uint32_t delay_us;
+
+    void I2C_Simulator_Reset(void)
+    {
+        memset(devices, 0, sizeof(devices));
+        memset(&operation, 0, sizeof(operation));
+        master_status = 0;
+        latency = 0;
+        fault = I2C_SIMULATOR_NO_FAULT;
+        fault_count = 0;
+        sda_hold = 0;
+        sda_level = 1;
+        scl_level = 1;
+        init_count = 0;
+        operation_count = 0;
+        delay_us = 0;
+        I2C_Simulator_Cycles = 0;
+    }
+
+    I2C_SimulatorDevice* I2C_Simulator_AddDevice(uint8_t address)
+    {
+        for (uint8_t i = 0; i < I2C_SIMULATOR_MAX_DEVICES; i++)
+        {
+            if (devices[i].address == 0)
+            {
+                I2C_SimulatorDevice* device = &devices[i];
+                device->address = address;
+                device->registers[LIS3DH_WHO_AM_I_REG_ADDR] = LIS3DH_WHO_AM_I_VALUE;
+                device->registers[LIS3DH_CTRL_REG1] = LIS3DH_CTRL_REG1_DEFAULT;
+                return device;
+            }
+        }
+        return NULL;
+    }
+
+    void I2C_Simulator_SetLatency(uint8_t polls)
+    {
+        latency = polls;
+    }
+
+    void I2C_Simulator_InjectFault(I2C_SimulatorFault injected, uint8_t count)
+    {
+        fault = injected;
+        fault_count = count;
+    }
+
+    void I2C_Simulator_HoldSda(uint8_t pulses)
+    {
+        sda_hold = pulses;
+    }
+
+    void I2C_Simulator_PushSample(I2C_SimulatorDevice* device, const int16_t* xyz)
+    {
+        // As in stream mode, a full FIFO drops its oldest sample
+        if (device->fifo_level == I2C_SIMULATOR_FIFO_DEPTH)
+        {
+            memmove(device->fifo[0], device->fifo[1],
+                    sizeof(device->fifo[0]) * (I2C_SIMULATOR_FIFO_DEPTH - 1));
+            device->fifo_level--;
+            device->fifo_overrun = 1;
+        }
+        memcpy(device->fifo[device->fifo_level++], xyz, sizeof(device->fifo[0]));
+    }
+
+    uint16_t I2C_Simulator_GetInitCount(void)
+    {
+        return init_count;
+    }
+
+    uint16_t I2C_Simulator_GetOperationCount(void)
+    {
+        return operation_count;
+    }
+
+    uint32_t I2C_Simulator_GetDelayUs(void)
+    {
+        return delay_us;
+    }
+
+    static I2C_SimulatorDevice* I2C_Simulator_FindDevice(uint8_t address)
+    {
+        for (uint8_t i = 0; i < I2C_SIMULATOR_MAX_DEVICES; i++)
+        {
+            if (devices[i].address != 0 && devices[i].address == address)
+            {
+                return &devices[i];
+            }
+        }
+        return NULL;
+    }
+
+    static uint8_t I2C_Simulator_FifoEnabled(const I2C_SimulatorDevice* device)
+    {
+        return (device->registers[LIS3DH_CTRL_REG5] & LIS3DH_CTRL_REG5_FIFO_EN) != 0;
+    }
+
+    static uint8_t I2C_Simulator_ReadRegister(I2C_SimulatorDevice* device)
+    {
+        uint8_t value;
+        if (I2C_Simulator_FifoEnabled(device) &&
+            sub_address >= LIS3DH_OUT_X_L && sub_address <= LIS3DH_OUT_Z_L + 1)
+        {
+            // The output registers give the oldest sample of the FIFO, the
+            // address wraps around to OUT_X_L after the last byte
+            uint8_t byte = sub_address - LIS3DH_OUT_X_L;
+            uint16_t raw = (uint16_t) device->fifo[0][byte / 2];
+            value = (byte & 1) ? (uint8_t)(raw >> 8) : (uint8_t)(raw & 0xFF);
+            if (sub_address == LIS3DH_OUT_Z_L + 1 && device->fifo_level > 0)
+            {
+                device->fifo_level--;
+                memmove(device->fifo[0], device->fifo[1],
+                        sizeof(device->fifo[0]) * device->fifo_level);
+                device->fifo_overrun = 0;
+            }
+            if (auto_increment)
+            {
+                sub_address = (sub_address == LIS3DH_OUT_Z_L + 1) ? LIS3DH_OUT_X_L : sub_address + 1;
+            }
+            return value;
+        }
+
+        if (sub_address == LIS3DH_FIFO_SRC_REG)
+        {
+            uint8_t watermark = device->registers[LIS3DH_FIFO_CTRL_REG] & LIS3DH_FIFO_CTRL_FTH_MASK;
+            value = device->fifo_level & LIS3DH_FIFO_SRC_FSS_MASK;
+            if (device->fifo_level == 0)
+            {
+                value |= LIS3DH_FIFO_SRC_EMPTY;
+            }
+            if (device->fifo_level > watermark)
+            {
+                value |= LIS3DH_FIFO_SRC_WTM;
+            }
+            if (device->fifo_level == I2C_SIMULATOR_FIFO_DEPTH || device->fifo_overrun)
+            {
+                value |= LIS3DH_FIFO_SRC_OVRN;
+            }
+        }
+        else
+        {
+            value = device->registers[sub_address & 0x3F];
+        }
+        if (auto_increment)
+        {
+            sub_address = (sub_address + 1) & 0x3F;
+        }
+        return value;
+    }
+
+    static void I2C_Simulator_WriteRegister(I2C_SimulatorDevice* device, uint8_t value)
+    {
+        if (sub_address != LIS3DH_WHO_AM_I_REG_ADDR)
+        {
+            device->registers[sub_address & 0x3F] = value;
+        }
+        // Bypass mode empties the FIFO
+        if (sub_address == LIS3DH_FIFO_CTRL_REG && (value >> LIS3DH_FIFO_CTRL_FM_SHIFT) == 0)
+        {
+            device->fifo_level = 0;
+            device->fifo_overrun = 0;
+        }
+        if (auto_increment)
+        {
+            sub_address = (sub_address + 1) & 0x3F;
+        }
+    }
+
+    /**
+    *   \brief Carry out the operation on the bus once its polls are over.
+    */
+    static void I2C_Simulator_Complete(void)
+    {
+        I2C_SimulatorDevice* device = I2C_Simulator_FindDevice(operation.address);
+        operation.active = 0;
+
+        if (operation.fault == I2C_SIMULATOR_ADDRESS_NAK || device == NULL)
+        {
+            master_status |= I2C_Master_MSTAT_ERR_XFER | I2C_Master_MSTAT_ERR_ADDR_NAK;
+            return;
+        }
+        if (operation.fault == I2C_SIMULATOR_ARBITRATION_LOST)
+        {
+            master_status |= I2C_Master_MSTAT_ERR_XFER | I2C_Master_MSTAT_ERR_ARB_LOST;
+            return;
+        }
+        if (operation.fault == I2C_SIMULATOR_DATA_NAK)
+        {
+            master_status |= I2C_Master_MSTAT_ERR_XFER | I2C_Master_MSTAT_ERR_SHORT_XFER;
+            return;
+        }
+
+        if (operation.read)
+        {
+            device->reads++;
+            for (uint8_t i = 0; i < operation.count; i++)
+            {
+                operation.buffer[i] = I2C_Simulator_ReadRegister(device);
+            }
+            master_status |= I2C_Master_MSTAT_RD_CMPLT;
+            return;
+        }
+
+        // The first byte of a write is the register address, the address
+        // phase of a read carries nothing else
+        if (operation.count > 1)
+        {
+            device->writes++;
+            device->bytes_written += operation.count - 1;
+        }
+        sub_address = operation.buffer[0] & 0x7F;
+        auto_increment = (operation.buffer[0] & 0x80) != 0;
+        for (uint8_t i = 1; i < operation.count; i++)
+        {
+            I2C_Simulator_WriteRegister(device, operation.buffer[i]);
+        }
+        master_status |= I2C_Master_MSTAT_WR_CMPLT;
+        if (operation.mode == I2C_Master_MODE_NO_STOP)
+        {
+            master_status |= I2C_Master_MSTAT_XFER_HALT;
+        }
+    }
+
+    static uint8 I2C_Simulator_Start(uint8_t read, uint8 address, uint8* buffer, uint8 count, uint8 mode)
+    {
+        I2C_SimulatorFault injected = I2C_SIMULATOR_NO_FAULT;
+        if (fault_count > 0)
+        {
+            injected = fault;
+            fault_count--;
+        }
+        if (injected == I2C_SIMULATOR_BUS_BUSY)
+        {
+            return I2C_Master_MSTR_BUS_BUSY;
+        }
+
+        operation.active = 1;
+        operation.read = read;
+        operation.address = address;
+        operation.buffer = buffer;
+        operation.count = count;
+        operation.mode = mode;
+        operation.polls = latency;
+        operation.fault = injected;
+        operation_count++;
+        return I2C_Master_MSTR_NO_ERROR;
+    }
+
+    void I2C_Master_Start(void)
+    {
+    }
+
+    void I2C_Master_Stop(void)
+    {
+        operation.active = 0;
+    }
+
+    void I2C_Master_Init(void)
+    {
+        operation.active = 0;
+        master_status = 0;
+        init_count++;
+    }
+
+    uint8 I2C_Master_MasterSendStart(uint8 slaveAddress, uint8 R_nW)
+    {
+        (void) R_nW;
+        if (sda_hold > 0 || I2C_Simulator_FindDevice(slaveAddress) == NULL)
+        {
+            return I2C_Master_MSTR_ERR_LB_NAK;
+        }
+        return I2C_Master_MSTR_NO_ERROR;
+    }
+
+    uint8 I2C_Master_MasterSendStop(void)
+    {
+        master_status &= (uint8_t) ~I2C_Master_MSTAT_XFER_HALT;
+        return I2C_Master_MSTR_NO_ERROR;
+    }
+
+    uint8 I2C_Master_MasterStatus(void)
+    {
+        I2C_Simulator_Cycles += I2C_SIMULATOR_POLL_CYCLES;
+
+        // A stalled operation, or one blocked by SDA held low, never completes
+        if (operation.active && operation.fault != I2C_SIMULATOR_STALL && sda_hold == 0)
+        {
+            if (operation.polls > 0)
+            {
+                operation.polls--;
+            }
+            else
+            {
+                I2C_Simulator_Complete();
+            }
+        }
+        return master_status;
+    }
+
+    uint8 I2C_Master_MasterClearStatus(void)
+    {
+        uint8_t status = master_status;
+        master_status &= I2C_Master_MSTAT_XFER_HALT;
+        return status;
+    }
+
+    uint8 I2C_Master_MasterWriteBuf(uint8 slaveAddress, uint8* wrData, uint8 cnt, uint8 mode)
+    {
+        return I2C_Simulator_Start(0, slaveAddress, wrData, cnt, mode);
+    }
+
+    uint8 I2C_Master_MasterReadBuf(uint8 slaveAddress, uint8* rdData, uint8 cnt, uint8 mode)
+    {
+        return I2C_Simulator_Start(1, slaveAddress, rdData, cnt, mode);
+    }
+
+    uint8 SCL_1_Read(void)
+    {
+        return scl_level;
+    }
+
+    void SCL_1_Write(uint8 value)
+    {
+        // Each rising edge clocks out one bit of the device holding SDA
+        if (scl_level == 0 && value != 0 && sda_hold > 0)
+        {
+            sda_hold--;
+        }
+        scl_level = (value != 0);
+    }
+
+    uint8 SDA_1_Read(void)
+    {
+        return (sda_hold > 0) ? 0 : sda_level;
+    }
+
+    void SDA_1_Write(uint8 value)
+    {
+        sda_level = (value != 0);
+    }
+
+    void CyDelayUs(uint16 microseconds)
+    {
+        delay_us += microseconds;
+        I2C_Simulator_Cycles += microseconds * BCLK__BUS_CLK__MHZ;
+    }
+
+    void CyDelay(uint32 milliseconds)
+    {
+        delay_us += milliseconds * 1000;
+        I2C_Simulator_Cycles += milliseconds * 1000 * BCLK__BUS_CLK__MHZ;
+    }
+
+    uint8 CyEnterCriticalSection(void)
+    {
+        return 0;
+    }
+
+    void CyExitCriticalSection(uint8 saved)
+    {
+        (void) saved;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,117 @@
+/**
+ * \file I2C_Simulator.h
+ * \brief Simulated I2C master and LIS3DH devices for the host tests.
+ *
+ * The simulator implements the API of the I2C_Master component, of the
+ * SCL_1 and SDA_1 pins and the cy_boot delays used by I2C_Interface.c.
+ * Each bus operation completes after a given number of status polls, so
+ * that the asynchronous engine is exercised as on the board. The devices
+ * answer with a register file with auto-increment and the LIS3DH FIFO.
+ *
+ * The cycle counter of the core advances with the status polls and the
+ * delays, so that the time measured by the firmware follows the bus.
+ *
+ * Faults can be injected on the next bus operations: address or data NAK,
+ * lost arbitration, a master that refuses the bus, or an operation that
+ * never completes. SDA can be held low until a number of clock pulses.
+*/
+
+#ifndef I2C_Simulator_H
+    #define I2C_Simulator_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Number of simulated devices.
+    */
+    #define I2C_SIMULATOR_MAX_DEVICES 4
+
+    /**
+    *   \brief Cycles of the core counted for each status poll, 10 us at 24 MHz.
+    */
+    #define I2C_SIMULATOR_POLL_CYCLES 240
+
+    /**
+    *   \brief Samples held by the FIFO of a device.
+    */
+    #define I2C_SIMULATOR_FIFO_DEPTH 32
+
+    /**
+    *   \brief Faults that can be injected on a bus operation.
+    */
+    typedef enum {
+        I2C_SIMULATOR_NO_FAULT,             ///< The operation succeeds
+        I2C_SIMULATOR_ADDRESS_NAK,          ///< No device acknowledges the address
+        I2C_SIMULATOR_DATA_NAK,             ///< The device does not acknowledge a byte
+        I2C_SIMULATOR_ARBITRATION_LOST,     ///< Another master takes the bus
+        I2C_SIMULATOR_BUS_BUSY,             ///< The master refuses to start
+        I2C_SIMULATOR_STALL                 ///< The operation never completes
+    } I2C_SimulatorFault;
+
+    /**
+    *   \brief State of a simulated LIS3DH.
+    */
+    typedef struct {
+        uint8_t address;                                    ///< I2C address, 0 if absent
+        uint8_t registers[0x40];                            ///< Register file
+        int16_t fifo[I2C_SIMULATOR_FIFO_DEPTH][3];          ///< Samples in the FIFO
+        uint8_t fifo_level;                                 ///< Samples in the FIFO
+        uint8_t fifo_overrun;                               ///< True if a sample was lost
+        uint16_t reads;                                     ///< Read operations addressed to the device
+        uint16_t writes;                                    ///< Write operations carrying data to the device
+        uint16_t bytes_written;                             ///< Register values written to the device
+    } I2C_SimulatorDevice;
+
+    /**
+    *   \brief Remove the devices and the faults, release the lines.
+    */
+    void I2C_Simulator_Reset(void);
+
+    /**
+    *   \brief Connect a LIS3DH with its reset register values.
+    *
+    *   \param address I2C address of the device.
+    *   \retval Pointer to the device.
+    */
+    I2C_SimulatorDevice* I2C_Simulator_AddDevice(uint8_t address);
+
+    /**
+    *   \brief Set the status polls each bus operation takes to complete.
+    */
+    void I2C_Simulator_SetLatency(uint8_t polls);
+
+    /**
+    *   \brief Inject a fault on the next bus operations.
+    *
+    *   \param fault Fault to be injected.
+    *   \param count Number of operations affected.
+    */
+    void I2C_Simulator_InjectFault(I2C_SimulatorFault fault, uint8_t count);
+
+    /**
+    *   \brief Hold SDA low until SCL is pulsed a number of times.
+    */
+    void I2C_Simulator_HoldSda(uint8_t pulses);
+
+    /**
+    *   \brief Add a sample to the FIFO of a device, setting the overrun on a full FIFO.
+    */
+    void I2C_Simulator_PushSample(I2C_SimulatorDevice* device, const int16_t* xyz);
+
+    /**
+    *   \brief Number of times the I2C master was initialized.
+    */
+    uint16_t I2C_Simulator_GetInitCount(void);
+
+    /**
+    *   \brief Number of bus operations started, device probes excluded.
+    */
+    uint16_t I2C_Simulator_GetOperationCount(void);
+
+    /**
+    *   \brief Time spent in CyDelayUs and CyDelay, in us.
+    */
+    uint32_t I2C_Simulator_GetDelayUs(void);
+
+#endif // I2C_Simulator_H
+/* [] END OF FILE */
@@ -0,0 +1,46 @@
+/**
+ * \file Test.h
+ * \brief Minimal checks for the host tests.
+ *
+ * Each test is a program that runs its cases and returns the number of
+ * failed checks, so that CTest reports it as failed.
+*/
+
+#ifndef Test_H
+    #define Test_H
+    
+    #include <stdio.h>
+    
+    /**
+    *   \brief Number of failed checks of the program.
+    */
+    static int Test_Failures = 0;
+    
+    /**
+    *   \brief Check a condition, print it with its position if it is false.
+    */
+    #define TEST_CHECK(condition) \
+        do { \
+            if (!(condition)) \
+            { \
+                printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+                Test_Failures++; \
+            } \
+        } while (0)
+    
+    /**
+    *   \brief Run a test case, printing its name.
+    */
+    #define TEST_RUN(test) \
+        do { \
+            printf("%s\n", #test); \
+            test(); \
+        } while (0)
+    
+    /**
+    *   \brief Exit code of the program.
+    */
+    #define TEST_RESULT() (Test_Failures == 0 ? 0 : 1)
+    
+#endif // Test_H
+/* [] END OF FILE */
@@ -0,0 +1,292 @@
+/*
+* This file includes the tests of the capture of the
+* samples around a shock and of its heartbeat.
+*/
+
+#include "Test.h"
+#include "Capture.h"
+#include "LIS3DH_Profiles.h"
+
+#define THRESHOLD_MG 1000
+#define HYSTERESIS_MG 200
+#define RATE_HZ 100
+
+static Capture capture;
+static const LIS3DH_Format* format;
+
+/**
+*   \brief What the host received: the samples of the bursts and the last heartbeat.
+*/
+static int16_t received[CAPTURE_BUFFER_SAMPLES];
+static uint16_t received_count;
+static uint16_t burst_start;
+static int16_t first_offset;
+static uint8_t event;
+static uint16_t packets;
+static uint16_t heartbeats;
+static uint8_t heartbeat[CAPTURE_HEARTBEAT_SIZE];
+
+static uint16_t Get16(const uint8_t* data)
+{
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static void Setup(CaptureTrigger trigger, uint16_t pre_trigger, uint16_t post_trigger)
+{
+    // High resolution at 2 g: 1 mg per digit
+    format = LIS3DH_Format_Get(LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FSR_2G);
+    TEST_CHECK(Capture_Init(&capture, trigger, THRESHOLD_MG, HYSTERESIS_MG,
+                            pre_trigger, post_trigger, RATE_HZ) == NO_ERROR);
+    received_count = 0;
+    event = 0;
+    packets = 0;
+    heartbeats = 0;
+}
+
+/**
+*   \brief Send the packets that are due, as the main loop does with a fast stream.
+*/
+static void Process(void)
+{
+    uint8_t packet[CAPTURE_MAX_PACKET];
+    uint8_t length;
+    while ((length = Capture_Process(&capture, packet)) > 0)
+    {
+        TEST_CHECK(packet[length - 1] == 0xC0);
+        if (packet[0] == CAPTURE_HEARTBEAT_HEADER)
+        {
+            TEST_CHECK(length == CAPTURE_HEARTBEAT_SIZE);
+            for (uint8_t i = 0; i < length; i++)
+            {
+                heartbeat[i] = packet[i];
+            }
+            heartbeats++;
+            continue;
+        }
+
+        // The offsets of the packets of a burst follow each other
+        TEST_CHECK(packet[0] == CAPTURE_BURST_HEADER);
+        uint8_t count = packet[4];
+        int16_t offset = (int16_t) Get16(&packet[2]);
+        TEST_CHECK(length == 6 + 6 * count);
+        if (packet[1] != event)
+        {
+            event = packet[1];
+            burst_start = received_count;
+            first_offset = offset;
+        }
+        TEST_CHECK(offset == first_offset + (received_count - burst_start));
+        for (uint8_t n = 0; n < count; n++)
+        {
+            received[received_count++] = (int16_t) Get16(&packet[5 + 6 * n + 2]);
+        }
+        packets++;
+    }
+}
+
+/**
+*   \brief Add a sample with a level on X, its number on Y.
+*/
+static void Push(int16_t x_mg, uint16_t n)
+{
+    int16_t xyz[3] = {(int16_t)(x_mg * 16), (int16_t) n, 0};
+    Capture_Push(&capture, format, xyz);
+}
+
+static void Test_PreAndPostTrigger(void)
+{
+    Setup(CAPTURE_TRIGGER_AXIS, 50, 30);
+    uint16_t n = 0;
+    for (; n < 200; n++)
+    {
+        Push(0, n);
+        Process();
+    }
+    heartbeats = 0;
+
+    // 50 samples before the trigger, the trigger and 29 after it
+    Push(1500, n++);
+    Process();
+    for (; n < 300; n++)
+    {
+        Push(0, n);
+        Process();
+    }
+    TEST_CHECK(capture.events == 1);
+    TEST_CHECK(received_count == 80);
+    TEST_CHECK(first_offset == -50);
+    TEST_CHECK(packets == 4);
+    for (uint16_t i = 0; i < received_count; i++)
+    {
+        TEST_CHECK(received[i] == 150 + i);
+    }
+    TEST_CHECK(capture.state == CAPTURE_ARMED);
+    TEST_CHECK(capture.lost == 0);
+
+    // Right after the start only the samples stored come before the trigger
+    Setup(CAPTURE_TRIGGER_AXIS, 50, 30);
+    for (n = 0; n < 10; n++)
+    {
+        Push(0, n);
+    }
+    Push(1500, n++);
+    for (; n < 60; n++)
+    {
+        Push(0, n);
+        Process();
+    }
+    TEST_CHECK(received_count == 40);
+    TEST_CHECK(first_offset == -10);
+    TEST_CHECK(received[0] == 0 && received[39] == 39);
+}
+
+static void Test_HysteresisRearm(void)
+{
+    Setup(CAPTURE_TRIGGER_AXIS, 10, 20);
+    uint16_t n = 0;
+    Push(1500, n++);
+    Process();
+
+    // Above the release level the burst ends in hold, a new peak is ignored
+    for (; n < 40; n++)
+    {
+        Push(THRESHOLD_MG - HYSTERESIS_MG + 100, n);
+        Process();
+    }
+    TEST_CHECK(capture.state == CAPTURE_HOLD);
+    Push(THRESHOLD_MG + 100, n++);
+    Process();
+    TEST_CHECK(capture.events == 1);
+
+    // Just at the release level is not enough
+    Push(THRESHOLD_MG - HYSTERESIS_MG, n++);
+    Process();
+    TEST_CHECK(capture.state == CAPTURE_HOLD);
+
+    // Below it the trigger is armed again, the threshold itself starts a burst
+    Push(THRESHOLD_MG - HYSTERESIS_MG - 1, n++);
+    Process();
+    TEST_CHECK(capture.state == CAPTURE_ARMED);
+    Push(THRESHOLD_MG - 1, n++);
+    Process();
+    TEST_CHECK(capture.events == 1);
+    Push(THRESHOLD_MG, n++);
+    Process();
+    TEST_CHECK(capture.events == 2);
+    TEST_CHECK(capture.state == CAPTURE_BURST);
+
+    // A level that drops during the burst arms the trigger at its end
+    for (uint8_t i = 0; i < 30; i++)
+    {
+        Push(0, n++);
+        Process();
+    }
+    TEST_CHECK(capture.state == CAPTURE_ARMED);
+
+    // The first burst had no samples before the trigger
+    TEST_CHECK(received_count == 20 + 30);
+    TEST_CHECK(first_offset == -10);
+    TEST_CHECK(received[0] == 0 && received[20] == n - 41);
+}
+
+static void Test_OverrunLosesOldest(void)
+{
+    // The burst fills the buffer, nothing is sent until it wraps around
+    uint16_t pre = 96;
+    uint16_t post = CAPTURE_BUFFER_SAMPLES - pre;
+    Setup(CAPTURE_TRIGGER_AXIS, pre, post);
+    uint16_t n = 0;
+    for (; n < 200; n++)
+    {
+        Push(0, n);
+    }
+    Push(1500, n++);
+    for (uint16_t i = 0; i < post - 1 + 10; i++)
+    {
+        Push(0, n++);
+    }
+    TEST_CHECK(capture.lost == 10);
+
+    // The burst starts 10 samples later, the offsets show the gap
+    Process();
+    TEST_CHECK(capture.state == CAPTURE_ARMED);
+    TEST_CHECK(received_count == CAPTURE_BUFFER_SAMPLES - 10);
+    TEST_CHECK(first_offset == -(int16_t) pre + 10);
+    for (uint16_t i = 0; i < received_count; i++)
+    {
+        TEST_CHECK(received[i] == 200 - pre + 10 + i);
+    }
+
+    // The heartbeat reports the samples lost
+    for (uint16_t i = 0; i < RATE_HZ; i++)
+    {
+        Push(0, n++);
+        Process();
+    }
+    TEST_CHECK(heartbeats == 1);
+    TEST_CHECK(Get16(&heartbeat[1]) == 1);
+    TEST_CHECK(Get16(&heartbeat[3]) == 10);
+}
+
+static void Test_HeartbeatCadence(void)
+{
+    Setup(CAPTURE_TRIGGER_MAGNITUDE, 10, 20);
+
+    // One heartbeat every RATE_HZ samples, with the peak level since the previous one
+    for (uint16_t n = 0; n < 10 * RATE_HZ; n++)
+    {
+        int16_t xyz[3] = {0, 0, 0};
+        if (n == 150)
+        {
+            xyz[0] = 300 * 16;
+            xyz[1] = -400 * 16;
+        }
+        Capture_Push(&capture, format, xyz);
+        Process();
+        TEST_CHECK(heartbeats == (n + 1) / RATE_HZ);
+        if (n == 199)
+        {
+            TEST_CHECK(heartbeat[0] == CAPTURE_HEARTBEAT_HEADER);
+            TEST_CHECK(Get16(&heartbeat[5]) == 500);
+        }
+        if (n == 299)
+        {
+            TEST_CHECK(Get16(&heartbeat[5]) == 0);
+        }
+    }
+    TEST_CHECK(Get16(&heartbeat[1]) == 0 && Get16(&heartbeat[3]) == 0);
+
+    // No heartbeat during a burst, the next one comes RATE_HZ samples after it
+    heartbeats = 0;
+    Push(1200, 0);
+    Process();
+    for (uint16_t n = 1; n < 20 + RATE_HZ; n++)
+    {
+        Push(0, n);
+        Process();
+        TEST_CHECK(heartbeats == ((n >= 19 + RATE_HZ) ? 1 : 0));
+    }
+    TEST_CHECK(Get16(&heartbeat[1]) == 1);
+}
+
+static void Test_InvalidSettings(void)
+{
+    TEST_CHECK(Capture_Init(&capture, CAPTURE_TRIGGER_AXIS, 100, 200, 10, 10, RATE_HZ) == ERROR);
+    TEST_CHECK(Capture_Init(&capture, CAPTURE_TRIGGER_AXIS, 1000, 200, 10, 0, RATE_HZ) == ERROR);
+    TEST_CHECK(Capture_Init(&capture, CAPTURE_TRIGGER_AXIS, 1000, 200, 100,
+                            CAPTURE_BUFFER_SAMPLES - 99, RATE_HZ) == ERROR);
+    TEST_CHECK(Capture_Init(&capture, CAPTURE_TRIGGER_AXIS, 1000, 200, 100,
+                            CAPTURE_BUFFER_SAMPLES - 100, RATE_HZ) == NO_ERROR);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_PreAndPostTrigger);
+    TEST_RUN(Test_HysteresisRearm);
+    TEST_RUN(Test_OverrunLosesOldest);
+    TEST_RUN(Test_HeartbeatCadence);
+    TEST_RUN(Test_InvalidSettings);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,266 @@
+/*
+* This file includes the tests of the decimation
+* filter against a floating-point reference.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include "Test.h"
+#include "Decimator.h"
+#include "Frame.h"
+
+#define INPUTS 2048
+
+static int16_t input[INPUTS][3];
+
+/**
+*   \brief CIC output of an axis computed as a direct convolution, in double.
+*
+*   The impulse response of three cascaded moving sums of rate samples,
+*   divided by rate^3, is applied to the input ending at sample n.
+*/
+static double ReferenceCic(uint8_t rate, uint16_t n, uint8_t axis)
+{
+    static double response[3 * DECIMATOR_MAX_RATE];
+    uint16_t taps = 3 * rate - 2;
+    for (uint16_t k = 0; k < taps; k++)
+    {
+        // Number of ways to write k as the sum of three values below rate
+        uint32_t ways = 0;
+        for (uint16_t a = 0; a < rate; a++)
+        {
+            for (uint16_t b = 0; b < rate; b++)
+            {
+                ways += (k >= a + b && k - a - b < rate);
+            }
+        }
+        response[k] = ways;
+    }
+
+    double sum = 0;
+    for (uint16_t k = 0; k < taps && k <= n; k++)
+    {
+        sum += response[k] * input[n - k][axis];
+    }
+    return sum / ((double) rate * rate * rate);
+}
+
+/**
+*   \brief Run the decimator on the input and compare each output with the reference.
+*/
+static void CheckAgainstReference(uint8_t rate, double tolerance)
+{
+    Decimator decimator;
+    Decimator_Init(&decimator, rate, 1);
+    double cic[3][3] = {{0}};
+    uint16_t outputs = 0;
+    for (uint16_t n = 0; n < INPUTS; n++)
+    {
+        int16_t out[3];
+        if (!Decimator_Push(&decimator, input[n], out))
+        {
+            continue;
+        }
+        TEST_CHECK((n + 1) % rate == 0);
+        outputs++;
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            cic[axis][2] = cic[axis][1];
+            cic[axis][1] = cic[axis][0];
+            cic[axis][0] = ReferenceCic(rate, n, axis);
+            double expected = (-3 * cic[axis][0] + 22 * cic[axis][1] - 3 * cic[axis][2]) / 16;
+            if (expected > INT16_MAX)
+            {
+                expected = INT16_MAX;
+            }
+            else if (expected < INT16_MIN)
+            {
+                expected = INT16_MIN;
+            }
+            TEST_CHECK(fabs(out[axis] - expected) <= tolerance);
+        }
+    }
+    TEST_CHECK(outputs == INPUTS / rate);
+}
+
+static void Test_TestSignal(void)
+{
+    for (uint16_t n = 0; n < INPUTS; n++)
+    {
+        Decimator_TestSignal(n, input[n]);
+    }
+    static const uint8_t rates[] = {2, 3, 4, 5, 8, 10, 16, 25, 32};
+    for (uint8_t i = 0; i < sizeof(rates); i++)
+    {
+        // Two roundings: the CIC gain and the compensator
+        CheckAgainstReference(rates[i], 1.5);
+    }
+}
+
+/**
+*   \brief CIC output of an axis computed as a direct convolution, in integers.
+*
+*   The sum fits in 32 bits, so it is the value the integrators and the combs
+*   leave after their wraps; the division by rate^3 and the compensator are
+*   then the ones of the decimator.
+*/
+static int32_t ExactCic(const Decimator* decimator, uint16_t n, uint8_t axis)
+{
+    uint8_t rate = decimator->rate;
+    int64_t sum = 0;
+    for (uint16_t k = 0; k < 3 * rate - 2 && k <= n; k++)
+    {
+        int64_t ways = 0;
+        for (uint16_t a = 0; a < rate; a++)
+        {
+            for (uint16_t b = 0; b < rate; b++)
+            {
+                ways += (k >= a + b && k - a - b < rate);
+            }
+        }
+        sum += ways * input[n - k][axis];
+    }
+    return (int32_t)((sum * decimator->gain + ((int64_t) 1 << 31)) >> 32);
+}
+
+static void Test_BitExact(void)
+{
+    for (uint16_t n = 0; n < DECIMATOR_TEST_SAMPLES; n++)
+    {
+        Decimator_TestSignal(n, input[n]);
+    }
+
+    // The outputs of the boot test match the integer reference, their CRC
+    // is the one the firmware compares with
+    Decimator decimator;
+    Decimator_Init(&decimator, DECIMATOR_TEST_RATE, 1);
+    int32_t cic[3][3] = {{0}};
+    uint16_t crc = FRAME_CRC_INIT;
+    for (uint16_t n = 0; n < DECIMATOR_TEST_SAMPLES; n++)
+    {
+        int16_t out[3];
+        if (!Decimator_Push(&decimator, input[n], out))
+        {
+            continue;
+        }
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            cic[axis][2] = cic[axis][1];
+            cic[axis][1] = cic[axis][0];
+            cic[axis][0] = ExactCic(&decimator, n, axis);
+            int32_t expected = (-3 * cic[axis][0] + 22 * cic[axis][1] - 3 * cic[axis][2] + 8) >> 4;
+            if (expected > INT16_MAX)
+            {
+                expected = INT16_MAX;
+            }
+            else if (expected < INT16_MIN)
+            {
+                expected = INT16_MIN;
+            }
+            TEST_CHECK(out[axis] == expected);
+        }
+        crc = Frame_Crc16(crc, (const uint8_t*) out, sizeof(out));
+    }
+    TEST_CHECK(crc == DECIMATOR_TEST_CRC);
+}
+
+static void Test_FullScale(void)
+{
+    // The largest steps of the input, the integrators wrap many times
+    for (uint16_t n = 0; n < INPUTS; n++)
+    {
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            input[n][axis] = ((n >> axis) & 1) ? INT16_MAX : INT16_MIN;
+        }
+    }
+    CheckAgainstReference(DECIMATOR_MAX_RATE, 1.5);
+    CheckAgainstReference(7, 1.5);
+}
+
+static void Test_DcGain(void)
+{
+    for (uint8_t rate = 2; rate <= DECIMATOR_MAX_RATE; rate++)
+    {
+        Decimator decimator;
+        Decimator_Init(&decimator, rate, 1);
+        int16_t in[3] = {1000, -1000, INT16_MIN};
+        int16_t out[3] = {0};
+        for (uint16_t n = 0; n < 8 * rate; n++)
+        {
+            Decimator_Push(&decimator, in, out);
+        }
+        TEST_CHECK(out[0] == 1000 && out[1] == -1000 && out[2] == INT16_MIN);
+    }
+}
+
+/**
+*   \brief Largest output of an axis fed with a sine, after the filter settled.
+*/
+static int16_t ToneAmplitude(uint8_t rate, double frequency)
+{
+    Decimator decimator;
+    Decimator_Init(&decimator, rate, 1);
+    int16_t peak = 0;
+    for (uint16_t n = 0; n < INPUTS; n++)
+    {
+        int16_t in[3] = {(int16_t) lround(10000 * sin(2 * M_PI * frequency * n)), 0, 0};
+        int16_t out[3];
+        if (Decimator_Push(&decimator, in, out) && n > 8 * rate && abs(out[0]) > peak)
+        {
+            peak = (int16_t) abs(out[0]);
+        }
+    }
+    return peak;
+}
+
+static void Test_Aliasing(void)
+{
+    // Frequencies relative to the input rate, the output Nyquist is 1/8
+    TEST_CHECK(abs(ToneAmplitude(4, 0.02) - 10000) < 300);
+    TEST_CHECK(ToneAmplitude(4, 0.3) < 300);
+    TEST_CHECK(ToneAmplitude(4, 0.45) < 300);
+}
+
+static void Test_Unfiltered(void)
+{
+    for (uint16_t n = 0; n < INPUTS; n++)
+    {
+        Decimator_TestSignal(n, input[n]);
+    }
+
+    // One sample out of rate, from the first one
+    Decimator decimator;
+    Decimator_Init(&decimator, 5, 0);
+    uint16_t outputs = 0;
+    for (uint16_t n = 0; n < 100; n++)
+    {
+        int16_t out[3];
+        if (Decimator_Push(&decimator, input[n], out))
+        {
+            TEST_CHECK(n % 5 == 0);
+            TEST_CHECK(out[0] == input[n][0] && out[1] == input[n][1] && out[2] == input[n][2]);
+            outputs++;
+        }
+    }
+    TEST_CHECK(outputs == 20);
+
+    // Rate 1 is a plain copy even with the filter asked for
+    Decimator_Init(&decimator, 1, 1);
+    int16_t out[3];
+    TEST_CHECK(Decimator_Push(&decimator, input[7], out));
+    TEST_CHECK(out[0] == input[7][0] && out[2] == input[7][2]);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_TestSignal);
+    TEST_RUN(Test_BitExact);
+    TEST_RUN(Test_FullScale);
+    TEST_RUN(Test_DcGain);
+    TEST_RUN(Test_Aliasing);
+    TEST_RUN(Test_Unfiltered);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
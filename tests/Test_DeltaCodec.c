@@ -0,0 +1,253 @@
+/*
+* This file includes the tests of the compressed
+* stream, with corrupted and missing bytes.
+*/
+
+#include <math.h>
+#include <string.h>
+#include "Test.h"
+#include "DeltaCodec.h"
+
+#define FRAMES 5
+#define SAMPLES (FRAMES * DELTA_CODEC_FRAME_SAMPLES)
+#define PACKETS (FRAMES * (1 + DELTA_CODEC_FRAME_BLOCKS))
+
+static int16_t signal[SAMPLES][3];
+static uint8_t stream[SAMPLES * DELTA_CODEC_MAX_PACKET];
+static uint16_t stream_length;
+
+/**
+*   \brief Offset in the stream and first sample of each packet.
+*/
+static uint16_t packet_offset[PACKETS];
+static uint16_t packet_sample[PACKETS];
+
+static int16_t decoded[SAMPLES + DELTA_CODEC_BLOCK_SIZE][3];
+static uint16_t decoded_count;
+
+/**
+*   \brief Fill the signal with a random walk of the given bits and a few full-scale jumps.
+*/
+static void MakeSignal(uint8_t bits)
+{
+    uint32_t seed = 12345;
+    int16_t limit = (int16_t)((1 << (bits - 1)) - 1);
+    for (uint16_t i = 0; i < SAMPLES; i++)
+    {
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            seed = seed * 1103515245 + 12345;
+            int16_t step = (int16_t)((seed >> 16) % 33) - 16;
+            int32_t value = (i == 0) ? 0 : signal[i - 1][axis] + step;
+            if (i % 50 == 25)
+            {
+                // Opposite ends of the range in consecutive samples
+                value = (signal[i - 1][axis] > 0) ? -limit - 1 : limit;
+            }
+            if (value > limit)
+            {
+                value = limit;
+            }
+            else if (value < -limit - 1)
+            {
+                value = -limit - 1;
+            }
+            signal[i][axis] = (int16_t) value;
+        }
+    }
+}
+
+static void Encode(void)
+{
+    DeltaEncoder encoder;
+    DeltaCodec_InitEncoder(&encoder);
+    stream_length = 0;
+    uint8_t packets = 0;
+    uint16_t first = 0;
+    for (uint16_t i = 0; i < SAMPLES; i++)
+    {
+        uint8_t length = DeltaCodec_Encode(&encoder, signal[i], &stream[stream_length]);
+        if (length > 0)
+        {
+            packet_offset[packets] = stream_length;
+            packet_sample[packets] = first;
+            packets++;
+            stream_length += length;
+            first = i + 1;
+        }
+    }
+    TEST_CHECK(packets == PACKETS);
+}
+
+static void Decode(uint16_t start)
+{
+    DeltaDecoder decoder;
+    DeltaCodec_InitDecoder(&decoder);
+    decoded_count = 0;
+    for (uint16_t i = start; i < stream_length; i++)
+    {
+        decoded_count += DeltaCodec_Decode(&decoder, stream[i], &decoded[decoded_count]);
+    }
+}
+
+/**
+*   \brief Check that the decoded samples are the given range of the signal.
+*/
+static void CheckDecoded(uint16_t decoded_first, uint16_t signal_first, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        TEST_CHECK(memcmp(decoded[decoded_first + i], signal[signal_first + i], sizeof(signal[0])) == 0);
+    }
+}
+
+static void Test_RoundTrip(void)
+{
+    static const uint8_t bits[] = {8, 10, 12, 16};
+    for (uint8_t b = 0; b < sizeof(bits); b++)
+    {
+        MakeSignal(bits[b]);
+        Encode();
+        Decode(0);
+        TEST_CHECK(decoded_count == SAMPLES);
+        CheckDecoded(0, 0, SAMPLES);
+        TEST_CHECK(stream_length <= (uint32_t) DeltaCodec_WorstCaseBytes(bits[b]) * SAMPLES);
+    }
+
+    // A slow signal takes far less than the 6 bytes of the raw sample
+    memset(signal, 0, sizeof(signal));
+    Encode();
+    TEST_CHECK(stream_length < SAMPLES);
+    Decode(0);
+    TEST_CHECK(decoded_count == SAMPLES);
+    CheckDecoded(0, 0, SAMPLES);
+}
+
+static void Test_CorruptedData(void)
+{
+    MakeSignal(12);
+    Encode();
+
+    // A flipped bit in the second block of frame 1 drops it and the rest of the frame
+    uint8_t packet = 1 * (1 + DELTA_CODEC_FRAME_BLOCKS) + 2;
+    stream[packet_offset[packet] + 5] ^= 0x10;
+    Decode(0);
+    uint16_t kept = packet_sample[packet];
+    uint16_t resumed = 2 * DELTA_CODEC_FRAME_SAMPLES;
+    TEST_CHECK(decoded_count == kept + SAMPLES - resumed);
+    CheckDecoded(0, 0, kept);
+    CheckDecoded(kept, resumed, SAMPLES - resumed);
+
+    // A broken keyframe loses its whole frame
+    Encode();
+    stream[packet_offset[0] + 3] ^= 0x01;
+    Decode(0);
+    TEST_CHECK(decoded_count == SAMPLES - DELTA_CODEC_FRAME_SAMPLES);
+    CheckDecoded(0, DELTA_CODEC_FRAME_SAMPLES, SAMPLES - DELTA_CODEC_FRAME_SAMPLES);
+}
+
+static void Test_CorruptedWidths(void)
+{
+    MakeSignal(12);
+    Encode();
+
+    // Impossible widths: the packet length is unknown, the decoder skips
+    // bytes until it finds a valid keyframe
+    uint8_t packet = 2 * (1 + DELTA_CODEC_FRAME_BLOCKS) + 1;
+    stream[packet_offset[packet] + 1] = 0xFF;
+    Decode(0);
+    uint16_t tail = 2 * DELTA_CODEC_FRAME_SAMPLES;
+    TEST_CHECK(decoded_count >= packet_sample[packet] + tail);
+    CheckDecoded(0, 0, packet_sample[packet]);
+    CheckDecoded(decoded_count - tail, SAMPLES - tail, tail);
+}
+
+static void Test_JoinLate(void)
+{
+    MakeSignal(10);
+    Encode();
+
+    // Blocks received before the first keyframe cannot be decoded
+    Decode(packet_offset[2] + 1);
+    TEST_CHECK(decoded_count == SAMPLES - DELTA_CODEC_FRAME_SAMPLES);
+    CheckDecoded(0, DELTA_CODEC_FRAME_SAMPLES, decoded_count);
+}
+
+/**
+*   \brief Traces of a 12-bit accelerometer at 100 Hz, 2 mg per digit.
+*/
+typedef enum {
+    TRACE_STILL,        ///< Gravity on Z and the noise of the sensor
+    TRACE_WALKING,      ///< Steps at 2 Hz, 0.3 g vertical and 0.1 g sideways
+    TRACE_VIBRATION,    ///< Machine vibration at 23 Hz, 0.5 g on all axes
+} Trace;
+
+/**
+*   \brief Average bytes per second of the compressed stream of a trace.
+*/
+static uint32_t CompressedBytes(Trace trace, uint16_t seconds)
+{
+    const double pi = 3.14159265358979;
+    DeltaEncoder encoder;
+    DeltaCodec_InitEncoder(&encoder);
+    uint8_t packet[DELTA_CODEC_MAX_PACKET];
+    uint32_t seed = 777;
+    uint32_t bytes = 0;
+    for (uint32_t n = 0; n < 100u * seconds; n++)
+    {
+        double t = n / 100.0;
+        double motion[3] = {0, 0, 500};
+        if (trace == TRACE_WALKING)
+        {
+            motion[0] += 50 * sin(2 * pi * 2 * t);
+            motion[1] += 50 * sin(2 * pi * 1 * t + 1);
+            motion[2] += 150 * sin(2 * pi * 2 * t + 0.5);
+        }
+        else if (trace == TRACE_VIBRATION)
+        {
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                motion[axis] += 250 * sin(2 * pi * 23 * t + axis);
+            }
+        }
+
+        int16_t xyz[3];
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            // Noise of a few digits
+            seed = seed * 1103515245 + 12345;
+            xyz[axis] = (int16_t) lround(motion[axis]) + (int16_t)((seed >> 16) % 5) - 2;
+        }
+        bytes += DeltaCodec_Encode(&encoder, xyz, packet);
+    }
+    return bytes / seconds;
+}
+
+static void Test_CompressionRatio(void)
+{
+    // 100 samples of 6 raw bytes each second. Measured: 194, 243 and 439
+    // B/s, that is 32%, 40% and 73% of the raw samples, while the packed
+    // samples take 500 B/s (83%) whatever the signal.
+    static const char* const names[] = {"still", "walking", "vibration"};
+    static const uint16_t limits[] = {210, 270, 480};
+    for (uint8_t trace = TRACE_STILL; trace <= TRACE_VIBRATION; trace++)
+    {
+        uint32_t bytes = CompressedBytes((Trace) trace, 10);
+        printf("  %s: %lu B/s, %lu%% of the raw samples\n", names[trace],
+               (unsigned long) bytes, (unsigned long)(bytes * 100 / 600));
+        TEST_CHECK(bytes <= limits[trace]);
+        TEST_CHECK(bytes <= 100u * DeltaCodec_WorstCaseBytes(12));
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(Test_RoundTrip);
+    TEST_RUN(Test_CorruptedData);
+    TEST_RUN(Test_CorruptedWidths);
+    TEST_RUN(Test_JoinLate);
+    TEST_RUN(Test_CompressionRatio);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
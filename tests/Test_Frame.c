@@ -0,0 +1,190 @@
+/*
+* This file includes the tests of the framing of
+* the UART packets, with corrupted and lost bytes.
+*/
+
+#include <string.h>
+#include "Test.h"
+#include "Frame.h"
+
+#define FRAMES 6
+
+static uint8_t stream[FRAMES * (FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + FRAME_TRAILER_SIZE) + 32];
+static uint16_t stream_length;
+static uint16_t frame_offset[FRAMES];
+
+/**
+*   \brief Payload lengths, including an empty and a full one.
+*/
+static const uint8_t payload_length[FRAMES] = {12, 0, 1, FRAME_MAX_PAYLOAD, 7, 30};
+
+static uint8_t received[FRAMES * 2][FRAME_MAX_PAYLOAD];
+static uint8_t received_length[FRAMES * 2];
+static uint8_t received_count;
+
+/**
+*   \brief Payload of a frame, with sync patterns and valid headers inside.
+*/
+static void MakePayload(uint8_t frame, uint8_t* payload)
+{
+    for (uint8_t i = 0; i < payload_length[frame]; i++)
+    {
+        static const uint8_t pattern[] = {FRAME_SYNC_1, FRAME_SYNC_2, FRAME_VERSION};
+        payload[i] = (i % 5 < 3) ? pattern[i % 5] : (uint8_t)(frame * 31 + i);
+    }
+}
+
+static void AppendFrame(uint8_t frame, uint8_t sequence)
+{
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    MakePayload(frame, payload);
+    frame_offset[frame] = stream_length;
+    Frame_Encode(sequence, payload, payload_length[frame],
+                 &stream[stream_length],
+                 &stream[stream_length + FRAME_HEADER_SIZE + payload_length[frame]]);
+    memcpy(&stream[stream_length + FRAME_HEADER_SIZE], payload, payload_length[frame]);
+    stream_length += FRAME_HEADER_SIZE + payload_length[frame] + FRAME_TRAILER_SIZE;
+}
+
+/**
+*   \brief Encode all the frames, the sequence number wraps around after frame 2.
+*/
+static void Encode(void)
+{
+    stream_length = 0;
+    for (uint8_t frame = 0; frame < FRAMES; frame++)
+    {
+        AppendFrame(frame, (uint8_t)(253 + frame));
+    }
+}
+
+static void Parse(FrameParser* parser, const uint8_t* bytes, uint16_t length)
+{
+    Frame_InitParser(parser);
+    received_count = 0;
+    for (uint16_t i = 0; i < length; i++)
+    {
+        const uint8_t* payload;
+        uint8_t payload_size;
+        if (Frame_Parse(parser, bytes[i], &payload, &payload_size))
+        {
+            memcpy(received[received_count], payload, payload_size);
+            received_length[received_count] = payload_size;
+            received_count++;
+        }
+    }
+}
+
+/**
+*   \brief Check that a received payload is the one of a frame.
+*/
+static void CheckReceived(uint8_t index, uint8_t frame)
+{
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    MakePayload(frame, payload);
+    TEST_CHECK(received_length[index] == payload_length[frame]);
+    TEST_CHECK(memcmp(received[index], payload, payload_length[frame]) == 0);
+}
+
+static void Test_Crc(void)
+{
+    // Check value of CRC-16/CCITT-FALSE
+    const uint8_t text[] = "123456789";
+    TEST_CHECK(Frame_Crc16(FRAME_CRC_INIT, text, 9) == 0x29B1);
+    TEST_CHECK(Frame_Crc16(Frame_Crc16(FRAME_CRC_INIT, text, 4), &text[4], 5) == 0x29B1);
+    TEST_CHECK(Frame_Crc16(FRAME_CRC_INIT, text, 0) == FRAME_CRC_INIT);
+}
+
+static void Test_RoundTrip(void)
+{
+    Encode();
+    FrameParser parser;
+    Parse(&parser, stream, stream_length);
+    TEST_CHECK(received_count == FRAMES);
+    for (uint8_t frame = 0; frame < FRAMES; frame++)
+    {
+        CheckReceived(frame, frame);
+    }
+    TEST_CHECK(parser.lost == 0 && parser.rejected == 0);
+
+    // The header carries the check byte of its own CRC
+    uint16_t crc = Frame_Crc16(FRAME_CRC_INIT, &stream[2], 3);
+    TEST_CHECK(stream[0] == FRAME_SYNC_1 && stream[1] == FRAME_SYNC_2 && stream[2] == FRAME_VERSION);
+    TEST_CHECK(stream[3] == 253 && stream[4] == payload_length[0] && stream[5] == (crc & 0xFF));
+}
+
+static void Test_CorruptedFrame(void)
+{
+    FrameParser parser;
+    uint8_t corrupted_byte[] = {FRAME_HEADER_SIZE + 3, 3, 4, FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + 1};
+
+    // A flipped bit in the payload, the sequence, the length or the CRC of
+    // frame 3 costs that frame only
+    for (uint8_t i = 0; i < sizeof(corrupted_byte); i++)
+    {
+        Encode();
+        stream[frame_offset[3] + corrupted_byte[i]] ^= 0x04;
+        Parse(&parser, stream, stream_length);
+        TEST_CHECK(received_count == FRAMES - 1);
+        CheckReceived(0, 0);
+        CheckReceived(2, 2);
+        CheckReceived(3, 4);
+        CheckReceived(4, 5);
+        TEST_CHECK(parser.lost == 1);
+        TEST_CHECK(parser.rejected >= 1);
+    }
+}
+
+static void Test_LostBytes(void)
+{
+    // The end of frame 1 and the start of frame 2 are lost
+    Encode();
+    uint8_t damaged[sizeof(stream)];
+    uint16_t cut = frame_offset[1] + FRAME_HEADER_SIZE;
+    uint16_t resume = frame_offset[2] + 3;
+    memcpy(damaged, stream, cut);
+    memcpy(&damaged[cut], &stream[resume], stream_length - resume);
+
+    FrameParser parser;
+    Parse(&parser, damaged, stream_length - (resume - cut));
+    TEST_CHECK(received_count == FRAMES - 2);
+    CheckReceived(0, 0);
+    CheckReceived(1, 3);
+    TEST_CHECK(parser.lost == 2);
+}
+
+static void Test_FalseSync(void)
+{
+    // A sync pattern announcing the longest payload, with a wrong check byte
+    Encode();
+    uint8_t bytes[sizeof(stream)];
+    const uint8_t false_sync[] = {FRAME_SYNC_1, FRAME_SYNC_2, FRAME_VERSION, 0x00, FRAME_MAX_PAYLOAD, 0x00};
+    memcpy(bytes, false_sync, sizeof(false_sync));
+    memcpy(&bytes[sizeof(false_sync)], stream, stream_length);
+
+    // The first frame is returned with its last byte, not after 200 more
+    FrameParser parser;
+    uint16_t first_end = sizeof(false_sync) + frame_offset[1];
+    Parse(&parser, bytes, first_end - 1);
+    TEST_CHECK(received_count == 0);
+    Parse(&parser, bytes, first_end);
+    TEST_CHECK(received_count == 1);
+    CheckReceived(0, 0);
+    TEST_CHECK(parser.rejected == 1);
+
+    Parse(&parser, bytes, sizeof(false_sync) + stream_length);
+    TEST_CHECK(received_count == FRAMES);
+    TEST_CHECK(parser.lost == 0);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_Crc);
+    TEST_RUN(Test_RoundTrip);
+    TEST_RUN(Test_CorruptedFrame);
+    TEST_RUN(Test_LostBytes);
+    TEST_RUN(Test_FalseSync);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,387 @@
+/*
+* This file includes the tests of the asynchronous
+* I2C transfer engine against the simulated bus.
+*/
+
+#include "Test.h"
+#include "I2C_Simulator.h"
+#include "I2C_Interface.h"
+#include "LIS3DH_Registers.h"
+#include "SDA_1.h"
+#include "cyfitter.h"
+
+#define DEVICE_A 0x18
+#define DEVICE_B 0x19
+#define ABSENT 0x1A
+
+/**
+*   \brief Order in which the transfers were completed.
+*/
+static I2C_Transfer* completed[8];
+static uint8_t completed_count;
+
+static void RecordCompletion(I2C_Transfer* transfer)
+{
+    completed[completed_count++] = transfer;
+}
+
+/**
+*   \brief Advance the queue until it is empty, at most a given number of times.
+*/
+static uint16_t Drain(uint16_t max_calls)
+{
+    uint16_t calls = 0;
+    while (I2C_Peripheral_IsBusy() && calls < max_calls)
+    {
+        I2C_Peripheral_ProcessTransfers();
+        calls++;
+    }
+    return calls;
+}
+
+static I2C_Transfer ReadTransfer(uint8_t device, uint8_t reg, uint8_t count, uint8_t* data)
+{
+    return (I2C_Transfer) {
+        .device_address = device,
+        .register_address = reg,
+        .register_count = count,
+        .data = data,
+        .direction = I2C_TRANSFER_READ,
+        .callback = RecordCompletion,
+    };
+}
+
+static void Setup(void)
+{
+    I2C_Simulator_Reset();
+    I2C_Peripheral_ClearErrorCounts();
+    completed_count = 0;
+}
+
+static void Test_BlockingRoundTrip(void)
+{
+    Setup();
+    I2C_Simulator_AddDevice(DEVICE_A);
+    I2C_Simulator_SetLatency(4);
+
+    uint8_t value = 0;
+    TEST_CHECK(I2C_Peripheral_WriteRegister(DEVICE_A, LIS3DH_CTRL_REG1, 0x57) == NO_ERROR);
+    TEST_CHECK(I2C_Peripheral_ReadRegister(DEVICE_A, LIS3DH_CTRL_REG1, &value) == NO_ERROR);
+    TEST_CHECK(value == 0x57);
+
+    uint8_t written[3] = {0x01, 0x10, 0x88};
+    uint8_t read[3] = {0};
+    TEST_CHECK(I2C_Peripheral_WriteRegisterMulti(DEVICE_A, LIS3DH_CTRL_REG2, 3, written) == NO_ERROR);
+    TEST_CHECK(I2C_Peripheral_ReadRegisterMulti(DEVICE_A, LIS3DH_CTRL_REG2, 3, read) == NO_ERROR);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        TEST_CHECK(read[i] == written[i]);
+    }
+    TEST_CHECK(!I2C_Peripheral_IsBusy());
+}
+
+static void Test_QueueOrder(void)
+{
+    Setup();
+    I2C_SimulatorDevice* a = I2C_Simulator_AddDevice(DEVICE_A);
+    I2C_Simulator_AddDevice(DEVICE_B);
+    I2C_Simulator_SetLatency(3);
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        a->registers[LIS3DH_OUT_X_L + i] = 0x10 + i;
+    }
+
+    uint8_t sample[6] = {0};
+    uint8_t ctrl_reg1 = 0x47;
+    uint8_t who_am_i = 0;
+    I2C_Transfer first = ReadTransfer(DEVICE_A, LIS3DH_OUT_X_L, 6, sample);
+    I2C_Transfer second = ReadTransfer(DEVICE_B, LIS3DH_CTRL_REG1, 1, &ctrl_reg1);
+    second.direction = I2C_TRANSFER_WRITE;
+    I2C_Transfer third = ReadTransfer(DEVICE_B, LIS3DH_WHO_AM_I_REG_ADDR, 1, &who_am_i);
+
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&first) == NO_ERROR);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&second) == NO_ERROR);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&third) == NO_ERROR);
+
+    // Only the head of the queue goes on the bus right away
+    TEST_CHECK(first.state == I2C_TRANSFER_ADDRESSING);
+    TEST_CHECK(second.state == I2C_TRANSFER_PENDING);
+    TEST_CHECK(third.state == I2C_TRANSFER_PENDING);
+    TEST_CHECK(I2C_Peripheral_IsBusy());
+
+    Drain(100);
+    TEST_CHECK(!I2C_Peripheral_IsBusy());
+    TEST_CHECK(completed_count == 3);
+    TEST_CHECK(completed[0] == &first && completed[1] == &second && completed[2] == &third);
+    TEST_CHECK(first.state == I2C_TRANSFER_DONE && first.error == NO_ERROR);
+    TEST_CHECK(second.state == I2C_TRANSFER_DONE && second.error == NO_ERROR);
+    TEST_CHECK(third.state == I2C_TRANSFER_DONE && third.error == NO_ERROR);
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        TEST_CHECK(sample[i] == 0x10 + i);
+    }
+    TEST_CHECK(who_am_i == LIS3DH_WHO_AM_I_VALUE);
+
+    uint8_t value = 0;
+    TEST_CHECK(I2C_Peripheral_ReadRegister(DEVICE_B, LIS3DH_CTRL_REG1, &value) == NO_ERROR);
+    TEST_CHECK(value == 0x47);
+}
+
+static void Test_NakDoesNotStopTheQueue(void)
+{
+    Setup();
+    I2C_Simulator_AddDevice(DEVICE_A);
+
+    uint8_t absent = 0;
+    uint8_t present = 0;
+    I2C_Transfer first = ReadTransfer(ABSENT, LIS3DH_WHO_AM_I_REG_ADDR, 1, &absent);
+    I2C_Transfer second = ReadTransfer(DEVICE_A, LIS3DH_WHO_AM_I_REG_ADDR, 1, &present);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&first) == NO_ERROR);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&second) == NO_ERROR);
+
+    Drain(100);
+    TEST_CHECK(first.state == I2C_TRANSFER_DONE && first.error == ERROR_ADDRESS_NAK);
+    TEST_CHECK(second.state == I2C_TRANSFER_DONE && second.error == NO_ERROR);
+    TEST_CHECK(present == LIS3DH_WHO_AM_I_VALUE);
+    TEST_CHECK(I2C_Peripheral_GetErrorCount(ERROR_ADDRESS_NAK) == 1);
+}
+
+static void Test_InvalidDescriptors(void)
+{
+    Setup();
+    I2C_Simulator_AddDevice(DEVICE_A);
+    I2C_Simulator_SetLatency(2);
+
+    uint8_t data[I2C_TRANSFER_MAX_WRITE + 1] = {0};
+    I2C_Transfer transfer = ReadTransfer(DEVICE_A, LIS3DH_CTRL_REG1, 1, NULL);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(NULL) == ERROR);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&transfer) == ERROR);
+
+    transfer.data = data;
+    transfer.register_count = 0;
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&transfer) == ERROR);
+
+    transfer.direction = I2C_TRANSFER_WRITE;
+    transfer.register_count = I2C_TRANSFER_MAX_WRITE + 1;
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&transfer) == ERROR);
+
+    // A queued descriptor cannot be queued again until it is done
+    transfer.direction = I2C_TRANSFER_READ;
+    transfer.register_count = 1;
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&transfer) == NO_ERROR);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&transfer) == ERROR);
+    Drain(100);
+    TEST_CHECK(transfer.state == I2C_TRANSFER_DONE);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&transfer) == NO_ERROR);
+    Drain(100);
+    TEST_CHECK(completed_count == 2);
+}
+
+static void Test_BurstIsOneOperation(void)
+{
+    Setup();
+    I2C_SimulatorDevice* a = I2C_Simulator_AddDevice(DEVICE_A);
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        a->registers[LIS3DH_CTRL_REG1 + i] = 0xA0 + i;
+    }
+
+    // Register address, then all the registers with auto-increment
+    uint8_t data[8] = {0};
+    TEST_CHECK(I2C_Peripheral_ReadRegisterMulti(DEVICE_A, LIS3DH_CTRL_REG1, 8, data) == NO_ERROR);
+    TEST_CHECK(I2C_Simulator_GetOperationCount() == 2);
+    TEST_CHECK(a->reads == 1);
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        TEST_CHECK(data[i] == 0xA0 + i);
+    }
+
+    // A write sends address and data with a single operation
+    uint8_t written[4] = {1, 2, 3, 4};
+    TEST_CHECK(I2C_Peripheral_WriteRegisterMulti(DEVICE_A, LIS3DH_INT1_CFG, 4, written) == NO_ERROR);
+    TEST_CHECK(I2C_Simulator_GetOperationCount() == 3);
+    TEST_CHECK(a->registers[LIS3DH_INT1_CFG] == 1 && a->registers[LIS3DH_INT1_DURATION] == 4);
+}
+
+static void Test_FifoBlockBurst(void)
+{
+    Setup();
+    I2C_SimulatorDevice* a = I2C_Simulator_AddDevice(DEVICE_A);
+    I2C_Simulator_SetLatency(5);
+    a->registers[LIS3DH_CTRL_REG5] = LIS3DH_CTRL_REG5_FIFO_EN;
+    for (int16_t n = 0; n < 32; n++)
+    {
+        int16_t xyz[3] = {n, (int16_t)(-n), (int16_t)(n * 100)};
+        I2C_Simulator_PushSample(a, xyz);
+    }
+
+    // The whole FIFO, 192 bytes, comes with one burst
+    uint8_t data[32 * 6];
+    TEST_CHECK(I2C_Peripheral_ReadRegisterMulti(DEVICE_A, LIS3DH_OUT_X_L, sizeof(data), data) == NO_ERROR);
+    TEST_CHECK(I2C_Simulator_GetOperationCount() == 2);
+    TEST_CHECK(a->fifo_level == 0);
+    for (int16_t n = 0; n < 32; n++)
+    {
+        const uint8_t* sample = &data[n * 6];
+        TEST_CHECK((int16_t)(sample[0] | (sample[1] << 8)) == n);
+        TEST_CHECK((int16_t)(sample[2] | (sample[3] << 8)) == -n);
+        TEST_CHECK((int16_t)(sample[4] | (sample[5] << 8)) == n * 100);
+    }
+}
+
+static void Test_StalledTransferTimesOut(void)
+{
+    Setup();
+    I2C_Simulator_AddDevice(DEVICE_A);
+    I2C_Simulator_InjectFault(I2C_SIMULATOR_STALL, 1);
+
+    // One register at 100 kHz stays on the bus well within one tick
+    uint8_t value = 0;
+    I2C_Transfer transfer = ReadTransfer(DEVICE_A, LIS3DH_WHO_AM_I_REG_ADDR, 1, &value);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&transfer) == NO_ERROR);
+    for (uint8_t tick = 0; tick < I2C_TRANSFER_TIMEOUT_TICKS + 1; tick++)
+    {
+        Drain(10);
+        TEST_CHECK(transfer.state != I2C_TRANSFER_DONE);
+        I2C_Peripheral_Tick();
+    }
+    Drain(10);
+    TEST_CHECK(transfer.state == I2C_TRANSFER_DONE && transfer.error == ERROR_TIMEOUT);
+    TEST_CHECK(I2C_Peripheral_GetErrorCount(ERROR_TIMEOUT) == 1);
+    TEST_CHECK(I2C_Peripheral_GetRecoveryCount() == 1);
+    TEST_CHECK(I2C_Simulator_GetInitCount() == 1);
+
+    // The bus works again after the recovery
+    TEST_CHECK(I2C_Peripheral_ReadRegister(DEVICE_A, LIS3DH_WHO_AM_I_REG_ADDR, &value) == NO_ERROR);
+    TEST_CHECK(value == LIS3DH_WHO_AM_I_VALUE);
+}
+
+static void Test_LongBurstIsNotAborted(void)
+{
+    Setup();
+    I2C_SimulatorDevice* a = I2C_Simulator_AddDevice(DEVICE_A);
+    a->registers[LIS3DH_CTRL_REG5] = LIS3DH_CTRL_REG5_FIFO_EN;
+
+    // 192 bytes at 100 kHz take about 17.5 ms, three ticks can go by
+    uint8_t data[32 * 6];
+    I2C_Transfer transfer = ReadTransfer(DEVICE_A, LIS3DH_OUT_X_L, sizeof(data), data);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&transfer) == NO_ERROR);
+    for (uint8_t tick = 0; tick < 3; tick++)
+    {
+        I2C_Peripheral_Tick();
+    }
+    Drain(10);
+    TEST_CHECK(transfer.state == I2C_TRANSFER_DONE && transfer.error == NO_ERROR);
+    TEST_CHECK(I2C_Peripheral_GetRecoveryCount() == 0);
+}
+
+static void Test_BlockingFaults(void)
+{
+    Setup();
+    I2C_Simulator_AddDevice(DEVICE_A);
+    uint8_t value = 0;
+
+    // A stalled operation is aborted at the deadline of its length
+    I2C_Simulator_InjectFault(I2C_SIMULATOR_STALL, 1);
+    TEST_CHECK(I2C_Peripheral_ReadRegister(DEVICE_A, LIS3DH_CTRL_REG1, &value) == ERROR_TIMEOUT);
+    TEST_CHECK(I2C_Simulator_GetDelayUs() >= I2C_TIMEOUT_BASE_US + 3 * I2C_TIMEOUT_BYTE_US);
+    TEST_CHECK(I2C_Simulator_GetDelayUs() < 2 * (I2C_TIMEOUT_BASE_US + 3 * I2C_TIMEOUT_BYTE_US));
+    TEST_CHECK(I2C_Peripheral_GetRecoveryCount() == 1);
+
+    // A master that never gets the bus
+    I2C_Simulator_InjectFault(I2C_SIMULATOR_BUS_BUSY, UINT8_MAX);
+    TEST_CHECK(I2C_Peripheral_ReadRegister(DEVICE_A, LIS3DH_CTRL_REG1, &value) == ERROR_BUS_BUSY);
+    TEST_CHECK(I2C_Peripheral_GetRecoveryCount() == 2);
+    I2C_Simulator_InjectFault(I2C_SIMULATOR_NO_FAULT, 0);
+
+    I2C_Simulator_InjectFault(I2C_SIMULATOR_ARBITRATION_LOST, 1);
+    TEST_CHECK(I2C_Peripheral_ReadRegister(DEVICE_A, LIS3DH_CTRL_REG1, &value) == ERROR_ARBITRATION_LOST);
+    TEST_CHECK(I2C_Peripheral_GetRecoveryCount() == 3);
+
+    // A NAK leaves the bus in a known state, no recovery is needed
+    I2C_Simulator_InjectFault(I2C_SIMULATOR_DATA_NAK, 1);
+    TEST_CHECK(I2C_Peripheral_WriteRegister(DEVICE_A, LIS3DH_CTRL_REG1, 0x57) == ERROR_DATA_NAK);
+    TEST_CHECK(I2C_Peripheral_ReadRegister(0x1A, LIS3DH_CTRL_REG1, &value) == ERROR_ADDRESS_NAK);
+    TEST_CHECK(I2C_Peripheral_GetRecoveryCount() == 3);
+
+    TEST_CHECK(I2C_Peripheral_ReadRegister(DEVICE_A, LIS3DH_CTRL_REG1, &value) == NO_ERROR);
+    TEST_CHECK(value == LIS3DH_CTRL_REG1_DEFAULT);
+}
+
+static void Test_StuckSdaIsClockedFree(void)
+{
+    Setup();
+    I2C_Simulator_AddDevice(DEVICE_A);
+    uint8_t value = 0;
+
+    // A device holding SDA low stalls the transfer until the recovery
+    I2C_Simulator_HoldSda(5);
+    TEST_CHECK(I2C_Peripheral_ReadRegister(DEVICE_A, LIS3DH_CTRL_REG1, &value) == ERROR_TIMEOUT);
+    TEST_CHECK(SDA_1_Read() != 0);
+    TEST_CHECK(I2C_Peripheral_ReadRegister(DEVICE_A, LIS3DH_CTRL_REG1, &value) == NO_ERROR);
+
+    // The probe frees the line before addressing the device
+    I2C_Simulator_HoldSda(3);
+    TEST_CHECK(I2C_Peripheral_IsDeviceConnected(DEVICE_A));
+
+    // Nine pulses are not enough for a line that stays low
+    I2C_Simulator_HoldSda(20);
+    TEST_CHECK(I2C_Peripheral_RecoverBus() == ERROR_BUS_BUSY);
+    TEST_CHECK(I2C_Peripheral_RecoverBus() == NO_ERROR);
+}
+
+static void Test_LoopIsFreedDuringTheRead(void)
+{
+    Setup();
+    I2C_SimulatorDevice* a = I2C_Simulator_AddDevice(DEVICE_A);
+    a->registers[LIS3DH_STATUS_REG] = 0x0F;
+
+    // Each bus operation takes 10 polls, 100 us of bus time
+    I2C_Simulator_SetLatency(10);
+
+    // The blocking reads of a 100 Hz tick, status and output registers,
+    // keep the main loop waiting for the whole time on the bus
+    uint8_t status = 0;
+    uint8_t output[6];
+    TEST_CHECK(I2C_Peripheral_ReadRegister(DEVICE_A, LIS3DH_STATUS_REG, &status) == NO_ERROR);
+    TEST_CHECK(I2C_Peripheral_ReadRegisterMulti(DEVICE_A, LIS3DH_OUT_X_L, 6, output) == NO_ERROR);
+    uint32_t blocked_us = I2C_Simulator_GetDelayUs();
+    TEST_CHECK(blocked_us >= 4 * 10 * I2C_POLL_PERIOD_US);
+
+    // The same reads submitted to the queue: the loop goes on at each pass,
+    // without waiting, until they are completed
+    Setup();
+    a = I2C_Simulator_AddDevice(DEVICE_A);
+    a->registers[LIS3DH_STATUS_REG] = 0x0F;
+    I2C_Simulator_SetLatency(10);
+    I2C_Transfer status_read = ReadTransfer(DEVICE_A, LIS3DH_STATUS_REG, 1, &status);
+    I2C_Transfer output_read = ReadTransfer(DEVICE_A, LIS3DH_OUT_X_L, 6, output);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&status_read) == NO_ERROR);
+    TEST_CHECK(I2C_Peripheral_SubmitTransfer(&output_read) == NO_ERROR);
+    uint16_t passes = Drain(1000);
+    TEST_CHECK(!I2C_Peripheral_IsBusy());
+    TEST_CHECK(completed_count == 2 && status_read.error == NO_ERROR && output_read.error == NO_ERROR);
+    TEST_CHECK(I2C_Simulator_GetDelayUs() == 0);
+    TEST_CHECK(passes >= 4 * 10);
+
+    printf("  per 100 Hz tick: %lu us (%lu cycles) blocked, 0 asynchronous in %u loop passes\n",
+           (unsigned long) blocked_us, (unsigned long) blocked_us * BCLK__BUS_CLK__MHZ, passes);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_BlockingRoundTrip);
+    TEST_RUN(Test_QueueOrder);
+    TEST_RUN(Test_NakDoesNotStopTheQueue);
+    TEST_RUN(Test_InvalidDescriptors);
+    TEST_RUN(Test_BurstIsOneOperation);
+    TEST_RUN(Test_FifoBlockBurst);
+    TEST_RUN(Test_StalledTransferTimesOut);
+    TEST_RUN(Test_LongBurstIsNotAborted);
+    TEST_RUN(Test_BlockingFaults);
+    TEST_RUN(Test_StuckSdaIsClockedFree);
+    TEST_RUN(Test_LoopIsFreedDuringTheRead);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,206 @@
+/*
+* This file includes the tests of the batch reads
+* of the FIFO against a simulated LIS3DH.
+*/
+
+#include "Test.h"
+#include "I2C_Simulator.h"
+#include "LIS3DH_Fifo.h"
+#include "LIS3DH_Registers.h"
+
+#define DEVICE_A 0x18
+
+static I2C_SimulatorDevice* device;
+
+static void Setup(uint8_t samples)
+{
+    I2C_Simulator_Reset();
+    I2C_Simulator_SetLatency(2);
+    device = I2C_Simulator_AddDevice(DEVICE_A);
+    device->registers[LIS3DH_CTRL_REG5] = LIS3DH_CTRL_REG5_FIFO_EN;
+    // Stream mode, the oldest sample is overwritten when the FIFO is full
+    device->registers[LIS3DH_FIFO_CTRL_REG] = 2 << LIS3DH_FIFO_CTRL_FM_SHIFT;
+    for (uint8_t i = 0; i < samples; i++)
+    {
+        int16_t xyz[3] = {(int16_t)(16 * i), (int16_t)(-16 * i), (int16_t)(0x4000 + i)};
+        I2C_Simulator_PushSample(device, xyz);
+    }
+}
+
+/**
+*   \brief Check that the samples of a batch follow the pattern of Setup.
+*/
+static void CheckBatch(const LIS3DH_FifoBatch* batch, uint8_t first)
+{
+    for (uint8_t i = 0; i < batch->count; i++)
+    {
+        int16_t xyz[3];
+        uint8_t n = first + i;
+        LIS3DH_Fifo_GetSample(batch, i, xyz);
+        TEST_CHECK(xyz[0] == 16 * n && xyz[1] == -16 * n && xyz[2] == 0x4000 + n);
+    }
+}
+
+static void Test_Level(void)
+{
+    TEST_CHECK(LIS3DH_Fifo_Level(LIS3DH_FIFO_SRC_EMPTY) == 0);
+    TEST_CHECK(LIS3DH_Fifo_Level(0x05) == 5);
+    TEST_CHECK(LIS3DH_Fifo_Level(LIS3DH_FIFO_SRC_WTM | 0x1F) == 31);
+    TEST_CHECK(LIS3DH_Fifo_Level(LIS3DH_FIFO_SRC_WTM | LIS3DH_FIFO_SRC_OVRN) == LIS3DH_FIFO_DEPTH);
+}
+
+static void Test_DrainIsOneBurst(void)
+{
+    Setup(10);
+    LIS3DH_FifoBatch batch;
+    TEST_CHECK(LIS3DH_Fifo_Drain(DEVICE_A, 1, &batch) == NO_ERROR);
+    TEST_CHECK(batch.count == 10 && !batch.overrun);
+    TEST_CHECK(device->fifo_level == 0);
+    CheckBatch(&batch, 0);
+
+    // FIFO_SRC_REG and the samples: two reads whatever the level
+    TEST_CHECK(device->reads == 2);
+}
+
+static void Test_EmptyAndBelowWatermark(void)
+{
+    Setup(0);
+    LIS3DH_FifoBatch batch;
+    TEST_CHECK(LIS3DH_Fifo_Drain(DEVICE_A, 1, &batch) == NO_ERROR);
+    TEST_CHECK(batch.count == 0);
+    TEST_CHECK(device->reads == 1);
+
+    // Below the minimum level the samples are left in the FIFO
+    Setup(5);
+    TEST_CHECK(LIS3DH_Fifo_Drain(DEVICE_A, 8, &batch) == NO_ERROR);
+    TEST_CHECK(batch.count == 0);
+    TEST_CHECK(device->fifo_level == 5);
+    TEST_CHECK(LIS3DH_Fifo_Drain(DEVICE_A, 5, &batch) == NO_ERROR);
+    TEST_CHECK(batch.count == 5);
+    CheckBatch(&batch, 0);
+}
+
+static void Test_Overrun(void)
+{
+    // Three samples more than the FIFO holds: the oldest ones are lost
+    Setup(LIS3DH_FIFO_DEPTH + 3);
+    LIS3DH_FifoBatch batch;
+    TEST_CHECK(LIS3DH_Fifo_Drain(DEVICE_A, 1, &batch) == NO_ERROR);
+    TEST_CHECK(batch.count == LIS3DH_FIFO_DEPTH && batch.overrun);
+    CheckBatch(&batch, 3);
+    TEST_CHECK(device->fifo_level == 0);
+
+    // The flag is cleared by the read
+    int16_t xyz[3] = {0};
+    I2C_Simulator_PushSample(device, xyz);
+    TEST_CHECK(LIS3DH_Fifo_Drain(DEVICE_A, 1, &batch) == NO_ERROR);
+    TEST_CHECK(batch.count == 1 && !batch.overrun);
+}
+
+static void Test_SubmitDrain(void)
+{
+    Setup(20);
+    LIS3DH_FifoDrain drain = {.state = LIS3DH_FIFO_DRAIN_IDLE};
+    LIS3DH_FifoBatch batch;
+    ErrorCode error = ERROR;
+    TEST_CHECK(LIS3DH_Fifo_SubmitDrain(&drain, DEVICE_A, 16, &batch) == NO_ERROR);
+    TEST_CHECK(LIS3DH_Fifo_SubmitDrain(&drain, DEVICE_A, 16, &batch) == ERROR);
+
+    uint16_t calls = 0;
+    while (!LIS3DH_Fifo_IsDrainComplete(&drain, &error) && calls < 100)
+    {
+        I2C_Peripheral_ProcessTransfers();
+        calls++;
+    }
+    TEST_CHECK(calls > 0 && calls < 100);
+    TEST_CHECK(error == NO_ERROR);
+    TEST_CHECK(batch.count == 20 && !batch.overrun);
+    CheckBatch(&batch, 0);
+    TEST_CHECK(drain.state == LIS3DH_FIFO_DRAIN_IDLE);
+    TEST_CHECK(!LIS3DH_Fifo_IsDrainComplete(&drain, &error));
+
+    // Below the minimum level only FIFO_SRC_REG is read
+    I2C_Simulator_PushSample(device, (int16_t[3]) {0});
+    uint16_t reads = device->reads;
+    TEST_CHECK(LIS3DH_Fifo_SubmitDrain(&drain, DEVICE_A, 16, &batch) == NO_ERROR);
+    while (!LIS3DH_Fifo_IsDrainComplete(&drain, &error))
+    {
+        I2C_Peripheral_ProcessTransfers();
+    }
+    TEST_CHECK(error == NO_ERROR && batch.count == 0);
+    TEST_CHECK(device->reads == reads + 1);
+
+    // A failed read completes the drain with the bus error
+    TEST_CHECK(LIS3DH_Fifo_SubmitDrain(&drain, 0x1A, 1, &batch) == NO_ERROR);
+    while (!LIS3DH_Fifo_IsDrainComplete(&drain, &error))
+    {
+        I2C_Peripheral_ProcessTransfers();
+    }
+    TEST_CHECK(error == ERROR_ADDRESS_NAK && batch.count == 0);
+}
+
+static void Test_ConsecutiveDrains(void)
+{
+    Setup(0);
+    LIS3DH_FifoDrain drain = {.state = LIS3DH_FIFO_DRAIN_IDLE};
+    LIS3DH_FifoBatch batch;
+    ErrorCode error;
+    uint16_t pushed = 0;
+    uint16_t received = 0;
+    uint8_t drains = 0;
+
+    // The sensor keeps sampling while the FIFO is read, a batch is started
+    // each time the watermark is reached: the samples of all the batches
+    // must follow each other, none lost or read twice
+    while (pushed < 400)
+    {
+        for (uint8_t i = 0; i < 5; i++, pushed++)
+        {
+            int16_t xyz[3] = {(int16_t)(16 * pushed), (int16_t)(-16 * pushed), (int16_t)(0x4000 + pushed)};
+            I2C_Simulator_PushSample(device, xyz);
+        }
+        if (device->fifo_level < 16)
+        {
+            continue;
+        }
+
+        TEST_CHECK(LIS3DH_Fifo_SubmitDrain(&drain, DEVICE_A, 16, &batch) == NO_ERROR);
+        uint16_t calls = 0;
+        while (!LIS3DH_Fifo_IsDrainComplete(&drain, &error) && calls < 100)
+        {
+            I2C_Peripheral_ProcessTransfers();
+            if (++calls % 3 == 0)
+            {
+                int16_t xyz[3] = {(int16_t)(16 * pushed), (int16_t)(-16 * pushed), (int16_t)(0x4000 + pushed)};
+                I2C_Simulator_PushSample(device, xyz);
+                pushed++;
+            }
+        }
+        TEST_CHECK(error == NO_ERROR && !batch.overrun);
+        TEST_CHECK(batch.count >= 16);
+        for (uint8_t i = 0; i < batch.count; i++, received++)
+        {
+            int16_t xyz[3];
+            LIS3DH_Fifo_GetSample(&batch, i, xyz);
+            TEST_CHECK(xyz[0] == (int16_t)(16 * received) && xyz[2] == (int16_t)(0x4000 + received));
+        }
+        drains++;
+    }
+
+    // The samples taken during the last read wait for the next one
+    TEST_CHECK(drains > 10);
+    TEST_CHECK(received + device->fifo_level == pushed);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_Level);
+    TEST_RUN(Test_DrainIsOneBurst);
+    TEST_RUN(Test_EmptyAndBelowWatermark);
+    TEST_RUN(Test_Overrun);
+    TEST_RUN(Test_SubmitDrain);
+    TEST_RUN(Test_ConsecutiveDrains);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
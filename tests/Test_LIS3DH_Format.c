@@ -0,0 +1,70 @@
+/*
+* This file includes the tests of the data format
+* descriptors of the LIS3DH.
+*/
+
+#include "Test.h"
+#include "LIS3DH_Profiles.h"
+
+static void Test_Descriptors(void)
+{
+    // Sensitivity in mg/digit, datasheet table 4
+    static const uint8_t sensitivity[LIS3DH_FORMAT_MODES][LIS3DH_FORMAT_RANGES] = {
+        {16, 32, 64, 192},
+        {4, 8, 16, 48},
+        {1, 2, 4, 12},
+    };
+    static const uint8_t bits[LIS3DH_FORMAT_MODES] = {8, 10, 12};
+
+    for (uint8_t mode = 0; mode < LIS3DH_FORMAT_MODES; mode++)
+    {
+        for (uint8_t fsr = 0; fsr < LIS3DH_FORMAT_RANGES; fsr++)
+        {
+            const LIS3DH_Format* format = LIS3DH_Format_Get(mode, fsr);
+            TEST_CHECK(format->bits == bits[mode]);
+            TEST_CHECK(format->bits + format->shift == 16);
+            TEST_CHECK(format->mg_per_digit == sensitivity[mode][fsr]);
+
+            // The ADC has 10 bits, 8 in low-power mode
+            TEST_CHECK(format->adc_shift == (mode == LIS3DH_MODE_LOW_POWER ? 8 : 6));
+        }
+    }
+
+    LIS3DH_Profile profile = {.mode = LIS3DH_MODE_NORMAL, .fsr = LIS3DH_FSR_8G};
+    TEST_CHECK(LIS3DH_Profile_Format(&profile) == &LIS3DH_Formats[LIS3DH_MODE_NORMAL][LIS3DH_FSR_8G]);
+}
+
+static void Test_Decode(void)
+{
+    const LIS3DH_Format* high_resolution = LIS3DH_Format_Get(LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FSR_2G);
+    const LIS3DH_Format* normal = LIS3DH_Format_Get(LIS3DH_MODE_NORMAL, LIS3DH_FSR_2G);
+    const LIS3DH_Format* low_power = LIS3DH_Format_Get(LIS3DH_MODE_LOW_POWER, LIS3DH_FSR_16G);
+
+    // 1 g in high resolution mode, the unused low bits are dropped
+    TEST_CHECK(LIS3DH_Format_Align(high_resolution, 0x400F) == 1024);
+    TEST_CHECK(LIS3DH_Format_ToMilliG(high_resolution, 0x4000) == 1024);
+
+    // The sign is kept by the arithmetic shift
+    TEST_CHECK(LIS3DH_Format_ToMilliG(normal, (int16_t) 0xFFC0) == -4);
+    TEST_CHECK(LIS3DH_Format_ToMilliG(normal, (int16_t) 0x8000) == -512 * 4);
+    TEST_CHECK(LIS3DH_Format_ToMilliG(low_power, 0x7F00) == 127 * 192);
+
+    // ADC output, 10 bits in high resolution mode
+    TEST_CHECK(LIS3DH_Format_AlignAdc(high_resolution, (int16_t) 0x8000) == -512);
+    TEST_CHECK(LIS3DH_Format_AlignAdc(low_power, (int16_t) 0xFF00) == -1);
+
+    // 1000 mg is 9806 mm/s^2, 40165000 / 4096 truncated
+    TEST_CHECK(LIS3DH_Format_ToMmPerS2(high_resolution, 1000 << 4) == 9805);
+    TEST_CHECK(LIS3DH_Format_ToMmPerS2(high_resolution, -1000 * 16) == -9805);
+    TEST_CHECK(LIS3DH_Format_ToMmPerS2(high_resolution, 0) == 0);
+    TEST_CHECK(LIS3DH_Format_ToMmPerS2(high_resolution, -1 * 16) == -9);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_Descriptors);
+    TEST_RUN(Test_Decode);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,114 @@
+/*
+* This file includes the tests of the configuration
+* profiles against a simulated LIS3DH.
+*/
+
+#include "Test.h"
+#include "I2C_Simulator.h"
+#include "LIS3DH_Profiles.h"
+#include "LIS3DH_Registers.h"
+
+#define DEVICE_A 0x18
+
+static I2C_SimulatorDevice* device;
+static LIS3DH_RegisterCache cache;
+
+static void Setup(void)
+{
+    I2C_Simulator_Reset();
+    I2C_Simulator_SetLatency(1);
+    device = I2C_Simulator_AddDevice(DEVICE_A);
+    TEST_CHECK(LIS3DH_Cache_Init(&cache, DEVICE_A) == NO_ERROR);
+}
+
+static void Test_Encode(void)
+{
+    LIS3DH_RegisterImage image;
+    LIS3DH_Profile_Encode(&LIS3DH_Profiles[LIS3DH_PROFILE_HIGH_RESOLUTION_100HZ_4G], &image);
+    TEST_CHECK(image.config[LIS3DH_CTRL_REG1 - LIS3DH_CONFIG_FIRST] == 0x57);
+    TEST_CHECK(image.config[LIS3DH_CTRL_REG3 - LIS3DH_CONFIG_FIRST] == LIS3DH_CTRL_REG3_I1_ZYXDA);
+    TEST_CHECK(image.config[LIS3DH_CTRL_REG4 - LIS3DH_CONFIG_FIRST] == 0x98);
+    TEST_CHECK(image.config[LIS3DH_CTRL_REG5 - LIS3DH_CONFIG_FIRST] == 0x00);
+    TEST_CHECK(image.fifo_ctrl == 0x00);
+
+    LIS3DH_Profile_Encode(&LIS3DH_Profiles[LIS3DH_PROFILE_LOW_POWER_5376HZ_4G], &image);
+    TEST_CHECK(image.config[LIS3DH_CTRL_REG1 - LIS3DH_CONFIG_FIRST] == 0x9F);
+    TEST_CHECK(image.config[LIS3DH_CTRL_REG4 - LIS3DH_CONFIG_FIRST] == 0x90);
+    TEST_CHECK(image.config[LIS3DH_CTRL_REG5 - LIS3DH_CONFIG_FIRST] == LIS3DH_CTRL_REG5_FIFO_EN);
+    TEST_CHECK(image.fifo_ctrl == ((LIS3DH_FIFO_STREAM << LIS3DH_FIFO_CTRL_FM_SHIFT) | 24));
+
+    LIS3DH_Profile_Encode(&LIS3DH_Profiles[LIS3DH_PROFILE_NORMAL_50HZ_ADC], &image);
+    TEST_CHECK(image.config[LIS3DH_TEMP_CFG_REG - LIS3DH_CONFIG_FIRST] ==
+               (LIS3DH_TEMP_CFG_ADC_EN | LIS3DH_TEMP_CFG_TEMP_EN));
+}
+
+static void Test_ApplyEveryProfile(void)
+{
+    Setup();
+    for (uint8_t p = 0; p < LIS3DH_PROFILE_COUNT; p++)
+    {
+        LIS3DH_RegisterImage image;
+        LIS3DH_Profile_Encode(&LIS3DH_Profiles[p], &image);
+        TEST_CHECK(LIS3DH_Profile_Apply(&cache, &LIS3DH_Profiles[p]) == NO_ERROR);
+        for (uint8_t i = 0; i < LIS3DH_CONFIG_SIZE; i++)
+        {
+            TEST_CHECK(device->registers[LIS3DH_CONFIG_FIRST + i] == image.config[i]);
+        }
+        TEST_CHECK(device->registers[LIS3DH_FIFO_CTRL_REG] == image.fifo_ctrl);
+        TEST_CHECK(LIS3DH_Profile_Verify(DEVICE_A, &image) == NO_ERROR);
+    }
+}
+
+static void Test_ApplyWritesOnlyChanges(void)
+{
+    Setup();
+    const LIS3DH_Profile* profile = &LIS3DH_Profiles[LIS3DH_PROFILE_STREAM_400HZ_4G];
+    TEST_CHECK(LIS3DH_Profile_Apply(&cache, profile) == NO_ERROR);
+    uint16_t writes = device->writes;
+
+    // The same profile again only costs the read-back
+    TEST_CHECK(LIS3DH_Profile_Apply(&cache, profile) == NO_ERROR);
+    TEST_CHECK(device->writes == writes);
+}
+
+static void Test_VerifyDetectsMismatch(void)
+{
+    Setup();
+    LIS3DH_RegisterImage image;
+    LIS3DH_Profile_Encode(&LIS3DH_Profiles[LIS3DH_PROFILE_HIGH_RESOLUTION_100HZ_4G], &image);
+    TEST_CHECK(LIS3DH_Profile_Apply(&cache, &LIS3DH_Profiles[LIS3DH_PROFILE_HIGH_RESOLUTION_100HZ_4G]) == NO_ERROR);
+
+    device->registers[LIS3DH_CTRL_REG4] ^= LIS3DH_CTRL_REG4_HR;
+    TEST_CHECK(LIS3DH_Profile_Verify(DEVICE_A, &image) == ERROR);
+    device->registers[LIS3DH_CTRL_REG4] ^= LIS3DH_CTRL_REG4_HR;
+    TEST_CHECK(LIS3DH_Profile_Verify(DEVICE_A, &image) == NO_ERROR);
+
+    // A FIFO mode left behind is caught even when the image bypasses the FIFO
+    device->registers[LIS3DH_FIFO_CTRL_REG] = LIS3DH_FIFO_STREAM << LIS3DH_FIFO_CTRL_FM_SHIFT;
+    TEST_CHECK(LIS3DH_Profile_Verify(DEVICE_A, &image) == ERROR);
+
+    // An absent device is reported by the bus
+    TEST_CHECK(LIS3DH_Profile_Verify(0x1A, &image) == ERROR_ADDRESS_NAK);
+}
+
+static void Test_SwitchBackToBypass(void)
+{
+    Setup();
+    TEST_CHECK(LIS3DH_Profile_Apply(&cache, &LIS3DH_Profiles[LIS3DH_PROFILE_STREAM_400HZ_4G]) == NO_ERROR);
+    TEST_CHECK(device->registers[LIS3DH_FIFO_CTRL_REG] != 0x00);
+    TEST_CHECK(LIS3DH_Profile_Apply(&cache, &LIS3DH_Profiles[LIS3DH_PROFILE_NORMAL_100HZ_2G]) == NO_ERROR);
+    TEST_CHECK(device->registers[LIS3DH_FIFO_CTRL_REG] == 0x00);
+    TEST_CHECK(device->registers[LIS3DH_CTRL_REG5] == 0x00);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_Encode);
+    TEST_RUN(Test_ApplyEveryProfile);
+    TEST_RUN(Test_ApplyWritesOnlyChanges);
+    TEST_RUN(Test_VerifyDetectsMismatch);
+    TEST_RUN(Test_SwitchBackToBypass);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
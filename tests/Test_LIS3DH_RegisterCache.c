@@ -0,0 +1,163 @@
+/*
+* This file includes the tests of the shadow copy of the
+* LIS3DH configuration registers on the simulated bus.
+*/
+
+#include "Test.h"
+#include "I2C_Simulator.h"
+#include "LIS3DH_RegisterCache.h"
+
+#define DEVICE_A 0x18
+
+static I2C_SimulatorDevice* device;
+static LIS3DH_RegisterCache cache;
+
+/**
+*   \brief Registers changed before a flush and the bus traffic expected for them.
+*/
+typedef struct {
+    uint8_t registers[LIS3DH_CACHE_SIZE];   ///< Registers to be changed, 0 ends the list
+    uint8_t bursts;                         ///< Write operations on the bus
+    uint8_t bytes;                          ///< Register values written
+} DirtySet;
+
+static const DirtySet DirtySets[] = {
+    // Clean registers between two dirty ones go in the same burst
+    {{LIS3DH_CTRL_REG1, LIS3DH_CTRL_REG4}, 1, 4},
+    {{LIS3DH_TEMP_CFG_REG, LIS3DH_CTRL_REG6}, 1, 7},
+    {{LIS3DH_INT1_THS, LIS3DH_INT2_CFG}, 1, 3},
+
+    // Registers that are not cached split the bursts
+    {{LIS3DH_CTRL_REG1, LIS3DH_FIFO_CTRL_REG}, 2, 2},
+    {{LIS3DH_CTRL_REG6, LIS3DH_FIFO_CTRL_REG, LIS3DH_INT1_CFG}, 3, 3},
+    {{LIS3DH_INT1_THS, LIS3DH_INT2_CFG, LIS3DH_INT2_DURATION}, 2, 4},
+
+    // Every register: one burst per group of consecutive cached registers
+    {{LIS3DH_TEMP_CFG_REG, LIS3DH_CTRL_REG1, LIS3DH_CTRL_REG2, LIS3DH_CTRL_REG3,
+      LIS3DH_CTRL_REG4, LIS3DH_CTRL_REG5, LIS3DH_CTRL_REG6, LIS3DH_FIFO_CTRL_REG,
+      LIS3DH_INT1_CFG, LIS3DH_INT1_THS, LIS3DH_INT1_DURATION, LIS3DH_INT2_CFG,
+      LIS3DH_INT2_THS, LIS3DH_INT2_DURATION}, 5, 14},
+};
+
+static void Setup(void)
+{
+    I2C_Simulator_Reset();
+    I2C_Simulator_SetLatency(1);
+    device = I2C_Simulator_AddDevice(DEVICE_A);
+    TEST_CHECK(LIS3DH_Cache_Init(&cache, DEVICE_A) == NO_ERROR);
+}
+
+/**
+*   \brief Check that the device holds the values of the cache.
+*/
+static void CheckDevice(void)
+{
+    for (uint8_t i = 0; i < LIS3DH_CACHE_SIZE; i++)
+    {
+        uint8_t value;
+        if (LIS3DH_Cache_Read(&cache, LIS3DH_CACHE_FIRST + i, &value) == NO_ERROR)
+        {
+            TEST_CHECK(device->registers[LIS3DH_CACHE_FIRST + i] == value);
+        }
+    }
+}
+
+static void Test_InitReadsEveryRegister(void)
+{
+    I2C_Simulator_Reset();
+    I2C_Simulator_SetLatency(1);
+    device = I2C_Simulator_AddDevice(DEVICE_A);
+    for (uint8_t i = 0; i < LIS3DH_CACHE_SIZE; i++)
+    {
+        device->registers[LIS3DH_CACHE_FIRST + i] = 0x80 + i;
+    }
+
+    // One read for each group of consecutive cached registers
+    TEST_CHECK(LIS3DH_Cache_Init(&cache, DEVICE_A) == NO_ERROR);
+    TEST_CHECK(device->reads == 5);
+    TEST_CHECK(cache.dirty == 0);
+    CheckDevice();
+}
+
+static void Test_CleanCacheIsNotSent(void)
+{
+    Setup();
+    uint16_t operations = I2C_Simulator_GetOperationCount();
+    uint8_t bursts = 0xFF;
+    TEST_CHECK(LIS3DH_Cache_Flush(&cache, &bursts) == NO_ERROR);
+    TEST_CHECK(bursts == 0);
+
+    // Writing the value a register already holds does not make it dirty
+    TEST_CHECK(LIS3DH_Cache_Write(&cache, LIS3DH_CTRL_REG1, LIS3DH_CTRL_REG1_DEFAULT) == NO_ERROR);
+    TEST_CHECK(cache.dirty == 0);
+    TEST_CHECK(LIS3DH_Cache_Flush(&cache, &bursts) == NO_ERROR);
+    TEST_CHECK(bursts == 0);
+    TEST_CHECK(I2C_Simulator_GetOperationCount() == operations);
+    TEST_CHECK(device->writes == 0);
+
+    // Registers outside the cache are refused
+    TEST_CHECK(LIS3DH_Cache_Write(&cache, LIS3DH_STATUS_REG, 0x01) == ERROR);
+    TEST_CHECK(LIS3DH_Cache_Write(&cache, LIS3DH_INT1_SRC, 0x01) == ERROR);
+    TEST_CHECK(cache.dirty == 0);
+}
+
+static void Test_ScatteredDirtySets(void)
+{
+    for (uint8_t i = 0; i < sizeof(DirtySets) / sizeof(DirtySets[0]); i++)
+    {
+        const DirtySet* set = &DirtySets[i];
+        Setup();
+        for (uint8_t j = 0; j < LIS3DH_CACHE_SIZE && set->registers[j] != 0; j++)
+        {
+            uint8_t value;
+            TEST_CHECK(LIS3DH_Cache_Read(&cache, set->registers[j], &value) == NO_ERROR);
+            TEST_CHECK(LIS3DH_Cache_Write(&cache, set->registers[j], value ^ 0x5A) == NO_ERROR);
+        }
+
+        uint16_t operations = I2C_Simulator_GetOperationCount();
+        uint8_t bursts = 0;
+        TEST_CHECK(LIS3DH_Cache_Flush(&cache, &bursts) == NO_ERROR);
+        TEST_CHECK(bursts == set->bursts);
+        TEST_CHECK(I2C_Simulator_GetOperationCount() - operations == set->bursts);
+        TEST_CHECK(device->writes == set->bursts);
+        TEST_CHECK(device->bytes_written == set->bytes);
+        TEST_CHECK(cache.dirty == 0);
+
+        // The clean registers inside a burst are written with their own values
+        CheckDevice();
+    }
+}
+
+static void Test_FailedFlushIsRepeated(void)
+{
+    Setup();
+    TEST_CHECK(LIS3DH_Cache_Write(&cache, LIS3DH_CTRL_REG1, 0x57) == NO_ERROR);
+    TEST_CHECK(LIS3DH_Cache_Write(&cache, LIS3DH_FIFO_CTRL_REG, 0x98) == NO_ERROR);
+    uint32_t dirty = cache.dirty;
+
+    // The first burst fails: the flush stops there, everything stays dirty
+    uint8_t bursts = 0;
+    I2C_Simulator_InjectFault(I2C_SIMULATOR_DATA_NAK, 1);
+    TEST_CHECK(LIS3DH_Cache_Flush(&cache, &bursts) == ERROR_DATA_NAK);
+    TEST_CHECK(bursts == 1);
+    TEST_CHECK(cache.dirty == dirty);
+    TEST_CHECK(device->bytes_written == 0);
+
+    // The next flush sends both groups
+    TEST_CHECK(LIS3DH_Cache_Flush(&cache, &bursts) == NO_ERROR);
+    TEST_CHECK(bursts == 2);
+    TEST_CHECK(device->bytes_written == 2);
+    TEST_CHECK(cache.dirty == 0);
+    CheckDevice();
+}
+
+int main(void)
+{
+    TEST_RUN(Test_InitReadsEveryRegister);
+    TEST_RUN(Test_CleanCacheIsNotSent);
+    TEST_RUN(Test_ScatteredDirtySets);
+    TEST_RUN(Test_FailedFlushIsRepeated);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
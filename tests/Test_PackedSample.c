@@ -0,0 +1,158 @@
+/*
+* This file includes the tests of the bit-packed
+* samples and of the stream decoder.
+*/
+
+#include <string.h>
+#include "Test.h"
+#include "PackedSample.h"
+#include "LIS3DH_Profiles.h"
+
+/**
+*   \brief Left-justified values covering the range of each format.
+*/
+static const int16_t values[] = {0, 16, -16, 64, -64, 256, -256, 0x7FF0, -0x8000, 0x1230, -0x4560};
+
+static void Test_RoundTrip(void)
+{
+    for (uint8_t mode = 0; mode < LIS3DH_FORMAT_MODES; mode++)
+    {
+        const LIS3DH_Format* format = LIS3DH_Format_Get(mode, 0);
+        uint8_t count = sizeof(values) / sizeof(values[0]);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            int16_t raw[3] = {values[i], values[(i + 1) % count], values[(i + 5) % count]};
+            uint8_t packet[PACKED_SAMPLE_MAX_SIZE];
+            int16_t xyz[3];
+            uint8_t size = PackedSample_Pack(format, raw, packet);
+            TEST_CHECK(size == PackedSample_Size(format));
+            TEST_CHECK(packet[0] >= 0x80 && packet[0] <= 0xBF);
+            TEST_CHECK(PackedSample_Unpack(format->bits, packet, xyz) == size);
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                TEST_CHECK(xyz[axis] == LIS3DH_Format_Align(format, raw[axis]));
+            }
+        }
+    }
+
+    // A 12-bit marker is not taken for a 10-bit sample and vice versa
+    uint8_t packet[PACKED_SAMPLE_MAX_SIZE] = {0x00};
+    int16_t xyz[3];
+    TEST_CHECK(PackedSample_Unpack(12, packet, xyz) == 0);
+    TEST_CHECK(PackedSample_Unpack(10, packet, xyz) == 0);
+    packet[0] = PACKED_SAMPLE_MARKER_10 | 0x10;
+    TEST_CHECK(PackedSample_Unpack(12, packet, xyz) == 0);
+}
+
+/**
+*   \brief Feed a buffer to the decoder, saving the decoded samples.
+*/
+static uint8_t Feed(PackedDecoder* decoder, const uint8_t* stream, uint16_t length, int16_t (*samples)[3])
+{
+    uint8_t count = 0;
+    for (uint16_t i = 0; i < length; i++)
+    {
+        if (PackedSample_Decode(decoder, stream[i], samples[count]))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+static void Test_DecodeStream(void)
+{
+    const LIS3DH_Format* high_resolution = LIS3DH_Format_Get(LIS3DH_MODE_HIGH_RESOLUTION, LIS3DH_FSR_4G);
+    const LIS3DH_Format* normal = LIS3DH_Format_Get(LIS3DH_MODE_NORMAL, LIS3DH_FSR_2G);
+    uint8_t stream[128];
+    uint16_t length = 0;
+
+    // A receiver joining late sees the end of a sample first
+    stream[length++] = 0x34;
+    stream[length++] = 0xA5;
+    stream[length++] = 0x12;
+
+    // A header with a broken footer is dropped
+    PackedSample_StreamHeader(high_resolution, 100, &stream[length]);
+    stream[length + PACKED_STREAM_HEADER_SIZE - 1] = 0x00;
+    length += PACKED_STREAM_HEADER_SIZE;
+
+    PackedSample_StreamHeader(high_resolution, 100, &stream[length]);
+    length += PACKED_STREAM_HEADER_SIZE;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        int16_t raw[3] = {values[i], values[i + 1], values[i + 2]};
+        length += PackedSample_Pack(high_resolution, raw, &stream[length]);
+    }
+
+    // The format changes with the next header
+    PackedSample_StreamHeader(normal, 400, &stream[length]);
+    length += PACKED_STREAM_HEADER_SIZE;
+    for (uint8_t i = 4; i < 6; i++)
+    {
+        int16_t raw[3] = {values[i], values[i + 1], values[i + 2]};
+        length += PackedSample_Pack(normal, raw, &stream[length]);
+    }
+
+    PackedDecoder decoder;
+    int16_t samples[8][3];
+    PackedSample_InitDecoder(&decoder);
+    TEST_CHECK(Feed(&decoder, stream, length, samples) == 6);
+    TEST_CHECK(decoder.errors == 1);
+    TEST_CHECK(decoder.bits == 10 && decoder.mg_per_digit == 4);
+    TEST_CHECK(decoder.mm_s2_q12 == normal->mm_s2_q12 && decoder.odr_hz == 400);
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        const LIS3DH_Format* format = (i < 4) ? high_resolution : normal;
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            TEST_CHECK(samples[i][axis] == LIS3DH_Format_Align(format, values[i + axis]));
+        }
+    }
+
+    // Before the first header nothing is decoded
+    PackedSample_InitDecoder(&decoder);
+    uint16_t first_header = 3 + PACKED_STREAM_HEADER_SIZE;
+    TEST_CHECK(Feed(&decoder, stream, first_header, samples) == 0);
+    TEST_CHECK(decoder.bits == 0);
+}
+
+static void Test_LostBytes(void)
+{
+    const LIS3DH_Format* format = LIS3DH_Format_Get(LIS3DH_MODE_NORMAL, LIS3DH_FSR_2G);
+    uint8_t stream[96];
+    uint16_t length = 0;
+    PackedSample_StreamHeader(format, 100, stream);
+    length += PACKED_STREAM_HEADER_SIZE;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        int16_t raw[3] = {values[i], values[i + 1], values[i + 2]};
+        length += PackedSample_Pack(format, raw, &stream[length]);
+    }
+
+    // Without the first byte of a sample, the decoder skips to the next marker
+    uint8_t damaged[96];
+    uint16_t cut = PACKED_STREAM_HEADER_SIZE + 2 * PACKED_SAMPLE_SIZE_10;
+    memcpy(damaged, stream, cut);
+    memcpy(&damaged[cut], &stream[cut + 1], length - cut - 1);
+
+    PackedDecoder decoder;
+    int16_t samples[8][3];
+    PackedSample_InitDecoder(&decoder);
+    uint8_t count = Feed(&decoder, damaged, length - 1, samples);
+    TEST_CHECK(count >= 5 && count < 8);
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        TEST_CHECK(samples[count - 1][axis] == LIS3DH_Format_Align(format, values[7 + axis]));
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(Test_RoundTrip);
+    TEST_RUN(Test_DecodeStream);
+    TEST_RUN(Test_LostBytes);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
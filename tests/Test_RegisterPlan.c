@@ -0,0 +1,158 @@
+/*
+* This file includes the tests of the merge of the
+* register ranges into auto-increment bursts.
+*/
+
+#include "Test.h"
+#include "I2C_Simulator.h"
+#include "RegisterPlan.h"
+#include "LIS3DH_Registers.h"
+
+#define DEVICE_A 0x18
+
+static void Test_StatusAndOutputMerge(void)
+{
+    RegisterPlan plan;
+    RegisterPlan_Clear(&plan);
+    TEST_CHECK(RegisterPlan_Add(&plan, LIS3DH_OUT_X_L, 6) == NO_ERROR);
+    TEST_CHECK(RegisterPlan_Add(&plan, LIS3DH_STATUS_REG, 1) == NO_ERROR);
+    TEST_CHECK(RegisterPlan_BusBytes(&plan) == 13);
+
+    RegisterPlan_Coalesce(&plan, REGISTER_PLAN_DEFAULT_GAP);
+    TEST_CHECK(plan.burst_count == 1);
+    TEST_CHECK(plan.bursts[0].register_address == LIS3DH_STATUS_REG);
+    TEST_CHECK(plan.bursts[0].register_count == 7);
+    TEST_CHECK(RegisterPlan_BusBytes(&plan) == 10);
+}
+
+static void Test_GapLimit(void)
+{
+    RegisterPlan plan;
+
+    // Three unused registers are read to save a burst, four are not
+    RegisterPlan_Clear(&plan);
+    RegisterPlan_Add(&plan, 0x24, 1);
+    RegisterPlan_Add(&plan, 0x20, 1);
+    RegisterPlan_Coalesce(&plan, 3);
+    TEST_CHECK(plan.burst_count == 1);
+    TEST_CHECK(plan.bursts[0].register_address == 0x20 && plan.bursts[0].register_count == 5);
+
+    RegisterPlan_Clear(&plan);
+    RegisterPlan_Add(&plan, 0x25, 1);
+    RegisterPlan_Add(&plan, 0x20, 1);
+    RegisterPlan_Coalesce(&plan, 3);
+    TEST_CHECK(plan.burst_count == 2);
+    TEST_CHECK(plan.bursts[0].register_address == 0x20 && plan.bursts[1].register_address == 0x25);
+
+    // Without a gap only touching or overlapping ranges are merged
+    RegisterPlan_Clear(&plan);
+    RegisterPlan_Add(&plan, 0x30, 2);
+    RegisterPlan_Add(&plan, 0x20, 8);
+    RegisterPlan_Add(&plan, 0x22, 2);
+    RegisterPlan_Add(&plan, 0x28, 2);
+    RegisterPlan_Coalesce(&plan, 0);
+    TEST_CHECK(plan.burst_count == 2);
+    TEST_CHECK(plan.bursts[0].register_address == 0x20 && plan.bursts[0].register_count == 10);
+    TEST_CHECK(plan.bursts[1].register_address == 0x30 && plan.bursts[1].register_count == 2);
+}
+
+static void Test_AddRejects(void)
+{
+    RegisterPlan plan;
+    RegisterPlan_Clear(&plan);
+    TEST_CHECK(RegisterPlan_Add(&plan, 0x20, 0) == ERROR);
+    TEST_CHECK(RegisterPlan_Add(&plan, 0x3F, 2) == ERROR);
+    for (uint8_t i = 0; i < REGISTER_PLAN_MAX_BURSTS; i++)
+    {
+        TEST_CHECK(RegisterPlan_Add(&plan, 2 * i, 1) == NO_ERROR);
+    }
+    TEST_CHECK(RegisterPlan_Add(&plan, 0x30, 1) == ERROR);
+}
+
+static void Test_ExecuteAndSubmit(void)
+{
+    I2C_Simulator_Reset();
+    I2C_SimulatorDevice* device = I2C_Simulator_AddDevice(DEVICE_A);
+    I2C_Simulator_SetLatency(2);
+    for (uint8_t i = 0; i < 7; i++)
+    {
+        device->registers[LIS3DH_STATUS_REG + i] = 0x50 + i;
+    }
+    device->registers[LIS3DH_INT1_SRC] = 0x42;
+
+    RegisterPlan plan;
+    RegisterPlan_Clear(&plan);
+    RegisterPlan_Add(&plan, LIS3DH_STATUS_REG, 7);
+    RegisterPlan_Add(&plan, LIS3DH_INT1_SRC, 1);
+    RegisterPlan_Coalesce(&plan, 0);
+    TEST_CHECK(plan.burst_count == 2);
+
+    uint8_t image[REGISTER_PLAN_IMAGE_SIZE] = {0};
+    TEST_CHECK(RegisterPlan_Execute(&plan, DEVICE_A, image) == NO_ERROR);
+    TEST_CHECK(image[LIS3DH_STATUS_REG] == 0x50 && image[LIS3DH_OUT_Z_L + 1] == 0x56);
+    TEST_CHECK(image[LIS3DH_INT1_SRC] == 0x42);
+
+    // The same bursts through the queue
+    uint8_t queued[REGISTER_PLAN_IMAGE_SIZE] = {0};
+    I2C_Transfer transfers[REGISTER_PLAN_MAX_BURSTS] = {{0}};
+    ErrorCode error = ERROR;
+    TEST_CHECK(RegisterPlan_Submit(&plan, DEVICE_A, queued, transfers) == NO_ERROR);
+    TEST_CHECK(!RegisterPlan_IsComplete(&plan, transfers, &error));
+    while (I2C_Peripheral_IsBusy())
+    {
+        I2C_Peripheral_ProcessTransfers();
+    }
+    TEST_CHECK(RegisterPlan_IsComplete(&plan, transfers, &error));
+    TEST_CHECK(error == NO_ERROR);
+    for (uint8_t i = 0; i < REGISTER_PLAN_IMAGE_SIZE; i++)
+    {
+        TEST_CHECK(queued[i] == image[i]);
+    }
+}
+
+static void Test_SubmitPartialFailure(void)
+{
+    I2C_Simulator_Reset();
+    I2C_Simulator_AddDevice(DEVICE_A);
+    I2C_Simulator_SetLatency(2);
+
+    RegisterPlan plan;
+    RegisterPlan_Clear(&plan);
+    RegisterPlan_Add(&plan, LIS3DH_STATUS_REG, 7);
+    RegisterPlan_Add(&plan, LIS3DH_INT1_SRC, 1);
+    RegisterPlan_Coalesce(&plan, 0);
+
+    // The second descriptor is still in use, so the queue refuses it
+    uint8_t image[REGISTER_PLAN_IMAGE_SIZE];
+    I2C_Transfer transfers[REGISTER_PLAN_MAX_BURSTS] = {{0}};
+    ErrorCode error = NO_ERROR;
+    transfers[1].state = I2C_TRANSFER_PENDING;
+    TEST_CHECK(RegisterPlan_Submit(&plan, DEVICE_A, image, transfers) == NO_ERROR);
+    TEST_CHECK(transfers[1].state == I2C_TRANSFER_DONE && transfers[1].error == ERROR);
+    TEST_CHECK(!RegisterPlan_IsComplete(&plan, transfers, &error));
+    while (I2C_Peripheral_IsBusy())
+    {
+        I2C_Peripheral_ProcessTransfers();
+    }
+    TEST_CHECK(RegisterPlan_IsComplete(&plan, transfers, &error));
+    TEST_CHECK(error == ERROR);
+
+    // Nothing queued: the error is returned and the plan is complete
+    transfers[0].state = I2C_TRANSFER_PENDING;
+    TEST_CHECK(RegisterPlan_Submit(&plan, DEVICE_A, image, transfers) == ERROR);
+    TEST_CHECK(!I2C_Peripheral_IsBusy());
+    TEST_CHECK(RegisterPlan_IsComplete(&plan, transfers, &error));
+    TEST_CHECK(error == ERROR);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_StatusAndOutputMerge);
+    TEST_RUN(Test_GapLimit);
+    TEST_RUN(Test_AddRejects);
+    TEST_RUN(Test_ExecuteAndSubmit);
+    TEST_RUN(Test_SubmitPartialFailure);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,182 @@
+/*
+* This file includes the tests of the sampling of
+* several LIS3DH in the same tick, on the simulated bus.
+*/
+
+#include "Test.h"
+#include "I2C_Simulator.h"
+#include "I2C_Interface.h"
+#include "SampleScheduler.h"
+#include "LIS3DH_Registers.h"
+
+#define DEVICE_COUNT 4
+#define LATENCY 3
+
+static const uint8_t addresses[DEVICE_COUNT] = {0x18, 0x19, 0x1A, 0x1B};
+static I2C_SimulatorDevice* simulated[DEVICE_COUNT];
+static LIS3DH_Device devices[DEVICE_COUNT];
+static SampleScheduler scheduler;
+
+/**
+*   \brief Connect the devices, each with its own sample and new data on all the axes.
+*/
+static void Setup(uint8_t device_count)
+{
+    I2C_Simulator_Reset();
+    I2C_Peripheral_ClearErrorCounts();
+    I2C_Simulator_SetLatency(LATENCY);
+    SampleScheduler_Init(&scheduler);
+    for (uint8_t i = 0; i < device_count; i++)
+    {
+        simulated[i] = I2C_Simulator_AddDevice(addresses[i]);
+        simulated[i]->registers[LIS3DH_STATUS_REG] = LIS3DH_STATUS_ZYXDA;
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            int16_t value = (int16_t)(1000 * (i + 1) + axis);
+            simulated[i]->registers[LIS3DH_OUT_X_L + 2 * axis] = (uint8_t)(value & 0xFF);
+            simulated[i]->registers[LIS3DH_OUT_X_L + 2 * axis + 1] = (uint8_t)(value >> 8);
+        }
+        LIS3DH_Device_Init(&devices[i], addresses[i], &LIS3DH_Profiles[LIS3DH_PROFILE_NORMAL_100HZ_2G]);
+        TEST_CHECK(SampleScheduler_AddDevice(&scheduler, &devices[i]) == NO_ERROR);
+    }
+}
+
+/**
+*   \brief Run a round as the main loop does.
+*
+*   \retval Number of passes of the loop before the round is completed.
+*/
+static uint16_t RunRound(void)
+{
+    uint16_t passes = 0;
+    TEST_CHECK(SampleScheduler_StartRound(&scheduler) == NO_ERROR);
+    do
+    {
+        I2C_Peripheral_ProcessTransfers();
+        passes++;
+    } while (!SampleScheduler_Poll(&scheduler) && passes < 1000);
+    TEST_CHECK(!scheduler.active);
+    return passes;
+}
+
+static void Test_RoundReadsAllDevices(void)
+{
+    Setup(DEVICE_COUNT);
+    RunRound();
+    TEST_CHECK(scheduler.round_count == 1);
+    TEST_CHECK(scheduler.fresh_mask == (1u << DEVICE_COUNT) - 1);
+
+    // Status and output registers of each device come with one burst
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++)
+    {
+        TEST_CHECK(simulated[i]->reads == 1);
+    }
+    TEST_CHECK(SampleScheduler_BusBytes(&scheduler) == DEVICE_COUNT * RegisterPlan_BusBytes(&devices[0].plan));
+
+    uint8_t packet[SAMPLE_SCHEDULER_PACKET_SIZE(DEVICE_COUNT)];
+    TEST_CHECK(SampleScheduler_Pack(&scheduler, packet) == sizeof(packet));
+    TEST_CHECK(packet[0] == SAMPLE_SCHEDULER_HEADER);
+    TEST_CHECK(packet[1] == (1u << DEVICE_COUNT) - 1);
+    for (uint8_t i = 0; i < DEVICE_COUNT; i++)
+    {
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            const uint8_t* value = &packet[2 + 6 * i + 2 * axis];
+            TEST_CHECK((int16_t)(value[0] | (value[1] << 8)) == 1000 * (i + 1) + axis);
+        }
+    }
+    TEST_CHECK(packet[sizeof(packet) - 1] == SAMPLE_SCHEDULER_FOOTER);
+}
+
+static void Test_RoundTimeAndSkew(void)
+{
+    // A single device has no skew, its round is one burst on the bus
+    Setup(1);
+    RunRound();
+    uint32_t single = scheduler.round_cycles;
+    TEST_CHECK(single > 0);
+    TEST_CHECK(scheduler.skew_cycles == 0);
+
+    // The reads follow each other on the bus: each device adds the time
+    // of its burst to the round, the skew is the round after the first
+    // burst. A burst that follows another one starts with a status poll.
+    uint32_t burst = 0;
+    for (uint8_t count = 2; count <= DEVICE_COUNT; count++)
+    {
+        Setup(count);
+        RunRound();
+        printf("  %u devices: %lu cycles per round, %lu of skew\n", count,
+               (unsigned long) scheduler.round_cycles, (unsigned long) scheduler.skew_cycles);
+        if (count == 2)
+        {
+            burst = scheduler.round_cycles - single;
+            TEST_CHECK(burst == single + I2C_SIMULATOR_POLL_CYCLES);
+        }
+        TEST_CHECK(scheduler.round_cycles == single + (count - 1) * burst);
+        TEST_CHECK(scheduler.skew_cycles == scheduler.round_cycles - burst);
+        TEST_CHECK(scheduler.max_skew_cycles == scheduler.skew_cycles);
+    }
+
+    // A slower bus stretches both, the largest skew is kept
+    uint32_t skew = scheduler.skew_cycles;
+    I2C_Simulator_SetLatency(2 * LATENCY);
+    RunRound();
+    TEST_CHECK(scheduler.skew_cycles > skew);
+    I2C_Simulator_SetLatency(LATENCY);
+    RunRound();
+    TEST_CHECK(scheduler.skew_cycles == skew);
+    TEST_CHECK(scheduler.max_skew_cycles > skew);
+    TEST_CHECK(scheduler.round_count == 3);
+}
+
+static void Test_OneRoundAtATime(void)
+{
+    Setup(2);
+    TEST_CHECK(SampleScheduler_StartRound(&scheduler) == NO_ERROR);
+    TEST_CHECK(SampleScheduler_StartRound(&scheduler) == ERROR);
+    TEST_CHECK(!SampleScheduler_Poll(&scheduler));
+    while (!SampleScheduler_Poll(&scheduler))
+    {
+        I2C_Peripheral_ProcessTransfers();
+    }
+    TEST_CHECK(!SampleScheduler_Poll(&scheduler));
+    TEST_CHECK(scheduler.round_count == 1);
+
+    // No devices, no rounds
+    SampleScheduler_Init(&scheduler);
+    TEST_CHECK(SampleScheduler_StartRound(&scheduler) == ERROR);
+}
+
+static void Test_StaleAndFailedDevices(void)
+{
+    Setup(3);
+    RunRound();
+
+    // A device without new data and a device that does not answer close
+    // the round all the same, with their bit cleared
+    simulated[1]->registers[LIS3DH_STATUS_REG] = 0;
+    simulated[2]->address = 0;
+    simulated[0]->registers[LIS3DH_OUT_X_L] = 0x55;
+    RunRound();
+    TEST_CHECK(scheduler.round_count == 2);
+    TEST_CHECK(scheduler.fresh_mask == 0x01);
+    TEST_CHECK(devices[2].failure_count == 1);
+
+    // The failed device keeps the values of its last sample
+    uint8_t packet[SAMPLE_SCHEDULER_PACKET_SIZE(3)];
+    SampleScheduler_Pack(&scheduler, packet);
+    TEST_CHECK(packet[1] == 0x01);
+    TEST_CHECK(packet[2] == 0x55);
+    TEST_CHECK((int16_t)(packet[2 + 12] | (packet[2 + 13] << 8)) == 3000);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_RoundReadsAllDevices);
+    TEST_RUN(Test_RoundTimeAndSkew);
+    TEST_RUN(Test_OneRoundAtATime);
+    TEST_RUN(Test_StaleAndFailedDevices);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,217 @@
+/*
+* This file includes the tests of the Q15 FFT against
+* a direct DFT and of the spectrum packets.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Test.h"
+#include "Spectrum.h"
+#include "Decimator.h"
+#include "Frame.h"
+
+/**
+*   \brief Largest difference between the FFT and the DFT divided by the points.
+*/
+static double FftError(const int16_t* input, uint8_t log2_points)
+{
+    uint16_t points = 1 << log2_points;
+    int16_t data[2 * SPECTRUM_MAX_POINTS];
+    memcpy(data, input, 2 * points * sizeof(int16_t));
+    Spectrum_Fft(data, log2_points);
+
+    double error = 0;
+    for (uint16_t k = 0; k < points; k++)
+    {
+        double re = 0;
+        double im = 0;
+        for (uint16_t n = 0; n < points; n++)
+        {
+            double angle = -2 * M_PI * (double)((uint32_t) k * n % points) / points;
+            re += input[2*n] * cos(angle) - input[2*n+1] * sin(angle);
+            im += input[2*n] * sin(angle) + input[2*n+1] * cos(angle);
+        }
+        error = fmax(error, fabs(data[2*k] - re / points));
+        error = fmax(error, fabs(data[2*k+1] - im / points));
+    }
+    return error;
+}
+
+static void Test_FftAgainstDft(void)
+{
+    static int16_t input[2 * SPECTRUM_MAX_POINTS];
+    uint32_t seed = 7;
+    for (uint16_t i = 0; i < 2 * SPECTRUM_MAX_POINTS; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        input[i] = (int16_t)(seed >> 16);
+    }
+
+    // Full-scale noise, every size up to the largest
+    for (uint8_t log2_points = 1; log2_points <= SPECTRUM_MAX_LOG2; log2_points++)
+    {
+        // Each stage rounds the twiddle product and truncates the halving,
+        // about one LSB per stage at most
+        TEST_CHECK(FftError(input, log2_points) <= log2_points);
+    }
+
+    // Extreme values on the real part only, as the spectrum feeds it
+    for (uint16_t n = 0; n < SPECTRUM_MAX_POINTS; n++)
+    {
+        input[2*n] = (n & 3) ? INT16_MAX : INT16_MIN;
+        input[2*n+1] = 0;
+    }
+    TEST_CHECK(FftError(input, SPECTRUM_MIN_LOG2) <= SPECTRUM_MIN_LOG2);
+    TEST_CHECK(FftError(input, SPECTRUM_MAX_LOG2) <= SPECTRUM_MAX_LOG2);
+}
+
+static void Test_FftTone(void)
+{
+    // A full-scale cosine on bin 10 gives half its amplitude on bins 10 and N-10
+    int16_t data[2 * SPECTRUM_MAX_POINTS];
+    uint16_t points = SPECTRUM_MAX_POINTS;
+    for (uint16_t n = 0; n < points; n++)
+    {
+        data[2*n] = (int16_t) lround(32767 * cos(2 * M_PI * 10 * n / points));
+        data[2*n+1] = 0;
+    }
+    Spectrum_Fft(data, SPECTRUM_MAX_LOG2);
+    for (uint16_t k = 0; k < points; k++)
+    {
+        int16_t expected = (k == 10 || k == points - 10) ? 16384 : 0;
+        TEST_CHECK(abs(data[2*k] - expected) <= 2 && abs(data[2*k+1]) <= 2);
+    }
+}
+
+static void Test_FftTestSignal(void)
+{
+    // The transform of the boot test: the firmware compares its CRC with
+    // the one of this build
+    static int16_t data[2 * SPECTRUM_MAX_POINTS];
+    for (uint16_t n = 0; n < SPECTRUM_MAX_POINTS; n++)
+    {
+        int16_t xyz[3];
+        Decimator_TestSignal(n, xyz);
+        data[2*n] = xyz[0];
+        data[2*n+1] = xyz[1];
+    }
+    Spectrum_Fft(data, SPECTRUM_MAX_LOG2);
+    TEST_CHECK(Frame_Crc16(FRAME_CRC_INIT, (const uint8_t*) data, sizeof(data)) == SPECTRUM_TEST_CRC);
+}
+
+static uint16_t Get16(const uint8_t* data)
+{
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+/**
+*   \brief Fill a buffer with a full-scale sine on X at a bin, a smaller one on Y.
+*/
+static void PushTones(Spectrum* spectrum, uint8_t log2_points, uint16_t bin)
+{
+    uint16_t points = 1 << log2_points;
+    for (uint16_t n = 0; n < points; n++)
+    {
+        int16_t xyz[3] = {
+            (int16_t) lround(32767 * sin(2 * M_PI * bin * n / points)),
+            (int16_t) lround(8000 * sin(2 * M_PI * 3 * bin * n / points)),
+            1000
+        };
+        Spectrum_Push(spectrum, xyz);
+    }
+}
+
+static void Test_Bins(void)
+{
+    static Spectrum spectrum;
+    uint8_t packet[SPECTRUM_MAX_PACKET];
+    TEST_CHECK(Spectrum_Init(&spectrum, SPECTRUM_MIN_LOG2 - 1, 0, 100) == ERROR);
+    TEST_CHECK(Spectrum_Init(&spectrum, SPECTRUM_MAX_LOG2, SPECTRUM_MAX_PEAKS + 1, 100) == ERROR);
+    TEST_CHECK(Spectrum_Init(&spectrum, SPECTRUM_MAX_LOG2, 0, 400) == NO_ERROR);
+    TEST_CHECK(Spectrum_Process(&spectrum, packet) == 0);
+
+    PushTones(&spectrum, SPECTRUM_MAX_LOG2, 40);
+    uint16_t magnitudes[3][SPECTRUM_MAX_POINTS / 2];
+    uint16_t bytes = 0;
+    uint8_t packets = 0;
+    uint8_t length;
+    while ((length = Spectrum_Process(&spectrum, packet)) != 0)
+    {
+        TEST_CHECK(packet[0] == SPECTRUM_BINS_HEADER && packet[1] == 0);
+        TEST_CHECK(packet[3] == SPECTRUM_MAX_LOG2 && Get16(&packet[4]) == 400);
+        uint8_t axis = packet[2];
+        uint16_t first = Get16(&packet[6]);
+        uint8_t count = packet[8];
+        TEST_CHECK(axis < 3 && count == SPECTRUM_BINS_PER_PACKET);
+        TEST_CHECK(length == 10 + 2 * count && packet[length - 1] == 0xC0);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            magnitudes[axis][first + i] = Get16(&packet[9 + 2 * i]);
+        }
+        bytes += length;
+        packets++;
+    }
+    TEST_CHECK(packets == 3 * (SPECTRUM_MAX_POINTS / 2) / SPECTRUM_BINS_PER_PACKET);
+    TEST_CHECK(bytes <= Spectrum_BytesPerSample(&spectrum) * SPECTRUM_MAX_POINTS);
+
+    // The Hann window halves the tone and spreads half of it on each side
+    TEST_CHECK(abs(magnitudes[0][40] - 8192) < 16);
+    TEST_CHECK(abs(magnitudes[0][39] - 4096) < 16 && abs(magnitudes[0][41] - 4096) < 16);
+    TEST_CHECK(abs(magnitudes[1][120] - 2000) < 16);
+    TEST_CHECK(abs(magnitudes[2][0] - 500) < 4 && abs(magnitudes[2][1] - 250) < 4);
+    for (uint16_t k = 0; k < SPECTRUM_MAX_POINTS / 2; k++)
+    {
+        if (k < 38 || k > 42)
+        {
+            TEST_CHECK(magnitudes[0][k] < 16);
+        }
+    }
+}
+
+static void Test_Peaks(void)
+{
+    static Spectrum spectrum;
+    uint8_t packet[SPECTRUM_MAX_PACKET];
+    TEST_CHECK(Spectrum_Init(&spectrum, SPECTRUM_MIN_LOG2, 2, 100) == NO_ERROR);
+
+    // A second buffer filled before the first one is sent is lost
+    PushTones(&spectrum, SPECTRUM_MIN_LOG2, 20);
+    PushTones(&spectrum, SPECTRUM_MIN_LOG2, 30);
+    TEST_CHECK(spectrum.overruns == 1);
+
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        uint8_t length = Spectrum_Process(&spectrum, packet);
+        TEST_CHECK(packet[0] == SPECTRUM_PEAKS_HEADER && packet[2] == axis);
+        TEST_CHECK(packet[3] == SPECTRUM_MIN_LOG2 && packet[length - 1] == 0xC0);
+        if (axis == 0)
+        {
+            // The tone of the first buffer, the largest first
+            TEST_CHECK(packet[6] >= 1);
+            TEST_CHECK(Get16(&packet[7]) == 20 && abs(Get16(&packet[9]) - 8192) < 16);
+        }
+        else if (axis == 1)
+        {
+            TEST_CHECK(Get16(&packet[7]) == 60);
+        }
+    }
+    TEST_CHECK(Spectrum_Process(&spectrum, packet) == 0);
+
+    // The next buffer gets the next sequence number
+    PushTones(&spectrum, SPECTRUM_MIN_LOG2, 30);
+    TEST_CHECK(Spectrum_Process(&spectrum, packet) != 0);
+    TEST_CHECK(packet[1] == 1 && Get16(&packet[7]) == 30);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_FftAgainstDft);
+    TEST_RUN(Test_FftTone);
+    TEST_RUN(Test_FftTestSignal);
+    TEST_RUN(Test_Bins);
+    TEST_RUN(Test_Peaks);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
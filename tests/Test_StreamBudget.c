@@ -0,0 +1,150 @@
+/*
+* This file includes the tests of the stream budget
+* for each profile, packet format and read path.
+*/
+
+#include "Test.h"
+#include "StreamBudget.h"
+
+#define CONVERTED 14
+#define PACKED 5
+#define COMPRESSED 5
+#define RAW 0
+
+/**
+*   \brief A stream and the plan expected for it.
+*/
+typedef struct {
+    LIS3DH_ProfileIndex profile;
+    uint16_t i2c_khz;
+    uint8_t device_count;
+    uint8_t packet_size;
+    uint16_t output_hz;
+    StreamVerdict verdict;
+    uint8_t use_fifo;
+    uint8_t decimation;
+    uint32_t uart_bytes_per_second;
+} Plan;
+
+/**
+*   \brief UART capacity at 19200 baud: 1920 B/s, 80% of it for the stream.
+*/
+#define UART_CAPACITY 1536
+
+static const Plan Plans[] = {
+    {LIS3DH_PROFILE_POWER_DOWN, 400, 1, CONVERTED, 100, STREAM_REFUSED_ODR, 0, 1, 0},
+
+    // Single samples, up to 100 Hz all of them are sent
+    {LIS3DH_PROFILE_NORMAL_50HZ_ADC, 400, 1, CONVERTED, 100, STREAM_OK, 0, 1, 700},
+    {LIS3DH_PROFILE_NORMAL_100HZ_2G, 400, 1, CONVERTED, 100, STREAM_OK, 0, 1, 1400},
+    {LIS3DH_PROFILE_HIGH_RESOLUTION_100HZ_4G, 400, 1, PACKED, 100, STREAM_OK, 0, 1, 500},
+    {LIS3DH_PROFILE_HIGH_RESOLUTION_100HZ_4G, 400, 1, RAW, 100, STREAM_OK, 0, 1, 900},
+
+    // FIFO batches decimated to 100 Hz: the samples of a single device go
+    // out in the selected format, the raw ones in batches of 24
+    {LIS3DH_PROFILE_STREAM_400HZ_4G, 400, 1, CONVERTED, 100, STREAM_OK, 1, 4, 1400},
+    {LIS3DH_PROFILE_STREAM_400HZ_4G, 400, 1, COMPRESSED, 100, STREAM_OK, 1, 4, 500},
+    {LIS3DH_PROFILE_STREAM_400HZ_4G, 400, 1, RAW, 100, STREAM_OK, 1, 4, 100 * 6 + 16 * 4},
+    {LIS3DH_PROFILE_STREAM_1344HZ_4G, 400, 1, CONVERTED, 100, STREAM_OK, 1, 14, 96 * 14},
+    {LIS3DH_PROFILE_STREAM_1344HZ_4G, 400, 1, RAW, 100, STREAM_OK, 1, 14, 96 * 6 + 56 * 4},
+
+    // Computed on the board: as many samples as the UART carries
+    {LIS3DH_PROFILE_HIGH_RESOLUTION_100HZ_4G, 400, 1, 1, 0, STREAM_OK, 0, 1, 100},
+    {LIS3DH_PROFILE_STREAM_400HZ_4G, 400, 1, CONVERTED, 0, STREAM_OK, 1, 4, 1400},
+
+    // In low-power mode the raw batches carry 3 bytes per sample
+    {LIS3DH_PROFILE_LOW_POWER_5376HZ_4G, 400, 1, RAW, 100, STREAM_OK, 1, 32, 168 * 3 + 224 * 4},
+    {LIS3DH_PROFILE_LOW_POWER_5376HZ_4G, 400, 1, 4, 100, STREAM_OK, 1, 32, 168 * 4},
+    {LIS3DH_PROFILE_LOW_POWER_5376HZ_4G, 400, 1, CONVERTED, 100, STREAM_REFUSED_UART, 1, 1, 168 * 14},
+
+    // The bus must carry every sample, whatever is sent
+    {LIS3DH_PROFILE_LOW_POWER_5376HZ_4G, 100, 1, RAW, 100, STREAM_REFUSED_I2C, 1, 1, 0},
+
+    // More devices: raw samples only, in combined packets or batches
+    {LIS3DH_PROFILE_HIGH_RESOLUTION_100HZ_4G, 400, 2, CONVERTED, 100, STREAM_OK, 0, 1, 100 * 15},
+    {LIS3DH_PROFILE_STREAM_1344HZ_4G, 400, 2, RAW, 100, STREAM_OK, 1, 15, 2 * (89 * 6 + 56 * 4)},
+    {LIS3DH_PROFILE_STREAM_1344HZ_4G, 100, 2, RAW, 100, STREAM_REFUSED_I2C, 1, 1, 0},
+};
+
+static void Test_Plans(void)
+{
+    for (uint8_t i = 0; i < sizeof(Plans) / sizeof(Plans[0]); i++)
+    {
+        const Plan* plan = &Plans[i];
+        StreamBudget budget;
+        ErrorCode error = StreamBudget_Plan(&LIS3DH_Profiles[plan->profile], plan->i2c_khz,
+                                            STREAM_UART_BAUD_RATE, plan->device_count,
+                                            plan->packet_size, plan->output_hz, 1, &budget);
+        TEST_CHECK((error == NO_ERROR) == (plan->verdict == STREAM_OK));
+        TEST_CHECK(budget.verdict == plan->verdict);
+        TEST_CHECK(budget.use_fifo == plan->use_fifo);
+        TEST_CHECK(budget.decimation == plan->decimation);
+        TEST_CHECK(budget.uart_bytes_per_second == plan->uart_bytes_per_second);
+        if (budget.verdict == STREAM_OK)
+        {
+            TEST_CHECK(budget.uart_bytes_per_second <= UART_CAPACITY);
+        }
+    }
+}
+
+static void Test_SourceWithoutInt1(void)
+{
+    StreamBudget budget;
+
+    // Single samples read on the 10 ms timer: 100 Hz at most
+    LIS3DH_Profile profile = LIS3DH_Profiles[LIS3DH_PROFILE_NORMAL_100HZ_2G];
+    TEST_CHECK(StreamBudget_Plan(&profile, 400, STREAM_UART_BAUD_RATE, 1, PACKED, 100, 0, &budget) == NO_ERROR);
+    profile.odr = LIS3DH_ODR_200HZ;
+    TEST_CHECK(StreamBudget_Plan(&profile, 400, STREAM_UART_BAUD_RATE, 1, PACKED, 100, 0, &budget) == ERROR);
+    TEST_CHECK(budget.verdict == STREAM_REFUSED_SOURCE);
+    TEST_CHECK(StreamBudget_Plan(&profile, 400, STREAM_UART_BAUD_RATE, 1, PACKED, 100, 1, &budget) == NO_ERROR);
+
+    // The FIFO must not fill up between two ticks: 4 samples after the
+    // watermark of 24 at 400 Hz, 14 at 1.344 kHz
+    profile = LIS3DH_Profiles[LIS3DH_PROFILE_STREAM_400HZ_4G];
+    TEST_CHECK(StreamBudget_Plan(&profile, 400, STREAM_UART_BAUD_RATE, 1, RAW, 100, 0, &budget) == NO_ERROR);
+    profile = LIS3DH_Profiles[LIS3DH_PROFILE_STREAM_1344HZ_4G];
+    TEST_CHECK(StreamBudget_Plan(&profile, 400, STREAM_UART_BAUD_RATE, 1, RAW, 100, 0, &budget) == ERROR);
+    TEST_CHECK(budget.verdict == STREAM_REFUSED_SOURCE);
+    profile.fifo_watermark = 16;
+    TEST_CHECK(StreamBudget_Plan(&profile, 400, STREAM_UART_BAUD_RATE, 1, RAW, 100, 0, &budget) == NO_ERROR);
+    TEST_CHECK(budget.decimation == 14);
+}
+
+static void Test_ThroughputPerOdr(void)
+{
+    // Sustained throughput of a single device in normal mode, FIFO enabled,
+    // on a 400 kHz bus: raw batches and converted samples
+    LIS3DH_Profile profile = LIS3DH_Profiles[LIS3DH_PROFILE_STREAM_400HZ_4G];
+    for (LIS3DH_Odr odr = LIS3DH_ODR_1HZ; odr <= LIS3DH_ODR_1344HZ; odr++)
+    {
+        if (odr == LIS3DH_ODR_1620HZ)
+        {
+            continue;
+        }
+        profile.odr = odr;
+        StreamBudget raw, converted;
+        TEST_CHECK(StreamBudget_Plan(&profile, 400, STREAM_UART_BAUD_RATE, 1, RAW, 100, 1, &raw) == NO_ERROR);
+        TEST_CHECK(StreamBudget_Plan(&profile, 400, STREAM_UART_BAUD_RATE, 1, CONVERTED, 100, 1, &converted) == NO_ERROR);
+        printf("  %4u Hz: I2C %5lu B/s, raw 1/%u %4lu B/s, converted 1/%u %4lu B/s\n", raw.odr_hz,
+               (unsigned long) raw.i2c_bytes_per_second,
+               raw.decimation, (unsigned long) raw.uart_bytes_per_second,
+               converted.decimation, (unsigned long) converted.uart_bytes_per_second);
+
+        // Never more than 100 samples per second are sent
+        TEST_CHECK(raw.odr_hz / raw.decimation <= 100);
+        TEST_CHECK(converted.odr_hz / converted.decimation <= 100);
+        TEST_CHECK(raw.uart_bytes_per_second <= UART_CAPACITY);
+        TEST_CHECK(converted.uart_bytes_per_second <= UART_CAPACITY);
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(Test_Plans);
+    TEST_RUN(Test_SourceWithoutInt1);
+    TEST_RUN(Test_ThroughputPerOdr);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
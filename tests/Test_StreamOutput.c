@@ -0,0 +1,240 @@
+/*
+* This file includes the tests of the ring buffer of
+* the stream output and of its policies on a full buffer.
+*/
+
+#include <string.h>
+#include "Test.h"
+#include "UART_Simulator.h"
+#include "UART_Debug.h"
+#include "StreamOutput.h"
+#include "Frame.h"
+
+/**
+*   \brief Send a packet whose bytes are all equal to its number.
+*/
+static void SendPacket(uint8_t number, uint8_t length)
+{
+    uint8_t packet[FRAME_MAX_PAYLOAD];
+    memset(packet, number, length);
+    StreamOutput_Send(packet, length);
+}
+
+/**
+*   \brief Send all the queued bytes on the line, as the TX interrupt does.
+*/
+static void Drain(void)
+{
+    uint16_t length;
+    uint16_t previous;
+    do
+    {
+        UART_Simulator_GetLine(&previous);
+        StreamOutput_Transmit();
+        UART_Simulator_Shift(UART_SIMULATOR_FIFO_DEPTH);
+        UART_Simulator_GetLine(&length);
+    } while (length != previous);
+}
+
+/**
+*   \brief Check that the line carries whole packets with consecutive numbers.
+*
+*   \param skip Number of packets before the ones dropped, numbered from 0.
+*   \param first Number of the first packet after the ones dropped.
+*   \param length Number of bytes of each packet.
+*   \retval Number of the last packet on the line.
+*/
+static uint8_t CheckPackets(uint8_t skip, uint8_t first, uint8_t length)
+{
+    uint16_t line_length;
+    const uint8_t* line = UART_Simulator_GetLine(&line_length);
+    TEST_CHECK(line_length % length == 0);
+    uint8_t expected = 0;
+    for (uint16_t offset = 0; offset + length <= line_length; offset += length)
+    {
+        uint16_t index = offset / length;
+        if (index == skip)
+        {
+            expected = first;
+        }
+        for (uint8_t i = 0; i < length; i++)
+        {
+            if (line[offset + i] != expected)
+            {
+                TEST_CHECK(line[offset + i] == expected);
+                return expected;
+            }
+        }
+        expected++;
+    }
+    return (uint8_t)(expected - 1);
+}
+
+static void Test_DropNewest(void)
+{
+    UART_Simulator_Reset();
+    StreamOutput_Start(STREAM_OUTPUT_DROP_NEWEST);
+    StreamOutput_SetFramed(0);
+    TEST_CHECK(StreamOutput_CanSend(10));
+
+    // 102 packets of 10 bytes fill the buffer, the next 48 are discarded
+    for (uint8_t i = 0; i < 150; i++)
+    {
+        SendPacket(i, 10);
+    }
+    TEST_CHECK(!StreamOutput_CanSend(10));
+    TEST_CHECK(StreamOutput_GetOverflowCount() == 48);
+    TEST_CHECK(StreamOutput_GetHighWaterMark() == 1020);
+    TEST_CHECK(UART_Simulator_GetTxInterruptMode() == UART_Debug_TX_STS_FIFO_NOT_FULL);
+
+    Drain();
+    TEST_CHECK(CheckPackets(0, 0, 10) == 101);
+    TEST_CHECK(UART_Simulator_GetTxInterruptMode() == 0);
+}
+
+static void Test_DropOldestWholePackets(void)
+{
+    UART_Simulator_Reset();
+    StreamOutput_Start(STREAM_OUTPUT_DROP_OLDEST);
+    StreamOutput_SetFramed(0);
+
+    // The first 48 packets make room for the last ones
+    for (uint8_t i = 0; i < 150; i++)
+    {
+        SendPacket(i, 10);
+    }
+    TEST_CHECK(StreamOutput_GetOverflowCount() == 48);
+
+    Drain();
+    uint16_t length;
+    UART_Simulator_GetLine(&length);
+    TEST_CHECK(length == 1020);
+    TEST_CHECK(CheckPackets(0, 48, 10) == 149);
+}
+
+static void Test_PacketBeingSentIsNotCut(void)
+{
+    UART_Simulator_Reset();
+    StreamOutput_Start(STREAM_OUTPUT_DROP_OLDEST);
+    StreamOutput_SetFramed(0);
+    for (uint8_t i = 0; i < 100; i++)
+    {
+        SendPacket(i, 10);
+    }
+
+    // Packet 1 is in the middle of its transmission: 13 bytes on the
+    // line, 3 in the FIFO and 4 left in the buffer
+    uint16_t length = 0;
+    while (length < 13)
+    {
+        StreamOutput_Transmit();
+        UART_Simulator_Shift(1);
+        UART_Simulator_GetLine(&length);
+    }
+
+    // The fourth packet does not fit: packet 2 is dropped, not the rest of packet 1
+    for (uint8_t i = 100; i < 104; i++)
+    {
+        SendPacket(i, 10);
+    }
+    TEST_CHECK(StreamOutput_GetOverflowCount() == 1);
+
+    Drain();
+    UART_Simulator_GetLine(&length);
+    TEST_CHECK(length == 1030);
+    TEST_CHECK(CheckPackets(2, 3, 10) == 103);
+}
+
+static void Test_DropOldestFrames(void)
+{
+    UART_Simulator_Reset();
+    StreamOutput_Start(STREAM_OUTPUT_DROP_OLDEST);
+    StreamOutput_SetFramed(1);
+
+    // The link sends 6 bytes while a frame of 28 bytes is queued
+    for (uint8_t i = 0; i < 100; i++)
+    {
+        SendPacket(i, 20);
+        StreamOutput_Transmit();
+        UART_Simulator_Shift(6);
+    }
+    uint16_t dropped = StreamOutput_GetOverflowCount();
+    TEST_CHECK(dropped > 0);
+    Drain();
+
+    // Every frame on the line is valid, the dropped ones are counted as lost
+    uint16_t length;
+    const uint8_t* line = UART_Simulator_GetLine(&length);
+    FrameParser parser;
+    Frame_InitParser(&parser);
+    uint16_t frames = 0;
+    uint8_t previous = 0;
+    for (uint16_t i = 0; i < length; i++)
+    {
+        const uint8_t* payload;
+        uint8_t payload_length;
+        if (Frame_Parse(&parser, line[i], &payload, &payload_length))
+        {
+            TEST_CHECK(payload_length == 20);
+            TEST_CHECK(payload[0] == payload[19]);
+            TEST_CHECK(frames == 0 || payload[0] > previous);
+            previous = payload[0];
+            frames++;
+        }
+    }
+    TEST_CHECK(parser.rejected == 0);
+    TEST_CHECK(parser.lost == dropped);
+    TEST_CHECK(frames + dropped == 100);
+    TEST_CHECK(previous == 99);
+}
+
+static void Test_DropOldestSmallPackets(void)
+{
+    UART_Simulator_Reset();
+    StreamOutput_Start(STREAM_OUTPUT_DROP_OLDEST);
+    StreamOutput_SetFramed(0);
+
+    // The bytes fit, but only the last STREAM_OUTPUT_MAX_PACKETS are remembered
+    for (uint16_t i = 0; i < 200; i++)
+    {
+        SendPacket((uint8_t)i, 2);
+    }
+    TEST_CHECK(StreamOutput_GetOverflowCount() == 200 - STREAM_OUTPUT_MAX_PACKETS);
+
+    Drain();
+    uint16_t length;
+    UART_Simulator_GetLine(&length);
+    TEST_CHECK(length == 2 * STREAM_OUTPUT_MAX_PACKETS);
+    TEST_CHECK(CheckPackets(0, 200 - STREAM_OUTPUT_MAX_PACKETS, 2) == 199);
+}
+
+static void Test_Block(void)
+{
+    UART_Simulator_Reset();
+    UART_Simulator_SetInstant(1);
+    StreamOutput_Start(STREAM_OUTPUT_BLOCK);
+    StreamOutput_SetFramed(0);
+    for (uint8_t i = 0; i < 150; i++)
+    {
+        SendPacket(i, 10);
+    }
+    TEST_CHECK(StreamOutput_GetOverflowCount() == 0);
+    Drain();
+    uint16_t length;
+    UART_Simulator_GetLine(&length);
+    TEST_CHECK(length == 1500);
+    TEST_CHECK(CheckPackets(0, 0, 10) == 149);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_DropNewest);
+    TEST_RUN(Test_DropOldestWholePackets);
+    TEST_RUN(Test_PacketBeingSentIsNotCut);
+    TEST_RUN(Test_DropOldestFrames);
+    TEST_RUN(Test_DropOldestSmallPackets);
+    TEST_RUN(Test_Block);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,151 @@
+/*
+* This file includes the tests of the timestamps,
+* encoded and decoded again as on the host.
+*/
+
+#include "Test.h"
+#include "Timestamp.h"
+
+#define PERIOD_US 10000
+#define SAMPLES 200
+
+/**
+*   \brief Pseudo-random jitter in [-limit, limit] us.
+*/
+static int32_t Jitter(uint32_t* seed, int32_t limit)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return (int32_t)((*seed >> 16) % (2 * limit + 1)) - limit;
+}
+
+/**
+*   \brief Encode and decode a time, check that it comes back within half a step.
+*
+*   \retval Size of the timestamp.
+*/
+static uint8_t RoundTrip(TimestampEncoder* encoder, TimestampDecoder* decoder, uint64_t time_us)
+{
+    uint8_t data[TIMESTAMP_MAX_SIZE];
+    uint64_t decoded = 0;
+    uint8_t length = Timestamp_Encode(encoder, (uint32_t) time_us, data);
+    TEST_CHECK(Timestamp_Decode(decoder, data, &decoded) == length);
+    int64_t error = (int64_t)(decoded - time_us);
+    TEST_CHECK(error >= -TIMESTAMP_UNIT_US / 2 && error <= TIMESTAMP_UNIT_US / 2);
+    if (length == TIMESTAMP_MAX_SIZE)
+    {
+        TEST_CHECK(decoded == time_us);
+    }
+    return length;
+}
+
+static void Test_JitteredSamples(void)
+{
+    TimestampEncoder encoder;
+    TimestampDecoder decoder;
+    Timestamp_InitEncoder(&encoder, PERIOD_US);
+    Timestamp_InitDecoder(&decoder, PERIOD_US);
+
+    // The first time is absolute, then one byte per sample: the errors do
+    // not add up over the stream
+    uint32_t seed = 1;
+    uint64_t time_us = 123456;
+    uint16_t bytes = 0;
+    for (uint16_t n = 0; n < SAMPLES; n++)
+    {
+        uint8_t length = RoundTrip(&encoder, &decoder, time_us + Jitter(&seed, 250));
+        TEST_CHECK(length == ((n == 0) ? TIMESTAMP_MAX_SIZE : 1));
+        bytes += length;
+        time_us += PERIOD_US;
+    }
+    TEST_CHECK(bytes == TIMESTAMP_MAX_SIZE + SAMPLES - 1);
+}
+
+static void Test_ClockWrapsAround(void)
+{
+    TimestampEncoder encoder;
+    TimestampDecoder decoder;
+    Timestamp_InitEncoder(&encoder, PERIOD_US);
+    Timestamp_InitDecoder(&decoder, PERIOD_US);
+
+    // The board clock wraps in the middle of the stream, the decoded time
+    // goes on past 32 bits
+    uint32_t seed = 2;
+    uint64_t time_us = 0xFFFFFFFFull - 50 * PERIOD_US;
+    for (uint16_t n = 0; n < SAMPLES; n++)
+    {
+        uint8_t length = RoundTrip(&encoder, &decoder, time_us + Jitter(&seed, 100));
+        TEST_CHECK(length == ((n == 0) ? TIMESTAMP_MAX_SIZE : 1));
+        time_us += PERIOD_US;
+    }
+    TEST_CHECK(decoder.last_us > 0xFFFFFFFFull);
+
+    // An absolute time after the wrap keeps the upper bits
+    Timestamp_InitEncoder(&encoder, PERIOD_US);
+    TEST_CHECK(RoundTrip(&encoder, &decoder, time_us) == TIMESTAMP_MAX_SIZE);
+    TEST_CHECK(decoder.last_us == time_us);
+
+    // So does an absolute time that comes right after a wrap
+    Timestamp_InitEncoder(&encoder, PERIOD_US);
+    Timestamp_InitDecoder(&decoder, PERIOD_US);
+    TEST_CHECK(RoundTrip(&encoder, &decoder, 0xFFFFFFFFull - 1000) == TIMESTAMP_MAX_SIZE);
+    TEST_CHECK(RoundTrip(&encoder, &decoder, 0x100000000ull + 3 * PERIOD_US) == TIMESTAMP_MAX_SIZE);
+}
+
+static void Test_AbsoluteFallback(void)
+{
+    TimestampEncoder encoder;
+    TimestampDecoder decoder;
+    Timestamp_InitEncoder(&encoder, PERIOD_US);
+    Timestamp_InitDecoder(&decoder, PERIOD_US);
+    uint64_t time_us = 1000000;
+    TEST_CHECK(RoundTrip(&encoder, &decoder, time_us) == TIMESTAMP_MAX_SIZE);
+
+    // The largest jitter that fits in a byte, late and early
+    time_us += PERIOD_US + 127 * TIMESTAMP_UNIT_US;
+    TEST_CHECK(RoundTrip(&encoder, &decoder, time_us) == 1);
+    time_us += PERIOD_US - 127 * TIMESTAMP_UNIT_US;
+    TEST_CHECK(RoundTrip(&encoder, &decoder, time_us) == 1);
+
+    // A step more, or a lost sample, needs the absolute time
+    time_us += PERIOD_US + 128 * TIMESTAMP_UNIT_US;
+    TEST_CHECK(RoundTrip(&encoder, &decoder, time_us) == TIMESTAMP_MAX_SIZE);
+    time_us += 2 * PERIOD_US;
+    TEST_CHECK(RoundTrip(&encoder, &decoder, time_us) == TIMESTAMP_MAX_SIZE);
+    time_us += PERIOD_US - 200 * TIMESTAMP_UNIT_US;
+    TEST_CHECK(RoundTrip(&encoder, &decoder, time_us) == TIMESTAMP_MAX_SIZE);
+
+    // Then the deltas start again from it
+    time_us += PERIOD_US;
+    TEST_CHECK(RoundTrip(&encoder, &decoder, time_us) == 1);
+}
+
+static void Test_DecoderWaitsForAbsolute(void)
+{
+    TimestampEncoder encoder;
+    TimestampDecoder decoder;
+    Timestamp_InitEncoder(&encoder, PERIOD_US);
+    Timestamp_InitDecoder(&decoder, PERIOD_US);
+
+    // A receiver that joins the stream after the absolute time skips the
+    // deltas until the next one, sent after the next stream header
+    uint8_t data[TIMESTAMP_MAX_SIZE];
+    uint64_t decoded = 0;
+    Timestamp_Encode(&encoder, 5000, data);
+    TEST_CHECK(Timestamp_Encode(&encoder, 5000 + PERIOD_US, data) == 1);
+    TEST_CHECK(Timestamp_Decode(&decoder, data, &decoded) == 0);
+
+    Timestamp_InitEncoder(&encoder, PERIOD_US);
+    TEST_CHECK(RoundTrip(&encoder, &decoder, 5000 + 2 * PERIOD_US) == TIMESTAMP_MAX_SIZE);
+    TEST_CHECK(RoundTrip(&encoder, &decoder, 5000 + 3 * PERIOD_US) == 1);
+}
+
+int main(void)
+{
+    TEST_RUN(Test_JitteredSamples);
+    TEST_RUN(Test_ClockWrapsAround);
+    TEST_RUN(Test_AbsoluteFallback);
+    TEST_RUN(Test_DecoderWaitsForAbsolute);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
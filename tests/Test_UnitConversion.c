@@ -0,0 +1,72 @@
+/*
+* This file includes the tests of the Q12 conversion
+* of the LIS3DH output against the float computation.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include "Test.h"
+#include "UnitConversion.h"
+
+/**
+*   \brief Gravity constant used by the float conversion, in m/s^2.
+*/
+#define GRAVITY 9.806
+
+static void Test_ScaleTable(void)
+{
+    // Each Q12 scale is the float sensitivity rounded to the nearest 1/4096
+    for (uint8_t mode = 0; mode < LIS3DH_FORMAT_MODES; mode++)
+    {
+        for (uint8_t fsr = 0; fsr < LIS3DH_FORMAT_RANGES; fsr++)
+        {
+            const LIS3DH_Format* format = LIS3DH_Format_Get(mode, fsr);
+            double scale = format->mg_per_digit * GRAVITY * (1 << UNIT_CONVERSION_Q);
+            TEST_CHECK(format->mm_s2_q12 == lround(scale));
+        }
+    }
+}
+
+static void Test_SweepAgainstFloat(void)
+{
+    for (uint8_t mode = 0; mode < LIS3DH_FORMAT_MODES; mode++)
+    {
+        for (uint8_t fsr = 0; fsr < LIS3DH_FORMAT_RANGES; fsr++)
+        {
+            LIS3DH_Profile profile = {.mode = mode, .fsr = fsr};
+            const LIS3DH_Format* format = LIS3DH_Profile_Format(&profile);
+            UnitConversion raw, milli_g, mm_s2;
+            UnitConversion_Init(&raw, &profile, UNIT_RAW);
+            UnitConversion_Init(&milli_g, &profile, UNIT_MILLI_G);
+            UnitConversion_Init(&mm_s2, &profile, UNIT_MM_PER_S2);
+
+            // Every value of the output registers, also the unused low bits
+            for (int32_t value = INT16_MIN; value <= INT16_MAX; value++)
+            {
+                int16_t counts = (int16_t) value >> format->shift;
+                TEST_CHECK(UnitConversion_Apply(&raw, value) == counts);
+                TEST_CHECK(UnitConversion_Apply(&milli_g, value) == counts * format->mg_per_digit);
+
+                int32_t reference = (int32_t)(counts * format->mg_per_digit * GRAVITY);
+                int32_t converted = UnitConversion_Apply(&mm_s2, value);
+                TEST_CHECK(abs(converted - reference) <= 1);
+
+                // Truncated toward zero, the sign does not change the magnitude
+                if (counts > INT16_MIN >> format->shift)
+                {
+                    int16_t opposite = (int16_t)(-counts * (1 << format->shift));
+                    TEST_CHECK(UnitConversion_Apply(&mm_s2, opposite) == -converted);
+                }
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(Test_ScaleTable);
+    TEST_RUN(Test_SweepAgainstFloat);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,218 @@
+/*
+* This file includes the tests of the window
+* statistics against values computed directly.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include "Test.h"
+#include "WindowStats.h"
+
+#define SIGNAL_LENGTH 4096
+
+static int16_t signal[SIGNAL_LENGTH][3];
+
+/**
+*   \brief Fields of a summary, read back from its bytes.
+*/
+typedef struct {
+    uint8_t sequence;
+    uint16_t window;
+    int16_t mean[3];
+    uint16_t rms[3];
+    int16_t min[3];
+    int16_t max[3];
+    uint16_t peak_to_peak[3];
+    uint8_t crest[3];
+} Summary;
+
+static int16_t Get16(const uint8_t* data)
+{
+    return (int16_t)(data[0] | (data[1] << 8));
+}
+
+static Summary ReadSummary(const uint8_t* frame)
+{
+    Summary summary;
+    TEST_CHECK(frame[0] == WINDOW_STATS_HEADER);
+    TEST_CHECK(frame[WINDOW_STATS_FRAME_SIZE - 1] == 0xC0);
+    summary.sequence = frame[1];
+    summary.window = (uint16_t) Get16(&frame[2]);
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        const uint8_t* data = &frame[4 + 11 * axis];
+        summary.mean[axis] = Get16(&data[0]);
+        summary.rms[axis] = (uint16_t) Get16(&data[2]);
+        summary.min[axis] = Get16(&data[4]);
+        summary.max[axis] = Get16(&data[6]);
+        summary.peak_to_peak[axis] = (uint16_t) Get16(&data[8]);
+        summary.crest[axis] = data[10];
+    }
+    return summary;
+}
+
+/**
+*   \brief Compare a summary with the statistics of the samples first..first+window-1.
+*/
+static void CheckSummary(const Summary* summary, const int16_t (*samples)[3], uint32_t first, uint16_t window)
+{
+    TEST_CHECK(summary->window == window);
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        double sum = 0;
+        double sum_squares = 0;
+        int16_t min = INT16_MAX;
+        int16_t max = INT16_MIN;
+        for (uint16_t i = 0; i < window; i++)
+        {
+            int16_t value = samples[(first + i) % SIGNAL_LENGTH][axis];
+            sum += value;
+            sum_squares += (double) value * value;
+            min = (value < min) ? value : min;
+            max = (value > max) ? value : max;
+        }
+        double mean = sum / window;
+        double rms = sqrt(fmax(sum_squares / window - mean * mean, 0));
+
+        TEST_CHECK(summary->mean[axis] == lround(mean));
+        TEST_CHECK(fabs(summary->rms[axis] - rms) < 1);
+        TEST_CHECK(summary->min[axis] == min && summary->max[axis] == max);
+        TEST_CHECK(summary->peak_to_peak[axis] == (uint16_t)(max - min));
+        if (rms >= 16)
+        {
+            double peak = fmax(max - mean, mean - min);
+            TEST_CHECK(fabs(summary->crest[axis] - fmin(16 * peak / rms, 255)) <= 1.5);
+        }
+    }
+}
+
+/**
+*   \brief Noise around 1 g on Z, with a few full-scale values.
+*/
+static void MakeSignal(void)
+{
+    uint32_t seed = 1;
+    for (uint16_t n = 0; n < SIGNAL_LENGTH; n++)
+    {
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            int16_t noise = (int16_t)((seed >> 16) % 801) - 400;
+            signal[n][axis] = (int16_t)((axis == 2 ? 1000 : 0) + noise * (axis + 1));
+        }
+        if (n % 997 == 500)
+        {
+            signal[n][0] = INT16_MAX;
+            signal[n][1] = INT16_MIN;
+        }
+    }
+}
+
+static void Test_Init(void)
+{
+    WindowStats stats;
+    TEST_CHECK(WindowStats_Init(&stats, 1, 1) == ERROR);
+    TEST_CHECK(WindowStats_Init(&stats, WINDOW_STATS_MAX_WINDOW + 1, WINDOW_STATS_MAX_WINDOW + 1) == ERROR);
+    TEST_CHECK(WindowStats_Init(&stats, 100, 0) == ERROR);
+    TEST_CHECK(WindowStats_Init(&stats, 100, 101) == ERROR);
+    TEST_CHECK(WindowStats_Init(&stats, WINDOW_STATS_MAX_SLIDING + 1, 10) == ERROR);
+    TEST_CHECK(WindowStats_Init(&stats, WINDOW_STATS_MAX_WINDOW, WINDOW_STATS_MAX_WINDOW) == NO_ERROR);
+    TEST_CHECK(WindowStats_Init(&stats, WINDOW_STATS_MAX_SLIDING, 1) == NO_ERROR);
+}
+
+static void Test_KnownValues(void)
+{
+    WindowStats stats;
+    uint8_t frame[WINDOW_STATS_FRAME_SIZE];
+    TEST_CHECK(WindowStats_Init(&stats, 8, 8) == NO_ERROR);
+
+    // A square wave of ±100 mg around 1 g, and a constant
+    uint8_t length = 0;
+    for (uint8_t n = 0; n < 8; n++)
+    {
+        int16_t xyz[3] = {(int16_t)((n & 1) ? 1100 : 900), -250, 0};
+        length = WindowStats_Push(&stats, xyz, frame);
+        TEST_CHECK((length != 0) == (n == 7));
+    }
+    TEST_CHECK(length == WINDOW_STATS_FRAME_SIZE);
+    Summary summary = ReadSummary(frame);
+    TEST_CHECK(summary.sequence == 0);
+    TEST_CHECK(summary.mean[0] == 1000 && summary.rms[0] == 100 && summary.crest[0] == 16);
+    TEST_CHECK(summary.min[0] == 900 && summary.max[0] == 1100 && summary.peak_to_peak[0] == 200);
+    TEST_CHECK(summary.mean[1] == -250 && summary.rms[1] == 0 && summary.crest[1] == 0);
+    TEST_CHECK(summary.peak_to_peak[1] == 0);
+}
+
+static void Test_Tumbling(void)
+{
+    MakeSignal();
+    static const uint16_t windows[] = {400, 1000, WINDOW_STATS_MAX_WINDOW};
+    for (uint8_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++)
+    {
+        WindowStats stats;
+        uint8_t frame[WINDOW_STATS_FRAME_SIZE];
+        TEST_CHECK(WindowStats_Init(&stats, windows[w], windows[w]) == NO_ERROR);
+        uint8_t summaries = 0;
+        for (uint16_t n = 0; n < SIGNAL_LENGTH; n++)
+        {
+            if (WindowStats_Push(&stats, signal[n], frame))
+            {
+                Summary summary = ReadSummary(frame);
+                TEST_CHECK(summary.sequence == summaries);
+                TEST_CHECK((n + 1) % windows[w] == 0);
+                CheckSummary(&summary, signal, n + 1 - windows[w], windows[w]);
+                summaries++;
+            }
+        }
+        TEST_CHECK(summaries == SIGNAL_LENGTH / windows[w]);
+    }
+}
+
+static void Test_Sliding(void)
+{
+    MakeSignal();
+    WindowStats stats;
+    uint8_t frame[WINDOW_STATS_FRAME_SIZE];
+    uint16_t window = WINDOW_STATS_MAX_SLIDING;
+    uint16_t hop = 16;
+    TEST_CHECK(WindowStats_Init(&stats, window, hop) == NO_ERROR);
+
+    // Long enough for the sample positions to wrap around
+    uint32_t summaries = 0;
+    for (uint32_t n = 0; n < 70000; n++)
+    {
+        if (WindowStats_Push(&stats, signal[n % SIGNAL_LENGTH], frame))
+        {
+            Summary summary = ReadSummary(frame);
+            TEST_CHECK(summary.sequence == (uint8_t) summaries);
+            TEST_CHECK(n + 1 >= window && (n + 1 - window) % hop == 0);
+            CheckSummary(&summary, signal, (n + 1 - window) % SIGNAL_LENGTH, window);
+            summaries++;
+        }
+    }
+    TEST_CHECK(summaries == (uint32_t)(70000 - window) / hop + 1);
+
+    // A hop of one gives a summary per sample once the window is full
+    TEST_CHECK(WindowStats_Init(&stats, 5, 1) == NO_ERROR);
+    for (uint16_t n = 0; n < 200; n++)
+    {
+        uint8_t length = WindowStats_Push(&stats, signal[n], frame);
+        TEST_CHECK((length != 0) == (n >= 4));
+        if (length)
+        {
+            Summary summary = ReadSummary(frame);
+            CheckSummary(&summary, signal, n - 4, 5);
+        }
+    }
+}
+
+int main(void)
+{
+    TEST_RUN(Test_Init);
+    TEST_RUN(Test_KnownValues);
+    TEST_RUN(Test_Tumbling);
+    TEST_RUN(Test_Sliding);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
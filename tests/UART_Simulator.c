@@ -0,0 +1,108 @@
+/*
+* This file includes the simulated UART
+* used by the host tests.
+*/
+
+#include "UART_Simulator.h"
+#include "UART_Debug.h"
+#include "string.h"
+
+static uint8_t fifo[UART_SIMULATOR_FIFO_DEPTH];
+static uint8_t fifo_level;
+static uint8_t line[UART_SIMULATOR_LINE_SIZE];
+static uint16_t line_length;
+static uint8_t instant_shift;
+static uint8_t tx_mode;
+
+    void UART_Simulator_Reset(void)
+    {
+        fifo_level = 0;
+        line_length = 0;
+        instant_shift = 0;
+        tx_mode = 0;
+    }
+
+    void UART_Simulator_Shift(uint16_t count)
+    {
+        while (count > 0 && fifo_level > 0)
+        {
+            if (line_length < UART_SIMULATOR_LINE_SIZE)
+            {
+                line[line_length++] = fifo[0];
+            }
+            memmove(fifo, &fifo[1], --fifo_level);
+            count--;
+        }
+    }
+
+    void UART_Simulator_SetInstant(uint8_t instant)
+    {
+        instant_shift = instant;
+    }
+
+    const uint8_t* UART_Simulator_GetLine(uint16_t* length)
+    {
+        *length = line_length;
+        return line;
+    }
+
+    uint8_t UART_Simulator_GetTxInterruptMode(void)
+    {
+        return tx_mode;
+    }
+
+    void UART_Debug_Start(void)
+    {
+    }
+
+    void UART_Debug_PutString(const char string[])
+    {
+        UART_Debug_PutArray((const uint8*)string, (uint8)strlen(string));
+    }
+
+    void UART_Debug_PutArray(const uint8 string[], uint8 byteCount)
+    {
+        // The component waits for room in its buffer
+        for (uint8 i = 0; i < byteCount; i++)
+        {
+            while (!(UART_Debug_ReadTxStatus() & UART_Debug_TX_STS_FIFO_NOT_FULL))
+            {
+                UART_Simulator_Shift(1);
+            }
+            UART_Debug_WriteTxData(string[i]);
+        }
+    }
+
+    uint8 UART_Debug_ReadTxStatus(void)
+    {
+        return fifo_level < UART_SIMULATOR_FIFO_DEPTH ? UART_Debug_TX_STS_FIFO_NOT_FULL : 0;
+    }
+
+    void UART_Debug_WriteTxData(uint8 txDataByte)
+    {
+        if (fifo_level < UART_SIMULATOR_FIFO_DEPTH)
+        {
+            fifo[fifo_level++] = txDataByte;
+        }
+        if (instant_shift)
+        {
+            UART_Simulator_Shift(UART_SIMULATOR_FIFO_DEPTH);
+        }
+    }
+
+    void UART_Debug_SetTxInterruptMode(uint8 intSrc)
+    {
+        tx_mode = intSrc;
+    }
+
+    uint8 UART_Debug_ReadRxStatus(void)
+    {
+        return 0;
+    }
+
+    uint8 UART_Debug_ReadRxData(void)
+    {
+        return 0;
+    }
+
+/* [] END OF FILE */
@@ -0,0 +1,56 @@
+/**
+ * \file UART_Simulator.h
+ * \brief Simulated UART_Debug for the host tests.
+ *
+ * The simulator implements the API of the UART component used by the
+ * stream output and the command channel. The TX FIFO holds 4 bytes, as on
+ * the PSoC, and is emptied on the line only when the test says so, so that
+ * a slow link can be simulated. The bytes put on the line are recorded.
+*/
+
+#ifndef UART_Simulator_H
+    #define UART_Simulator_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Bytes held by the TX FIFO.
+    */
+    #define UART_SIMULATOR_FIFO_DEPTH 4
+
+    /**
+    *   \brief Bytes of the line that are recorded.
+    */
+    #define UART_SIMULATOR_LINE_SIZE 8192
+
+    /**
+    *   \brief Empty the FIFO and the line, disable the automatic sending.
+    */
+    void UART_Simulator_Reset(void);
+
+    /**
+    *   \brief Move bytes from the TX FIFO to the line.
+    *
+    *   \param count Largest number of bytes to be moved.
+    */
+    void UART_Simulator_Shift(uint16_t count);
+
+    /**
+    *   \brief Send each byte on the line as soon as it is written to the FIFO.
+    */
+    void UART_Simulator_SetInstant(uint8_t instant);
+
+    /**
+    *   \brief Bytes put on the line since the reset.
+    *
+    *   \param length Pointer to the variable where the number of bytes is saved.
+    */
+    const uint8_t* UART_Simulator_GetLine(uint16_t* length);
+
+    /**
+    *   \brief TX interrupt sources last enabled.
+    */
+    uint8_t UART_Simulator_GetTxInterruptMode(void);
+
+#endif // UART_Simulator_H
+/* [] END OF FILE */
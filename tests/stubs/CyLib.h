@@ -0,0 +1,17 @@
+/**
+ * \file CyLib.h
+ * \brief Host replacement of the cy_boot delays and critical sections.
+*/
+
+#ifndef CYLIB_H
+    #define CYLIB_H
+    
+    #include "cytypes.h"
+    
+    void CyDelayUs(uint16 microseconds);
+    void CyDelay(uint32 milliseconds);
+    uint8 CyEnterCriticalSection(void);
+    void CyExitCriticalSection(uint8 saved);
+    
+#endif // CYLIB_H
+/* [] END OF FILE */
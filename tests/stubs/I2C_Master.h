@@ -0,0 +1,52 @@
+/**
+ * \file I2C_Master.h
+ * \brief API of the I2C master component, implemented by I2C_Simulator.
+*/
+
+#ifndef I2C_MASTER_H
+    #define I2C_MASTER_H
+    
+    #include "cytypes.h"
+    
+    #define I2C_Master_DATA_RATE 100
+    
+    extern reg8 I2C_Master_CLKDIV1_REG;
+    extern reg8 I2C_Master_CLKDIV2_REG;
+    extern reg8 I2C_Master_CFG_REG;
+    
+    #define I2C_Master_CFG_CLK_RATE_MSK 0x04u
+    #define I2C_Master_CFG_CLK_RATE_100 0x00u
+    #define I2C_Master_CFG_CLK_RATE_400 0x04u
+    
+    #define I2C_Master_MODE_COMPLETE_XFER 0x00u
+    #define I2C_Master_MODE_REPEAT_START 0x01u
+    #define I2C_Master_MODE_NO_STOP 0x02u
+    #define I2C_Master_WRITE_XFER_MODE 0x00u
+    #define I2C_Master_READ_XFER_MODE 0x01u
+    
+    #define I2C_Master_MSTAT_RD_CMPLT 0x01u
+    #define I2C_Master_MSTAT_WR_CMPLT 0x02u
+    #define I2C_Master_MSTAT_XFER_INP 0x04u
+    #define I2C_Master_MSTAT_XFER_HALT 0x08u
+    #define I2C_Master_MSTAT_ERR_SHORT_XFER 0x10u
+    #define I2C_Master_MSTAT_ERR_ADDR_NAK 0x20u
+    #define I2C_Master_MSTAT_ERR_ARB_LOST 0x40u
+    #define I2C_Master_MSTAT_ERR_XFER 0x80u
+    
+    #define I2C_Master_MSTR_NO_ERROR 0x00u
+    #define I2C_Master_MSTR_BUS_BUSY 0x01u
+    #define I2C_Master_MSTR_NOT_READY 0x02u
+    #define I2C_Master_MSTR_ERR_LB_NAK 0x03u
+    
+    void I2C_Master_Start(void);
+    void I2C_Master_Stop(void);
+    void I2C_Master_Init(void);
+    uint8 I2C_Master_MasterSendStart(uint8 slaveAddress, uint8 R_nW);
+    uint8 I2C_Master_MasterSendStop(void);
+    uint8 I2C_Master_MasterStatus(void);
+    uint8 I2C_Master_MasterClearStatus(void);
+    uint8 I2C_Master_MasterWriteBuf(uint8 slaveAddress, uint8* wrData, uint8 cnt, uint8 mode);
+    uint8 I2C_Master_MasterReadBuf(uint8 slaveAddress, uint8* rdData, uint8 cnt, uint8 mode);
+    
+#endif // I2C_MASTER_H
+/* [] END OF FILE */
@@ -0,0 +1,19 @@
+/**
+ * \file SCL_1.h
+ * \brief API of the SCL_1 pin, implemented by I2C_Simulator.
+*/
+
+#ifndef SCL_1_H
+    #define SCL_1_H
+    
+    #include "cytypes.h"
+    
+    #define SCL_1_MASK 0x01u
+    
+    extern reg8 SCL_1_BYP;
+    
+    uint8 SCL_1_Read(void);
+    void SCL_1_Write(uint8 value);
+    
+#endif // SCL_1_H
+/* [] END OF FILE */
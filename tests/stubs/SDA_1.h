@@ -0,0 +1,19 @@
+/**
+ * \file SDA_1.h
+ * \brief API of the SDA_1 pin, implemented by I2C_Simulator.
+*/
+
+#ifndef SDA_1_H
+    #define SDA_1_H
+    
+    #include "cytypes.h"
+    
+    #define SDA_1_MASK 0x01u
+    
+    extern reg8 SDA_1_BYP;
+    
+    uint8 SDA_1_Read(void);
+    void SDA_1_Write(uint8 value);
+    
+#endif // SDA_1_H
+/* [] END OF FILE */
@@ -0,0 +1,24 @@
+/**
+ * \file UART_Debug.h
+ * \brief API of the UART component, implemented by UART_Simulator.
+*/
+
+#ifndef UART_DEBUG_H
+    #define UART_DEBUG_H
+    
+    #include "cytypes.h"
+    
+    #define UART_Debug_TX_STS_FIFO_NOT_FULL 0x08u
+    #define UART_Debug_RX_STS_FIFO_NOTEMPTY 0x20u
+    
+    void UART_Debug_Start(void);
+    void UART_Debug_PutString(const char string[]);
+    void UART_Debug_PutArray(const uint8 string[], uint8 byteCount);
+    uint8 UART_Debug_ReadTxStatus(void);
+    void UART_Debug_WriteTxData(uint8 txDataByte);
+    void UART_Debug_SetTxInterruptMode(uint8 intSrc);
+    uint8 UART_Debug_ReadRxStatus(void);
+    uint8 UART_Debug_ReadRxData(void);
+    
+#endif // UART_DEBUG_H
+/* [] END OF FILE */
@@ -0,0 +1,21 @@
+/**
+ * \file cyfitter.h
+ * \brief Host replacement of the clocks and components of the schematic.
+*/
+
+#ifndef CYFITTER_H
+    #define CYFITTER_H
+    
+    #include "cytypes.h"
+    
+    #define BCLK__BUS_CLK__KHZ 24000
+    #define BCLK__BUS_CLK__MHZ 24
+    
+    /**
+    *   \brief Cycle counter of the core, advanced by the simulated bus.
+    */
+    extern volatile uint32_t I2C_Simulator_Cycles;
+    #define CYCLE_COUNTER_DWT_CYCCNT_REG I2C_Simulator_Cycles
+    
+#endif // CYFITTER_H
+/* [] END OF FILE */
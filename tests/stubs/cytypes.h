@@ -0,0 +1,27 @@
+/**
+ * \file cytypes.h
+ * \brief Host replacement of the PSoC Creator base types.
+*/
+
+#ifndef CYTYPES_H
+    #define CYTYPES_H
+    
+    #include <stdint.h>
+    #include <stddef.h>
+    
+    typedef uint8_t uint8;
+    typedef uint16_t uint16;
+    typedef uint32_t uint32;
+    typedef int8_t int8;
+    typedef int16_t int16;
+    typedef int32_t int32;
+    typedef float float32;
+    typedef volatile uint8 reg8;
+    typedef void (*cyisraddress)(void);
+    
+    #define CY_ISR(name) void name(void)
+    #define CY_ISR_PROTO(name) void name(void)
+    #define CY_ALIGN(align) __attribute__((aligned(align)))
+    
+#endif // CYTYPES_H
+/* [] END OF FILE */